@@ -34,6 +34,17 @@ extern "C" JNIEXPORT void JNICALL Java_JniPerfBenchmark_perfSOAUncheckedCall(JNI
   ScopedObjectAccessUnchecked soa(Thread::Current());
 }
 
+extern "C" JNIEXPORT jint JNICALL Java_JniPerfBenchmark_perfJniStaticIntCall(
+    JNIEnv*, jclass, jint a, jint b) {
+  return a + b;
+}
+
+// Critical natives are passed a null jclass and must not use their JNIEnv*.
+extern "C" JNIEXPORT jint JNICALL Java_JniPerfBenchmark_perfJniCriticalIntCall(
+    JNIEnv*, jclass, jint a, jint b) {
+  return a + b;
+}
+
 }  // namespace
 
 }  // namespace art
@@ -15,6 +15,7 @@
  */
 
 import com.google.caliper.SimpleBenchmark;
+import dalvik.annotation.optimization.CriticalNative;
 
 public class JniPerfBenchmark extends SimpleBenchmark {
   private static final String MSG = "ABCDE";
@@ -22,6 +23,9 @@ public class JniPerfBenchmark extends SimpleBenchmark {
   native void perfJniEmptyCall();
   native void perfSOACall();
   native void perfSOAUncheckedCall();
+  static native int perfJniStaticIntCall(int a, int b);
+  @CriticalNative
+  static native int perfJniCriticalIntCall(int a, int b);
 
   public void timeFastJNI(int N) {
     // TODO: This might be an intrinsic.
@@ -48,6 +52,21 @@ public class JniPerfBenchmark extends SimpleBenchmark {
     }
   }
 
+  public void timeStaticIntCall(int N) {
+    int sum = 0;
+    for (int i = 0; i < N; i++) {
+      sum = perfJniStaticIntCall(sum, i);
+    }
+  }
+
+  // Same call as timeStaticIntCall, without the thread state transitions in the JNI stub.
+  public void timeCriticalIntCall(int N) {
+    int sum = 0;
+    for (int i = 0; i < N; i++) {
+      sum = perfJniCriticalIntCall(sum, i);
+    }
+  }
+
   {
     System.loadLibrary("artbenchmark");
   }
@@ -17,6 +17,9 @@
 import com.google.caliper.SimpleBenchmark;
 
 public class JObjectBenchmark extends SimpleBenchmark {
+  // Number of threads adding and removing references at the same time in the contended variants.
+  private static final int NUM_CONTENDED_THREADS = 4;
+
   public JObjectBenchmark() {
     // Make sure to link methods before benchmark starts.
     System.loadLibrary("artbenchmark");
@@ -36,4 +39,33 @@ public class JObjectBenchmark extends SimpleBenchmark {
   public native void timeAddRemoveWeakGlobal(int reps);
   public native void timeDecodeWeakGlobal(int reps);
   public native void timeDecodeHandleScopeRef(int reps);
+
+  // Each thread does all the repetitions, so a rep is NUM_CONTENDED_THREADS concurrent adds and
+  // removes.
+  public void timeAddRemoveGlobalContended(final int reps) throws InterruptedException {
+    runOnThreads(new Runnable() {
+      public void run() {
+        timeAddRemoveGlobal(reps);
+      }
+    });
+  }
+
+  public void timeAddRemoveWeakGlobalContended(final int reps) throws InterruptedException {
+    runOnThreads(new Runnable() {
+      public void run() {
+        timeAddRemoveWeakGlobal(reps);
+      }
+    });
+  }
+
+  private static void runOnThreads(Runnable runnable) throws InterruptedException {
+    Thread[] threads = new Thread[NUM_CONTENDED_THREADS];
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i] = new Thread(runnable);
+      threads[i].start();
+    }
+    for (Thread thread : threads) {
+      thread.join();
+    }
+  }
 }
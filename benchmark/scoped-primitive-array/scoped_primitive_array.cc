@@ -56,3 +56,15 @@ extern "C" JNIEXPORT jlong JNICALL Java_ScopedPrimitiveArrayBenchmark_measureLon
   }
   return ret;
 }
+
+extern "C" JNIEXPORT jlong JNICALL Java_ScopedPrimitiveArrayBenchmark_measureByteArrayCritical(
+    JNIEnv* env, jclass, int reps, jbyteArray arr) {
+  jlong ret = 0;
+  for (jint i = 0; i < reps; ++i) {
+    jsize size = env->GetArrayLength(arr);
+    jbyte* elements = static_cast<jbyte*>(env->GetPrimitiveArrayCritical(arr, nullptr));
+    ret += elements[0] + elements[size - 1];
+    env->ReleasePrimitiveArrayCritical(arr, elements, JNI_ABORT);
+  }
+  return ret;
+}
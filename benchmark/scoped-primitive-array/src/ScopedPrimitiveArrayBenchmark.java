@@ -22,13 +22,17 @@ public class ScopedPrimitiveArrayBenchmark extends SimpleBenchmark {
   static native long measureShortArray(int reps, short[] arr);
   static native long measureIntArray(int reps, int[] arr);
   static native long measureLongArray(int reps, long[] arr);
+  // Same as measureByteArray, with GetPrimitiveArrayCritical instead of ScopedPrimitiveArray.
+  static native long measureByteArrayCritical(int reps, byte[] arr);
 
   static final int smallLength = 16;
   static final int mediumLength = 256;
   static final int largeLength = 8096;
+  static final int hugeLength = 10 * 1024 * 1024;
   static byte[] smallBytes = new byte[smallLength];
   static byte[] mediumBytes = new byte[mediumLength];
   static byte[] largeBytes = new byte[largeLength];
+  static byte[] hugeBytes = new byte[hugeLength];
   static short[] smallShorts = new short[smallLength];
   static short[] mediumShorts = new short[mediumLength];
   static short[] largeShorts = new short[largeLength];
@@ -51,6 +55,22 @@ public class ScopedPrimitiveArrayBenchmark extends SimpleBenchmark {
     measureByteArray(reps, largeBytes);
   }
 
+  public void timeHugeBytes(int reps) {
+    measureByteArray(reps, hugeBytes);
+  }
+
+  public void timeSmallBytesCritical(int reps) {
+    measureByteArrayCritical(reps, smallBytes);
+  }
+
+  public void timeLargeBytesCritical(int reps) {
+    measureByteArrayCritical(reps, largeBytes);
+  }
+
+  public void timeHugeBytesCritical(int reps) {
+    measureByteArrayCritical(reps, hugeBytes);
+  }
+
   public void timeSmallShorts(int reps) {
     measureShortArray(reps, smallShorts);
   }
@@ -16,6 +16,9 @@
 
 #include "compiler_driver.h"
 
+#include <algorithm>
+#include <functional>
+#include <numeric>
 #include <unordered_set>
 #include <vector>
 #include <unistd.h>
@@ -85,6 +88,11 @@ static constexpr bool kRestrictCompilationFiltersToImage = true;
 // Print additional info during profile guided compilation.
 static constexpr bool kDebugProfileGuidedCompilation = false;
 
+// The dex files compiled by one phase, after which the arena pool memory is reclaimed. Bounds the
+// peak arena memory by that of a batch rather than of the whole app. A larger dex file is a batch
+// of its own.
+static constexpr size_t kCompileBatchDexBytes = 16 * MB;
+
 static double Percentage(size_t x, size_t y) {
   return 100.0 * (static_cast<double>(x)) / (static_cast<double>(x + y));
 }
@@ -759,6 +767,224 @@ void CompilerDriver::CompileOne(Thread* self, ArtMethod* method, TimingLogger* t
   self->GetJniEnv()->DeleteGlobalRef(jclass_loader);
 }
 
+class CompilationVisitor {
+ public:
+  virtual ~CompilationVisitor() {}
+  virtual void Visit(size_t index) = 0;
+};
+
+class ParallelCompilationManager {
+ public:
+  ParallelCompilationManager(ClassLinker* class_linker,
+                             jobject class_loader,
+                             CompilerDriver* compiler,
+                             const DexFile* dex_file,
+                             const std::vector<const DexFile*>& dex_files)
+    : class_linker_(class_linker),
+      class_loader_(class_loader),
+      compiler_(compiler),
+      dex_file_(dex_file),
+      dex_files_(dex_files) {}
+
+  ClassLinker* GetClassLinker() const {
+    CHECK(class_linker_ != nullptr);
+    return class_linker_;
+  }
+
+  jobject GetClassLoader() const {
+    return class_loader_;
+  }
+
+  CompilerDriver* GetCompiler() const {
+    CHECK(compiler_ != nullptr);
+    return compiler_;
+  }
+
+  const DexFile* GetDexFile() const {
+    CHECK(dex_file_ != nullptr);
+    return dex_file_;
+  }
+
+  const std::vector<const DexFile*>& GetDexFiles() const {
+    return dex_files_;
+  }
+
+ private:
+  ClassLinker* const class_linker_;
+  const jobject class_loader_;
+  CompilerDriver* const compiler_;
+  const DexFile* const dex_file_;
+  const std::vector<const DexFile*>& dex_files_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelCompilationManager);
+};
+
+// Runs the work of a compilation phase for all the dex files with a single start and wait of the
+// thread pool, instead of one per dex file, so that threads do not idle while the last classes of
+// each dex file are processed. The work items are claimed in the order they were added: a single
+// thread visits them in the same order as separate passes over each dex file would. With several
+// threads, items with an estimated cost are claimed costliest first, so that a few big classes
+// do not leave a single thread working at the end of the phase.
+class ParallelCompilationPhase {
+ public:
+  // Returns the estimated cost of visiting an item.
+  typedef std::function<size_t(size_t)> CostFunction;
+
+  ParallelCompilationPhase(CompilerDriver* compiler,
+                           const char* name,
+                           ThreadPool* thread_pool,
+                           size_t thread_count)
+    : compiler_(compiler),
+      name_(name),
+      thread_pool_(thread_pool),
+      thread_count_(thread_count),
+      num_items_(0),
+      index_(0),
+      busy_ns_(0) {}
+
+  // Returns a context for the visitors of the items of `dex_file`. Owned by the phase.
+  ParallelCompilationManager* NewContext(jobject class_loader,
+                                         const DexFile* dex_file,
+                                         const std::vector<const DexFile*>& dex_files) {
+    contexts_.emplace_back(new ParallelCompilationManager(Runtime::Current()->GetClassLinker(),
+                                                          class_loader,
+                                                          compiler_,
+                                                          dex_file,
+                                                          dex_files));
+    return contexts_.back().get();
+  }
+
+  // Adds the visits of the items [begin, end), after those added before. Takes ownership of the
+  // visitor. Items without a cost function have no cost, and are visited last.
+  void Add(CompilationVisitor* visitor,
+           size_t begin,
+           size_t end,
+           const CostFunction& cost_function = nullptr) {
+    visitors_.emplace_back(visitor);
+    if (begin < end) {
+      ranges_.push_back(WorkRange { visitor, begin, num_items_ });
+      if (cost_function != nullptr && thread_count_ > 1u) {
+        costs_.resize(num_items_, 0u);
+        for (size_t index = begin; index != end; ++index) {
+          costs_.push_back(cost_function(index));
+        }
+      }
+      num_items_ += end - begin;
+    }
+  }
+
+  void Run(TimingLogger* timings) REQUIRES(!*Locks::mutator_lock_) {
+    TimingLogger::ScopedTiming t(name_, timings);
+    Thread* self = Thread::Current();
+    self->AssertNoPendingException();
+    CHECK_GT(thread_count_, 0U);
+
+    if (!costs_.empty()) {
+      costs_.resize(num_items_, 0u);
+      order_.resize(num_items_);
+      std::iota(order_.begin(), order_.end(), 0u);
+      // Stable, so that items of equal cost keep their order.
+      std::stable_sort(order_.begin(), order_.end(), [this](size_t lhs, size_t rhs) {
+        return costs_[lhs] > costs_[rhs];
+      });
+    }
+
+    const uint64_t start_ns = NanoTime();
+    for (size_t i = 0; i < thread_count_; ++i) {
+      thread_pool_->AddTask(self, new ForAllClosure(this));
+    }
+    thread_pool_->StartWorkers(self);
+
+    // Ensure we're suspended while we're blocked waiting for the other threads to finish (worker
+    // thread destructor's called below perform join).
+    CHECK_NE(self->GetState(), kRunnable);
+
+    // Wait for all the worker threads to finish.
+    thread_pool_->Wait(self, true, false);
+
+    // And stop the workers accepting jobs.
+    thread_pool_->StopWorkers(self);
+
+    compiler_->RecordPhaseUtilization(name_,
+                                      thread_count_,
+                                      num_items_,
+                                      NanoTime() - start_ns,
+                                      busy_ns_.LoadRelaxed());
+  }
+
+ private:
+  // The phase items [first_item, first_item + end - begin) are the items [begin, end) of visitor.
+  struct WorkRange {
+    CompilationVisitor* visitor;
+    size_t begin;
+    size_t first_item;
+  };
+
+  size_t NextItem() {
+    return index_.FetchAndAddSequentiallyConsistent(1);
+  }
+
+  void Visit(size_t item) {
+    if (!order_.empty()) {
+      item = order_[item];
+    }
+    // The range is the last one starting at or before the item.
+    auto it = std::upper_bound(ranges_.begin(),
+                               ranges_.end(),
+                               item,
+                               [](size_t i, const WorkRange& range) {
+                                 return i < range.first_item;
+                               });
+    DCHECK(it != ranges_.begin());
+    --it;
+    it->visitor->Visit(it->begin + (item - it->first_item));
+  }
+
+  class ForAllClosure : public Task {
+   public:
+    explicit ForAllClosure(ParallelCompilationPhase* phase) : phase_(phase) {}
+
+    virtual void Run(Thread* self) {
+      // A task is busy from its start until no item is left, the rest of the phase is time spent
+      // starting up or waiting for the last items of the other threads.
+      const uint64_t start_ns = NanoTime();
+      while (true) {
+        const size_t item = phase_->NextItem();
+        if (UNLIKELY(item >= phase_->num_items_)) {
+          break;
+        }
+        phase_->Visit(item);
+        self->AssertNoPendingException();
+      }
+      phase_->busy_ns_.FetchAndAddRelaxed(NanoTime() - start_ns);
+    }
+
+    virtual void Finalize() {
+      delete this;
+    }
+
+   private:
+    ParallelCompilationPhase* const phase_;
+  };
+
+  CompilerDriver* const compiler_;
+  const char* const name_;
+  ThreadPool* const thread_pool_;
+  const size_t thread_count_;
+  std::vector<std::unique_ptr<ParallelCompilationManager>> contexts_;
+  std::vector<std::unique_ptr<CompilationVisitor>> visitors_;
+  std::vector<WorkRange> ranges_;
+  // Estimated cost of the items, empty if none was given or the phase is single threaded.
+  std::vector<size_t> costs_;
+  // The items by decreasing cost, if there are costs.
+  std::vector<size_t> order_;
+  size_t num_items_;
+  AtomicInteger index_;
+  Atomic<uint64_t> busy_ns_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelCompilationPhase);
+};
+
 void CompilerDriver::Resolve(jobject class_loader,
                              const std::vector<const DexFile*>& dex_files,
                              TimingLogger* timings) {
@@ -769,16 +995,13 @@ void CompilerDriver::Resolve(jobject class_loader,
                                      : parallel_thread_pool_.get();
   size_t resolve_thread_count = force_determinism ? 1U : parallel_thread_count_;
 
+  ParallelCompilationPhase phase(this, "Resolve", resolve_thread_pool, resolve_thread_count);
   for (size_t i = 0; i != dex_files.size(); ++i) {
     const DexFile* dex_file = dex_files[i];
     CHECK(dex_file != nullptr);
-    ResolveDexFile(class_loader,
-                   *dex_file,
-                   dex_files,
-                   resolve_thread_pool,
-                   resolve_thread_count,
-                   timings);
+    ResolveDexFile(class_loader, *dex_file, dex_files, &phase);
   }
+  phase.Run(timings);
 }
 
 // Resolve const-strings in the code. Done to have deterministic allocation behavior. Right now
@@ -1854,118 +2077,6 @@ bool CompilerDriver::IsSafeCast(const DexCompilationUnit* mUnit, uint32_t dex_pc
   return result;
 }
 
-class CompilationVisitor {
- public:
-  virtual ~CompilationVisitor() {}
-  virtual void Visit(size_t index) = 0;
-};
-
-class ParallelCompilationManager {
- public:
-  ParallelCompilationManager(ClassLinker* class_linker,
-                             jobject class_loader,
-                             CompilerDriver* compiler,
-                             const DexFile* dex_file,
-                             const std::vector<const DexFile*>& dex_files,
-                             ThreadPool* thread_pool)
-    : index_(0),
-      class_linker_(class_linker),
-      class_loader_(class_loader),
-      compiler_(compiler),
-      dex_file_(dex_file),
-      dex_files_(dex_files),
-      thread_pool_(thread_pool) {}
-
-  ClassLinker* GetClassLinker() const {
-    CHECK(class_linker_ != nullptr);
-    return class_linker_;
-  }
-
-  jobject GetClassLoader() const {
-    return class_loader_;
-  }
-
-  CompilerDriver* GetCompiler() const {
-    CHECK(compiler_ != nullptr);
-    return compiler_;
-  }
-
-  const DexFile* GetDexFile() const {
-    CHECK(dex_file_ != nullptr);
-    return dex_file_;
-  }
-
-  const std::vector<const DexFile*>& GetDexFiles() const {
-    return dex_files_;
-  }
-
-  void ForAll(size_t begin, size_t end, CompilationVisitor* visitor, size_t work_units)
-      REQUIRES(!*Locks::mutator_lock_) {
-    Thread* self = Thread::Current();
-    self->AssertNoPendingException();
-    CHECK_GT(work_units, 0U);
-
-    index_.StoreRelaxed(begin);
-    for (size_t i = 0; i < work_units; ++i) {
-      thread_pool_->AddTask(self, new ForAllClosure(this, end, visitor));
-    }
-    thread_pool_->StartWorkers(self);
-
-    // Ensure we're suspended while we're blocked waiting for the other threads to finish (worker
-    // thread destructor's called below perform join).
-    CHECK_NE(self->GetState(), kRunnable);
-
-    // Wait for all the worker threads to finish.
-    thread_pool_->Wait(self, true, false);
-
-    // And stop the workers accepting jobs.
-    thread_pool_->StopWorkers(self);
-  }
-
-  size_t NextIndex() {
-    return index_.FetchAndAddSequentiallyConsistent(1);
-  }
-
- private:
-  class ForAllClosure : public Task {
-   public:
-    ForAllClosure(ParallelCompilationManager* manager, size_t end, CompilationVisitor* visitor)
-        : manager_(manager),
-          end_(end),
-          visitor_(visitor) {}
-
-    virtual void Run(Thread* self) {
-      while (true) {
-        const size_t index = manager_->NextIndex();
-        if (UNLIKELY(index >= end_)) {
-          break;
-        }
-        visitor_->Visit(index);
-        self->AssertNoPendingException();
-      }
-    }
-
-    virtual void Finalize() {
-      delete this;
-    }
-
-   private:
-    ParallelCompilationManager* const manager_;
-    const size_t end_;
-    CompilationVisitor* const visitor_;
-  };
-
-  AtomicInteger index_;
-  ClassLinker* const class_linker_;
-  const jobject class_loader_;
-  CompilerDriver* const compiler_;
-  const DexFile* const dex_file_;
-  const std::vector<const DexFile*>& dex_files_;
-  ThreadPool* const thread_pool_;
-
-  DISALLOW_COPY_AND_ASSIGN(ParallelCompilationManager);
-};
-
 // A fast version of SkipClass above if the class pointer is available
 // that avoids the expensive FindInClassPath search.
 static bool SkipClass(jobject class_loader, const DexFile& dex_file, mirror::Class* klass)
@@ -2182,42 +2293,33 @@ class ResolveTypeVisitor : public CompilationVisitor {
 void CompilerDriver::ResolveDexFile(jobject class_loader,
                                     const DexFile& dex_file,
                                     const std::vector<const DexFile*>& dex_files,
-                                    ThreadPool* thread_pool,
-                                    size_t thread_count,
-                                    TimingLogger* timings) {
-  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-
+                                    ParallelCompilationPhase* phase) {
   // TODO: we could resolve strings here, although the string table is largely filled with class
   //       and method names.
 
-  ParallelCompilationManager context(class_linker, class_loader, this, &dex_file, dex_files,
-                                     thread_pool);
+  ParallelCompilationManager* context = phase->NewContext(class_loader, &dex_file, dex_files);
   if (IsBootImage()) {
     // For images we resolve all types, such as array, whereas for applications just those with
     // classdefs are resolved by ResolveClassFieldsAndMethods.
-    TimingLogger::ScopedTiming t("Resolve Types", timings);
-    ResolveTypeVisitor visitor(&context);
-    context.ForAll(0, dex_file.NumTypeIds(), &visitor, thread_count);
+    phase->Add(new ResolveTypeVisitor(context), 0, dex_file.NumTypeIds());
   }
 
-  TimingLogger::ScopedTiming t("Resolve MethodsAndFields", timings);
-  ResolveClassFieldsAndMethodsVisitor visitor(&context);
-  context.ForAll(0, dex_file.NumClassDefs(), &visitor, thread_count);
+  phase->Add(new ResolveClassFieldsAndMethodsVisitor(context), 0, dex_file.NumClassDefs());
 }
 
 void CompilerDriver::SetVerified(jobject class_loader,
                                  const std::vector<const DexFile*>& dex_files,
                                  TimingLogger* timings) {
   // This can be run in parallel.
+  ParallelCompilationPhase phase(this,
+                                 "Set Verified Dex Files",
+                                 parallel_thread_pool_.get(),
+                                 parallel_thread_count_);
   for (const DexFile* dex_file : dex_files) {
     CHECK(dex_file != nullptr);
-    SetVerifiedDexFile(class_loader,
-                       *dex_file,
-                       dex_files,
-                       parallel_thread_pool_.get(),
-                       parallel_thread_count_,
-                       timings);
+    SetVerifiedDexFile(class_loader, *dex_file, dex_files, &phase);
   }
+  phase.Run(timings);
 }
 
 void CompilerDriver::Verify(jobject class_loader,
@@ -2226,15 +2328,15 @@ void CompilerDriver::Verify(jobject class_loader,
   // Note: verification should not be pulling in classes anymore when compiling the boot image,
   //       as all should have been resolved before. As such, doing this in parallel should still
   //       be deterministic.
+  ParallelCompilationPhase phase(this,
+                                 "Verify Dex Files",
+                                 parallel_thread_pool_.get(),
+                                 parallel_thread_count_);
   for (const DexFile* dex_file : dex_files) {
     CHECK(dex_file != nullptr);
-    VerifyDexFile(class_loader,
-                  *dex_file,
-                  dex_files,
-                  parallel_thread_pool_.get(),
-                  parallel_thread_count_,
-                  timings);
+    VerifyDexFile(class_loader, *dex_file, dex_files, &phase);
   }
+  phase.Run(timings);
 }
 
 class VerifyClassVisitor : public CompilationVisitor {
@@ -2316,18 +2418,12 @@ class VerifyClassVisitor : public CompilationVisitor {
 void CompilerDriver::VerifyDexFile(jobject class_loader,
                                    const DexFile& dex_file,
                                    const std::vector<const DexFile*>& dex_files,
-                                   ThreadPool* thread_pool,
-                                   size_t thread_count,
-                                   TimingLogger* timings) {
-  TimingLogger::ScopedTiming t("Verify Dex File", timings);
-  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  ParallelCompilationManager context(class_linker, class_loader, this, &dex_file, dex_files,
-                                     thread_pool);
+                                   ParallelCompilationPhase* phase) {
+  ParallelCompilationManager* context = phase->NewContext(class_loader, &dex_file, dex_files);
   LogSeverity log_level = GetCompilerOptions().AbortOnHardVerifierFailure()
                               ? LogSeverity::INTERNAL_FATAL
                               : LogSeverity::WARNING;
-  VerifyClassVisitor visitor(&context, log_level);
-  context.ForAll(0, dex_file.NumClassDefs(), &visitor, thread_count);
+  phase->Add(new VerifyClassVisitor(context, log_level), 0, dex_file.NumClassDefs());
 }
 
 class SetVerifiedClassVisitor : public CompilationVisitor {
@@ -2380,15 +2476,9 @@ class SetVerifiedClassVisitor : public CompilationVisitor {
 void CompilerDriver::SetVerifiedDexFile(jobject class_loader,
                                         const DexFile& dex_file,
                                         const std::vector<const DexFile*>& dex_files,
-                                        ThreadPool* thread_pool,
-                                        size_t thread_count,
-                                        TimingLogger* timings) {
-  TimingLogger::ScopedTiming t("Verify Dex File", timings);
-  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  ParallelCompilationManager context(class_linker, class_loader, this, &dex_file, dex_files,
-                                     thread_pool);
-  SetVerifiedClassVisitor visitor(&context);
-  context.ForAll(0, dex_file.NumClassDefs(), &visitor, thread_count);
+                                        ParallelCompilationPhase* phase) {
+  ParallelCompilationManager* context = phase->NewContext(class_loader, &dex_file, dex_files);
+  phase->Add(new SetVerifiedClassVisitor(context), 0, dex_file.NumClassDefs());
 }
 
 class InitializeClassVisitor : public CompilationVisitor {
@@ -2492,25 +2582,9 @@ class InitializeClassVisitor : public CompilationVisitor {
 void CompilerDriver::InitializeClasses(jobject jni_class_loader,
                                        const DexFile& dex_file,
                                        const std::vector<const DexFile*>& dex_files,
-                                       TimingLogger* timings) {
-  TimingLogger::ScopedTiming t("InitializeNoClinit", timings);
-
-  // Initialization allocates objects and needs to run single-threaded to be deterministic.
-  bool force_determinism = GetCompilerOptions().IsForceDeterminism();
-  ThreadPool* init_thread_pool = force_determinism
-                                     ? single_thread_pool_.get()
-                                     : parallel_thread_pool_.get();
-  size_t init_thread_count = force_determinism ? 1U : parallel_thread_count_;
-
-  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  ParallelCompilationManager context(class_linker, jni_class_loader, this, &dex_file, dex_files,
-                                     init_thread_pool);
-  if (IsBootImage()) {
-    // TODO: remove this when transactional mode supports multithreading.
-    init_thread_count = 1U;
-  }
-  InitializeClassVisitor visitor(&context);
-  context.ForAll(0, dex_file.NumClassDefs(), &visitor, init_thread_count);
+                                       ParallelCompilationPhase* phase) {
+  ParallelCompilationManager* context = phase->NewContext(jni_class_loader, &dex_file, dex_files);
+  phase->Add(new InitializeClassVisitor(context), 0, dex_file.NumClassDefs());
 }
 
 class InitializeArrayClassesAndCreateConflictTablesVisitor : public ClassVisitor {
@@ -2554,11 +2628,23 @@ class InitializeArrayClassesAndCreateConflictTablesVisitor : public ClassVisitor
 void CompilerDriver::InitializeClasses(jobject class_loader,
                                        const std::vector<const DexFile*>& dex_files,
                                        TimingLogger* timings) {
+  // Initialization allocates objects and needs to run single-threaded to be deterministic.
+  bool force_determinism = GetCompilerOptions().IsForceDeterminism();
+  ThreadPool* init_thread_pool = force_determinism
+                                     ? single_thread_pool_.get()
+                                     : parallel_thread_pool_.get();
+  size_t init_thread_count = force_determinism ? 1U : parallel_thread_count_;
+  if (IsBootImage()) {
+    // TODO: remove this when transactional mode supports multithreading.
+    init_thread_count = 1U;
+  }
+  ParallelCompilationPhase phase(this, "InitializeNoClinit", init_thread_pool, init_thread_count);
   for (size_t i = 0; i != dex_files.size(); ++i) {
     const DexFile* dex_file = dex_files[i];
     CHECK(dex_file != nullptr);
-    InitializeClasses(class_loader, *dex_file, dex_files, timings);
+    InitializeClasses(class_loader, *dex_file, dex_files, &phase);
   }
+  phase.Run(timings);
   if (boot_image_ || app_image_) {
     // Make sure that we call EnsureIntiailized on all the array classes to call
     // SetVerificationAttempted so that the access flags are set. If we do not do this they get
@@ -2586,18 +2672,29 @@ void CompilerDriver::Compile(jobject class_loader,
   }
 
   DCHECK(current_dex_to_dex_methods_ == nullptr);
-  for (const DexFile* dex_file : dex_files) {
-    CHECK(dex_file != nullptr);
-    CompileDexFile(class_loader,
-                   *dex_file,
-                   dex_files,
-                   parallel_thread_pool_.get(),
-                   parallel_thread_count_,
-                   timings);
+  for (size_t begin = 0; begin != dex_files.size(); ) {
+    // Each batch of dex files is a separate phase, so that the arena memory of a batch is
+    // reclaimed before the next one. "arena alloc" is the maximum over the batches.
+    ParallelCompilationPhase phase(this,
+                                   "Compile Dex Files",
+                                   parallel_thread_pool_.get(),
+                                   parallel_thread_count_);
+    size_t batch_bytes = 0u;
+    size_t end = begin;
+    do {
+      const DexFile* dex_file = dex_files[end];
+      CHECK(dex_file != nullptr);
+      CompileDexFile(class_loader, *dex_file, dex_files, &phase);
+      batch_bytes += dex_file->Size();
+      ++end;
+    } while (end != dex_files.size() &&
+             batch_bytes + dex_files[end]->Size() <= kCompileBatchDexBytes);
+    phase.Run(timings);
     const ArenaPool* const arena_pool = Runtime::Current()->GetArenaPool();
     const size_t arena_alloc = arena_pool->GetBytesAllocated();
     max_arena_alloc_ = std::max(arena_alloc, max_arena_alloc_);
     Runtime::Current()->ReclaimArenaPoolMemory();
+    begin = end;
   }
 
   ArrayRef<DexFileMethodSet> dex_to_dex_references;
@@ -2608,13 +2705,14 @@ void CompilerDriver::Compile(jobject class_loader,
     dex_to_dex_references = ArrayRef<DexFileMethodSet>(dex_to_dex_references_);
   }
   for (const auto& method_set : dex_to_dex_references) {
+    // The methods to compile are those of the current dex file, so each one is a separate phase.
     current_dex_to_dex_methods_ = &method_set.GetMethodIndexes();
-    CompileDexFile(class_loader,
-                   method_set.GetDexFile(),
-                   dex_files,
-                   parallel_thread_pool_.get(),
-                   parallel_thread_count_,
-                   timings);
+    ParallelCompilationPhase phase(this,
+                                   "Compile Dex-to-Dex",
+                                   parallel_thread_pool_.get(),
+                                   parallel_thread_count_);
+    CompileDexFile(class_loader, method_set.GetDexFile(), dex_files, &phase);
+    phase.Run(timings);
   }
   current_dex_to_dex_methods_ = nullptr;
 
@@ -2741,17 +2839,77 @@ class CompileClassVisitor : public CompilationVisitor {
   const ParallelCompilationManager* const manager_;
 };
 
+// Estimates the cost of compiling a class from the size of the code of its methods. The compile
+// time of a method grows at least linearly with its size, and each method has a fixed overhead.
+static size_t EstimateClassCompilationCost(const DexFile& dex_file, size_t class_def_index) {
+  static constexpr size_t kMethodOverheadCodeUnits = 16u;
+  const uint8_t* class_data = dex_file.GetClassData(dex_file.GetClassDef(class_def_index));
+  if (class_data == nullptr) {
+    return 0u;
+  }
+  ClassDataItemIterator it(dex_file, class_data);
+  while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+    it.Next();
+  }
+  size_t cost = 0u;
+  for (; it.HasNextDirectMethod() || it.HasNextVirtualMethod(); it.Next()) {
+    const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+    if (code_item != nullptr) {
+      cost += kMethodOverheadCodeUnits + code_item->insns_size_in_code_units_;
+    }
+  }
+  return cost;
+}
+
 void CompilerDriver::CompileDexFile(jobject class_loader,
                                     const DexFile& dex_file,
                                     const std::vector<const DexFile*>& dex_files,
-                                    ThreadPool* thread_pool,
-                                    size_t thread_count,
-                                    TimingLogger* timings) {
-  TimingLogger::ScopedTiming t("Compile Dex File", timings);
-  ParallelCompilationManager context(Runtime::Current()->GetClassLinker(), class_loader, this,
-                                     &dex_file, dex_files, thread_pool);
-  CompileClassVisitor visitor(&context);
-  context.ForAll(0, dex_file.NumClassDefs(), &visitor, thread_count);
+                                    ParallelCompilationPhase* phase) {
+  ParallelCompilationManager* context = phase->NewContext(class_loader, &dex_file, dex_files);
+  if (current_dex_to_dex_methods_ == nullptr) {
+    // Start with the biggest classes.
+    phase->Add(new CompileClassVisitor(context),
+               0,
+               dex_file.NumClassDefs(),
+               [&dex_file](size_t class_def_index) {
+                 return EstimateClassCompilationCost(dex_file, class_def_index);
+               });
+  } else {
+    // Dex-to-dex compilation is cheap and only for some methods, keep the class order.
+    phase->Add(new CompileClassVisitor(context), 0, dex_file.NumClassDefs());
+  }
+}
+
+void CompilerDriver::RecordPhaseUtilization(const char* phase,
+                                            size_t thread_count,
+                                            size_t work_items,
+                                            uint64_t wall_ns,
+                                            uint64_t busy_ns) {
+  auto it = std::find_if(phase_utilization_.begin(),
+                         phase_utilization_.end(),
+                         [phase](const PhaseUtilization& u) {
+                           return strcmp(u.phase, phase) == 0;
+                         });
+  if (it == phase_utilization_.end()) {
+    phase_utilization_.push_back(PhaseUtilization { phase, 0u, 0u, 0u, 0u, 0u });
+    it = phase_utilization_.end() - 1;
+  }
+  ++it->runs;
+  it->work_items += work_items;
+  it->wall_ns += wall_ns;
+  it->busy_ns += busy_ns;
+  it->capacity_ns += wall_ns * thread_count;
+}
+
+void CompilerDriver::DumpPhaseUtilization(std::ostream& os) const {
+  os << "Compiler thread pool utilization:\n";
+  for (const PhaseUtilization& u : phase_utilization_) {
+    const double utilization =
+        (u.capacity_ns != 0u) ? 100.0 * u.busy_ns / u.capacity_ns : 100.0;
+    os << "  " << u.phase << ": " << PrettyDuration(u.wall_ns) << " in " << u.runs
+       << " run(s), " << u.work_items << " work items, "
+       << StringPrintf("%.1f%%", utilization) << " busy\n";
+  }
 }
 
 void CompilerDriver::AddCompiledMethod(const MethodReference& method_ref,
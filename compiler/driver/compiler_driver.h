@@ -61,6 +61,7 @@ class DexFileToMethodInlinerMap;
 struct InlineIGetIPutData;
 class InstructionSetFeatures;
 class ParallelCompilationManager;
+class ParallelCompilationPhase;
 class ScopedObjectAccess;
 template <class Allocator> class SrcMap;
 class SrcMapElem;
@@ -420,6 +421,15 @@ class CompilerDriver {
     return timings_logger_;
   }
 
+  // Records a run of a parallel phase, `busy_ns` being the total time the threads spent on it.
+  void RecordPhaseUtilization(const char* phase,
+                              size_t thread_count,
+                              size_t work_items,
+                              uint64_t wall_ns,
+                              uint64_t busy_ns);
+  // Dumps how busy the threads were in each parallel phase, for --dump-timing.
+  void DumpPhaseUtilization(std::ostream& os) const;
+
   void SetDedupeEnabled(bool dedupe_enabled) {
     compiled_method_storage_.SetDedupeEnabled(dedupe_enabled);
   }
@@ -569,12 +579,11 @@ class CompilerDriver {
                const std::vector<const DexFile*>& dex_files,
                TimingLogger* timings)
       REQUIRES(!Locks::mutator_lock_);
+  // The *DexFile functions add the work for `dex_file` to the phase, which runs it.
   void ResolveDexFile(jobject class_loader,
                       const DexFile& dex_file,
                       const std::vector<const DexFile*>& dex_files,
-                      ThreadPool* thread_pool,
-                      size_t thread_count,
-                      TimingLogger* timings)
+                      ParallelCompilationPhase* phase)
       REQUIRES(!Locks::mutator_lock_);
 
   void Verify(jobject class_loader,
@@ -583,9 +592,7 @@ class CompilerDriver {
   void VerifyDexFile(jobject class_loader,
                      const DexFile& dex_file,
                      const std::vector<const DexFile*>& dex_files,
-                     ThreadPool* thread_pool,
-                     size_t thread_count,
-                     TimingLogger* timings)
+                     ParallelCompilationPhase* phase)
       REQUIRES(!Locks::mutator_lock_);
 
   void SetVerified(jobject class_loader,
@@ -594,9 +601,7 @@ class CompilerDriver {
   void SetVerifiedDexFile(jobject class_loader,
                           const DexFile& dex_file,
                           const std::vector<const DexFile*>& dex_files,
-                          ThreadPool* thread_pool,
-                          size_t thread_count,
-                          TimingLogger* timings)
+                          ParallelCompilationPhase* phase)
       REQUIRES(!Locks::mutator_lock_);
 
   void InitializeClasses(jobject class_loader,
@@ -606,7 +611,7 @@ class CompilerDriver {
   void InitializeClasses(jobject class_loader,
                          const DexFile& dex_file,
                          const std::vector<const DexFile*>& dex_files,
-                         TimingLogger* timings)
+                         ParallelCompilationPhase* phase)
       REQUIRES(!Locks::mutator_lock_, !compiled_classes_lock_);
 
   void UpdateImageClasses(TimingLogger* timings) REQUIRES(!Locks::mutator_lock_);
@@ -619,9 +624,7 @@ class CompilerDriver {
   void CompileDexFile(jobject class_loader,
                       const DexFile& dex_file,
                       const std::vector<const DexFile*>& dex_files,
-                      ThreadPool* thread_pool,
-                      size_t thread_count,
-                      TimingLogger* timings)
+                      ParallelCompilationPhase* phase)
       REQUIRES(!Locks::mutator_lock_);
 
   bool MayInlineInternal(const DexFile* inlined_from, const DexFile* inlined_into) const;
@@ -715,6 +718,17 @@ class CompilerDriver {
 
   size_t max_arena_alloc_;
 
+  // Thread utilization of the parallel phases, accumulated per phase name.
+  struct PhaseUtilization {
+    const char* phase;
+    size_t runs;
+    size_t work_items;
+    uint64_t wall_ns;
+    uint64_t busy_ns;
+    uint64_t capacity_ns;  // Sum of the wall time times the thread count of the runs.
+  };
+  std::vector<PhaseUtilization> phase_utilization_;
+
   // Data for delaying dex-to-dex compilation.
   Mutex dex_to_dex_references_lock_;
   // In the first phase, dex_to_dex_references_ collects methods for dex-to-dex compilation.
@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <memory>
+#include <sstream>
 
 #include "art_method-inl.h"
 #include "class_linker-inl.h"
@@ -175,6 +176,33 @@ TEST_F(CompilerDriverTest, AbstractMethodErrorStub) {
   }
 }
 
+TEST_F(CompilerDriverTest, PhasesSpanDexFiles) {
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader = LoadDex("MultiDex");
+  }
+  ASSERT_TRUE(class_loader != nullptr);
+  ASSERT_GT(GetDexFiles(class_loader).size(), 1u);
+  TimingLogger timings("CompilerDriverTest::PhasesSpanDexFiles", false, false);
+  compiler_driver_->CompileAll(class_loader, GetDexFiles(class_loader), &timings);
+
+  // Each phase is a single pass over all the dex files.
+  size_t verify_index = timings.FindTimingIndex("Verify Dex Files", 0);
+  ASSERT_NE(TimingLogger::kIndexNotFound, verify_index);
+  EXPECT_EQ(TimingLogger::kIndexNotFound, timings.FindTimingIndex("Verify Dex Files",
+                                                                  verify_index + 1));
+  size_t compile_index = timings.FindTimingIndex("Compile Dex Files", 0);
+  ASSERT_NE(TimingLogger::kIndexNotFound, compile_index);
+  EXPECT_EQ(TimingLogger::kIndexNotFound, timings.FindTimingIndex("Compile Dex Files",
+                                                                  compile_index + 1));
+
+  std::ostringstream oss;
+  compiler_driver_->DumpPhaseUtilization(oss);
+  EXPECT_NE(std::string::npos, oss.str().find("Compile Dex Files: ")) << oss.str();
+  EXPECT_NE(std::string::npos, oss.str().find("Verify Dex Files: ")) << oss.str();
+}
+
 class CompilerDriverMethodsTest : public CompilerDriverTest {
  protected:
   std::unordered_set<std::string>* GetCompiledMethods() OVERRIDE {
@@ -1772,4 +1772,30 @@ void JniCompilerTest::StackArgsSignExtendedMips64Impl() {
 
 JNI_TEST(StackArgsSignExtendedMips64)
 
+int gJava_MyClassNatives_criticalSII_calls = 0;
+jint Java_MyClassNatives_criticalSII(JNIEnv* env, jclass klass, jint x, jint y) {
+  // The stub of a critical native stays Runnable and does not pass the class.
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  EXPECT_EQ(Thread::Current()->GetJniEnv(), env);
+  EXPECT_TRUE(klass == nullptr);
+  gJava_MyClassNatives_criticalSII_calls++;
+  return x + y;
+}
+
+// Not a JNI_TEST, the generic JNI stub ignores @CriticalNative and makes a regular call.
+TEST_F(JniCompilerTest, CompileAndRunStaticCriticalNativeMethod) {
+  SetUpForTest(true, "criticalSII", "(II)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_criticalSII));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_criticalSII_calls);
+  jint result = env_->CallStaticIntMethod(jklass_, jmethod_, 20, 30);
+  EXPECT_EQ(50, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_criticalSII_calls);
+  result = env_->CallStaticIntMethod(jklass_, jmethod_, -7, 3);
+  EXPECT_EQ(-4, result);
+  EXPECT_EQ(2, gJava_MyClassNatives_criticalSII_calls);
+
+  gJava_MyClassNatives_criticalSII_calls = 0;
+}
+
 }  // namespace art
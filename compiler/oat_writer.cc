@@ -20,6 +20,7 @@
 #include <zlib.h>
 
 #include "arch/arm64/instruction_set_features_arm64.h"
+#include "art_field-inl.h"
 #include "art_method-inl.h"
 #include "base/allocator.h"
 #include "base/bit_vector.h"
@@ -41,6 +42,7 @@
 #include "linker/multi_oat_relative_patcher.h"
 #include "linker/output_stream.h"
 #include "mirror/array.h"
+#include "mirror/class-inl.h"
 #include "mirror/class_loader.h"
 #include "mirror/dex_cache-inl.h"
 #include "mirror/object-inl.h"
@@ -150,7 +152,8 @@ class OatWriter::OatClass {
   OatClass(size_t offset,
            const dchecked_vector<CompiledMethod*>& compiled_methods,
            uint32_t num_non_null_compiled_methods,
-           mirror::Class::Status status);
+           mirror::Class::Status status,
+           dchecked_vector<uint32_t>&& link_snapshot);
   OatClass(OatClass&& src) = default;
   size_t GetOatMethodOffsetsOffsetFromOatHeader(size_t class_def_method_index_) const;
   size_t GetOatMethodOffsetsOffsetFromOatClass(size_t class_def_method_index_) const;
@@ -182,6 +185,9 @@ class OatWriter::OatClass {
   static_assert(OatClassType::kOatClassMax < (1 << 16), "oat_class type won't fit in 16bits");
   uint16_t type_;
 
+  // OatClassLinkSnapshot followed by the field offsets, empty if the class was not linked.
+  dchecked_vector<uint32_t> link_snapshot_;
+
   uint32_t method_bitmap_size_;
 
   // bit vector indexed by ClassDef method index. When
@@ -204,6 +210,10 @@ class OatWriter::OatClass {
     return method_offsets_.size() * sizeof(method_offsets_[0]);
   }
 
+  size_t GetLinkSnapshotRawSize() const {
+    return link_snapshot_.size() * sizeof(link_snapshot_[0]);
+  }
+
   DISALLOW_COPY_AND_ASSIGN(OatClass);
 };
 
@@ -316,6 +326,7 @@ OatWriter::OatWriter(bool compiling_boot_image, TimingLogger* timings)
     size_oat_class_offsets_(0),
     size_oat_class_type_(0),
     size_oat_class_status_(0),
+    size_oat_class_link_snapshots_(0),
     size_oat_class_method_bitmaps_(0),
     size_oat_class_method_offsets_(0),
     relative_patcher_(nullptr),
@@ -671,12 +682,64 @@ class OatWriter::InitOatClassesMethodVisitor : public DexMethodVisitor {
     writer_->oat_classes_.emplace_back(offset_,
                                        compiled_methods_,
                                        num_non_null_compiled_methods_,
-                                       status);
+                                       status,
+                                       GetLinkSnapshot(status));
     offset_ += writer_->oat_classes_.back().SizeOf();
     return DexMethodVisitor::EndClass();
   }
 
  private:
+  // Record the field layout of the classes the compiler linked, see OatClassLinkSnapshot. Boot
+  // image classes do not need one, they are loaded from the image.
+  dchecked_vector<uint32_t> GetLinkSnapshot(mirror::Class::Status status) {
+    dchecked_vector<uint32_t> link_snapshot;
+    if (writer_->HasBootImage() || status < mirror::Class::kStatusResolved) {
+      return link_snapshot;
+    }
+    ClassLinker* linker = Runtime::Current()->GetClassLinker();
+    ScopedObjectAccess soa(Thread::Current());
+    mirror::DexCache* dex_cache = linker->FindDexCache(soa.Self(), *dex_file_, true);
+    if (dex_cache == nullptr) {
+      return link_snapshot;
+    }
+    mirror::Class* klass =
+        dex_cache->GetResolvedType(dex_file_->GetClassDef(class_def_index_).class_idx_);
+    // The type may also resolve to a class defined by another dex file.
+    if (klass == nullptr ||
+        !klass->IsResolved() ||
+        klass->IsErroneous() ||
+        klass->GetDexCache() != dex_cache ||
+        klass->GetDexClassDefIndex() != class_def_index_ ||
+        klass->GetSuperClass() == nullptr ||
+        klass->IsVariableSize()) {
+      return link_snapshot;
+    }
+    const size_t num_static_fields = klass->NumStaticFields();
+    const size_t num_instance_fields = klass->NumInstanceFields();
+    link_snapshot.resize(sizeof(OatClassLinkSnapshot) / sizeof(uint32_t) +
+                         num_static_fields +
+                         num_instance_fields);
+    OatClassLinkSnapshot* snapshot = reinterpret_cast<OatClassLinkSnapshot*>(link_snapshot.data());
+    snapshot->super_object_size_ = klass->GetSuperClass()->GetObjectSize();
+    snapshot->embedded_vtable_length_ =
+        klass->ShouldHaveEmbeddedVTable() ? klass->GetEmbeddedVTableLength() : 0u;
+    snapshot->object_size_ = klass->GetObjectSize();
+    snapshot->class_size_ = klass->GetClassSize();
+    snapshot->num_static_fields_ = num_static_fields;
+    snapshot->num_instance_fields_ = num_instance_fields;
+    snapshot->num_reference_static_fields_ = klass->NumReferenceStaticFields();
+    snapshot->num_reference_instance_fields_ = klass->NumReferenceInstanceFields();
+    uint32_t* offsets = &link_snapshot[sizeof(OatClassLinkSnapshot) / sizeof(uint32_t)];
+    for (size_t i = 0; i != num_static_fields; ++i) {
+      *offsets++ = klass->GetStaticField(i)->GetOffset().Uint32Value();
+    }
+    for (size_t i = 0; i != num_instance_fields; ++i) {
+      *offsets++ = klass->GetInstanceField(i)->GetOffset().Uint32Value();
+    }
+    DCHECK_EQ(snapshot->SizeOf(), link_snapshot.size() * sizeof(uint32_t));
+    return link_snapshot;
+  }
+
   dchecked_vector<CompiledMethod*> compiled_methods_;
   size_t num_non_null_compiled_methods_;
 };
@@ -1616,6 +1679,7 @@ bool OatWriter::WriteCode(OutputStream* out) {
     DO_STAT(size_oat_class_offsets_);
     DO_STAT(size_oat_class_type_);
     DO_STAT(size_oat_class_status_);
+    DO_STAT(size_oat_class_link_snapshots_);
     DO_STAT(size_oat_class_method_bitmaps_);
     DO_STAT(size_oat_class_method_offsets_);
     #undef DO_STAT
@@ -2380,8 +2444,9 @@ bool OatWriter::OatDexFile::WriteClassOffsets(OatWriter* oat_writer, OutputStrea
 OatWriter::OatClass::OatClass(size_t offset,
                               const dchecked_vector<CompiledMethod*>& compiled_methods,
                               uint32_t num_non_null_compiled_methods,
-                              mirror::Class::Status status)
-    : compiled_methods_(compiled_methods) {
+                              mirror::Class::Status status,
+                              dchecked_vector<uint32_t>&& link_snapshot)
+    : compiled_methods_(compiled_methods), link_snapshot_(std::move(link_snapshot)) {
   uint32_t num_methods = compiled_methods.size();
   CHECK_LE(num_non_null_compiled_methods, num_methods);
 
@@ -2406,7 +2471,8 @@ OatWriter::OatClass::OatClass(size_t offset,
   method_offsets_.resize(num_non_null_compiled_methods);
   method_headers_.resize(num_non_null_compiled_methods);
 
-  uint32_t oat_method_offsets_offset_from_oat_class = sizeof(type_) + sizeof(status_);
+  uint32_t oat_method_offsets_offset_from_oat_class =
+      sizeof(type_) + sizeof(status_) + sizeof(uint32_t) + GetLinkSnapshotRawSize();
   if (type_ == kOatClassSomeCompiled) {
     method_bitmap_.reset(new BitVector(num_methods, false, Allocator::GetMallocAllocator()));
     method_bitmap_size_ = method_bitmap_->GetSizeOf();
@@ -2448,6 +2514,8 @@ size_t OatWriter::OatClass::GetOatMethodOffsetsOffsetFromOatClass(
 size_t OatWriter::OatClass::SizeOf() const {
   return sizeof(status_)
           + sizeof(type_)
+          + sizeof(uint32_t)
+          + GetLinkSnapshotRawSize()
           + ((method_bitmap_size_ == 0) ? 0 : sizeof(method_bitmap_size_))
           + method_bitmap_size_
           + (sizeof(method_offsets_[0]) * method_offsets_.size());
@@ -2469,6 +2537,14 @@ bool OatWriter::OatClass::Write(OatWriter* oat_writer,
   }
   oat_writer->size_oat_class_type_ += sizeof(type_);
 
+  const uint32_t link_snapshot_size = GetLinkSnapshotRawSize();
+  if (!out->WriteFully(&link_snapshot_size, sizeof(link_snapshot_size)) ||
+      (link_snapshot_size != 0u && !out->WriteFully(link_snapshot_.data(), link_snapshot_size))) {
+    PLOG(ERROR) << "Failed to write class link snapshot to " << out->GetLocation();
+    return false;
+  }
+  oat_writer->size_oat_class_link_snapshots_ += sizeof(link_snapshot_size) + link_snapshot_size;
+
   if (method_bitmap_size_ != 0) {
     CHECK_EQ(kOatClassSomeCompiled, type_);
     if (!out->WriteFully(&method_bitmap_size_, sizeof(method_bitmap_size_))) {
@@ -75,7 +75,7 @@ class MultiOatRelativePatcher;
 // ClassOffsets[D]
 //
 // OatClass[0]       one variable sized OatClass for each of C DexFile::ClassDefs
-// OatClass[1]       contains OatClass entries with class status, offsets to code, etc.
+// OatClass[1]       contains OatClass entries with class status, field layout, code offsets, etc.
 // ...
 // OatClass[C]
 //
@@ -360,6 +360,7 @@ class OatWriter {
   uint32_t size_oat_class_offsets_;
   uint32_t size_oat_class_type_;
   uint32_t size_oat_class_status_;
+  uint32_t size_oat_class_link_snapshots_;
   uint32_t size_oat_class_method_bitmaps_;
   uint32_t size_oat_class_method_offsets_;
 
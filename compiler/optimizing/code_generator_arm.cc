@@ -4788,6 +4788,9 @@ void CodeGeneratorARM::MarkGCCard(Register temp,
   __ LoadFromOffset(kLoadWord, card, TR, Thread::CardTableOffset<kArmWordSize>().Int32Value());
   __ Lsr(temp, object, gc::accounting::CardTable::kCardShift);
   __ strb(card, Address(card, temp));
+  // Also dirty the chunk summary at card - 1 - (object >> kSummaryShift).
+  __ mvn(temp, ShifterOperand(object, LSR, gc::accounting::CardTable::kSummaryShift));
+  __ strb(card, Address(card, temp));
   if (can_be_null) {
     __ Bind(&is_null);
   }
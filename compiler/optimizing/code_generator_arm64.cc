@@ -1084,6 +1084,10 @@ void CodeGeneratorARM64::MarkGCCard(Register object, Register value, bool value_
   __ Ldr(card, MemOperand(tr, Thread::CardTableOffset<kArm64WordSize>().Int32Value()));
   __ Lsr(temp, object, gc::accounting::CardTable::kCardShift);
   __ Strb(card, MemOperand(card, temp.X()));
+  // Also dirty the chunk summary at card - 1 - (object >> kSummaryShift), the 32-bit index is
+  // negative so it must be sign extended.
+  __ Mvn(temp, Operand(object, LSR, gc::accounting::CardTable::kSummaryShift));
+  __ Strb(card, MemOperand(card, temp, SXTW));
   if (value_can_be_null) {
     __ Bind(&done);
   }
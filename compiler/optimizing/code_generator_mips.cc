@@ -986,6 +986,11 @@ void CodeGeneratorMIPS::MarkGCCard(Register object, Register value) {
   __ Srl(temp, object, gc::accounting::CardTable::kCardShift);
   __ Addu(temp, card, temp);
   __ Sb(card, temp, 0);
+  // Also dirty the chunk summary at card - 1 - (object >> kSummaryShift).
+  __ Srl(temp, object, gc::accounting::CardTable::kSummaryShift);
+  __ Nor(temp, temp, ZERO);
+  __ Addu(temp, card, temp);
+  __ Sb(card, temp, 0);
   __ Bind(&done);
 }
 
@@ -886,6 +886,11 @@ void CodeGeneratorMIPS64::MarkGCCard(GpuRegister object,
   __ Dsrl(temp, object, gc::accounting::CardTable::kCardShift);
   __ Daddu(temp, card, temp);
   __ Sb(card, temp, 0);
+  // Also dirty the chunk summary at card - 1 - (object >> kSummaryShift).
+  __ Dsrl(temp, object, gc::accounting::CardTable::kSummaryShift);
+  __ Nor(temp, temp, ZERO);
+  __ Daddu(temp, card, temp);
+  __ Sb(card, temp, 0);
   if (value_can_be_null) {
     __ Bind(&done);
   }
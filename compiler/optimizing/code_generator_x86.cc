@@ -4527,6 +4527,12 @@ void CodeGeneratorX86::MarkGCCard(Register temp,
   __ fs()->movl(card, Address::Absolute(Thread::CardTableOffset<kX86WordSize>().Int32Value()));
   __ movl(temp, object);
   __ shrl(temp, Immediate(gc::accounting::CardTable::kCardShift));
+  __ movb(Address(temp, card, TIMES_1, 0),
+          X86ManagedRegister::FromCpuRegister(card).AsByteRegister());
+  // Also dirty the chunk summary at card - 1 - (object >> kSummaryShift).
+  __ shrl(temp, Immediate(gc::accounting::CardTable::kSummaryShift -
+                          gc::accounting::CardTable::kCardShift));
+  __ notl(temp);
   __ movb(Address(temp, card, TIMES_1, 0),
           X86ManagedRegister::FromCpuRegister(card).AsByteRegister());
   if (value_can_be_null) {
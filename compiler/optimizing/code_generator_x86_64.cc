@@ -5047,6 +5047,11 @@ void CodeGeneratorX86_64::MarkGCCard(CpuRegister temp,
   __ movq(temp, object);
   __ shrq(temp, Immediate(gc::accounting::CardTable::kCardShift));
   __ movb(Address(temp, card, TIMES_1, 0), card);
+  // Also dirty the chunk summary at card - 1 - (object >> kSummaryShift).
+  __ shrq(temp, Immediate(gc::accounting::CardTable::kSummaryShift -
+                          gc::accounting::CardTable::kCardShift));
+  __ notq(temp);
+  __ movb(Address(temp, card, TIMES_1, 0), card);
   if (value_can_be_null) {
     __ Bind(&is_null);
   }
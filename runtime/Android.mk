@@ -117,6 +117,7 @@ LIBART_COMMON_SRC_FILES := \
   jni_internal.cc \
   jobject_comparator.cc \
   linear_alloc.cc \
+  lock_contention_profile.cc \
   mem_map.cc \
   memory_region.cc \
   mirror/abstract_method.cc \
@@ -193,6 +194,7 @@ LIBART_COMMON_SRC_FILES := \
   verifier/reg_type.cc \
   verifier/reg_type_cache.cc \
   verifier/register_line.cc \
+  verifier/verification_cache.cc \
   well_known_classes.cc \
   zip_archive.cc
 
@@ -19,6 +19,7 @@
 
 #if defined(__cplusplus)
 #include "art_method.h"
+#include "gc/accounting/card_table.h"
 #include "gc/allocator/rosalloc.h"
 #include "jit/jit.h"
 #include "lock_word.h"
@@ -112,6 +113,11 @@ ADD_TEST_EQ(THREAD_IS_GC_MARKING_OFFSET,
 ADD_TEST_EQ(THREAD_CARD_TABLE_OFFSET,
             art::Thread::CardTableOffset<__SIZEOF_POINTER__>().Int32Value())
 
+// Shift from a heap address to its card table summary index.
+#define CARD_TABLE_SUMMARY_SHIFT 16
+ADD_TEST_EQ(static_cast<size_t>(CARD_TABLE_SUMMARY_SHIFT),
+            art::gc::accounting::CardTable::kSummaryShift)
+
 // Offset of field Thread::tlsPtr_.exception.
 #define THREAD_EXCEPTION_OFFSET (THREAD_CARD_TABLE_OFFSET + __SIZEOF_POINTER__)
 ADD_TEST_EQ(THREAD_EXCEPTION_OFFSET,
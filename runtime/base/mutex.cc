@@ -24,6 +24,7 @@
 #include "base/time_utils.h"
 #include "base/systrace.h"
 #include "base/value_object.h"
+#include "lock_contention_profile.h"
 #include "mutex-inl.h"
 #include "runtime.h"
 #include "scoped_thread_state_change.h"
@@ -116,11 +117,18 @@ class ScopedAllMutexesLock FINAL {
 // Scoped class that generates events at the beginning and end of lock contention.
 class ScopedContentionRecorder FINAL : public ValueObject {
  public:
-  ScopedContentionRecorder(BaseMutex* mutex, uint64_t blocked_tid, uint64_t owner_tid)
-      : mutex_(kLogLockContentions ? mutex : nullptr),
+  ScopedContentionRecorder(BaseMutex* mutex,
+                           uint64_t blocked_tid,
+                           uint64_t owner_tid,
+                           const void* blocked_pc,
+                           const void* owner_pc)
+      : mutex_(mutex),
         blocked_tid_(kLogLockContentions ? blocked_tid : 0),
         owner_tid_(kLogLockContentions ? owner_tid : 0),
-        start_nano_time_(kLogLockContentions ? NanoTime() : 0) {
+        profile_(LockContentionProfile::Current()),
+        blocked_pc_(blocked_pc),
+        owner_pc_(owner_pc),
+        start_nano_time_(kLogLockContentions || profile_ != nullptr ? NanoTime() : 0) {
     if (ATRACE_ENABLED()) {
       std::string msg = StringPrintf("Lock contention on %s (owner tid: %" PRIu64 ")",
                                      mutex->GetName(), owner_tid);
@@ -130,9 +138,20 @@ class ScopedContentionRecorder FINAL : public ValueObject {
 
   ~ScopedContentionRecorder() {
     ATRACE_END();
-    if (kLogLockContentions) {
+    if (kLogLockContentions || profile_ != nullptr) {
       uint64_t end_nano_time = NanoTime();
-      mutex_->RecordContention(blocked_tid_, owner_tid_, end_nano_time - start_nano_time_);
+      if (kLogLockContentions) {
+        mutex_->RecordContention(blocked_tid_, owner_tid_, end_nano_time - start_nano_time_);
+      }
+      if (profile_ != nullptr) {
+        profile_->RecordMutexContention(mutex_->IsReaderWriterMutex()
+                                            ? LockContentionProfile::kReaderWriterMutex
+                                            : LockContentionProfile::kMutex,
+                                        mutex_->GetName(),
+                                        blocked_pc_,
+                                        owner_pc_,
+                                        end_nano_time - start_nano_time_);
+      }
     }
   }
 
@@ -140,10 +159,14 @@ class ScopedContentionRecorder FINAL : public ValueObject {
   BaseMutex* const mutex_;
   const uint64_t blocked_tid_;
   const uint64_t owner_tid_;
+  LockContentionProfile* const profile_;
+  const void* const blocked_pc_;
+  const void* const owner_pc_;
   const uint64_t start_nano_time_;
 };
 
-BaseMutex::BaseMutex(const char* name, LockLevel level) : level_(level), name_(name) {
+BaseMutex::BaseMutex(const char* name, LockLevel level)
+    : level_(level), name_(name), exclusive_owner_pc_(nullptr) {
   if (kLogLockContentions) {
     ScopedAllMutexesLock mu(this);
     std::set<BaseMutex*>** all_mutexes_ptr = &gAllMutexData->all_mutexes;
@@ -163,6 +186,12 @@ BaseMutex::~BaseMutex() {
   }
 }
 
+inline void BaseMutex::SetExclusiveOwnerPc(const void* pc) {
+  if (UNLIKELY(LockContentionProfile::Current() != nullptr)) {
+    exclusive_owner_pc_ = pc;
+  }
+}
+
 void BaseMutex::DumpAll(std::ostream& os) {
   if (kLogLockContentions) {
     os << "Mutex logging:\n";
@@ -371,7 +400,11 @@ void Mutex::ExclusiveLock(Thread* self) {
         done = state_.CompareExchangeWeakAcquire(0 /* cur_state */, 1 /* new state */);
       } else {
         // Failed to acquire, hang up.
-        ScopedContentionRecorder scr(this, SafeGetTid(self), GetExclusiveOwnerTid());
+        ScopedContentionRecorder scr(this,
+                                     SafeGetTid(self),
+                                     GetExclusiveOwnerTid(),
+                                     __builtin_return_address(0),
+                                     exclusive_owner_pc_);
         num_contenders_++;
         if (futex(state_.Address(), FUTEX_WAIT, 1, nullptr, nullptr, 0) != 0) {
           // EAGAIN and EINTR both indicate a spurious failure, try again from the beginning.
@@ -389,6 +422,7 @@ void Mutex::ExclusiveLock(Thread* self) {
 #endif
     DCHECK_EQ(exclusive_owner_, 0U);
     exclusive_owner_ = SafeGetTid(self);
+    SetExclusiveOwnerPc(__builtin_return_address(0));
     RegisterAsLocked(self);
   }
   recursion_count_++;
@@ -429,6 +463,7 @@ bool Mutex::ExclusiveTryLock(Thread* self) {
 #endif
     DCHECK_EQ(exclusive_owner_, 0U);
     exclusive_owner_ = SafeGetTid(self);
+    SetExclusiveOwnerPc(__builtin_return_address(0));
     RegisterAsLocked(self);
   }
   recursion_count_++;
@@ -469,6 +504,7 @@ void Mutex::ExclusiveUnlock(Thread* self) {
       if (LIKELY(cur_state == 1)) {
         // We're no longer the owner.
         exclusive_owner_ = 0;
+        exclusive_owner_pc_ = nullptr;
         // Change state to 0 and impose load/store ordering appropriate for lock release.
         // Note, the relaxed loads below musn't reorder before the CompareExchange.
         // TODO: the ordering here is non-trivial as state is split across 3 fields, fix by placing
@@ -494,6 +530,7 @@ void Mutex::ExclusiveUnlock(Thread* self) {
     } while (!done);
 #else
     exclusive_owner_ = 0;
+    exclusive_owner_pc_ = nullptr;
     CHECK_MUTEX_CALL(pthread_mutex_unlock, (&mutex_));
 #endif
   }
@@ -558,7 +595,12 @@ void ReaderWriterMutex::ExclusiveLock(Thread* self) {
       done =  state_.CompareExchangeWeakAcquire(0 /* cur_state*/, -1 /* new state */);
     } else {
       // Failed to acquire, hang up.
-      ScopedContentionRecorder scr(this, SafeGetTid(self), GetExclusiveOwnerTid());
+      // Readers do not record their sites, they are described as the shared holders.
+      ScopedContentionRecorder scr(this,
+                                   SafeGetTid(self),
+                                   GetExclusiveOwnerTid(),
+                                   __builtin_return_address(0),
+                                   cur_state > 0 ? nullptr : exclusive_owner_pc_);
       ++num_pending_writers_;
       if (futex(state_.Address(), FUTEX_WAIT, cur_state, nullptr, nullptr, 0) != 0) {
         // EAGAIN and EINTR both indicate a spurious failure, try again from the beginning.
@@ -576,6 +618,7 @@ void ReaderWriterMutex::ExclusiveLock(Thread* self) {
 #endif
   DCHECK_EQ(exclusive_owner_, 0U);
   exclusive_owner_ = SafeGetTid(self);
+  SetExclusiveOwnerPc(__builtin_return_address(0));
   RegisterAsLocked(self);
   AssertExclusiveHeld(self);
 }
@@ -592,6 +635,7 @@ void ReaderWriterMutex::ExclusiveUnlock(Thread* self) {
     if (LIKELY(cur_state == -1)) {
       // We're no longer the owner.
       exclusive_owner_ = 0;
+      exclusive_owner_pc_ = nullptr;
       // Change state from -1 to 0 and impose load/store ordering appropriate for lock release.
       // Note, the relaxed loads below musn't reorder before the CompareExchange.
       // TODO: the ordering here is non-trivial as state is split across 3 fields, fix by placing
@@ -610,6 +654,7 @@ void ReaderWriterMutex::ExclusiveUnlock(Thread* self) {
   } while (!done);
 #else
   exclusive_owner_ = 0;
+  exclusive_owner_pc_ = nullptr;
   CHECK_MUTEX_CALL(pthread_rwlock_unlock, (&rwlock_));
 #endif
 }
@@ -634,7 +679,12 @@ bool ReaderWriterMutex::ExclusiveLockWithTimeout(Thread* self, int64_t ms, int32
       if (ComputeRelativeTimeSpec(&rel_ts, end_abs_ts, now_abs_ts)) {
         return false;  // Timed out.
       }
-      ScopedContentionRecorder scr(this, SafeGetTid(self), GetExclusiveOwnerTid());
+      // Readers do not record their sites, they are described as the shared holders.
+      ScopedContentionRecorder scr(this,
+                                   SafeGetTid(self),
+                                   GetExclusiveOwnerTid(),
+                                   __builtin_return_address(0),
+                                   cur_state > 0 ? nullptr : exclusive_owner_pc_);
       ++num_pending_writers_;
       if (futex(state_.Address(), FUTEX_WAIT, cur_state, &rel_ts, nullptr, 0) != 0) {
         if (errno == ETIMEDOUT) {
@@ -663,6 +713,7 @@ bool ReaderWriterMutex::ExclusiveLockWithTimeout(Thread* self, int64_t ms, int32
   }
 #endif
   exclusive_owner_ = SafeGetTid(self);
+  SetExclusiveOwnerPc(__builtin_return_address(0));
   RegisterAsLocked(self);
   AssertSharedHeld(self);
   return true;
@@ -672,7 +723,11 @@ bool ReaderWriterMutex::ExclusiveLockWithTimeout(Thread* self, int64_t ms, int32
 #if ART_USE_FUTEXES
 void ReaderWriterMutex::HandleSharedLockContention(Thread* self, int32_t cur_state) {
   // Owner holds it exclusively, hang up.
-  ScopedContentionRecorder scr(this, GetExclusiveOwnerTid(), SafeGetTid(self));
+  ScopedContentionRecorder scr(this,
+                               GetExclusiveOwnerTid(),
+                               SafeGetTid(self),
+                               __builtin_return_address(0),
+                               exclusive_owner_pc_);
   ++num_pending_readers_;
   if (futex(state_.Address(), FUTEX_WAIT, cur_state, nullptr, nullptr, 0) != 0) {
     if (errno != EAGAIN) {
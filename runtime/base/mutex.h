@@ -81,14 +81,17 @@ enum LockLevel {
   kArenaPoolLock,
   kDexFileMethodInlinerLock,
   kDexFileToMethodInlinerMapLock,
+  kInternTableShardLock,
   kInternTableLock,
   kOatFileSecondaryLookupLock,
   kHostDlOpenHandlesLock,
   kOatFileManagerLock,
   kTracingUniqueMethodsLock,
   kTracingStreamingLock,
+  kTracingFlushLock,
   kDeoptimizedMethodsLock,
   kClassLoaderClassesLock,
+  kVerificationCacheLock,
   kDefaultMutexLevel,
   kMarkSweepLargeObjectLock,
   kPinTableLock,
@@ -166,8 +169,14 @@ class BaseMutex {
   void RecordContention(uint64_t blocked_tid, uint64_t owner_tid, uint64_t nano_time_blocked);
   void DumpContention(std::ostream& os) const;
 
+  // Records the return address of an exclusive lock call for the lock contention profile.
+  void SetExclusiveOwnerPc(const void* pc);
+
   const LockLevel level_;  // Support for lock hierarchy.
   const char* const name_;
+  // Where the exclusive owner locked the mutex, only set if the lock contention profile is enabled.
+  // Null while the mutex is not held exclusively.
+  const void* exclusive_owner_pc_;
 
   // A log entry that records contention but makes no guarantee that either tid will be held live.
   struct ContentionLogEntry {
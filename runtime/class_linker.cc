@@ -93,6 +93,7 @@
 #include "utils.h"
 #include "utils/dex_cache_arrays_layout-inl.h"
 #include "verifier/method_verifier.h"
+#include "verifier/verification_cache.h"
 #include "well_known_classes.h"
 
 namespace art {
@@ -313,6 +314,7 @@ ClassLinker::ClassLinker(InternTable* intern_table)
     // dex_lock_ is recursive as it may be used in stack dumping.
     : dex_lock_("ClassLinker dex lock", kDefaultMutexLevel),
       hooked_methods_lock_("ClassLinker hooked methods lock", kDefaultMutexLevel),
+      verification_caches_lock_("ClassLinker verification caches lock", kVerificationCacheLock),
       dex_cache_boot_image_class_lookup_required_(false),
       failed_dex_cache_class_lookups_(0),
       class_roots_(nullptr),
@@ -325,7 +327,11 @@ ClassLinker::ClassLinker(InternTable* intern_table)
       quick_imt_conflict_trampoline_(nullptr),
       quick_generic_jni_trampoline_(nullptr),
       quick_to_interpreter_bridge_trampoline_(nullptr),
-      image_pointer_size_(sizeof(void*)) {
+      image_pointer_size_(sizeof(void*)),
+      lazy_link_threshold_(0u),
+      lazy_imt_method_(nullptr),
+      num_lazy_imts_(0u),
+      num_lazy_imts_filled_(0u) {
   CHECK(intern_table_ != nullptr);
   static_assert(kFindArrayCacheSize == arraysize(find_array_class_cache_),
                 "Array cache size wrong.");
@@ -2199,18 +2205,22 @@ mirror::Class* ClassLinker::EnsureResolved(Thread* self,
     StackHandleScope<1> hs(self);
     Handle<mirror::Class> h_class(hs.NewHandle(klass));
     ObjectLock<mirror::Class> lock(self, h_class);
-    // Loop and wait for the resolving thread to retire this class.
-    while (!h_class->IsRetired() && !h_class->IsErroneous()) {
+    // Loop and wait for the resolving thread to retire this class, or to resolve it in place if
+    // it was allocated with the right size.
+    while (!h_class->IsRetired() && !h_class->IsResolved() && !h_class->IsErroneous()) {
       lock.WaitIgnoringInterrupts();
     }
     if (h_class->IsErroneous()) {
       ThrowEarlierClassFailure(h_class.Get());
       return nullptr;
     }
-    CHECK(h_class->IsRetired());
-    // Get the updated class from class table.
-    klass = LookupClass(self, descriptor, ComputeModifiedUtf8Hash(descriptor),
-                        h_class.Get()->GetClassLoader());
+    if (h_class->IsRetired()) {
+      // Get the updated class from class table.
+      klass = LookupClass(self, descriptor, ComputeModifiedUtf8Hash(descriptor),
+                          h_class.Get()->GetClassLoader());
+    } else {
+      klass = h_class.Get();
+    }
   }
 
   // Wait for the class if it has not already been linked.
@@ -2519,12 +2529,18 @@ mirror::Class* ClassLinker::DefineClass(Thread* self,
     }
   }
 
+  const OatClassLinkSnapshot* const snapshot =
+      FindLinkSnapshot(dex_file, dex_file.GetIndexForClassDef(dex_class_def));
   if (klass.Get() == nullptr) {
     // Allocate a class with the status of not ready.
     // Interface object should get the right size here. Regular class will
     // figure out the right size later and be replaced with one of the right
-    // size when the class becomes resolved.
-    klass.Assign(AllocClass(self, SizeOfClassWithoutEmbeddedTables(dex_file, dex_class_def)));
+    // size when the class becomes resolved, unless the oat file recorded the
+    // size and it still holds.
+    const uint32_t class_size = (snapshot != nullptr && snapshot->embedded_vtable_length_ != 0u)
+        ? snapshot->class_size_
+        : SizeOfClassWithoutEmbeddedTables(dex_file, dex_class_def);
+    klass.Assign(AllocClass(self, class_size));
   }
   if (UNLIKELY(klass.Get() == nullptr)) {
     self->AssertPendingOOMException();
@@ -2587,7 +2603,7 @@ mirror::Class* ClassLinker::DefineClass(Thread* self,
   auto interfaces = hs.NewHandle<mirror::ObjectArray<mirror::Class>>(nullptr);
 
   MutableHandle<mirror::Class> h_new_class = hs.NewHandle<mirror::Class>(nullptr);
-  if (!LinkClass(self, descriptor, klass, interfaces, &h_new_class)) {
+  if (!LinkClass(self, descriptor, klass, interfaces, snapshot, &h_new_class)) {
     // Linking failed.
     if (!klass->IsErroneous()) {
       mirror::Class::SetStatus(klass, mirror::Class::kStatusError, self);
@@ -2689,6 +2705,15 @@ uint32_t ClassLinker::SizeOfClassWithoutEmbeddedTables(const DexFile& dex_file,
                                          image_pointer_size_);
 }
 
+const OatClassLinkSnapshot* ClassLinker::FindLinkSnapshot(const DexFile& dex_file,
+                                                          uint16_t class_def_idx) {
+  if (dex_file.GetOatDexFile() == nullptr) {
+    return nullptr;
+  }
+  bool found;
+  return FindOatClass(dex_file, class_def_idx, &found).GetLinkSnapshot();
+}
+
 OatFile::OatClass ClassLinker::FindOatClass(const DexFile& dex_file,
                                             uint16_t class_def_idx,
                                             bool* found) {
@@ -3837,14 +3862,13 @@ mirror::Class* ClassLinker::LookupClass(Thread* self,
                                         const char* descriptor,
                                         size_t hash,
                                         mirror::ClassLoader* class_loader) {
-  {
-    ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
-    ClassTable* const class_table = ClassTableForClassLoader(class_loader);
-    if (class_table != nullptr) {
-      mirror::Class* result = class_table->Lookup(descriptor, hash);
-      if (result != nullptr) {
-        return result;
-      }
+  // Class table lookups do not need classlinker_classes_lock_. The table of a class loader is
+  // only deleted once the class loader is unreachable.
+  ClassTable* const class_table = ClassTableForClassLoader(class_loader);
+  if (class_table != nullptr) {
+    mirror::Class* result = class_table->Lookup(descriptor, hash);
+    if (result != nullptr) {
+      return result;
     }
   }
   if (class_loader != nullptr || !dex_cache_boot_image_class_lookup_required_) {
@@ -4158,12 +4182,26 @@ void ClassLinker::VerifyClass(Thread* self, Handle<mirror::Class> klass, LogSeve
   std::string error_msg;
   if (!preverified) {
     Runtime* runtime = Runtime::Current();
-    verifier_failure = verifier::MethodVerifier::VerifyClass(self,
-                                                             klass.Get(),
-                                                             runtime->GetCompilerCallbacks(),
-                                                             runtime->IsAotCompiler(),
-                                                             log_level,
-                                                             &error_msg);
+    // Try the result of verifying the class in an earlier run, otherwise record what the
+    // verification depends on so that a later run can use its result.
+    verifier::VerificationCache* cache =
+        runtime->IsAotCompiler() ? nullptr : GetVerificationCache(dex_file);
+    if (cache == nullptr || !cache->Lookup(self, klass, &verifier_failure)) {
+      std::unique_ptr<verifier::VerifierDeps> deps(
+          cache != nullptr ? new verifier::VerifierDeps() : nullptr);
+      {
+        verifier::ScopedVerifierDeps scoped_deps(self, deps.get());
+        verifier_failure = verifier::MethodVerifier::VerifyClass(self,
+                                                                 klass.Get(),
+                                                                 runtime->GetCompilerCallbacks(),
+                                                                 runtime->IsAotCompiler(),
+                                                                 log_level,
+                                                                 &error_msg);
+      }
+      if (cache != nullptr) {
+        cache->Record(klass->GetDexClassDefIndex(), verifier_failure, std::move(deps));
+      }
+    }
   }
 
   // Verification is done, grab the lock again.
@@ -4229,6 +4267,34 @@ void ClassLinker::VerifyClass(Thread* self, Handle<mirror::Class> klass, LogSeve
   }
 }
 
+void ClassLinker::SetVerificationCacheDirectory(const std::string& cache_dir) {
+  MutexLock mu(Thread::Current(), verification_caches_lock_);
+  if (verification_cache_dir_.empty()) {
+    VLOG(class_linker) << "Caching verification results in " << cache_dir;
+    verification_cache_dir_ = cache_dir;
+  }
+}
+
+verifier::VerificationCache* ClassLinker::GetVerificationCache(const DexFile& dex_file) {
+  MutexLock mu(Thread::Current(), verification_caches_lock_);
+  if (verification_cache_dir_.empty()) {
+    return nullptr;
+  }
+  auto it = verification_caches_.find(dex_file.GetLocation());
+  if (it == verification_caches_.end()) {
+    std::string error_msg;
+    std::unique_ptr<verifier::VerificationCache> cache =
+        verifier::VerificationCache::Open(verification_cache_dir_, dex_file, &error_msg);
+    if (cache == nullptr) {
+      LOG(WARNING) << "Not caching verification results of " << dex_file.GetLocation() << ": "
+                   << error_msg;
+    }
+    it = verification_caches_.emplace(dex_file.GetLocation(), std::move(cache)).first;
+  }
+  verifier::VerificationCache* cache = it->second.get();
+  return (cache != nullptr && cache->IsFor(dex_file)) ? cache : nullptr;
+}
+
 void ClassLinker::EnsureSkipAccessChecksMethods(Handle<mirror::Class> klass) {
   if (!klass->WasVerificationAttempted()) {
     klass->SetSkipAccessChecksFlagOnAllMethods(image_pointer_size_);
@@ -4462,7 +4528,7 @@ mirror::Class* ClassLinker::CreateProxyClass(ScopedObjectAccessAlreadyRunnable&
     // The new class will replace the old one in the class table.
     Handle<mirror::ObjectArray<mirror::Class>> h_interfaces(
         hs.NewHandle(soa.Decode<mirror::ObjectArray<mirror::Class>*>(interfaces)));
-    if (!LinkClass(self, descriptor.c_str(), klass, h_interfaces, &new_class)) {
+    if (!LinkClass(self, descriptor.c_str(), klass, h_interfaces, nullptr, &new_class)) {
       mirror::Class::SetStatus(klass, mirror::Class::kStatusError, self);
       return nullptr;
     }
@@ -5271,8 +5337,10 @@ void ClassLinker::RegisterClassLoader(mirror::ClassLoader* class_loader) {
   Thread* const self = Thread::Current();
   ClassLoaderData data;
   data.weak_root = self->GetJniEnv()->vm->AddWeakGlobalRef(self, class_loader);
-  // Create and set the class table.
+  // Create and set the class table. LookupClass() reads it without holding
+  // classlinker_classes_lock_, make sure it sees the constructed table.
   data.class_table = new ClassTable;
+  QuasiAtomic::ThreadFenceRelease();
   class_loader->SetClassTable(data.class_table);
   // Create and set the linear allocator.
   data.allocator = Runtime::Current()->CreateLinearAlloc();
@@ -5313,6 +5381,7 @@ bool ClassLinker::LinkClass(Thread* self,
                             const char* descriptor,
                             Handle<mirror::Class> klass,
                             Handle<mirror::ObjectArray<mirror::Class>> interfaces,
+                            const OatClassLinkSnapshot* snapshot,
                             MutableHandle<mirror::Class>* h_new_class_out) {
   CHECK_EQ(mirror::Class::kStatusLoaded, klass->GetStatus());
 
@@ -5323,14 +5392,17 @@ bool ClassLinker::LinkClass(Thread* self,
   // If there are any new conflicts compared to super class.
   bool new_conflict = false;
   std::fill_n(imt_data, arraysize(imt_data), Runtime::Current()->GetImtUnimplementedMethod());
-  if (!LinkMethods(self, klass, interfaces, &new_conflict, imt_data)) {
+  // The IMT of a lazily linked class is built on the first interface call that needs it.
+  const bool lazy_imt =
+      ShouldLinkLazily(klass->NumDirectMethods() + klass->NumDeclaredVirtualMethods());
+  if (!LinkMethods(self, klass, interfaces, &new_conflict, lazy_imt ? nullptr : imt_data)) {
     return false;
   }
-  if (!LinkInstanceFields(self, klass)) {
+  if (!LinkInstanceFields(self, klass, snapshot)) {
     return false;
   }
   size_t class_size;
-  if (!LinkStaticFields(self, klass, &class_size)) {
+  if (!LinkStaticFields(self, klass, snapshot, &class_size)) {
     return false;
   }
   CreateReferenceInstanceOffsets(klass);
@@ -5338,12 +5410,16 @@ bool ClassLinker::LinkClass(Thread* self,
 
   ImTable* imt = nullptr;
   if (klass->ShouldHaveImt()) {
-    // If there are any new conflicts compared to the super class we can not make a copy. There
-    // can be cases where both will have a conflict method at the same slot without having the same
-    // set of conflicts. In this case, we can not share the IMT since the conflict table slow path
-    // will possibly create a table that is incorrect for either of the classes.
-    // Same IMT with new_conflict does not happen very often.
-    if (!new_conflict) {
+    if (lazy_imt) {
+      // The IMT is filled in place by FillLazyImt, so it can not be shared with the super class.
+      std::fill_n(imt_data, arraysize(imt_data), lazy_imt_method_);
+      num_lazy_imts_.FetchAndAddRelaxed(1u);
+    } else if (!new_conflict) {
+      // If there are any new conflicts compared to the super class we can not make a copy. There
+      // can be cases where both will have a conflict method at the same slot without having the
+      // same set of conflicts. In this case, we can not share the IMT since the conflict table
+      // slow path will possibly create a table that is incorrect for either of the classes.
+      // Same IMT with new_conflict does not happen very often.
       ImTable* super_imt = FindSuperImt(klass.Get(), image_pointer_size_);
       if (super_imt != nullptr) {
         bool imt_equals = true;
@@ -5366,9 +5442,10 @@ bool ClassLinker::LinkClass(Thread* self,
     }
   }
 
-  if (!klass->IsTemp() || (!init_done_ && klass->GetClassSize() == class_size)) {
+  if (!klass->IsTemp() || klass->GetClassSize() == class_size) {
     // We don't need to retire this class as it has no embedded tables or it was created the
-    // correct size during class linker initialization.
+    // correct size, either during class linker initialization or from the link snapshot of the
+    // oat file.
     CHECK_EQ(klass->GetClassSize(), class_size) << PrettyDescriptor(klass.Get());
 
     if (klass->ShouldHaveEmbeddedVTable()) {
@@ -6304,7 +6381,10 @@ ArtMethod* ClassLinker::AddMethodToConflictTable(mirror::Class* klass,
   ImtConflictTable* current_table = conflict_method->GetImtConflictTable(sizeof(void*));
   Runtime* const runtime = Runtime::Current();
   LinearAlloc* linear_alloc = GetAllocatorForClassLoader(klass->GetClassLoader());
-  bool new_entry = conflict_method == runtime->GetImtConflictMethod() || force_new_conflict_method;
+  // The conflict tables of the shared conflict methods must stay empty.
+  bool new_entry = conflict_method == runtime->GetImtConflictMethod() ||
+                   IsLazyImtMethod(conflict_method) ||
+                   force_new_conflict_method;
 
   // Create a new entry if the existing one is the shared conflict method.
   ArtMethod* new_conflict_method = new_entry
@@ -6419,6 +6499,9 @@ void ClassLinker::FillIMTAndConflictTables(mirror::Class* klass) {
       imt = super_imt;
     }
   }
+  // Make sure the conflict tables are visible before the conflict methods, the IMT may already be
+  // in use if it was lazily linked.
+  QuasiAtomic::ThreadFenceRelease();
   if (imt == nullptr) {
     imt = klass->GetImt(image_pointer_size_);
     DCHECK(imt != nullptr);
@@ -6428,6 +6511,35 @@ void ClassLinker::FillIMTAndConflictTables(mirror::Class* klass) {
   }
 }
 
+void ClassLinker::EnableLazyLinking(size_t threshold) {
+  Runtime* const runtime = Runtime::Current();
+  CHECK(!runtime->IsAotCompiler());
+  if (lazy_imt_method_ == nullptr) {
+    lazy_imt_method_ = runtime->CreateImtConflictMethod(runtime->GetLinearAlloc());
+  }
+  lazy_link_threshold_ = threshold;
+}
+
+bool ClassLinker::HasLazyImtSlots(ImTable* imt) const {
+  if (lazy_imt_method_ == nullptr) {
+    return false;
+  }
+  for (size_t i = 0; i < ImTable::kSize; ++i) {
+    if (imt->Get(i, image_pointer_size_) == lazy_imt_method_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClassLinker::FillLazyImt(mirror::Class* klass) {
+  DCHECK(klass->ShouldHaveImt()) << PrettyClass(klass);
+  // Threads racing to build the IMT of the same class store the same implementation methods, only
+  // their conflict methods differ. The losing ones are leaked in the LinearAlloc.
+  FillIMTAndConflictTables(klass);
+  num_lazy_imts_filled_.FetchAndAddRelaxed(1u);
+}
+
 static inline uint32_t GetIMTIndex(ArtMethod* interface_method)
     SHARED_REQUIRES(Locks::mutator_lock_) {
   return interface_method->GetDexMethodIndex() % ImTable::kSize;
@@ -6846,13 +6958,15 @@ void ClassLinker::FillImtFromSuperClass(Handle<mirror::Class> klass,
                                         ArtMethod** imt) {
   DCHECK(klass->HasSuperClass());
   mirror::Class* super_class = klass->GetSuperClass();
-  if (super_class->ShouldHaveImt()) {
+  if (super_class->ShouldHaveImt() &&
+      !HasLazyImtSlots(super_class->GetImt(image_pointer_size_))) {
     ImTable* super_imt = super_class->GetImt(image_pointer_size_);
     for (size_t i = 0; i < ImTable::kSize; ++i) {
       imt[i] = super_imt->Get(i, image_pointer_size_);
     }
   } else {
-    // No imt in the super class, need to reconstruct from the iftable.
+    // No imt in the super class, or one that is not built yet, need to reconstruct from the
+    // iftable.
     mirror::IfTable* if_table = super_class->GetIfTable();
     if (if_table != nullptr) {
       // Ignore copied methods since we will handle these in LinkInterfaceMethods.
@@ -6907,7 +7021,7 @@ bool ClassLinker::LinkInterfaceMethods(
   ArtMethod* const imt_conflict_method = runtime->GetImtConflictMethod();
   // Copy the IMT from the super class if possible.
   const bool extend_super_iftable = has_superclass;
-  if (has_superclass && fill_tables) {
+  if (has_superclass && fill_tables && out_imt != nullptr) {
     FillImtFromSuperClass(klass,
                           unimplemented_method,
                           imt_conflict_method,
@@ -6997,8 +7111,8 @@ bool ClassLinker::LinkInterfaceMethods(
         auto* interface_method = iftable->GetInterface(i)->GetVirtualMethod(j, image_pointer_size_);
         MethodNameAndSignatureComparator interface_name_comparator(
             interface_method->GetInterfaceMethodIfProxy(image_pointer_size_));
-        uint32_t imt_index = GetIMTIndex(interface_method);
-        ArtMethod** imt_ptr = &out_imt[imt_index];
+        ArtMethod** imt_ptr =
+            (out_imt != nullptr) ? &out_imt[GetIMTIndex(interface_method)] : nullptr;
         // For each method listed in the interface's method list, find the
         // matching method in our class's method list.  We want to favor the
         // subclass over the superclass, which just requires walking
@@ -7039,12 +7153,14 @@ bool ClassLinker::LinkInterfaceMethods(
               found_impl = true;
               if (LIKELY(fill_tables)) {
                 method_array->SetElementPtrSize(j, vtable_method, image_pointer_size_);
-                // Place method in imt if entry is empty, place conflict otherwise.
-                SetIMTRef(unimplemented_method,
-                          imt_conflict_method,
-                          vtable_method,
-                          /*out*/out_new_conflict,
-                          /*out*/imt_ptr);
+                if (imt_ptr != nullptr) {
+                  // Place method in imt if entry is empty, place conflict otherwise.
+                  SetIMTRef(unimplemented_method,
+                            imt_conflict_method,
+                            vtable_method,
+                            /*out*/out_new_conflict,
+                            /*out*/imt_ptr);
+                }
               }
               break;
             }
@@ -7196,11 +7312,13 @@ bool ClassLinker::LinkInterfaceMethods(
           if (current_method != nullptr) {
             // We found a default method implementation. Record it in the iftable and IMT.
             method_array->SetElementPtrSize(j, current_method, image_pointer_size_);
-            SetIMTRef(unimplemented_method,
-                      imt_conflict_method,
-                      current_method,
-                      /*out*/out_new_conflict,
-                      /*out*/imt_ptr);
+            if (imt_ptr != nullptr) {
+              SetIMTRef(unimplemented_method,
+                        imt_conflict_method,
+                        current_method,
+                        /*out*/out_new_conflict,
+                        /*out*/imt_ptr);
+            }
           }
         }
       }  // For each method in interface end.
@@ -7431,7 +7549,7 @@ bool ClassLinker::LinkInterfaceMethods(
       }
 
       // Fix up IMT next
-      for (size_t i = 0; i < ImTable::kSize; ++i) {
+      for (size_t i = 0; out_imt != nullptr && i < ImTable::kSize; ++i) {
         auto it = move_table.find(out_imt[i]);
         if (it != move_table.end()) {
           out_imt[i] = it->second;
@@ -7474,14 +7592,61 @@ bool ClassLinker::LinkInterfaceMethods(
   return true;
 }
 
-bool ClassLinker::LinkInstanceFields(Thread* self, Handle<mirror::Class> klass) {
+bool ClassLinker::LinkInstanceFields(Thread* self,
+                                     Handle<mirror::Class> klass,
+                                     const OatClassLinkSnapshot* snapshot) {
   CHECK(klass.Get() != nullptr);
-  return LinkFields(self, klass, false, nullptr);
+  return LinkFields(self, klass, false, snapshot, nullptr);
 }
 
-bool ClassLinker::LinkStaticFields(Thread* self, Handle<mirror::Class> klass, size_t* class_size) {
+bool ClassLinker::LinkStaticFields(Thread* self,
+                                   Handle<mirror::Class> klass,
+                                   const OatClassLinkSnapshot* snapshot,
+                                   size_t* class_size) {
   CHECK(klass.Get() != nullptr);
-  return LinkFields(self, klass, true, class_size);
+  return LinkFields(self, klass, true, snapshot, class_size);
+}
+
+bool ClassLinker::LinkFieldsFromSnapshot(Handle<mirror::Class> klass,
+                                         bool is_static,
+                                         const OatClassLinkSnapshot& snapshot,
+                                         size_t* class_size) {
+  mirror::Class* super_class = klass->GetSuperClass();
+  if (is_static) {
+    const uint32_t vtable_length =
+        klass->ShouldHaveEmbeddedVTable() ? klass->GetVTableDuringLinking()->GetLength() : 0u;
+    if (snapshot.embedded_vtable_length_ != vtable_length ||
+        snapshot.num_static_fields_ != klass->NumStaticFields()) {
+      return false;
+    }
+    const uint32_t* offsets = snapshot.GetStaticFieldOffsets();
+    for (size_t i = 0; i != snapshot.num_static_fields_; ++i) {
+      DCHECK_LT(offsets[i], snapshot.class_size_) << PrettyClass(klass.Get());
+      klass->GetStaticField(i)->SetOffset(MemberOffset(offsets[i]));
+    }
+    klass->SetNumReferenceStaticFields(snapshot.num_reference_static_fields_);
+    *class_size = snapshot.class_size_;
+  } else {
+    if (super_class == nullptr ||
+        klass->IsVariableSize() ||
+        snapshot.super_object_size_ != super_class->GetObjectSize() ||
+        snapshot.num_instance_fields_ != klass->NumInstanceFields()) {
+      return false;
+    }
+    const uint32_t* offsets = snapshot.GetInstanceFieldOffsets();
+    for (size_t i = 0; i != snapshot.num_instance_fields_; ++i) {
+      DCHECK_GE(offsets[i], snapshot.super_object_size_) << PrettyClass(klass.Get());
+      DCHECK_LT(offsets[i], snapshot.object_size_) << PrettyClass(klass.Get());
+      klass->GetInstanceField(i)->SetOffset(MemberOffset(offsets[i]));
+    }
+    klass->SetNumReferenceInstanceFields(snapshot.num_reference_instance_fields_);
+    if (snapshot.num_reference_instance_fields_ == 0u &&
+        (super_class->GetClassFlags() & mirror::kClassFlagNoReferenceFields) != 0) {
+      klass->SetClassFlags(klass->GetClassFlags() | mirror::kClassFlagNoReferenceFields);
+    }
+    klass->SetObjectSize(snapshot.object_size_);
+  }
+  return true;
 }
 
 struct LinkFieldsComparator {
@@ -7521,8 +7686,12 @@ struct LinkFieldsComparator {
 bool ClassLinker::LinkFields(Thread* self,
                              Handle<mirror::Class> klass,
                              bool is_static,
+                             const OatClassLinkSnapshot* snapshot,
                              size_t* class_size) {
   self->AllowThreadSuspension();
+  if (snapshot != nullptr && LinkFieldsFromSnapshot(klass, is_static, *snapshot, class_size)) {
+    return true;
+  }
   const size_t num_fields = is_static ? klass->NumStaticFields() : klass->NumInstanceFields();
   LengthPrefixedArray<ArtField>* const fields = is_static ? klass->GetSFieldsPtr() :
       klass->GetIFieldsPtr();
@@ -8199,6 +8368,10 @@ void ClassLinker::DumpForSigQuit(std::ostream& os) {
   ReaderMutexLock mu(soa.Self(), *Locks::classlinker_classes_lock_);
   os << "Zygote loaded classes=" << NumZygoteClasses() << " post zygote classes="
      << NumNonZygoteClasses() << "\n";
+  if (lazy_link_threshold_ != 0u) {
+    os << "Lazy IMTs built/deferred=" << num_lazy_imts_filled_.LoadRelaxed()
+       << "/" << num_lazy_imts_.LoadRelaxed() << "\n";
+  }
 }
 
 class CountClassesVisitor : public ClassLoaderVisitor {
@@ -52,6 +52,9 @@ namespace mirror {
   template<class T> class ObjectArray;
   class StackTraceElement;
 }  // namespace mirror
+namespace verifier {
+  class VerificationCache;
+}  // namespace verifier
 
 class ImtConflictTable;
 template<class T> class Handle;
@@ -489,6 +492,9 @@ class ClassLinker {
                                mirror::Class::Status& oat_file_class_status)
       SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!dex_lock_);
+  // Returns the cache of runtime verification results for `dex_file`, or null if there is none.
+  verifier::VerificationCache* GetVerificationCache(const DexFile& dex_file)
+      REQUIRES(!verification_caches_lock_);
   void ResolveClassExceptionHandlerTypes(Handle<mirror::Class> klass)
       SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!hooked_methods_lock_)
@@ -605,6 +611,11 @@ class ClassLinker {
   // entries are roots, but potentially not image classes.
   void DropFindArrayClassCache() SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Sets the directory runtime verification results are cached in, see
+  // verifier::VerificationCache. Has no effect once a directory is set.
+  void SetVerificationCacheDirectory(const std::string& cache_dir)
+      REQUIRES(!verification_caches_lock_);
+
   // Clean up class loaders, this needs to happen after JNI weak globals are cleared.
   void CleanupClassLoaders()
       REQUIRES(!Locks::classlinker_classes_lock_)
@@ -659,6 +670,18 @@ class ClassLinker {
   // Create the IMT and conflict tables for a class.
   void FillIMTAndConflictTables(mirror::Class* klass) SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Link the classes declaring at least `threshold` methods lazily: their IMT is only built on the
+  // first interface call that goes through it. Only for a non-compiler runtime.
+  void EnableLazyLinking(size_t threshold) SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Returns true if `method` is the placeholder filling the IMT of a lazily linked class.
+  bool IsLazyImtMethod(ArtMethod* method) const {
+    return method == lazy_imt_method_ && method != nullptr;
+  }
+
+  // Build the IMT of a lazily linked class, replacing the placeholders.
+  void FillLazyImt(mirror::Class* klass) SHARED_REQUIRES(Locks::mutator_lock_);
+
   // Clear class table strong roots (other than classes themselves). This is done by dex2oat to
   // allow pruning dex caches.
   void ClearClassTableStrongRoots() const
@@ -818,6 +841,10 @@ class ClassLinker {
   OatFile::OatClass FindOatClass(const DexFile& dex_file, uint16_t class_def_idx, bool* found)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Finds the field layout the compiler recorded for a class in the oat file, or null.
+  const OatClassLinkSnapshot* FindLinkSnapshot(const DexFile& dex_file, uint16_t class_def_idx)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   void RegisterDexFileLocked(const DexFile& dex_file, Handle<mirror::DexCache> dex_cache)
       REQUIRES(dex_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
@@ -857,10 +884,13 @@ class ClassLinker {
                                                      mirror::Class* klass2)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Takes the field layout from `snapshot` if it is not null and still holds, see
+  // LinkFieldsFromSnapshot.
   bool LinkClass(Thread* self,
                  const char* descriptor,
                  Handle<mirror::Class> klass,
                  Handle<mirror::ObjectArray<mirror::Class>> interfaces,
+                 const OatClassLinkSnapshot* snapshot,
                  MutableHandle<mirror::Class>* h_new_class_out)
       SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!Locks::classlinker_classes_lock_);
@@ -1019,7 +1049,8 @@ class ClassLinker {
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   // Sets the imt entries and fixes up the vtable for the given class by linking all the interface
-  // methods. See LinkVirtualMethods for an explanation of what default_translations is.
+  // methods. See LinkVirtualMethods for an explanation of what default_translations is. The imt
+  // entries are not computed if out_imt is null.
   bool LinkInterfaceMethods(
       Thread* self,
       Handle<mirror::Class> klass,
@@ -1028,11 +1059,28 @@ class ClassLinker {
       ArtMethod** out_imt)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
-  bool LinkStaticFields(Thread* self, Handle<mirror::Class> klass, size_t* class_size)
+  // The snapshot may be null, the fields are laid out from scratch if it does not hold.
+  bool LinkStaticFields(Thread* self,
+                        Handle<mirror::Class> klass,
+                        const OatClassLinkSnapshot* snapshot,
+                        size_t* class_size)
       SHARED_REQUIRES(Locks::mutator_lock_);
-  bool LinkInstanceFields(Thread* self, Handle<mirror::Class> klass)
+  bool LinkInstanceFields(Thread* self,
+                          Handle<mirror::Class> klass,
+                          const OatClassLinkSnapshot* snapshot)
       SHARED_REQUIRES(Locks::mutator_lock_);
-  bool LinkFields(Thread* self, Handle<mirror::Class> klass, bool is_static, size_t* class_size)
+  bool LinkFields(Thread* self,
+                  Handle<mirror::Class> klass,
+                  bool is_static,
+                  const OatClassLinkSnapshot* snapshot,
+                  size_t* class_size)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+  // Takes the field layout from the snapshot if the super class and the embedded vtable have the
+  // sizes the compiler saw. Returns false without changing the class otherwise.
+  bool LinkFieldsFromSnapshot(Handle<mirror::Class> klass,
+                              bool is_static,
+                              const OatClassLinkSnapshot& snapshot,
+                              size_t* class_size)
       SHARED_REQUIRES(Locks::mutator_lock_);
   void LinkCode(ArtMethod* method,
                 const OatFile::OatClass* oat_class,
@@ -1160,6 +1208,13 @@ class ClassLinker {
                              bool* new_conflict,
                              ArtMethod** imt) SHARED_REQUIRES(Locks::mutator_lock_);
 
+  bool ShouldLinkLazily(size_t num_methods) const {
+    return lazy_link_threshold_ != 0u && num_methods >= lazy_link_threshold_;
+  }
+
+  // Returns true if the lazily linked IMT still has placeholders.
+  bool HasLazyImtSlots(ImTable* imt) const SHARED_REQUIRES(Locks::mutator_lock_);
+
   ArtMethod* FindArtMethodForIdx(mirror::DexCache* dex_cache,
                                  const DexFile* dex_file,
                                  uint32_t dex_method_idx,
@@ -1182,6 +1237,13 @@ class ClassLinker {
   // The hashes of all methods which have been hooked. Will always be sorted.
   std::vector<uint32_t> hooked_methods_hashes_ GUARDED_BY(hooked_methods_lock_);
 
+  Mutex verification_caches_lock_;
+  std::string verification_cache_dir_ GUARDED_BY(verification_caches_lock_);
+  // Verification caches by dex location. Null if the cache could not be opened. Caches are never
+  // removed, so they can be used without holding the lock.
+  std::unordered_map<std::string, std::unique_ptr<verifier::VerificationCache>>
+      verification_caches_ GUARDED_BY(verification_caches_lock_);
+
   // Boot class path table. Since the class loader for this is null.
   ClassTable boot_class_table_ GUARDED_BY(Locks::classlinker_classes_lock_);
 
@@ -1221,12 +1283,23 @@ class ClassLinker {
   // Image pointer size.
   size_t image_pointer_size_;
 
+  // Classes declaring at least this many methods are linked lazily, zero if lazy linking is
+  // disabled. See EnableLazyLinking.
+  size_t lazy_link_threshold_;
+  // Placeholder filling the IMT of lazily linked classes. A runtime method with an empty conflict
+  // table, so interface calls through it end up in artInvokeInterfaceTrampoline.
+  ArtMethod* lazy_imt_method_;
+  // Lazy linking statistics, dumped on SIGQUIT.
+  Atomic<uint32_t> num_lazy_imts_;
+  Atomic<uint32_t> num_lazy_imts_filled_;
+
   class FindVirtualMethodHolderVisitor;
   friend struct CompilationHelper;  // For Compile in ImageTest.
   friend class ImageDumper;  // for DexLock
   friend class ImageWriter;  // for GetClassRoots
   friend class JniCompilerTest;  // for GetRuntimeQuickGenericJniStub
   friend class JniInternalTest;  // for GetRuntimeQuickGenericJniStub
+  friend class LinkSnapshotTest;  // for DefineClass steps and LinkClass
   ART_FRIEND_TEST(ClassLinkerTest, RegisterDexFileName);  // for DexLock, and RegisterDexFileLocked
   ART_FRIEND_TEST(mirror::DexCacheTest, Open);  // for AllocDexCache
   DISALLOW_COPY_AND_ASSIGN(ClassLinker);
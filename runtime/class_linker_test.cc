@@ -21,7 +21,9 @@
 
 #include "art_field-inl.h"
 #include "art_method-inl.h"
+#include "base/time_utils.h"
 #include "class_linker-inl.h"
+#include "class_table.h"
 #include "common_runtime_test.h"
 #include "dex_file.h"
 #include "experimental_flags.h"
@@ -39,8 +41,12 @@
 #include "mirror/stack_trace_element.h"
 #include "mirror/string-inl.h"
 #include "handle_scope-inl.h"
+#include "imtable.h"
+#include "object_lock.h"
 #include "scoped_thread_state_change.h"
 #include "thread-inl.h"
+#include "thread_pool.h"
+#include "utf.h"
 
 namespace art {
 
@@ -1265,4 +1271,492 @@ TEST_F(ClassLinkerTest, RegisterDexFileName) {
   }
 }
 
+// Collects boot image classes, which are never moved by the GC.
+class BootImageClassesVisitor : public ClassVisitor {
+ public:
+  explicit BootImageClassesVisitor(size_t max_classes) : max_classes_(max_classes) {}
+
+  bool operator()(mirror::Class* klass) OVERRIDE SHARED_REQUIRES(Locks::mutator_lock_) {
+    if (Runtime::Current()->GetHeap()->ObjectIsInBootImageSpace(klass)) {
+      std::string temp;
+      classes_.push_back(klass);
+      descriptors_.push_back(klass->GetDescriptor(&temp));
+    }
+    return classes_.size() < max_classes_;
+  }
+
+  std::vector<mirror::Class*> classes_;
+  std::vector<std::string> descriptors_;
+
+ private:
+  const size_t max_classes_;
+};
+
+// Inserts the classes into the table one by one.
+class ClassTableInsertTask : public Task {
+ public:
+  ClassTableInsertTask(ClassTable* table,
+                       const BootImageClassesVisitor* classes,
+                       Atomic<size_t>* num_inserted)
+      : table_(table), classes_(classes), num_inserted_(num_inserted) {}
+
+  void Run(Thread* self) OVERRIDE {
+    ScopedObjectAccess soa(self);
+    for (size_t i = 0; i != classes_->classes_.size(); ++i) {
+      const char* descriptor = classes_->descriptors_[i].c_str();
+      table_->InsertWithHash(classes_->classes_[i], ComputeModifiedUtf8Hash(descriptor));
+      num_inserted_->StoreRelease(i + 1);
+    }
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  ClassTable* const table_;
+  const BootImageClassesVisitor* const classes_;
+  Atomic<size_t>* const num_inserted_;
+};
+
+// Looks up classes while they are being inserted. Every class inserted before a lookup started
+// must be found, the class being inserted may or may not be.
+class ClassTableLookupTask : public Task {
+ public:
+  ClassTableLookupTask(ClassTable* table,
+                       const BootImageClassesVisitor* classes,
+                       Atomic<size_t>* num_inserted)
+      : table_(table), classes_(classes), num_inserted_(num_inserted) {}
+
+  void Run(Thread* self) OVERRIDE {
+    ScopedObjectAccess soa(self);
+    const size_t num_classes = classes_->classes_.size();
+    bool done = false;
+    while (!done) {
+      const size_t num_inserted = num_inserted_->LoadAcquire();
+      done = num_inserted == num_classes;
+      for (size_t i = 0; i != num_classes; ++i) {
+        const char* descriptor = classes_->descriptors_[i].c_str();
+        mirror::Class* klass = table_->Lookup(descriptor, ComputeModifiedUtf8Hash(descriptor));
+        if (i < num_inserted) {
+          ASSERT_EQ(classes_->classes_[i], klass) << descriptor;
+        } else if (klass != nullptr) {
+          ASSERT_EQ(classes_->classes_[i], klass) << descriptor;
+          ASSERT_LE(i, num_inserted_->LoadAcquire()) << descriptor;
+        }
+      }
+      self->AllowThreadSuspension();
+    }
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  ClassTable* const table_;
+  const BootImageClassesVisitor* const classes_;
+  Atomic<size_t>* const num_inserted_;
+};
+
+TEST_F(ClassLinkerTest, ClassTableConcurrentLookups) {
+  // Enough classes for the newest class set to be copied and republished several times while the
+  // lookups are running.
+  static constexpr size_t kNumClasses = 2000;
+  static constexpr size_t kNumLookupThreads = 4;
+  Thread* const self = Thread::Current();
+  BootImageClassesVisitor classes(kNumClasses);
+  std::unique_ptr<ClassTable> table;
+  {
+    ScopedObjectAccess soa(self);
+    class_linker_->VisitClasses(&classes);
+    table.reset(new ClassTable());
+  }
+  ASSERT_FALSE(classes.classes_.empty());
+  Atomic<size_t> num_inserted(0u);
+  ThreadPool thread_pool("Class table test thread pool", kNumLookupThreads + 1);
+  for (size_t i = 0; i != kNumLookupThreads; ++i) {
+    thread_pool.AddTask(self, new ClassTableLookupTask(table.get(), &classes, &num_inserted));
+  }
+  thread_pool.AddTask(self, new ClassTableInsertTask(table.get(), &classes, &num_inserted));
+  thread_pool.StartWorkers(self);
+  thread_pool.Wait(self, false, false);
+
+  ScopedObjectAccess soa(self);
+  EXPECT_EQ(classes.classes_.size(), table->NumNonZygoteClasses());
+  for (mirror::Class* klass : classes.classes_) {
+    EXPECT_TRUE(table->Contains(klass));
+  }
+}
+
+// Looks up boot classes through the class linker.
+class ClassLookupBenchmarkTask : public Task {
+ public:
+  ClassLookupBenchmarkTask(ClassLinker* class_linker,
+                           const BootImageClassesVisitor* classes,
+                           size_t iterations)
+      : class_linker_(class_linker), classes_(classes), iterations_(iterations) {}
+
+  void Run(Thread* self) OVERRIDE {
+    ScopedObjectAccess soa(self);
+    for (size_t i = 0; i != iterations_; ++i) {
+      for (const std::string& descriptor : classes_->descriptors_) {
+        const size_t hash = ComputeModifiedUtf8Hash(descriptor.c_str());
+        ASSERT_TRUE(class_linker_->LookupClass(self, descriptor.c_str(), hash, nullptr) != nullptr)
+            << descriptor;
+      }
+      self->AllowThreadSuspension();
+    }
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  ClassLinker* const class_linker_;
+  const BootImageClassesVisitor* const classes_;
+  const size_t iterations_;
+};
+
+TEST_F(ClassLinkerTest, ClassLookupContentionBenchmark) {
+  static constexpr size_t kNumClasses = 500;
+  static constexpr size_t kNumThreads = 8;
+  static constexpr size_t kNumIterations = 200;
+  Thread* const self = Thread::Current();
+  BootImageClassesVisitor classes(kNumClasses);
+  {
+    ScopedObjectAccess soa(self);
+    class_linker_->VisitClasses(&classes);
+  }
+  ThreadPool thread_pool("Class lookup benchmark thread pool", kNumThreads);
+  for (size_t i = 0; i != kNumThreads; ++i) {
+    thread_pool.AddTask(self,
+                        new ClassLookupBenchmarkTask(class_linker_, &classes, kNumIterations));
+  }
+  const uint64_t start = NanoTime();
+  thread_pool.StartWorkers(self);
+  thread_pool.Wait(self, false, false);
+  LOG(INFO) << kNumThreads << " threads looked up " << classes.classes_.size() << " classes "
+            << kNumIterations << " times in " << PrettyDuration(NanoTime() - start);
+}
+
+class LazyLinkingTest : public ClassLinkerTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    options->push_back(std::make_pair("-Xlazylinkthreshold:1", nullptr));
+  }
+};
+
+TEST_F(LazyLinkingTest, FillImtOnDemand) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::ClassLoader> class_loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader*>(LoadDex("Interfaces"))));
+  Handle<mirror::Class> klass(
+      hs.NewHandle(class_linker_->FindClass(soa.Self(), "LInterfaces$A;", class_loader)));
+  ASSERT_TRUE(klass.Get() != nullptr);
+  ASSERT_TRUE(klass->ShouldHaveImt());
+  const size_t pointer_size = class_linker_->GetImagePointerSize();
+
+  // Only placeholders until the first interface call.
+  ImTable* imt = klass->GetImt(pointer_size);
+  for (size_t i = 0; i < ImTable::kSize; ++i) {
+    EXPECT_TRUE(class_linker_->IsLazyImtMethod(imt->Get(i, pointer_size))) << i;
+  }
+
+  class_linker_->FillLazyImt(klass.Get());
+  imt = klass->GetImt(pointer_size);
+  for (size_t i = 0; i < ImTable::kSize; ++i) {
+    EXPECT_FALSE(class_linker_->IsLazyImtMethod(imt->Get(i, pointer_size))) << i;
+  }
+  mirror::IfTable* iftable = klass->GetIfTable();
+  for (int32_t i = 0; i < klass->GetIfTableCount(); ++i) {
+    for (ArtMethod& interface_method : iftable->GetInterface(i)->GetVirtualMethods(pointer_size)) {
+      ArtMethod* implementation =
+          klass->FindVirtualMethodForInterface(&interface_method, pointer_size);
+      ASSERT_TRUE(implementation != nullptr);
+      ArtMethod* imt_method =
+          imt->Get(interface_method.GetDexMethodIndex() % ImTable::kSize, pointer_size);
+      if (imt_method->IsRuntimeMethod()) {
+        ImtConflictTable* table = imt_method->GetImtConflictTable(pointer_size);
+        EXPECT_EQ(implementation, table->Lookup(&interface_method, pointer_size));
+      } else {
+        EXPECT_EQ(implementation, imt_method);
+      }
+    }
+  }
+}
+
+class LinkSnapshotTest : public ClassLinkerTest {
+ protected:
+  // Returns the OatClassLinkSnapshot the oat writer records for the linked `klass`, followed by
+  // the field offsets.
+  static std::vector<uint32_t> TakeSnapshot(mirror::Class* klass)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    const size_t num_static_fields = klass->NumStaticFields();
+    const size_t num_instance_fields = klass->NumInstanceFields();
+    std::vector<uint32_t> data(
+        sizeof(OatClassLinkSnapshot) / sizeof(uint32_t) + num_static_fields + num_instance_fields);
+    OatClassLinkSnapshot* snapshot = AsSnapshot(&data);
+    snapshot->super_object_size_ = klass->GetSuperClass()->GetObjectSize();
+    snapshot->embedded_vtable_length_ = klass->GetEmbeddedVTableLength();
+    snapshot->object_size_ = klass->GetObjectSize();
+    snapshot->class_size_ = klass->GetClassSize();
+    snapshot->num_static_fields_ = num_static_fields;
+    snapshot->num_instance_fields_ = num_instance_fields;
+    snapshot->num_reference_static_fields_ = klass->NumReferenceStaticFields();
+    snapshot->num_reference_instance_fields_ = klass->NumReferenceInstanceFields();
+    uint32_t* offsets = &data[sizeof(OatClassLinkSnapshot) / sizeof(uint32_t)];
+    for (size_t i = 0; i != num_static_fields; ++i) {
+      *offsets++ = klass->GetStaticField(i)->GetOffset().Uint32Value();
+    }
+    for (size_t i = 0; i != num_instance_fields; ++i) {
+      *offsets++ = klass->GetInstanceField(i)->GetOffset().Uint32Value();
+    }
+    return data;
+  }
+
+  static OatClassLinkSnapshot* AsSnapshot(std::vector<uint32_t>* data) {
+    return reinterpret_cast<OatClassLinkSnapshot*>(data->data());
+  }
+
+  // Swaps the offsets of two fields of the same size in the snapshot, a layout that still holds
+  // but that LinkFields does not produce.
+  static void SwapOffsets(std::vector<uint32_t>* data, size_t first, size_t second) {
+    uint32_t* offsets = &(*data)[sizeof(OatClassLinkSnapshot) / sizeof(uint32_t)];
+    std::swap(offsets[first], offsets[second]);
+  }
+
+  static size_t StaticFieldIndex(mirror::Class* klass, const char* name)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    for (size_t i = 0; i != klass->NumStaticFields(); ++i) {
+      if (strcmp(klass->GetStaticField(i)->GetName(), name) == 0) {
+        return i;
+      }
+    }
+    LOG(FATAL) << "No static field " << name << " in " << PrettyClass(klass);
+    UNREACHABLE();
+  }
+
+  static size_t InstanceFieldIndex(mirror::Class* klass, const char* name)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    for (size_t i = 0; i != klass->NumInstanceFields(); ++i) {
+      if (strcmp(klass->GetInstanceField(i)->GetName(), name) == 0) {
+        return i;
+      }
+    }
+    LOG(FATAL) << "No instance field " << name << " in " << PrettyClass(klass);
+    UNREACHABLE();
+  }
+
+  // Defines `descriptor` from the dex file of a new class loader the way DefineClass does, but
+  // allocates the class with `class_size` and links it with `snapshot`. Sets `temp_class` to the
+  // class allocated and returns the linked one.
+  mirror::Class* DefineWithSnapshot(Thread* self,
+                                    const char* descriptor,
+                                    uint32_t class_size,
+                                    const OatClassLinkSnapshot* snapshot,
+                                    MutableHandle<mirror::Class>* temp_class)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    jobject jclass_loader = LoadDex("AllFields");
+    std::vector<const DexFile*> dex_files = GetDexFiles(jclass_loader);
+    CHECK_EQ(1u, dex_files.size());
+    const DexFile& dex_file = *dex_files[0];
+    const size_t hash = ComputeModifiedUtf8Hash(descriptor);
+    const DexFile::ClassDef* class_def = dex_file.FindClassDef(descriptor, hash);
+    CHECK(class_def != nullptr);
+    StackHandleScope<3> hs(self);
+    Handle<mirror::ClassLoader> class_loader(
+        hs.NewHandle(self->DecodeJObject(jclass_loader)->AsClassLoader()));
+
+    temp_class->Assign(class_linker_->AllocClass(self, class_size));
+    CHECK(temp_class->Get() != nullptr);
+    (*temp_class)->SetDexCache(class_linker_->RegisterDexFile(dex_file, class_loader.Get()));
+    class_linker_->SetupClass(dex_file, *class_def, *temp_class, class_loader.Get());
+    ObjectLock<mirror::Class> lock(self, *temp_class);
+    (*temp_class)->SetClinitThreadId(self->GetTid());
+    CHECK(class_linker_->InsertClass(descriptor, temp_class->Get(), hash) == nullptr);
+    class_linker_->LoadClass(self, dex_file, *class_def, *temp_class);
+    CHECK(class_linker_->LoadSuperAndInterfaces(*temp_class, dex_file));
+
+    auto interfaces = hs.NewHandle<mirror::ObjectArray<mirror::Class>>(nullptr);
+    MutableHandle<mirror::Class> new_class = hs.NewHandle<mirror::Class>(nullptr);
+    CHECK(class_linker_->LinkClass(
+        self, descriptor, *temp_class, interfaces, snapshot, &new_class));
+    CHECK(new_class->IsResolved());
+    CHECK_EQ(new_class.Get(),
+             class_linker_->LookupClass(self, descriptor, hash, class_loader.Get()));
+    return new_class.Get();
+  }
+
+  // Loads AllFields without a snapshot, as the reference layout.
+  mirror::Class* LoadReference(ScopedObjectAccess& soa) SHARED_REQUIRES(Locks::mutator_lock_) {
+    StackHandleScope<1> hs(soa.Self());
+    Handle<mirror::ClassLoader> class_loader(
+        hs.NewHandle(soa.Decode<mirror::ClassLoader*>(LoadDex("AllFields"))));
+    mirror::Class* klass = class_linker_->FindClass(soa.Self(), "LAllFields;", class_loader);
+    CHECK(klass != nullptr);
+    return klass;
+  }
+
+  // The snapshot of the reference class with the offsets of sI and sF, and of iI and iF, swapped.
+  static std::vector<uint32_t> TakeSwappedSnapshot(mirror::Class* reference)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    std::vector<uint32_t> data = TakeSnapshot(reference);
+    SwapOffsets(&data, StaticFieldIndex(reference, "sI"), StaticFieldIndex(reference, "sF"));
+    const size_t num_static_fields = reference->NumStaticFields();
+    SwapOffsets(&data,
+                num_static_fields + InstanceFieldIndex(reference, "iI"),
+                num_static_fields + InstanceFieldIndex(reference, "iF"));
+    return data;
+  }
+
+  uint32_t SizeOfClassWithoutEmbeddedTables(mirror::Class* klass)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    const DexFile& dex_file = klass->GetDexFile();
+    return class_linker_->SizeOfClassWithoutEmbeddedTables(
+        dex_file, dex_file.GetClassDef(klass->GetDexClassDefIndex()));
+  }
+
+  static uint32_t StaticOffset(mirror::Class* klass, const char* name)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    return klass->GetStaticField(StaticFieldIndex(klass, name))->GetOffset().Uint32Value();
+  }
+
+  static uint32_t InstanceOffset(mirror::Class* klass, const char* name)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    return klass->GetInstanceField(InstanceFieldIndex(klass, name))->GetOffset().Uint32Value();
+  }
+};
+
+TEST_F(LinkSnapshotTest, AdoptSnapshot) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> reference(hs.NewHandle(LoadReference(soa)));
+  std::vector<uint32_t> data = TakeSwappedSnapshot(reference.Get());
+  const OatClassLinkSnapshot* snapshot = AsSnapshot(&data);
+
+  MutableHandle<mirror::Class> temp_class(hs.NewHandle<mirror::Class>(nullptr));
+  mirror::Class* klass = DefineWithSnapshot(
+      soa.Self(), "LAllFields;", snapshot->class_size_, snapshot, &temp_class);
+  // Allocated with the right size, so resolved in place.
+  EXPECT_EQ(temp_class.Get(), klass);
+  EXPECT_FALSE(klass->IsRetired());
+  EXPECT_EQ(reference->GetClassSize(), klass->GetClassSize());
+  EXPECT_EQ(reference->GetObjectSize(), klass->GetObjectSize());
+  EXPECT_EQ(StaticOffset(reference.Get(), "sF"), StaticOffset(klass, "sI"));
+  EXPECT_EQ(StaticOffset(reference.Get(), "sI"), StaticOffset(klass, "sF"));
+  EXPECT_EQ(InstanceOffset(reference.Get(), "iF"), InstanceOffset(klass, "iI"));
+  EXPECT_EQ(InstanceOffset(reference.Get(), "iI"), InstanceOffset(klass, "iF"));
+  EXPECT_EQ(reference->NumReferenceStaticFields(), klass->NumReferenceStaticFields());
+  EXPECT_EQ(reference->NumReferenceInstanceFields(), klass->NumReferenceInstanceFields());
+}
+
+TEST_F(LinkSnapshotTest, SuperObjectSizeMismatch) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> reference(hs.NewHandle(LoadReference(soa)));
+  std::vector<uint32_t> data = TakeSwappedSnapshot(reference.Get());
+  OatClassLinkSnapshot* snapshot = AsSnapshot(&data);
+  snapshot->super_object_size_ += sizeof(uint32_t);
+
+  MutableHandle<mirror::Class> temp_class(hs.NewHandle<mirror::Class>(nullptr));
+  mirror::Class* klass = DefineWithSnapshot(
+      soa.Self(), "LAllFields;", snapshot->class_size_, snapshot, &temp_class);
+  // The instance fields are laid out from scratch, the static fields still use the snapshot.
+  EXPECT_EQ(InstanceOffset(reference.Get(), "iI"), InstanceOffset(klass, "iI"));
+  EXPECT_EQ(InstanceOffset(reference.Get(), "iF"), InstanceOffset(klass, "iF"));
+  EXPECT_EQ(reference->GetObjectSize(), klass->GetObjectSize());
+  EXPECT_EQ(StaticOffset(reference.Get(), "sF"), StaticOffset(klass, "sI"));
+  EXPECT_EQ(temp_class.Get(), klass);
+}
+
+TEST_F(LinkSnapshotTest, InstanceFieldCountMismatch) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> reference(hs.NewHandle(LoadReference(soa)));
+  std::vector<uint32_t> data = TakeSwappedSnapshot(reference.Get());
+  OatClassLinkSnapshot* snapshot = AsSnapshot(&data);
+  snapshot->num_instance_fields_ -= 1u;
+
+  MutableHandle<mirror::Class> temp_class(hs.NewHandle<mirror::Class>(nullptr));
+  mirror::Class* klass = DefineWithSnapshot(
+      soa.Self(), "LAllFields;", snapshot->class_size_, snapshot, &temp_class);
+  EXPECT_EQ(InstanceOffset(reference.Get(), "iI"), InstanceOffset(klass, "iI"));
+  EXPECT_EQ(InstanceOffset(reference.Get(), "iF"), InstanceOffset(klass, "iF"));
+  EXPECT_EQ(StaticOffset(reference.Get(), "sF"), StaticOffset(klass, "sI"));
+}
+
+TEST_F(LinkSnapshotTest, EmbeddedVTableLengthMismatch) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> reference(hs.NewHandle(LoadReference(soa)));
+  std::vector<uint32_t> data = TakeSwappedSnapshot(reference.Get());
+  OatClassLinkSnapshot* snapshot = AsSnapshot(&data);
+  snapshot->embedded_vtable_length_ += 1u;
+
+  MutableHandle<mirror::Class> temp_class(hs.NewHandle<mirror::Class>(nullptr));
+  mirror::Class* klass = DefineWithSnapshot(
+      soa.Self(), "LAllFields;", snapshot->class_size_, snapshot, &temp_class);
+  // The static fields are laid out from scratch, the instance fields still use the snapshot.
+  EXPECT_EQ(StaticOffset(reference.Get(), "sI"), StaticOffset(klass, "sI"));
+  EXPECT_EQ(StaticOffset(reference.Get(), "sF"), StaticOffset(klass, "sF"));
+  EXPECT_EQ(InstanceOffset(reference.Get(), "iF"), InstanceOffset(klass, "iI"));
+  // The computed class size is the one the class was allocated with.
+  EXPECT_EQ(reference->GetClassSize(), klass->GetClassSize());
+  EXPECT_EQ(temp_class.Get(), klass);
+}
+
+TEST_F(LinkSnapshotTest, StaticFieldCountMismatch) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> reference(hs.NewHandle(LoadReference(soa)));
+  std::vector<uint32_t> data = TakeSwappedSnapshot(reference.Get());
+  OatClassLinkSnapshot* snapshot = AsSnapshot(&data);
+  // Drop the offset of the last static field, the instance field offsets still follow.
+  data.erase(data.begin() + sizeof(OatClassLinkSnapshot) / sizeof(uint32_t) +
+             snapshot->num_static_fields_ - 1u);
+  snapshot = AsSnapshot(&data);
+  snapshot->num_static_fields_ -= 1u;
+
+  MutableHandle<mirror::Class> temp_class(hs.NewHandle<mirror::Class>(nullptr));
+  mirror::Class* klass = DefineWithSnapshot(
+      soa.Self(), "LAllFields;", snapshot->class_size_, snapshot, &temp_class);
+  EXPECT_EQ(StaticOffset(reference.Get(), "sI"), StaticOffset(klass, "sI"));
+  EXPECT_EQ(StaticOffset(reference.Get(), "sF"), StaticOffset(klass, "sF"));
+}
+
+TEST_F(LinkSnapshotTest, ResolveTempClassInPlace) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> reference(hs.NewHandle(LoadReference(soa)));
+
+  // Without a snapshot, a class allocated with its final size is still resolved in place.
+  MutableHandle<mirror::Class> temp_class(hs.NewHandle<mirror::Class>(nullptr));
+  mirror::Class* klass = DefineWithSnapshot(
+      soa.Self(), "LAllFields;", reference->GetClassSize(), nullptr, &temp_class);
+  EXPECT_EQ(temp_class.Get(), klass);
+  EXPECT_FALSE(klass->IsRetired());
+  EXPECT_EQ(reference->GetClassSize(), klass->GetClassSize());
+}
+
+TEST_F(LinkSnapshotTest, RetireTempClassOfWrongSize) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> reference(hs.NewHandle(LoadReference(soa)));
+  std::vector<uint32_t> data = TakeSnapshot(reference.Get());
+  const OatClassLinkSnapshot* snapshot = AsSnapshot(&data);
+
+  // Allocated without the embedded tables, so retired even though the snapshot is used.
+  const uint32_t temp_size = SizeOfClassWithoutEmbeddedTables(reference.Get());
+  ASSERT_NE(snapshot->class_size_, temp_size);
+  MutableHandle<mirror::Class> temp_class(hs.NewHandle<mirror::Class>(nullptr));
+  mirror::Class* klass =
+      DefineWithSnapshot(soa.Self(), "LAllFields;", temp_size, snapshot, &temp_class);
+  EXPECT_NE(temp_class.Get(), klass);
+  EXPECT_TRUE(temp_class->IsRetired());
+  EXPECT_EQ(snapshot->class_size_, klass->GetClassSize());
+}
+
 }  // namespace art
@@ -16,26 +16,42 @@
 
 #include "class_table.h"
 
+#include <algorithm>
+
 #include "mirror/class-inl.h"
 
 namespace art {
 
 ClassTable::ClassTable() : lock_("Class loader classes", kClassLoaderClassesLock) {
   Runtime* const runtime = Runtime::Current();
-  classes_.push_back(ClassSet(runtime->GetHashTableMinLoadFactor(),
-                              runtime->GetHashTableMaxLoadFactor()));
+  ClassSet* const class_set = new ClassSet(runtime->GetHashTableMinLoadFactor(),
+                                           runtime->GetHashTableMaxLoadFactor());
+  ClassSets* const class_sets = new ClassSets(1u, class_set);
+  owned_sets_.emplace_back(class_set);
+  owned_class_sets_.emplace_back(class_sets);
+  classes_.StoreRelaxed(class_sets);
+}
+
+void ClassTable::Publish(ClassSets* class_sets, ClassSet* class_set) {
+  DCHECK(std::find(class_sets->begin(), class_sets->end(), class_set) != class_sets->end());
+  owned_sets_.emplace_back(class_set);
+  owned_class_sets_.emplace_back(class_sets);
+  // Release so that lookups see the contents of the new set.
+  classes_.StoreRelease(class_sets);
 }
 
 void ClassTable::FreezeSnapshot() {
   WriterMutexLock mu(Thread::Current(), lock_);
-  classes_.push_back(ClassSet());
+  ClassSet* const class_set = new ClassSet();
+  ClassSets* const class_sets = new ClassSets(GetClassSets());
+  class_sets->push_back(class_set);
+  Publish(class_sets, class_set);
 }
 
 bool ClassTable::Contains(mirror::Class* klass) {
-  ReaderMutexLock mu(Thread::Current(), lock_);
-  for (ClassSet& class_set : classes_) {
-    auto it = class_set.Find(GcRoot<mirror::Class>(klass));
-    if (it != class_set.end()) {
+  for (ClassSet* class_set : GetClassSets()) {
+    auto it = class_set->Find(GcRoot<mirror::Class>(klass));
+    if (it != class_set->end()) {
       return it->Read() == klass;
     }
   }
@@ -43,10 +59,9 @@ bool ClassTable::Contains(mirror::Class* klass) {
 }
 
 mirror::Class* ClassTable::LookupByDescriptor(mirror::Class* klass) {
-  ReaderMutexLock mu(Thread::Current(), lock_);
-  for (ClassSet& class_set : classes_) {
-    auto it = class_set.Find(GcRoot<mirror::Class>(klass));
-    if (it != class_set.end()) {
+  for (ClassSet* class_set : GetClassSets()) {
+    auto it = class_set->Find(GcRoot<mirror::Class>(klass));
+    if (it != class_set->end()) {
       return it->Read();
     }
   }
@@ -55,11 +70,12 @@ mirror::Class* ClassTable::LookupByDescriptor(mirror::Class* klass) {
 
 mirror::Class* ClassTable::UpdateClass(const char* descriptor, mirror::Class* klass, size_t hash) {
   WriterMutexLock mu(Thread::Current(), lock_);
+  const ClassSets& class_sets = GetClassSets();
   // Should only be updating latest table.
-  auto existing_it = classes_.back().FindWithHash(descriptor, hash);
-  if (kIsDebugBuild && existing_it == classes_.back().end()) {
-    for (const ClassSet& class_set : classes_) {
-      if (class_set.FindWithHash(descriptor, hash) != class_set.end()) {
+  auto existing_it = class_sets.back()->FindWithHash(descriptor, hash);
+  if (kIsDebugBuild && existing_it == class_sets.back()->end()) {
+    for (const ClassSet* class_set : class_sets) {
+      if (class_set->FindWithHash(descriptor, hash) != class_set->end()) {
         LOG(FATAL) << "Updating class found in frozen table " << descriptor;
       }
     }
@@ -72,30 +88,31 @@ mirror::Class* ClassTable::UpdateClass(const char* descriptor, mirror::Class* kl
   CHECK(!klass->IsTemp()) << descriptor;
   VerifyObject(klass);
   // Update the element in the hash set with the new class. This is safe to do since the descriptor
-  // doesn't change.
+  // doesn't change. Lookups see either class, make sure they see the fields of the new one.
+  QuasiAtomic::ThreadFenceRelease();
   *existing_it = GcRoot<mirror::Class>(klass);
   return existing;
 }
 
 size_t ClassTable::NumZygoteClasses() const {
   ReaderMutexLock mu(Thread::Current(), lock_);
+  const ClassSets& class_sets = GetClassSets();
   size_t sum = 0;
-  for (size_t i = 0; i < classes_.size() - 1; ++i) {
-    sum += classes_[i].Size();
+  for (size_t i = 0; i < class_sets.size() - 1; ++i) {
+    sum += class_sets[i]->Size();
   }
   return sum;
 }
 
 size_t ClassTable::NumNonZygoteClasses() const {
   ReaderMutexLock mu(Thread::Current(), lock_);
-  return classes_.back().Size();
+  return GetClassSets().back()->Size();
 }
 
 mirror::Class* ClassTable::Lookup(const char* descriptor, size_t hash) {
-  ReaderMutexLock mu(Thread::Current(), lock_);
-  for (ClassSet& class_set : classes_) {
-    auto it = class_set.FindWithHash(descriptor, hash);
-    if (it != class_set.end()) {
+  for (ClassSet* class_set : GetClassSets()) {
+    auto it = class_set->FindWithHash(descriptor, hash);
+    if (it != class_set->end()) {
      return it->Read();
     }
   }
@@ -104,24 +121,40 @@ mirror::Class* ClassTable::Lookup(const char* descriptor, size_t hash) {
 
 void ClassTable::Insert(mirror::Class* klass) {
   WriterMutexLock mu(Thread::Current(), lock_);
-  classes_.back().Insert(GcRoot<mirror::Class>(klass));
+  InsertWithHashLocked(klass, ClassDescriptorHashEquals()(GcRoot<mirror::Class>(klass)));
 }
 
 void ClassTable::InsertWithoutLocks(mirror::Class* klass) {
-  classes_.back().Insert(GcRoot<mirror::Class>(klass));
+  InsertWithHashLocked(klass, ClassDescriptorHashEquals()(GcRoot<mirror::Class>(klass)));
 }
 
 void ClassTable::InsertWithHash(mirror::Class* klass, size_t hash) {
   WriterMutexLock mu(Thread::Current(), lock_);
-  classes_.back().InsertWithHash(GcRoot<mirror::Class>(klass), hash);
+  InsertWithHashLocked(klass, hash);
+}
+
+void ClassTable::InsertWithHashLocked(mirror::Class* klass, size_t hash) {
+  ClassSet* const newest = GetClassSets().back();
+  if (newest->Size() >= newest->ElementsUntilExpand()) {
+    // Expanding reallocates the buckets lookups may be reading, expand a copy instead.
+    ClassSet* const class_set = new ClassSet(*newest);
+    class_set->InsertWithHash(GcRoot<mirror::Class>(klass), hash);
+    ClassSets* const class_sets = new ClassSets(GetClassSets());
+    class_sets->back() = class_set;
+    Publish(class_sets, class_set);
+  } else {
+    // Inserting only fills an empty slot, lookups see it either empty or holding the new class.
+    QuasiAtomic::ThreadFenceRelease();
+    newest->InsertWithHash(GcRoot<mirror::Class>(klass), hash);
+  }
 }
 
 bool ClassTable::Remove(const char* descriptor) {
   WriterMutexLock mu(Thread::Current(), lock_);
-  for (ClassSet& class_set : classes_) {
-    auto it = class_set.Find(descriptor);
-    if (it != class_set.end()) {
-      class_set.Erase(it);
+  for (ClassSet* class_set : GetClassSets()) {
+    auto it = class_set->Find(descriptor);
+    if (it != class_set->end()) {
+      class_set->Erase(it);
       return true;
     }
   }
@@ -167,8 +200,8 @@ size_t ClassTable::WriteToMemory(uint8_t* ptr) const {
   ClassSet combined;
   // Combine all the class sets in case there are multiple, also adjusts load factor back to
   // default in case classes were pruned.
-  for (const ClassSet& class_set : classes_) {
-    for (const GcRoot<mirror::Class>& root : class_set) {
+  for (const ClassSet* class_set : GetClassSets()) {
+    for (const GcRoot<mirror::Class>& root : *class_set) {
       combined.Insert(root);
     }
   }
@@ -190,7 +223,10 @@ size_t ClassTable::ReadFromMemory(uint8_t* ptr) {
 
 void ClassTable::AddClassSet(ClassSet&& set) {
   WriterMutexLock mu(Thread::Current(), lock_);
-  classes_.insert(classes_.begin(), std::move(set));
+  ClassSet* const class_set = new ClassSet(std::move(set));
+  ClassSets* const class_sets = new ClassSets(GetClassSets());
+  class_sets->insert(class_sets->begin(), class_set);
+  Publish(class_sets, class_set);
 }
 
 void ClassTable::ClearStrongRoots() {
@@ -17,10 +17,12 @@
 #ifndef ART_RUNTIME_CLASS_TABLE_H_
 #define ART_RUNTIME_CLASS_TABLE_H_
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "atomic.h"
 #include "base/allocator.h"
 #include "base/hash_set.h"
 #include "base/macros.h"
@@ -36,7 +38,9 @@ namespace mirror {
   class ClassLoader;
 }  // namespace mirror
 
-// Each loader has a ClassTable
+// Each loader has a ClassTable. Lookups do not take the lock: the class sets they read are
+// published as a whole and a published set is never resized or freed, inserting into a set which
+// would have to expand inserts into a copy of it and publishes a new list of sets instead.
 class ClassTable {
  public:
   class ClassDescriptorHashEquals {
@@ -69,9 +73,8 @@ class ClassTable {
 
   ClassTable();
 
-  // Used by image writer for checking.
+  // Used by image writer for checking. Does not take the lock.
   bool Contains(mirror::Class* klass)
-      REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   // Freeze the current class tables by allocating a new table and never updating or modifying the
@@ -110,14 +113,14 @@ class ClassTable {
       REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
-  // Return the first class that matches the descriptor. Returns null if there are none.
+  // Return the first class that matches the descriptor. Returns null if there are none. Does not
+  // take the lock, a class inserted concurrently may or may not be found.
   mirror::Class* Lookup(const char* descriptor, size_t hash)
-      REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   // Return the first class that matches the descriptor of klass. Returns null if there are none.
+  // Does not take the lock.
   mirror::Class* LookupByDescriptor(mirror::Class* klass)
-      REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   void Insert(mirror::Class* klass)
@@ -128,7 +131,9 @@ class ClassTable {
       REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
-  // Returns true if the class was found and removed, false otherwise.
+  // Returns true if the class was found and removed, false otherwise. The class is removed in
+  // place, so a concurrent lookup may miss a class moved by the removal. This is only used by the
+  // image writer while pruning classes.
   bool Remove(const char* descriptor)
       REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
@@ -163,12 +168,32 @@ class ClassTable {
   }
 
  private:
+  typedef std::vector<ClassSet*> ClassSets;
+
   void InsertWithoutLocks(mirror::Class* klass) NO_THREAD_SAFETY_ANALYSIS;
 
+  void InsertWithHashLocked(mirror::Class* klass, size_t hash) REQUIRES(lock_);
+
+  // The class sets lookups currently see, oldest first.
+  const ClassSets& GetClassSets() const {
+    return *classes_.LoadAcquire();
+  }
+
+  // Makes lookups use `class_sets`, which must hold the new set `class_set`. Takes ownership of
+  // both.
+  void Publish(ClassSets* class_sets, ClassSet* class_set) REQUIRES(lock_);
+
   // Lock to guard inserting and removing.
   mutable ReaderWriterMutex lock_;
-  // We have a vector to help prevent dirty pages after the zygote forks by calling FreezeSnapshot.
-  std::vector<ClassSet> classes_ GUARDED_BY(lock_);
+  // We have several sets to help prevent dirty pages after the zygote forks by calling
+  // FreezeSnapshot. Only the newest set is inserted into. Written with the lock held, read by
+  // lookups without it.
+  Atomic<const ClassSets*> classes_;
+  // Every set and list of sets ever published. Lookups may still be reading the replaced ones,
+  // so they are only freed with the table. Sets are replaced when they expand, so the replaced
+  // sets take at most as much memory as the live ones.
+  std::vector<std::unique_ptr<ClassSet>> owned_sets_ GUARDED_BY(lock_);
+  std::vector<std::unique_ptr<const ClassSets>> owned_class_sets_ GUARDED_BY(lock_);
   // Extra strong roots that can be either dex files or dex caches. Dex files used by the class
   // loader which may not be owned by the class loader must be held strongly live. Also dex caches
   // are held live to prevent them being unloading once they have classes in them.
@@ -18,23 +18,27 @@
 
 #include <fcntl.h>
 #include <limits.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/file.h>
 #include <sys/stat.h>
 
+#include <functional>
 #include <memory>
 #include <sstream>
 
 #include "art_field-inl.h"
 #include "art_method-inl.h"
+#include "atomic.h"
 #include "base/file_magic.h"
 #include "base/hash_map.h"
 #include "base/logging.h"
 #include "base/stl_util.h"
 #include "base/stringprintf.h"
 #include "base/systrace.h"
+#include "base/timing_logger.h"
 #include "class_linker-inl.h"
 #include "dex_file-inl.h"
 #include "dex_file_verifier.h"
@@ -46,6 +50,7 @@
 #include "mirror/string.h"
 #include "os.h"
 #include "reflection.h"
+#include "runtime.h"
 #include "safe_map.h"
 #include "thread.h"
 #include "type_lookup_table.h"
@@ -121,7 +126,8 @@ bool DexFile::GetChecksum(const char* filename, uint32_t* checksum, std::string*
 }
 
 bool DexFile::Open(const char* filename, const char* location, std::string* error_msg,
-                   std::vector<std::unique_ptr<const DexFile>>* dex_files) {
+                   std::vector<std::unique_ptr<const DexFile>>* dex_files,
+                   TimingLogger* timings) {
   ScopedTrace trace(std::string("Open dex file ") + location);
   DCHECK(dex_files != nullptr) << "DexFile::Open: out-param is nullptr";
   uint32_t magic;
@@ -131,7 +137,7 @@ bool DexFile::Open(const char* filename, const char* location, std::string* erro
     return false;
   }
   if (IsZipMagic(magic)) {
-    return DexFile::OpenZip(fd.release(), location, error_msg, dex_files);
+    return DexFile::OpenZip(fd.release(), location, error_msg, dex_files, timings);
   }
   if (IsDexMagic(magic)) {
     std::unique_ptr<const DexFile> dex_file(DexFile::OpenFile(fd.release(), location, true,
@@ -286,7 +292,8 @@ std::unique_ptr<const DexFile> DexFile::OpenFile(int fd, const char* location, b
 const char* DexFile::kClassesDex = "classes.dex";
 
 bool DexFile::OpenZip(int fd, const std::string& location, std::string* error_msg,
-                      std::vector<std::unique_ptr<const DexFile>>* dex_files) {
+                      std::vector<std::unique_ptr<const DexFile>>* dex_files,
+                      TimingLogger* timings) {
   ScopedTrace trace("Dex file open Zip " + std::string(location));
   DCHECK(dex_files != nullptr) << "DexFile::OpenZip: out-param is nullptr";
   std::unique_ptr<ZipArchive> zip_archive(ZipArchive::OpenFromFd(fd, location.c_str(), error_msg));
@@ -294,7 +301,7 @@ bool DexFile::OpenZip(int fd, const std::string& location, std::string* error_ms
     DCHECK(!error_msg->empty());
     return false;
   }
-  return DexFile::OpenFromZip(*zip_archive, location, error_msg, dex_files);
+  return DexFile::OpenFromZip(*zip_archive, location, error_msg, dex_files, timings);
 }
 
 std::unique_ptr<const DexFile> DexFile::OpenMemory(const std::string& location,
@@ -310,25 +317,51 @@ std::unique_ptr<const DexFile> DexFile::OpenMemory(const std::string& location,
                     error_msg);
 }
 
-std::unique_ptr<const DexFile> DexFile::Open(const ZipArchive& zip_archive, const char* entry_name,
-                                             const std::string& location, std::string* error_msg,
-                                             ZipOpenErrorCode* error_code) {
-  ScopedTrace trace("Dex file open from Zip Archive " + std::string(location));
+std::unique_ptr<MemMap> DexFile::ExtractZipEntry(const ZipArchive& zip_archive,
+                                                 const char* entry_name,
+                                                 const std::string& location,
+                                                 uint32_t* location_checksum,
+                                                 std::string* error_msg,
+                                                 ZipOpenErrorCode* error_code) {
+  ScopedTrace trace("Dex file extract from Zip Archive " + std::string(location));
   CHECK(!location.empty());
   std::unique_ptr<ZipEntry> zip_entry(zip_archive.Find(entry_name, error_msg));
   if (zip_entry.get() == nullptr) {
     *error_code = ZipOpenErrorCode::kEntryNotFound;
     return nullptr;
   }
-  std::unique_ptr<MemMap> map(zip_entry->ExtractToMemMap(location.c_str(), entry_name, error_msg));
+  std::unique_ptr<MemMap> map;
+  if (zip_entry->IsUncompressed() && zip_entry->IsAlignedTo(alignof(Header))) {
+    // Map a stored dex file straight from the zip file. Its pages stay clean and shareable instead
+    // of being copied into private memory.
+    map.reset(zip_entry->MapDirectlyFromFile(location.c_str(), entry_name, error_msg));
+    if (map.get() == nullptr) {
+      LOG(WARNING) << "Can't map '" << entry_name << "' from '" << location << "' directly, "
+                   << "extracting it instead: " << *error_msg;
+      error_msg->clear();
+    }
+  }
+  if (map.get() == nullptr) {
+    map.reset(zip_entry->ExtractToMemMap(location.c_str(), entry_name, error_msg));
+  }
   if (map.get() == nullptr) {
     *error_msg = StringPrintf("Failed to extract '%s' from '%s': %s", entry_name, location.c_str(),
                               error_msg->c_str());
     *error_code = ZipOpenErrorCode::kExtractToMemoryError;
     return nullptr;
   }
-  std::unique_ptr<const DexFile> dex_file(OpenMemory(location, zip_entry->GetCrc32(), map.release(),
-                                               error_msg));
+  *location_checksum = zip_entry->GetCrc32();
+  return map;
+}
+
+std::unique_ptr<const DexFile> DexFile::OpenZipEntry(std::unique_ptr<MemMap> map,
+                                                     const std::string& location,
+                                                     uint32_t location_checksum,
+                                                     std::string* error_msg,
+                                                     ZipOpenErrorCode* error_code) {
+  ScopedTrace trace("Dex file open from Zip Archive " + std::string(location));
+  std::unique_ptr<const DexFile> dex_file(OpenMemory(location, location_checksum, map.release(),
+                                                     error_msg));
   if (dex_file.get() == nullptr) {
     *error_msg = StringPrintf("Failed to open dex file '%s' from memory: %s", location.c_str(),
                               error_msg->c_str());
@@ -356,53 +389,155 @@ std::unique_ptr<const DexFile> DexFile::Open(const ZipArchive& zip_archive, cons
 // seems an excessive number.
 static constexpr size_t kWarnOnManyDexFilesThreshold = 100;
 
+// Upper bound of the threads extracting and verifying the dex files of a multidex zip archive.
+static constexpr size_t kMaxOpenFromZipThreads = 4;
+
+// Runs `function` on `num_threads` threads, including the calling one which first runs
+// `caller_function`. Dex files are also opened before the runtime is started, or without any
+// runtime, so the helper threads only attach to the runtime when it is started, as unattached
+// threads may then not take ART locks.
+static void RunOnThreads(size_t num_threads,
+                         const std::function<void()>& caller_function,
+                         const std::function<void()>& function) {
+  struct HelperArgs {
+    const std::function<void()>* function;
+    bool attach;
+  };
+  Runtime* const runtime = Runtime::Current();
+  HelperArgs args = { &function, runtime != nullptr && runtime->IsStarted() };
+  auto helper = [](void* arg) -> void* {
+    const HelperArgs* helper_args = reinterpret_cast<const HelperArgs*>(arg);
+    if (helper_args->attach) {
+      CHECK(Runtime::Current()->AttachCurrentThread("Dex file opener", true, nullptr, false));
+      Thread::Current()->SetCanCallIntoJava(false);
+    }
+    (*helper_args->function)();
+    if (helper_args->attach) {
+      Runtime::Current()->DetachCurrentThread();
+    }
+    return nullptr;
+  };
+  std::vector<pthread_t> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    pthread_t thread;
+    const int rc = pthread_create(&thread, nullptr, helper, &args);
+    if (rc != 0) {
+      // The calling thread does the remaining work anyway.
+      errno = rc;
+      PLOG(WARNING) << "Failed to create a dex file opener thread";
+      break;
+    }
+    threads.push_back(thread);
+  }
+  caller_function();
+  function();
+  for (pthread_t thread : threads) {
+    CHECK_PTHREAD_CALL(pthread_join, (thread, nullptr), "dex file opener shutdown");
+  }
+}
+
 bool DexFile::OpenFromZip(const ZipArchive& zip_archive, const std::string& location,
                           std::string* error_msg,
-                          std::vector<std::unique_ptr<const DexFile>>* dex_files) {
+                          std::vector<std::unique_ptr<const DexFile>>* dex_files,
+                          TimingLogger* timings) {
   ScopedTrace trace("Dex file open from Zip " + std::string(location));
   DCHECK(dex_files != nullptr) << "DexFile::OpenFromZip: out-param is nullptr";
-  ZipOpenErrorCode error_code;
-  std::unique_ptr<const DexFile> dex_file(Open(zip_archive, kClassesDex, location, error_msg,
-                                               &error_code));
-  if (dex_file.get() == nullptr) {
-    return false;
-  } else {
-    // Had at least classes.dex.
-    dex_files->push_back(std::move(dex_file));
-
-    // Now try some more.
-
-    // We could try to avoid std::string allocations by working on a char array directly. As we
-    // do not expect a lot of iterations, this seems too involved and brittle.
-
-    for (size_t i = 1; ; ++i) {
-      std::string name = GetMultiDexClassesDexName(i);
-      std::string fake_location = GetMultiDexLocation(i, location.c_str());
-      std::unique_ptr<const DexFile> next_dex_file(Open(zip_archive, name.c_str(), fake_location,
-                                                        error_msg, &error_code));
-      if (next_dex_file.get() == nullptr) {
-        if (error_code != ZipOpenErrorCode::kEntryNotFound) {
-          LOG(WARNING) << error_msg;
-        }
-        break;
-      } else {
-        dex_files->push_back(std::move(next_dex_file));
-      }
+  if (timings != nullptr) {
+    timings->StartTiming("Find multidex entries");
+  }
+  // The entries are classes.dex, classes2.dex, ... up to the first missing one. A missing
+  // classes.dex is reported when opening it.
+
+  // We could try to avoid std::string allocations by working on a char array directly. As we
+  // do not expect a lot of iterations, this seems too involved and brittle.
+  std::vector<std::string> names(1, kClassesDex);
+  std::vector<std::string> locations(1, location);
+  for (size_t i = 1; ; ++i) {
+    std::string name = GetMultiDexClassesDexName(i);
+    std::string entry_error_msg;
+    if (std::unique_ptr<ZipEntry>(zip_archive.Find(name.c_str(), &entry_error_msg)) == nullptr) {
+      break;
+    }
+    names.push_back(name);
+    locations.push_back(GetMultiDexLocation(i, location.c_str()));
 
-      if (i == kWarnOnManyDexFilesThreshold) {
-        LOG(WARNING) << location << " has in excess of " << kWarnOnManyDexFilesThreshold
-                     << " dex files. Please consider coalescing and shrinking the number to "
-                        " avoid runtime overhead.";
-      }
+    if (i == kWarnOnManyDexFilesThreshold) {
+      LOG(WARNING) << location << " has in excess of " << kWarnOnManyDexFilesThreshold
+                   << " dex files. Please consider coalescing and shrinking the number to "
+                      " avoid runtime overhead.";
+    }
+
+    if (i == std::numeric_limits<size_t>::max()) {
+      LOG(ERROR) << "Overflow in number of dex files!";
+      break;
+    }
+  }
 
-      if (i == std::numeric_limits<size_t>::max()) {
-        LOG(ERROR) << "Overflow in number of dex files!";
+  // Extraction reads through the file offset of the archive, so the calling thread extracts (or
+  // maps) the entries in order, up to the first failure. The dex files are opened and verified
+  // concurrently, each as soon as its entry is extracted. The results are kept per entry and
+  // collected in order below, so the dex files and the errors reported do not depend on the
+  // scheduling of the threads.
+  const size_t num_entries = names.size();
+  std::vector<std::unique_ptr<MemMap>> maps(num_entries);
+  std::vector<uint32_t> checksums(num_entries, 0u);
+  std::vector<std::unique_ptr<const DexFile>> opened(num_entries);
+  std::vector<std::string> error_msgs(num_entries);
+  std::vector<ZipOpenErrorCode> error_codes(num_entries, ZipOpenErrorCode::kNoError);
+  Atomic<size_t> num_extracted(0);
+  Atomic<size_t> next_entry(0);
+  auto extract_entries = [&]() {
+    for (size_t i = 0; i < num_entries; ++i) {
+      maps[i] = ExtractZipEntry(zip_archive, names[i].c_str(), locations[i], &checksums[i],
+                                &error_msgs[i], &error_codes[i]);
+      if (maps[i].get() == nullptr) {
         break;
       }
+      num_extracted.StoreRelease(i + 1);
     }
+    // The entries which were not extracted are skipped.
+    num_extracted.StoreRelease(num_entries);
+  };
+  auto open_entries = [&]() {
+    for (size_t i = next_entry.FetchAndAddSequentiallyConsistent(1);
+         i < num_entries;
+         i = next_entry.FetchAndAddSequentiallyConsistent(1)) {
+      while (num_extracted.LoadAcquire() <= i) {
+        sched_yield();
+      }
+      if (maps[i].get() != nullptr) {
+        opened[i] = OpenZipEntry(std::move(maps[i]), locations[i], checksums[i], &error_msgs[i],
+                                 &error_codes[i]);
+      }
+    }
+  };
+  const size_t num_threads = std::min(
+      std::min(num_entries, kMaxOpenFromZipThreads),
+      static_cast<size_t>(std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L)));
+  if (timings != nullptr) {
+    timings->NewTiming("Open and verify dex files");
+  }
+  RunOnThreads(num_threads, extract_entries, open_entries);
+  if (timings != nullptr) {
+    timings->EndTiming();
+  }
 
-    return true;
+  if (opened[0].get() == nullptr) {
+    *error_msg = error_msgs[0];
+    return false;
   }
+  // Had at least classes.dex. Keep the following entries up to the first one which failed.
+  for (size_t i = 0; i < num_entries; ++i) {
+    if (opened[i].get() == nullptr) {
+      *error_msg = error_msgs[i];
+      if (error_codes[i] != ZipOpenErrorCode::kEntryNotFound) {
+        LOG(WARNING) << *error_msg;
+      }
+      break;
+    }
+    dex_files->push_back(std::move(opened[i]));
+  }
+  return true;
 }
 
 
@@ -1387,6 +1522,39 @@ bool DexFile::IsMethodAnnotationPresent(ArtMethod* method, Handle<mirror::Class>
   return annotation_item != nullptr;
 }
 
+bool DexFile::HasMethodAnnotation(uint32_t method_idx, const char* descriptor) const {
+  const ClassDef* class_def = FindClassDef(GetMethodId(method_idx).class_idx_);
+  if (class_def == nullptr) {
+    return false;
+  }
+  const AnnotationsDirectoryItem* annotations_dir = GetAnnotationsDirectory(*class_def);
+  if (annotations_dir == nullptr) {
+    return false;
+  }
+  const MethodAnnotationsItem* method_annotations = GetMethodAnnotations(annotations_dir);
+  if (method_annotations == nullptr) {
+    return false;
+  }
+  for (uint32_t i = 0; i < annotations_dir->methods_size_; ++i) {
+    if (method_annotations[i].method_idx_ != method_idx) {
+      continue;
+    }
+    const AnnotationSetItem* annotation_set = GetMethodAnnotationSetItem(method_annotations[i]);
+    if (annotation_set == nullptr) {
+      return false;
+    }
+    for (uint32_t j = 0; j < annotation_set->size_; ++j) {
+      const uint8_t* annotation = GetAnnotationItem(annotation_set, j)->annotation_;
+      uint32_t type_index = DecodeUnsignedLeb128(&annotation);
+      if (strcmp(descriptor, StringByTypeIdx(type_index)) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+  return false;
+}
+
 const DexFile::AnnotationSetItem* DexFile::FindAnnotationSetForClass(Handle<mirror::Class> klass)
     const {
   const AnnotationsDirectoryItem* annotations_dir = GetAnnotationsDirectory(*klass->GetClassDef());
@@ -51,6 +51,7 @@ class OatDexFile;
 class Signature;
 template<class T> class Handle;
 class StringPiece;
+class TimingLogger;
 class TypeLookupTable;
 class ZipArchive;
 
@@ -416,8 +417,10 @@ class DexFile {
   static bool GetChecksum(const char* filename, uint32_t* checksum, std::string* error_msg);
 
   // Opens .dex files found in the container, guessing the container format based on file extension.
+  // If `timings` is not null, the opening of a multidex zip archive is split into phases in it.
   static bool Open(const char* filename, const char* location, std::string* error_msg,
-                   std::vector<std::unique_ptr<const DexFile>>* dex_files);
+                   std::vector<std::unique_ptr<const DexFile>>* dex_files,
+                   TimingLogger* timings = nullptr);
 
   // Checks whether the given file has the dex magic, or is a zip file with a classes.dex entry.
   // If this function returns false, Open will not succeed. The inverse is not true, however.
@@ -431,10 +434,12 @@ class DexFile {
                                              bool verify,
                                              std::string* error_msg);
 
-  // Open all classesXXX.dex files from a zip archive.
+  // Open all classesXXX.dex files from a zip archive. The entries are extracted and verified by
+  // several threads, the dex files are returned in the order of the entries.
   static bool OpenFromZip(const ZipArchive& zip_archive, const std::string& location,
                           std::string* error_msg,
-                          std::vector<std::unique_ptr<const DexFile>>* dex_files);
+                          std::vector<std::unique_ptr<const DexFile>>* dex_files,
+                          TimingLogger* timings = nullptr);
 
   // Closes a .dex file.
   virtual ~DexFile();
@@ -1003,6 +1008,9 @@ class DexFile {
       SHARED_REQUIRES(Locks::mutator_lock_);
   bool IsMethodAnnotationPresent(ArtMethod* method, Handle<mirror::Class> annotation_class) const
       SHARED_REQUIRES(Locks::mutator_lock_);
+  // Checks for an annotation of the given type on a method of this dex file, with any visibility.
+  // Only looks at the dex file, so it does not need the declaring class to be loaded.
+  bool HasMethodAnnotation(uint32_t method_idx, const char* descriptor) const;
 
   const AnnotationSetItem* FindAnnotationSetForClass(Handle<mirror::Class> klass) const
       SHARED_REQUIRES(Locks::mutator_lock_);
@@ -1185,7 +1193,8 @@ class DexFile {
 
   // Opens dex files from within a .jar, .zip, or .apk file
   static bool OpenZip(int fd, const std::string& location, std::string* error_msg,
-                      std::vector<std::unique_ptr<const DexFile>>* dex_files);
+                      std::vector<std::unique_ptr<const DexFile>>* dex_files,
+                      TimingLogger* timings);
 
   enum class ZipOpenErrorCode {  // private
     kNoError,
@@ -1196,11 +1205,23 @@ class DexFile {
     kVerifyError
   };
 
-  // Opens .dex file from the entry_name in a zip archive. error_code is undefined when non-null
-  // return.
-  static std::unique_ptr<const DexFile> Open(const ZipArchive& zip_archive, const char* entry_name,
-                                             const std::string& location, std::string* error_msg,
-                                             ZipOpenErrorCode* error_code);
+  // Maps or extracts the entry_name of a zip archive, to be opened with OpenZipEntry. Extraction
+  // reads through the file offset of the archive, so it must not run concurrently with other
+  // extractions from the same archive. error_code is undefined when non-null return.
+  static std::unique_ptr<MemMap> ExtractZipEntry(const ZipArchive& zip_archive,
+                                                 const char* entry_name,
+                                                 const std::string& location,
+                                                 uint32_t* location_checksum,
+                                                 std::string* error_msg,
+                                                 ZipOpenErrorCode* error_code);
+
+  // Opens and verifies the .dex file of a zip entry returned by ExtractZipEntry. error_code is
+  // undefined when non-null return.
+  static std::unique_ptr<const DexFile> OpenZipEntry(std::unique_ptr<MemMap> map,
+                                                     const std::string& location,
+                                                     uint32_t location_checksum,
+                                                     std::string* error_msg,
+                                                     ZipOpenErrorCode* error_code);
 
   // Opens a .dex file at the given address backed by a MemMap
   static std::unique_ptr<const DexFile> OpenMemory(const std::string& location,
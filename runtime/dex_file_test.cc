@@ -19,6 +19,7 @@
 #include <memory>
 
 #include "base/stl_util.h"
+#include "base/timing_logger.h"
 #include "base/unix_file/fd_file.h"
 #include "common_runtime_test.h"
 #include "dex_file-inl.h"
@@ -165,6 +166,36 @@ static std::unique_ptr<const DexFile> OpenDexFileBase64(const char* base64,
   return dex_file;
 }
 
+TEST_F(DexFileTest, OpenMultiDexInOrder) {
+  std::string dex_location = GetTestDexFileName("MultiDex");
+  std::string error_msg;
+  TimingLogger timings("OpenMultiDex", false, false);
+  std::vector<std::unique_ptr<const DexFile>> dex_files;
+  ASSERT_TRUE(DexFile::Open(dex_location.c_str(),
+                            dex_location.c_str(),
+                            &error_msg,
+                            &dex_files,
+                            &timings)) << error_msg;
+  ASSERT_GT(dex_files.size(), 1u);
+  for (size_t i = 0; i < dex_files.size(); ++i) {
+    EXPECT_EQ(DexFile::GetMultiDexLocation(i, dex_location.c_str()),
+              dex_files[i]->GetLocation());
+    EXPECT_TRUE(dex_files[i]->IsReadOnly());
+  }
+  timings.Verify();
+  EXPECT_NE(TimingLogger::kIndexNotFound, timings.FindTimingIndex("Open and verify dex files", 0));
+
+  // The result does not depend on the scheduling of the threads.
+  std::vector<std::unique_ptr<const DexFile>> dex_files2;
+  ASSERT_TRUE(DexFile::Open(dex_location.c_str(), dex_location.c_str(), &error_msg, &dex_files2))
+      << error_msg;
+  ASSERT_EQ(dex_files.size(), dex_files2.size());
+  for (size_t i = 0; i < dex_files.size(); ++i) {
+    EXPECT_EQ(dex_files[i]->GetLocation(), dex_files2[i]->GetLocation());
+    EXPECT_EQ(dex_files[i]->GetLocationChecksum(), dex_files2[i]->GetLocationChecksum());
+  }
+}
+
 TEST_F(DexFileTest, Header) {
   ScratchFile tmp;
   std::unique_ptr<const DexFile> raw(OpenDexFileBase64(kRawDex, tmp.GetFilename().c_str()));
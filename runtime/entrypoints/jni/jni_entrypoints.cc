@@ -31,7 +31,10 @@ extern "C" void* artFindNativeMethod() {
 extern "C" void* artFindNativeMethod(Thread* self) {
   DCHECK_EQ(self, Thread::Current());
 #endif
-  Locks::mutator_lock_->AssertNotHeld(self);  // We come here as Native.
+  // We come here as Native, except for the first call of a critical native which stays Runnable.
+  if (self->GetState() != kRunnable) {
+    Locks::mutator_lock_->AssertNotHeld(self);
+  }
   ScopedObjectAccess soa(self);
 
   ArtMethod* method = self->GetCurrentMethod(nullptr);
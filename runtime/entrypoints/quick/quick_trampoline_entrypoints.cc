@@ -2184,6 +2184,7 @@ extern "C" TwoWordReturn artInvokeInterfaceTrampoline(uint32_t deadbeef ATTRIBUT
       dex_method_idx, sizeof(void*));
   DCHECK(interface_method != nullptr) << dex_method_idx << " " << PrettyMethod(caller_method);
   ArtMethod* method = nullptr;
+  ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
   ImTable* imt = cls->GetImt(sizeof(void*));
 
   if (LIKELY(interface_method->GetDexMethodIndex() != DexFile::kDexNoIndex)) {
@@ -2191,6 +2192,12 @@ extern "C" TwoWordReturn artInvokeInterfaceTrampoline(uint32_t deadbeef ATTRIBUT
     // a match in the ImtConflictTable.
     uint32_t imt_index = interface_method->GetDexMethodIndex();
     ArtMethod* conflict_method = imt->Get(imt_index % ImTable::kSize, sizeof(void*));
+    if (UNLIKELY(class_linker->IsLazyImtMethod(conflict_method))) {
+      // First interface call through the IMT of a lazily linked class, build it now.
+      class_linker->FillLazyImt(cls.Get());
+      imt = cls->GetImt(sizeof(void*));
+      conflict_method = imt->Get(imt_index % ImTable::kSize, sizeof(void*));
+    }
     if (LIKELY(conflict_method->IsRuntimeMethod())) {
       ImtConflictTable* current_table = conflict_method->GetImtConflictTable(sizeof(void*));
       DCHECK(current_table != nullptr);
@@ -2243,8 +2250,13 @@ extern "C" TwoWordReturn artInvokeInterfaceTrampoline(uint32_t deadbeef ATTRIBUT
   // We create a new table with the new pair { interface_method, method }.
   uint32_t imt_index = interface_method->GetDexMethodIndex();
   ArtMethod* conflict_method = imt->Get(imt_index % ImTable::kSize, sizeof(void*));
+  if (UNLIKELY(class_linker->IsLazyImtMethod(conflict_method))) {
+    class_linker->FillLazyImt(cls.Get());
+    imt = cls->GetImt(sizeof(void*));
+    conflict_method = imt->Get(imt_index % ImTable::kSize, sizeof(void*));
+  }
   if (conflict_method->IsRuntimeMethod()) {
-    ArtMethod* new_conflict_method = Runtime::Current()->GetClassLinker()->AddMethodToConflictTable(
+    ArtMethod* new_conflict_method = class_linker->AddMethodToConflictTable(
         cls.Get(),
         conflict_method,
         interface_method,
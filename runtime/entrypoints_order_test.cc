@@ -136,7 +136,10 @@ class EntrypointsOrderTest : public CommonRuntimeTest {
     EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, nested_signal_state, flip_function, sizeof(void*));
     EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, flip_function, method_verifier, sizeof(void*));
     EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, method_verifier, thread_local_mark_stack, sizeof(void*));
-    EXPECT_OFFSET_DIFF(Thread, tlsPtr_.thread_local_mark_stack, Thread, wait_mutex_, sizeof(void*),
+    EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, thread_local_mark_stack, verifier_deps, sizeof(void*));
+    EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, verifier_deps, trace_sample_buffer, sizeof(void*));
+    EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, trace_sample_buffer, trace_event_buffer, sizeof(void*));
+    EXPECT_OFFSET_DIFF(Thread, tlsPtr_.trace_event_buffer, Thread, wait_mutex_, sizeof(void*),
                        thread_tlsptr_end);
   }
 
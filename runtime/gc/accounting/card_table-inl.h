@@ -52,6 +52,25 @@ static inline bool byte_cas(uint8_t old_value, uint8_t new_value, uint8_t* addre
 template <bool kClearCard, typename Visitor>
 inline size_t CardTable::Scan(ContinuousSpaceBitmap* bitmap, uint8_t* scan_begin, uint8_t* scan_end,
                               const Visitor& visitor, const uint8_t minimum_age) const {
+  size_t cards_scanned = 0;
+  // Only look at the cards of chunks whose summary is dirty, on large mostly old heaps nearly all
+  // of the chunks are clean.
+  while (scan_begin < scan_end) {
+    uint8_t* chunk_end = std::min(AlignDown(scan_begin, kSummarySize) + kSummarySize, scan_end);
+    if (*SummaryFromAddr(scan_begin) != kCardClean) {
+      cards_scanned += ScanCards<kClearCard>(bitmap, scan_begin, chunk_end, visitor, minimum_age);
+    }
+    scan_begin = chunk_end;
+  }
+  return cards_scanned;
+}
+
+template <bool kClearCard, typename Visitor>
+inline size_t CardTable::ScanCards(ContinuousSpaceBitmap* bitmap,
+                                   uint8_t* scan_begin,
+                                   uint8_t* scan_end,
+                                   const Visitor& visitor,
+                                   const uint8_t minimum_age) const {
   DCHECK_GE(scan_begin, reinterpret_cast<uint8_t*>(bitmap->HeapBegin()));
   // scan_end is the byte after the last byte we scan.
   DCHECK_LE(scan_end, reinterpret_cast<uint8_t*>(bitmap->HeapLimit()));
@@ -137,6 +156,31 @@ inline size_t CardTable::Scan(ContinuousSpaceBitmap* bitmap, uint8_t* scan_begin
 template <typename Visitor, typename ModifiedVisitor>
 inline void CardTable::ModifyCardsAtomic(uint8_t* scan_begin, uint8_t* scan_end, const Visitor& visitor,
                                          const ModifiedVisitor& modified) {
+  if (UNLIKELY(visitor(kCardClean) != kCardClean)) {
+    // Clean cards may become non clean, conservatively dirty the summaries of the whole range.
+    ModifyCardsAtomicInRange(scan_begin, scan_end, visitor, modified);
+    for (uint8_t* chunk = AlignDown(scan_begin, kSummarySize); chunk < scan_end;
+         chunk += kSummarySize) {
+      *SummaryFromAddr(chunk) = kCardDirty;
+    }
+    return;
+  }
+  // Clean cards stay clean, skip the chunks which have no dirty card. The summaries are never
+  // cleared here since mutators may be concurrently marking cards.
+  while (scan_begin < scan_end) {
+    uint8_t* chunk_end = std::min(AlignDown(scan_begin, kSummarySize) + kSummarySize, scan_end);
+    if (*SummaryFromAddr(scan_begin) != kCardClean) {
+      ModifyCardsAtomicInRange(scan_begin, chunk_end, visitor, modified);
+    }
+    scan_begin = chunk_end;
+  }
+}
+
+template <typename Visitor, typename ModifiedVisitor>
+inline void CardTable::ModifyCardsAtomicInRange(uint8_t* scan_begin,
+                                                uint8_t* scan_end,
+                                                const Visitor& visitor,
+                                                const ModifiedVisitor& modified) {
   uint8_t* card_cur = CardFromAddr(scan_begin);
   uint8_t* card_end = CardFromAddr(AlignUp(scan_end, kCardSize));
   CheckCardValid(card_cur);
@@ -224,6 +268,18 @@ inline uint8_t* CardTable::CardFromAddr(const void *addr) const {
   return card_addr;
 }
 
+inline uint8_t* CardTable::SummaryFromAddr(const void *addr) const {
+  uint8_t* summary_addr =
+      biased_begin_ - 1 - (reinterpret_cast<uintptr_t>(addr) >> kSummaryShift);
+  DCHECK(IsValidSummary(summary_addr)) << "addr: " << addr
+      << " summary_addr: " << reinterpret_cast<void*>(summary_addr);
+  return summary_addr;
+}
+
+inline bool CardTable::IsValidSummary(const uint8_t* summary_addr) const {
+  return summary_addr >= mem_map_->Begin() && summary_addr < biased_begin_;
+}
+
 inline bool CardTable::IsValidCard(const uint8_t* card_addr) const {
   uint8_t* begin = mem_map_->Begin() + offset_;
   uint8_t* end = mem_map_->End();
@@ -34,6 +34,9 @@ constexpr size_t CardTable::kCardShift;
 constexpr size_t CardTable::kCardSize;
 constexpr uint8_t CardTable::kCardClean;
 constexpr uint8_t CardTable::kCardDirty;
+constexpr size_t CardTable::kSummaryShift;
+constexpr size_t CardTable::kSummarySize;
+constexpr size_t CardTable::kCardsPerSummary;
 
 /*
  * Maintain a card table from the write barrier. All writes of
@@ -55,23 +58,36 @@ constexpr uint8_t CardTable::kCardDirty;
  * fabricate or load GC_DIRTY_CARD to store into the card table,
  * biased base is within the mmap allocation at a point where its low
  * byte is equal to GC_DIRTY_CARD. See CardTable::Create for details.
+ *
+ * The summary bytes live in the same allocation, right below the
+ * biased base, so that the write barrier can dirty them by storing the
+ * same register at biased_begin - 1 - (addr >> kSummaryShift).
  */
 
 CardTable* CardTable::Create(const uint8_t* heap_begin, size_t heap_capacity) {
   ScopedTrace trace(__PRETTY_FUNCTION__);
   /* Set up the card table */
   size_t capacity = heap_capacity / kCardSize;
+  // One summary byte per chunk, indexed from address zero since the summaries are addressed
+  // relative to the biased begin. The end is computed in 64 bits since a 32-bit heap may end at
+  // 4GB.
+  const uint64_t heap_end = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(heap_begin)) +
+      heap_capacity;
+  const size_t summary_size =
+      static_cast<size_t>(RoundUp(heap_end, static_cast<uint64_t>(kSummarySize)) >> kSummaryShift);
+  // The biased begin is summary_size bytes in, the cards start heap_begin >> kCardShift after it.
+  const size_t cards_offset = summary_size + (reinterpret_cast<uintptr_t>(heap_begin) >> kCardShift);
   /* Allocate an extra 256 bytes to allow fixed low-byte of base */
   std::string error_msg;
   std::unique_ptr<MemMap> mem_map(
-      MemMap::MapAnonymous("card table", nullptr, capacity + 256, PROT_READ | PROT_WRITE,
-                           false, false, &error_msg));
+      MemMap::MapAnonymous("card table", nullptr, cards_offset + capacity + 256,
+                           PROT_READ | PROT_WRITE, false, false, &error_msg));
   CHECK(mem_map.get() != nullptr) << "couldn't allocate card table: " << error_msg;
   // All zeros is the correct initial value; all clean. Anonymous mmaps are initialized to zero, we
   // don't clear the card table to avoid unnecessary pages being allocated
   static_assert(kCardClean == 0, "kCardClean must be 0");
 
-  uint8_t* cardtable_begin = mem_map->Begin();
+  uint8_t* cardtable_begin = mem_map->Begin() + cards_offset;
   CHECK(cardtable_begin != nullptr);
 
   // We allocated up to a bytes worth of extra space to allow biased_begin's byte value to equal
@@ -86,7 +102,8 @@ CardTable* CardTable::Create(const uint8_t* heap_begin, size_t heap_capacity) {
     biased_begin += offset;
   }
   CHECK_EQ(reinterpret_cast<uintptr_t>(biased_begin) & 0xff, kCardDirty);
-  return new CardTable(mem_map.release(), biased_begin, offset);
+  CHECK_GE(biased_begin - summary_size, mem_map->Begin());
+  return new CardTable(mem_map.release(), biased_begin, cards_offset + offset);
 }
 
 CardTable::CardTable(MemMap* mem_map, uint8_t* biased_begin, size_t offset)
@@ -129,6 +146,27 @@ void CardTable::ClearCardRange(uint8_t* start, uint8_t* end) {
   memset(std::max(round_end, start_card), 0, end_card - std::max(round_end, start_card));
 }
 
+void CardTable::ClearCleanSummaries(uint8_t* begin, uint8_t* end) {
+  // Only chunks fully covered by the range, the cards of the others may be in use by someone else.
+  uint8_t* chunk = AlignUp(begin, kSummarySize);
+  uint8_t* chunk_end = AlignDown(end, kSummarySize);
+  for (; chunk < chunk_end; chunk += kSummarySize) {
+    uint8_t* summary = SummaryFromAddr(chunk);
+    if (*summary == kCardClean) {
+      continue;
+    }
+    static_assert(kCardsPerSummary % sizeof(uintptr_t) == 0, "Chunk cards must be whole words");
+    const uintptr_t* word = reinterpret_cast<const uintptr_t*>(CardFromAddr(chunk));
+    const uintptr_t* word_end = word + kCardsPerSummary / sizeof(uintptr_t);
+    while (word < word_end && *word == 0) {
+      ++word;
+    }
+    if (word == word_end) {
+      *summary = kCardClean;
+    }
+  }
+}
+
 bool CardTable::AddrIsInCardTable(const void* addr) const {
   return IsValidCard(biased_begin_ + ((uintptr_t)addr >> kCardShift));
 }
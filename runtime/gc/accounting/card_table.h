@@ -45,19 +45,30 @@ template<size_t kAlignment> class SpaceBitmap;
 // Maintain a card table from the the write barrier. All writes of
 // non-null values to heap addresses should go through an entry in
 // WriteBarrier, and from there to here.
+//
+// In addition to the cards, the table keeps one summary byte per kSummarySize chunk of the heap
+// which is dirtied together with any card of the chunk. Scans skip the cards of chunks with a clean
+// summary. The summary bytes are stored below the biased begin in reverse address order so that
+// the write barrier can reach them from the same base register:
+//   summary(addr) = biased_begin - 1 - (addr >> kSummaryShift)
 class CardTable {
  public:
   static constexpr size_t kCardShift = 7;
   static constexpr size_t kCardSize = 1 << kCardShift;
   static constexpr uint8_t kCardClean = 0x0;
   static constexpr uint8_t kCardDirty = 0x70;
+  static constexpr size_t kSummaryShift = 16;
+  static constexpr size_t kSummarySize = 1 << kSummaryShift;
+  static constexpr size_t kCardsPerSummary = kSummarySize / kCardSize;
 
   static CardTable* Create(const uint8_t* heap_begin, size_t heap_capacity);
   ~CardTable();
 
-  // Set the card associated with the given address to GC_CARD_DIRTY.
+  // Set the card associated with the given address to GC_CARD_DIRTY. Also dirties the summary of
+  // the chunk containing the card, compiled code does the same two stores (see MarkGCCard).
   ALWAYS_INLINE void MarkCard(const void *addr) {
     *CardFromAddr(addr) = kCardDirty;
+    *SummaryFromAddr(addr) = kCardDirty;
   }
 
   // Is the object on a dirty card?
@@ -101,6 +112,11 @@ class CardTable {
   void ModifyCardsAtomic(uint8_t* scan_begin, uint8_t* scan_end, const Visitor& visitor,
                          const ModifiedVisitor& modified);
 
+  // Clears the summary of every chunk fully within begin to end whose cards are all clean. Must
+  // only be called with the mutators suspended since a concurrent MarkCard could otherwise have
+  // its summary store overwritten after its card store was missed.
+  void ClearCleanSummaries(uint8_t* begin, uint8_t* end);
+
   // For every dirty at least minumum age between begin and end invoke the visitor with the
   // specified argument. Returns how many cards the visitor was run on.
   template <bool kClearCard, typename Visitor>
@@ -128,11 +144,32 @@ class CardTable {
   // Returns the address of the relevant byte in the card table, given an address on the heap.
   uint8_t* CardFromAddr(const void *addr) const ALWAYS_INLINE;
 
+  // Returns the address of the summary byte of the chunk containing the given heap address.
+  uint8_t* SummaryFromAddr(const void *addr) const ALWAYS_INLINE;
+
+  // Is the chunk containing the given heap address possibly holding non clean cards?
+  bool IsSummaryDirty(const void* addr) const {
+    return *SummaryFromAddr(addr) != kCardClean;
+  }
+
   bool AddrIsInCardTable(const void* addr) const;
 
  private:
   CardTable(MemMap* begin, uint8_t* biased_begin, size_t offset);
 
+  // Scan and ModifyCardsAtomic for a range of cards which doesn't care about summaries.
+  template <bool kClearCard, typename Visitor>
+  size_t ScanCards(SpaceBitmap<kObjectAlignment>* bitmap, uint8_t* scan_begin, uint8_t* scan_end,
+                   const Visitor& visitor, const uint8_t minimum_age) const
+      REQUIRES(Locks::heap_bitmap_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+  template <typename Visitor, typename ModifiedVisitor>
+  void ModifyCardsAtomicInRange(uint8_t* scan_begin, uint8_t* scan_end, const Visitor& visitor,
+                                const ModifiedVisitor& modified);
+
+  // Returns true iff the summary address is within the bounds of the summary table.
+  bool IsValidSummary(const uint8_t* summary_addr) const ALWAYS_INLINE;
+
   // Returns true iff the card table address is within the bounds of the card table.
   bool IsValidCard(const uint8_t* card_addr) const ALWAYS_INLINE;
 
@@ -146,7 +183,8 @@ class CardTable {
   // Value used to compute card table addresses from object addresses, see GetBiasedBegin
   uint8_t* const biased_begin_;
   // Card table doesn't begin at the beginning of the mem_map_, instead it is displaced by offset
-  // to allow the byte value of biased_begin_ to equal GC_CARD_DIRTY
+  // to make room for the summaries and to allow the byte value of biased_begin_ to equal
+  // GC_CARD_DIRTY
   const size_t offset_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(CardTable);
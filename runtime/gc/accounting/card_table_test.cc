@@ -144,6 +144,67 @@ TEST_F(CardTableTest, TestModifyCardsAtomic) {
   }
 }
 
+TEST_F(CardTableTest, TestSummary) {
+  CommonSetup();
+  for (const uint8_t* addr = HeapBegin(); addr < HeapLimit(); addr += CardTable::kSummarySize) {
+    EXPECT_FALSE(card_table_->IsSummaryDirty(addr));
+  }
+  // Dirty one card per chunk at a varying offset and check that only that chunk's summary is set
+  // and that the summaries don't alias any card.
+  uint8_t* chunk = HeapBegin();
+  for (size_t i = 0; chunk < HeapLimit(); ++i, chunk += CardTable::kSummarySize) {
+    uint8_t* addr = chunk + (i * CardTable::kCardSize) % CardTable::kSummarySize;
+    card_table_->MarkCard(addr);
+    EXPECT_TRUE(card_table_->IsSummaryDirty(chunk));
+    EXPECT_TRUE(card_table_->IsSummaryDirty(chunk + CardTable::kSummarySize - 1));
+    if (chunk + CardTable::kSummarySize < HeapLimit()) {
+      EXPECT_FALSE(card_table_->IsSummaryDirty(chunk + CardTable::kSummarySize));
+    }
+    size_t dirty_cards = 0;
+    for (uint8_t* cur = HeapBegin(); cur < HeapLimit(); cur += CardTable::kCardSize) {
+      if (card_table_->IsDirty(reinterpret_cast<mirror::Object*>(cur))) {
+        ++dirty_cards;
+      }
+    }
+    EXPECT_EQ(dirty_cards, i + 1);
+  }
+  // Chunks whose cards are all clean lose their summary, the others keep it.
+  uint8_t* second_chunk = HeapBegin() + CardTable::kSummarySize;
+  *card_table_->CardFromAddr(HeapBegin()) = CardTable::kCardClean;
+  card_table_->ClearCleanSummaries(HeapBegin(), HeapLimit());
+  EXPECT_FALSE(card_table_->IsSummaryDirty(HeapBegin()));
+  EXPECT_TRUE(card_table_->IsSummaryDirty(second_chunk));
+  // Partially covered chunks are left alone.
+  ClearCardTable();
+  card_table_->MarkCard(second_chunk);
+  *card_table_->CardFromAddr(second_chunk) = CardTable::kCardClean;
+  card_table_->ClearCleanSummaries(second_chunk + CardTable::kCardSize, HeapLimit());
+  EXPECT_TRUE(card_table_->IsSummaryDirty(second_chunk));
+}
+
+TEST_F(CardTableTest, TestSummaryAtEndOfAddressSpace) {
+  // On 32-bit targets the heap may end at 4GB, the summaries must still cover its last chunk.
+  static constexpr size_t kHeapSize = 2 * MB;
+  uint8_t* const heap_begin =
+      reinterpret_cast<uint8_t*>(static_cast<uintptr_t>(UINT64_C(0x100000000) - kHeapSize));
+  std::unique_ptr<CardTable> card_table(CardTable::Create(heap_begin, kHeapSize));
+  ASSERT_TRUE(card_table.get() != nullptr);
+  const size_t num_chunks = kHeapSize / CardTable::kSummarySize;
+  for (size_t i = 0; i < num_chunks; ++i) {
+    EXPECT_FALSE(card_table->IsSummaryDirty(heap_begin + i * CardTable::kSummarySize));
+  }
+  uint8_t* const last_chunk = heap_begin + (num_chunks - 1) * CardTable::kSummarySize;
+  uint8_t* const last_card_addr = heap_begin + (kHeapSize - CardTable::kCardSize);
+  EXPECT_TRUE(card_table->AddrIsInCardTable(last_card_addr));
+  card_table->MarkCard(last_card_addr);
+  EXPECT_TRUE(card_table->IsDirty(reinterpret_cast<mirror::Object*>(last_card_addr)));
+  EXPECT_TRUE(card_table->IsSummaryDirty(last_chunk));
+  EXPECT_TRUE(card_table->IsSummaryDirty(last_card_addr));
+  for (size_t i = 0; i + 1 < num_chunks; ++i) {
+    EXPECT_FALSE(card_table->IsSummaryDirty(heap_begin + i * CardTable::kSummarySize));
+  }
+}
+
 // TODO: Add test for CardTable::Scan.
 }  // namespace accounting
 }  // namespace gc
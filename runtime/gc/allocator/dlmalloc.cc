@@ -18,6 +18,7 @@
 
 #include "base/bit_utils.h"
 #include "base/logging.h"
+#include "mem_map.h"
 
 // ART specific morecore implementation defined in space.cc.
 static void* art_heap_morecore(void* m, intptr_t increment);
@@ -66,7 +67,7 @@ extern "C" void DlmallocMadviseCallback(void* start, void* end, size_t used_byte
   end = reinterpret_cast<void*>(art::RoundDown(reinterpret_cast<uintptr_t>(end), art::kPageSize));
   if (end > start) {
     size_t length = reinterpret_cast<uint8_t*>(end) - reinterpret_cast<uint8_t*>(start);
-    int rc = madvise(start, length, MADV_DONTNEED);
+    int rc = art::MadviseFree(start, length);
     if (UNLIKELY(rc != 0)) {
       errno = rc;
       PLOG(::art::FATAL) << "madvise failed during heap trimming";
@@ -26,6 +26,7 @@
 #include "thread-inl.h"
 #include "thread_list.h"
 
+#include <limits>
 #include <map>
 #include <list>
 #include <sstream>
@@ -1986,12 +1987,24 @@ void RosAlloc::Run::Verify(Thread* self, RosAlloc* rosalloc, bool running_on_mem
 
 size_t RosAlloc::ReleasePages() {
   VLOG(heap) << "RosAlloc::ReleasePages()";
+  size_t page_idx = 0;
+  size_t reclaimed_bytes = 0;
+  bool done = ReleasePagesSlice(&page_idx, std::numeric_limits<size_t>::max(), &reclaimed_bytes);
+  DCHECK(done);
+  return reclaimed_bytes;
+}
+
+bool RosAlloc::ReleasePagesSlice(size_t* page_idx, size_t max_bytes, size_t* reclaimed_bytes) {
   DCHECK(!DoesReleaseAllPages());
   Thread* self = Thread::Current();
-  size_t reclaimed_bytes = 0;
-  size_t i = 0;
+  size_t advised_bytes = 0;
+  size_t i = *page_idx;
   // Check the page map size which might have changed due to grow/shrink.
   while (i < page_map_size_) {
+    if (advised_bytes >= max_bytes) {
+      *page_idx = i;
+      return false;
+    }
     // Reading the page map without a lock is racy but the race is benign since it should only
     // result in occasionally not releasing pages which we could release.
     uint8_t pm = page_map_[i];
@@ -1999,7 +2012,8 @@ size_t RosAlloc::ReleasePages() {
       case kPageMapReleased:
         // Fall through.
       case kPageMapEmpty: {
-        // This is currently the start of a free page run.
+        // This is currently the start of a free page run, or a page in the middle of one if the
+        // previous slice stopped there.
         // Acquire the lock to prevent other threads racing in and modifying the page map.
         MutexLock mu(self, lock_);
         // Check that it's still empty after we acquired the lock since another thread could have
@@ -2007,21 +2021,28 @@ size_t RosAlloc::ReleasePages() {
         if (IsFreePage(i)) {
           // Free page runs can start with a released page if we coalesced a released page free
           // page run with an empty page run.
-          FreePageRun* fpr = reinterpret_cast<FreePageRun*>(base_ + i * kPageSize);
-          // There is a race condition where FreePage can coalesce fpr with the previous
-          // free page run before we acquire lock_. In that case free_page_runs_.find will not find
-          // a run starting at fpr. To handle this race, we skip reclaiming the page range and go
-          // to the next page.
-          if (free_page_runs_.find(fpr) != free_page_runs_.end()) {
-            size_t fpr_size = fpr->ByteSize(this);
-            DCHECK_ALIGNED(fpr_size, kPageSize);
-            uint8_t* start = reinterpret_cast<uint8_t*>(fpr);
-            reclaimed_bytes += ReleasePageRange(start, start + fpr_size);
-            size_t pages = fpr_size / kPageSize;
-            CHECK_GT(pages, 0U) << "Infinite loop probable";
-            i += pages;
-            DCHECK_LE(i, page_map_size_);
-            break;
+          uint8_t* start = base_ + i * kPageSize;
+          // Find the free page run containing the page. FreePage can also coalesce it with the
+          // previous free page run before we acquire lock_.
+          auto it = free_page_runs_.upper_bound(reinterpret_cast<FreePageRun*>(start));
+          if (it != free_page_runs_.begin()) {
+            FreePageRun* fpr = *--it;
+            uint8_t* fpr_end = reinterpret_cast<uint8_t*>(fpr->End(this));
+            if (start < fpr_end) {
+              DCHECK_ALIGNED(fpr_end, kPageSize);
+              // Split large runs so that a slice does not go much over its budget.
+              uint8_t* end = fpr_end;
+              if (static_cast<size_t>(end - start) > max_bytes - advised_bytes) {
+                end = start + RoundUp(max_bytes - advised_bytes, kPageSize);
+              }
+              *reclaimed_bytes += ReleasePageRange(start, end);
+              advised_bytes += end - start;
+              size_t pages = (end - start) / kPageSize;
+              CHECK_GT(pages, 0U) << "Infinite loop probable";
+              i += pages;
+              DCHECK_LE(i, page_map_size_);
+              break;
+            }
           }
         }
         FALLTHROUGH_INTENDED;
@@ -2037,16 +2058,19 @@ size_t RosAlloc::ReleasePages() {
         break;
     }
   }
-  return reclaimed_bytes;
+  *page_idx = i;
+  return true;
 }
 
 size_t RosAlloc::ReleasePageRange(uint8_t* start, uint8_t* end) {
   DCHECK_ALIGNED(start, kPageSize);
   DCHECK_ALIGNED(end, kPageSize);
   DCHECK_LT(start, end);
-  if (kIsDebugBuild) {
+  if (kIsDebugBuild && reinterpret_cast<FreePageRun*>(start)->magic_num_ == kMagicNumFree) {
     // In the debug build, the first page of a free page run
-    // contains a magic number for debugging. Exclude it.
+    // contains a magic number for debugging. Exclude it. A range
+    // resumed in the middle of a free page run by ReleasePagesSlice
+    // starts at a zeroed page, which is released.
     start += kPageSize;
 
     // Single pages won't be released.
@@ -2058,7 +2082,8 @@ size_t RosAlloc::ReleasePageRange(uint8_t* start, uint8_t* end) {
     // TODO: Do this when we resurrect the page instead.
     memset(start, 0, end - start);
   }
-  CHECK_EQ(madvise(start, end - start, MADV_DONTNEED), 0);
+  // Free pages are zero, so the lazy release does not change what a later allocation reads.
+  CHECK_EQ(MadviseFree(start, end - start), 0);
   size_t pm_idx = ToPageMapIndex(start);
   size_t reclaimed_bytes = 0;
   // Calculate reclaimed bytes and upate page map.
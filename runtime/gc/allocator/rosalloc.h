@@ -883,6 +883,11 @@ class RosAlloc {
 
   // Release empty pages.
   size_t ReleasePages() REQUIRES(!lock_);
+  // Release empty pages starting at the page map index *page_idx, stops once about max_bytes bytes
+  // were advised. Updates *page_idx to the index the next slice resumes from and adds the released
+  // bytes to *reclaimed_bytes. Returns true once the end of the page map was reached.
+  bool ReleasePagesSlice(size_t* page_idx, size_t max_bytes, size_t* reclaimed_bytes)
+      REQUIRES(!lock_);
   // Returns the current footprint.
   size_t Footprint() REQUIRES(!lock_);
   // Returns the current capacity, maximum footprint.
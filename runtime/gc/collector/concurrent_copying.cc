@@ -341,6 +341,9 @@ class EmptyCheckpoint : public Closure {
     Thread* self = Thread::Current();
     CHECK(thread == self || thread->IsSuspended() || thread->GetState() == kWaitingPerformingGc)
         << thread->GetState() << " thread " << thread << " self " << self;
+    if (thread == self) {
+      concurrent_copying_->AcknowledgeCheckpoint();
+    }
     // If thread is a running mutator, then act on behalf of the garbage collector.
     // See the code in ThreadList::RunCheckpoint.
     concurrent_copying_->GetBarrier().Pass(self);
@@ -497,6 +500,9 @@ class ConcurrentCopying::DisableMarkingCheckpoint : public Closure {
     Thread* self = Thread::Current();
     DCHECK(thread == self || thread->IsSuspended() || thread->GetState() == kWaitingPerformingGc)
         << thread->GetState() << " thread " << thread << " self " << self;
+    if (thread == self) {
+      concurrent_copying_->AcknowledgeCheckpoint();
+    }
     // Disable the thread-local is_gc_marking flag.
     // Note a thread that has just started right before this checkpoint may have already this flag
     // set to false, which is ok.
@@ -515,10 +521,12 @@ void ConcurrentCopying::IssueDisableMarkingCheckpoint() {
   DisableMarkingCheckpoint check_point(this);
   ThreadList* thread_list = Runtime::Current()->GetThreadList();
   gc_barrier_->Init(self, 0);
+  StartCheckpointTiming();
   size_t barrier_count = thread_list->RunCheckpoint(&check_point);
   // If there are no threads to wait which implies that all the checkpoint functions are finished,
   // then no need to release the mutator lock.
   if (barrier_count == 0) {
+    RecordCheckpointTimeToSafepoint();
     return;
   }
   // Release locks then wait for all mutator threads to pass the barrier.
@@ -527,6 +535,7 @@ void ConcurrentCopying::IssueDisableMarkingCheckpoint() {
     ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
     gc_barrier_->Increment(self, barrier_count);
   }
+  RecordCheckpointTimeToSafepoint();
   Locks::mutator_lock_->SharedLock(self);
 }
 
@@ -552,10 +561,12 @@ void ConcurrentCopying::IssueEmptyCheckpoint() {
   EmptyCheckpoint check_point(this);
   ThreadList* thread_list = Runtime::Current()->GetThreadList();
   gc_barrier_->Init(self, 0);
+  StartCheckpointTiming();
   size_t barrier_count = thread_list->RunCheckpoint(&check_point);
   // If there are no threads to wait which implys that all the checkpoint functions are finished,
   // then no need to release the mutator lock.
   if (barrier_count == 0) {
+    RecordCheckpointTimeToSafepoint();
     return;
   }
   // Release locks then wait for all mutator threads to pass the barrier.
@@ -564,6 +575,7 @@ void ConcurrentCopying::IssueEmptyCheckpoint() {
     ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
     gc_barrier_->Increment(self, barrier_count);
   }
+  RecordCheckpointTimeToSafepoint();
   Locks::mutator_lock_->SharedLock(self);
 }
 
@@ -898,6 +910,9 @@ class ConcurrentCopying::RevokeThreadLocalMarkStackCheckpoint : public Closure {
     Thread* self = Thread::Current();
     CHECK(thread == self || thread->IsSuspended() || thread->GetState() == kWaitingPerformingGc)
         << thread->GetState() << " thread " << thread << " self " << self;
+    if (thread == self) {
+      concurrent_copying_->AcknowledgeCheckpoint();
+    }
     // Revoke thread local mark stacks.
     accounting::AtomicStack<mirror::Object>* tl_mark_stack = thread->GetThreadLocalMarkStack();
     if (tl_mark_stack != nullptr) {
@@ -924,10 +939,12 @@ void ConcurrentCopying::RevokeThreadLocalMarkStacks(bool disable_weak_ref_access
   RevokeThreadLocalMarkStackCheckpoint check_point(this, disable_weak_ref_access);
   ThreadList* thread_list = Runtime::Current()->GetThreadList();
   gc_barrier_->Init(self, 0);
+  StartCheckpointTiming();
   size_t barrier_count = thread_list->RunCheckpoint(&check_point);
   // If there are no threads to wait which implys that all the checkpoint functions are finished,
   // then no need to release the mutator lock.
   if (barrier_count == 0) {
+    RecordCheckpointTimeToSafepoint();
     return;
   }
   Locks::mutator_lock_->SharedUnlock(self);
@@ -935,6 +952,7 @@ void ConcurrentCopying::RevokeThreadLocalMarkStacks(bool disable_weak_ref_access
     ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
     gc_barrier_->Increment(self, barrier_count);
   }
+  RecordCheckpointTimeToSafepoint();
   Locks::mutator_lock_->SharedLock(self);
 }
 
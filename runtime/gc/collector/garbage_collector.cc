@@ -61,7 +61,9 @@ GarbageCollector::GarbageCollector(Heap* heap, const std::string& name)
       name_(name),
       pause_histogram_((name_ + " paused").c_str(), kPauseBucketSize, kPauseBucketCount),
       cumulative_timings_(name),
-      pause_histogram_lock_("pause histogram lock", kDefaultMutexLevel, true) {
+      pause_histogram_lock_("pause histogram lock", kDefaultMutexLevel, true),
+      checkpoint_request_ns_(0),
+      last_checkpoint_ack_ns_(0) {
   ResetCumulativeStatistics();
 }
 
@@ -69,6 +71,24 @@ void GarbageCollector::RegisterPause(uint64_t nano_length) {
   GetCurrentIteration()->pause_times_.push_back(nano_length);
 }
 
+void GarbageCollector::StartCheckpointTiming() {
+  checkpoint_request_ns_ = NanoTime();
+  last_checkpoint_ack_ns_.StoreRelaxed(checkpoint_request_ns_);
+}
+
+void GarbageCollector::AcknowledgeCheckpoint() {
+  const uint64_t now = NanoTime();
+  uint64_t last_ack = last_checkpoint_ack_ns_.LoadRelaxed();
+  while (now > last_ack && !last_checkpoint_ack_ns_.CompareExchangeWeakRelaxed(last_ack, now)) {
+    last_ack = last_checkpoint_ack_ns_.LoadRelaxed();
+  }
+}
+
+void GarbageCollector::RecordCheckpointTimeToSafepoint() {
+  // The checkpoint barrier orders the acknowledgments before this load.
+  heap_->RecordTimeToSafepoint(last_checkpoint_ack_ns_.LoadRelaxed() - checkpoint_request_ns_);
+}
+
 void GarbageCollector::ResetCumulativeStatistics() {
   cumulative_timings_.Reset();
   total_time_ns_ = 0;
@@ -156,7 +176,9 @@ void GarbageCollector::ResetMeasurements() {
 
 GarbageCollector::ScopedPause::ScopedPause(GarbageCollector* collector)
     : start_time_(NanoTime()), collector_(collector) {
-  Runtime::Current()->GetThreadList()->SuspendAll(__FUNCTION__);
+  ThreadList* const thread_list = Runtime::Current()->GetThreadList();
+  thread_list->SuspendAll(__FUNCTION__);
+  collector_->GetHeap()->RecordTimeToSafepoint(thread_list->GetSuspendAllTimeToSafepoint());
 }
 
 GarbageCollector::ScopedPause::~ScopedPause() {
@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <vector>
 
+#include "atomic.h"
 #include "base/histogram.h"
 #include "base/mutex.h"
 #include "base/timing_logger.h"
@@ -182,6 +183,9 @@ class GarbageCollector : public RootVisitor, public IsMarkedVisitor, public Mark
   // Record a free of large objects.
   void RecordFreeLOS(const ObjectBytePair& freed);
   void DumpPerformanceInfo(std::ostream& os) REQUIRES(!pause_histogram_lock_);
+  // Called by a thread which reached a checkpoint of the collector and runs it for itself.
+  // Suspended threads are at a safepoint when the checkpoint is requested already.
+  void AcknowledgeCheckpoint();
 
   // Helper functions for querying if objects are marked. These are used for processing references,
   // and will be used for reading system weaks while the GC is running.
@@ -204,6 +208,10 @@ class GarbageCollector : public RootVisitor, public IsMarkedVisitor, public Mark
   virtual void RunPhases() = 0;
   // Revoke all the thread-local buffers.
   virtual void RevokeAllThreadLocalBuffers() = 0;
+  // Bracket a checkpoint to record its time to safepoint, from the request until the last thread
+  // acknowledged it. The end is recorded once all the threads passed the checkpoint.
+  void StartCheckpointTiming();
+  void RecordCheckpointTimeToSafepoint();
 
   static constexpr size_t kPauseBucketSize = 500;
   static constexpr size_t kPauseBucketCount = 32;
@@ -217,6 +225,9 @@ class GarbageCollector : public RootVisitor, public IsMarkedVisitor, public Mark
   int64_t total_freed_bytes_;
   CumulativeLogger cumulative_timings_;
   mutable Mutex pause_histogram_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  // When the ongoing checkpoint was requested, and when the last thread acknowledged it.
+  uint64_t checkpoint_request_ns_;
+  Atomic<uint64_t> last_checkpoint_ack_ns_;
 
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(GarbageCollector);
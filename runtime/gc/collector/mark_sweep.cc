@@ -966,6 +966,16 @@ void MarkSweep::ScanGrayObjects(bool paused, uint8_t minimum_age) {
       }
     }
   }
+  if (paused) {
+    // The mutators are suspended, drop the summaries of the chunks whose cards all got cleaned so
+    // that the next card scans skip them.
+    TimingLogger::ScopedTiming t("(Paused)ClearCleanCardSummaries", GetTimings());
+    for (const auto& space : GetHeap()->GetContinuousSpaces()) {
+      if (space->GetMarkBitmap() != nullptr) {
+        card_table->ClearCleanSummaries(space->Begin(), space->End());
+      }
+    }
+  }
 }
 
 class MarkSweep::RecursiveMarkTask : public MarkStackTask<false> {
@@ -1143,6 +1153,9 @@ class MarkSweep::CheckpointMarkThreadRoots : public Closure, public RootVisitor
     Thread* const self = Thread::Current();
     CHECK(thread == self || thread->IsSuspended() || thread->GetState() == kWaitingPerformingGc)
         << thread->GetState() << " thread " << thread << " self " << self;
+    if (thread == self) {
+      mark_sweep_->AcknowledgeCheckpoint();
+    }
     thread->VisitRoots(this);
     if (revoke_ros_alloc_thread_local_buffers_at_checkpoint_) {
       ScopedTrace trace2("RevokeRosAllocThreadLocalBuffers");
@@ -1163,13 +1176,16 @@ void MarkSweep::MarkRootsCheckpoint(Thread* self,
   TimingLogger::ScopedTiming t(__FUNCTION__, GetTimings());
   CheckpointMarkThreadRoots check_point(this, revoke_ros_alloc_thread_local_buffers_at_checkpoint);
   ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  StartCheckpointTiming();
   // Request the check point is run on all threads returning a count of the threads that must
-  // run through the barrier including self.
-  size_t barrier_count = thread_list->RunCheckpoint(&check_point);
+  // run through the barrier including self. The heap thread pool is idle at this point, let it
+  // mark the roots of the suspended threads.
+  size_t barrier_count = thread_list->RunCheckpoint(&check_point, GetHeap()->GetThreadPool());
   // Release locks then wait for all mutator threads to pass the barrier.
   // If there are no threads to wait which implys that all the checkpoint functions are finished,
   // then no need to release locks.
   if (barrier_count == 0) {
+    RecordCheckpointTimeToSafepoint();
     return;
   }
   Locks::heap_bitmap_lock_->ExclusiveUnlock(self);
@@ -1178,6 +1194,7 @@ void MarkSweep::MarkRootsCheckpoint(Thread* self,
     ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
     gc_barrier_->Increment(self, barrier_count);
   }
+  RecordCheckpointTimeToSafepoint();
   Locks::mutator_lock_->SharedLock(self);
   Locks::heap_bitmap_lock_->ExclusiveLock(self);
 }
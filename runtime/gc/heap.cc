@@ -154,7 +154,8 @@ Heap::Heap(size_t initial_size,
            bool verify_post_gc_rosalloc,
            bool gc_stress_mode,
            bool use_homogeneous_space_compaction_for_oom,
-           uint64_t min_interval_homogeneous_space_compaction_by_oom)
+           uint64_t min_interval_homogeneous_space_compaction_by_oom,
+           bool concurrent_monitor_deflation)
     : non_moving_space_(nullptr),
       rosalloc_space_(nullptr),
       dlmalloc_space_(nullptr),
@@ -193,6 +194,8 @@ Heap::Heap(size_t initial_size,
                                    1U,
                                    kNativeAllocationHistogramBuckets),
       native_free_histogram_("Native free sizes", 1U, kNativeAllocationHistogramBuckets),
+      safepoint_histogram_lock_("Time to safepoint histogram lock"),
+      time_to_safepoint_histogram_("Time to safepoint", 16, 64),
       num_bytes_freed_revoke_(0),
       verify_missing_card_marks_(false),
       verify_system_weaks_(false),
@@ -232,7 +235,10 @@ Heap::Heap(size_t initial_size,
       last_time_homogeneous_space_compaction_by_oom_(NanoTime()),
       pending_collector_transition_(nullptr),
       pending_heap_trim_(nullptr),
+      pending_heap_trim_slice_(nullptr),
+      heap_trim_page_idx_(0),
       use_homogeneous_space_compaction_for_oom_(use_homogeneous_space_compaction_for_oom),
+      concurrent_monitor_deflation_(concurrent_monitor_deflation),
       running_collection_is_blocking_(false),
       blocking_gc_count_(0U),
       blocking_gc_time_(0U),
@@ -899,6 +905,18 @@ void Heap::DecrementDisableThreadFlip(Thread* self) {
   }
 }
 
+void Heap::PinRegionSpaceObject(mirror::Object* obj) {
+  CHECK(kUseReadBarrier);
+  DCHECK(region_space_ != nullptr && region_space_->HasAddress(obj)) << obj;
+  region_space_->PinObject(obj);
+}
+
+void Heap::UnpinRegionSpaceObject(mirror::Object* obj) {
+  CHECK(kUseReadBarrier);
+  DCHECK(region_space_ != nullptr && region_space_->HasAddress(obj)) << obj;
+  region_space_->UnpinObject(obj);
+}
+
 void Heap::ThreadFlipBegin(Thread* self) {
   // Supposed to be called by GC. Set thread_flip_running_ to be true. If disable_thread_flip_count_
   // > 0, block. Otherwise, go ahead.
@@ -1045,6 +1063,65 @@ void Heap::VisitObjectsInternal(ObjectCallback callback, void* arg) {
   }
 }
 
+void Heap::GetObjectVisitUnitsPaused(size_t unit_bytes, std::vector<ObjectVisitUnit>* units) {
+  Thread* self = Thread::Current();
+  Locks::mutator_lock_->AssertExclusiveHeld(self);
+  DCHECK_NE(unit_bytes, 0u);
+  // Same order as VisitObjectsInternalRegionSpace and VisitObjectsInternal.
+  if (region_space_ != nullptr) {
+    DCHECK(IsGcConcurrentAndMoving());
+    DCHECK(IsMovingGCDisabled(self));
+    space::RegionSpace* const region_space = region_space_;
+    const size_t num_regions = region_space->GetNumRegions();
+    const size_t regions_per_unit =
+        std::max<size_t>(unit_bytes / space::RegionSpace::kRegionSize, 1u);
+    for (size_t begin = 0; begin < num_regions; begin += regions_per_unit) {
+      const size_t end = std::min(begin + regions_per_unit, num_regions);
+      units->push_back([region_space, begin, end](ObjectCallback* callback, void* arg) {
+        region_space->WalkRegions(begin, end, callback, arg);
+      });
+    }
+  }
+  if (bump_pointer_space_ != nullptr) {
+    space::BumpPointerSpace* const bump_pointer_space = bump_pointer_space_;
+    std::vector<space::BumpPointerSpace::WalkRange> ranges;
+    bump_pointer_space->GetWalkRanges(unit_bytes, &ranges);
+    for (const space::BumpPointerSpace::WalkRange& range : ranges) {
+      units->push_back([bump_pointer_space, range](ObjectCallback* callback, void* arg)
+          NO_THREAD_SAFETY_ANALYSIS {
+        bump_pointer_space->Walk(range, callback, arg);
+      });
+    }
+  }
+  accounting::ObjectStack* const allocation_stack = allocation_stack_.get();
+  units->push_back([allocation_stack](ObjectCallback* callback, void* arg)
+      NO_THREAD_SAFETY_ANALYSIS {
+    for (auto* it = allocation_stack->Begin(), *end = allocation_stack->End(); it < end; ++it) {
+      mirror::Object* const obj = it->AsMirrorPtr();
+      if (obj != nullptr && obj->GetClass() != nullptr) {
+        callback(obj, arg);
+      }
+    }
+  });
+  ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+  for (accounting::ContinuousSpaceBitmap* bitmap : live_bitmap_->continuous_space_bitmaps_) {
+    const uintptr_t limit = bitmap->HeapLimit();
+    for (uintptr_t begin = bitmap->HeapBegin(); begin < limit; begin += unit_bytes) {
+      const uintptr_t end = std::min(begin + unit_bytes, limit);
+      units->push_back([bitmap, begin, end](ObjectCallback* callback, void* arg) {
+        bitmap->VisitMarkedRange(begin, end, [callback, arg](mirror::Object* obj) {
+          callback(obj, arg);
+        });
+      });
+    }
+  }
+  for (accounting::LargeObjectBitmap* bitmap : live_bitmap_->large_object_bitmaps_) {
+    units->push_back([bitmap](ObjectCallback* callback, void* arg) NO_THREAD_SAFETY_ANALYSIS {
+      bitmap->Walk(callback, arg);
+    });
+  }
+}
+
 void Heap::MarkAllocStackAsLive(accounting::ObjectStack* stack) {
   space::ContinuousSpace* space1 = main_space_ != nullptr ? main_space_ : non_moving_space_;
   space::ContinuousSpace* space2 = non_moving_space_;
@@ -1056,6 +1133,15 @@ void Heap::MarkAllocStackAsLive(accounting::ObjectStack* stack) {
                  stack);
 }
 
+size_t Heap::GetWeakProcessingThreadCount(bool paused) const {
+  // Like the marking phase, use less threads if we are in a background state (non jank
+  // perceptible) since we want to leave more CPU time for the foreground apps.
+  if (thread_pool_ == nullptr || !CareAboutPauseTimes()) {
+    return 1;
+  }
+  return (paused ? parallel_gc_threads_ : conc_gc_threads_) + 1;
+}
+
 void Heap::DeleteThreadPool() {
   thread_pool_.reset(nullptr);
 }
@@ -1172,6 +1258,7 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
   os << "Total GC time: " << PrettyDuration(GetGcTime()) << "\n";
   os << "Total blocking GC count: " << GetBlockingGcCount() << "\n";
   os << "Total blocking GC time: " << PrettyDuration(GetBlockingGcTime()) << "\n";
+  reference_processor_->DumpStatistics(os);
 
   {
     MutexLock mu(Thread::Current(), *gc_complete_lock_);
@@ -1206,6 +1293,15 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
     }
   }
 
+  {
+    MutexLock mu(Thread::Current(), safepoint_histogram_lock_);
+    if (time_to_safepoint_histogram_.SampleSize() > 0u) {
+      Histogram<uint64_t>::CumulativeData data;
+      time_to_safepoint_histogram_.CreateHistogram(&data);
+      time_to_safepoint_histogram_.PrintConfidenceIntervals(os, 0.99, data);
+    }
+  }
+
   BaseMutex::DumpAll(os);
 }
 
@@ -1227,6 +1323,10 @@ void Heap::ResetGcPerformanceInfo() {
     gc_count_rate_histogram_.Reset();
     blocking_gc_count_rate_histogram_.Reset();
   }
+  {
+    MutexLock mu(Thread::Current(), safepoint_histogram_lock_);
+    time_to_safepoint_histogram_.Reset();
+  }
 }
 
 uint64_t Heap::GetGcCount() const {
@@ -1372,9 +1472,15 @@ void Heap::DoPendingCollectorTransition() {
   }
 }
 
-void Heap::Trim(Thread* self) {
+void Heap::Trim(Thread* self, bool incremental) {
   Runtime* const runtime = Runtime::Current();
-  if (!CareAboutPauseTimes()) {
+  if (concurrent_monitor_deflation_) {
+    ScopedTrace trace("Deflating monitors concurrently");
+    uint64_t start_time = NanoTime();
+    size_t count = runtime->GetMonitorList()->DeflateMonitorsConcurrently(self);
+    VLOG(heap) << "Deflating " << count << " monitors concurrently took "
+        << PrettyDuration(NanoTime() - start_time);
+  } else if (!CareAboutPauseTimes()) {
     // Deflate the monitors, this can cause a pause but shouldn't matter since we don't care
     // about pauses.
     ScopedTrace trace("Deflating monitors");
@@ -1385,7 +1491,7 @@ void Heap::Trim(Thread* self) {
         << PrettyDuration(NanoTime() - start_time);
   }
   TrimIndirectReferenceTables(self);
-  TrimSpaces(self);
+  TrimSpaces(self, incremental);
   // Trim arenas that may have been used by JIT or verifier.
   runtime->GetArenaPool()->TrimMaps();
 }
@@ -1428,7 +1534,7 @@ void Heap::StartGC(Thread* self, GcCause cause, CollectorType collector_type) {
   collector_type_running_ = collector_type;
 }
 
-void Heap::TrimSpaces(Thread* self) {
+void Heap::TrimSpaces(Thread* self, bool incremental) {
   {
     // Need to do this before acquiring the locks since we don't want to get suspended while
     // holding any locks.
@@ -1448,7 +1554,9 @@ void Heap::TrimSpaces(Thread* self) {
     for (const auto& space : continuous_spaces_) {
       if (space->IsMallocSpace()) {
         gc::space::MallocSpace* malloc_space = space->AsMallocSpace();
-        if (malloc_space->IsRosAllocSpace() || !CareAboutPauseTimes()) {
+        if (incremental && malloc_space == rosalloc_space_) {
+          // Released in slices by TrimSpacesSlice below.
+        } else if (malloc_space->IsRosAllocSpace() || !CareAboutPauseTimes()) {
           // Don't trim dlmalloc spaces if we care about pauses since this can hold the space lock
           // for a long period of time.
           managed_reclaimed += malloc_space->Trim();
@@ -1476,6 +1584,33 @@ void Heap::TrimSpaces(Thread* self) {
   VLOG(heap) << "Heap trim of managed (duration=" << PrettyDuration(gc_heap_end_ns - start_ns)
       << ", advised=" << PrettySize(managed_reclaimed) << ") heap. Managed heap utilization of "
       << static_cast<int>(100 * managed_utilization) << "%.";
+  if (incremental) {
+    // Restart from the beginning of the space, a slice which is still pending continues from there.
+    heap_trim_page_idx_ = 0;
+    TrimSpacesSlice(self);
+  }
+}
+
+void Heap::TrimSpacesSlice(Thread* self) {
+  {
+    ScopedThreadStateChange tsc(self, kWaitingForGcToComplete);
+    // Pretend we are doing a GC to prevent background compaction from deleting the space we are
+    // trimming.
+    StartGC(self, kGcCauseTrim, kCollectorTypeHeapTrim);
+  }
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  const uint64_t start_ns = NanoTime();
+  size_t reclaimed = 0;
+  bool done = true;
+  if (rosalloc_space_ != nullptr) {
+    done = rosalloc_space_->TrimSlice(&heap_trim_page_idx_, kHeapTrimSliceBytes, &reclaimed);
+  }
+  FinishGC(self, collector::kGcTypeNone);
+  VLOG(heap) << "Heap trim slice (duration=" << PrettyDuration(NanoTime() - start_ns)
+      << ", advised=" << PrettySize(reclaimed) << ")" << (done ? " done." : ".");
+  if (!done) {
+    RequestTrimSlice(self);
+  }
 }
 
 bool Heap::IsValidObjectAddress(const mirror::Object* obj) const {
@@ -1648,6 +1783,11 @@ void Heap::RecordFree(uint64_t freed_objects, int64_t freed_bytes) {
   }
 }
 
+void Heap::RecordTimeToSafepoint(uint64_t duration_ns) {
+  MutexLock mu(Thread::Current(), safepoint_histogram_lock_);
+  time_to_safepoint_histogram_.AdjustAndAddValue(duration_ns);
+}
+
 void Heap::RecordFreeRevoke() {
   // Subtract num_bytes_freed_revoke_ from num_bytes_allocated_ to cancel out the
   // the ahead-of-time, bulk counting of bytes allocated in rosalloc thread-local buffers.
@@ -3777,16 +3917,51 @@ class Heap::HeapTrimTask : public HeapTask {
   explicit HeapTrimTask(uint64_t delta_time) : HeapTask(NanoTime() + delta_time) { }
   virtual void Run(Thread* self) OVERRIDE {
     gc::Heap* heap = Runtime::Current()->GetHeap();
-    heap->Trim(self);
+    heap->Trim(self, /* incremental */ true);
     heap->ClearPendingTrim(self);
   }
 };
 
+// Releases the next slice of free pages, spreading the page releases (and the page faults if the
+// pages get reused) over time.
+class Heap::HeapTrimSliceTask : public HeapTask {
+ public:
+  explicit HeapTrimSliceTask(uint64_t delta_time) : HeapTask(NanoTime() + delta_time) { }
+  virtual void Run(Thread* self) OVERRIDE {
+    gc::Heap* heap = Runtime::Current()->GetHeap();
+    // Clear first since the slice requests the next one.
+    heap->ClearPendingTrimSlice(self);
+    heap->TrimSpacesSlice(self);
+  }
+};
+
 void Heap::ClearPendingTrim(Thread* self) {
   MutexLock mu(self, *pending_task_lock_);
   pending_heap_trim_ = nullptr;
 }
 
+void Heap::ClearPendingTrimSlice(Thread* self) {
+  MutexLock mu(self, *pending_task_lock_);
+  pending_heap_trim_slice_ = nullptr;
+}
+
+void Heap::RequestTrimSlice(Thread* self) {
+  if (!CanAddHeapTask(self)) {
+    return;
+  }
+  HeapTrimSliceTask* added_task = nullptr;
+  {
+    MutexLock mu(self, *pending_task_lock_);
+    if (pending_heap_trim_slice_ != nullptr) {
+      // Already have a slice in the task processor, it resumes from heap_trim_page_idx_.
+      return;
+    }
+    added_task = new HeapTrimSliceTask(kHeapTrimSliceWait);
+    pending_heap_trim_slice_ = added_task;
+  }
+  task_processor_->AddTask(self, added_task);
+}
+
 void Heap::RequestTrim(Thread* self) {
   if (!CanAddHeapTask(self)) {
     return;
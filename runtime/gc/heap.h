@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_GC_HEAP_H_
 #define ART_RUNTIME_GC_HEAP_H_
 
+#include <functional>
 #include <iosfwd>
 #include <string>
 #include <unordered_set>
@@ -148,6 +149,10 @@ class Heap {
 
   // How often we allow heap trimming to happen (nanoseconds).
   static constexpr uint64_t kHeapTrimWait = MsToNs(5000);
+  // How many bytes of free RosAlloc pages a heap trim slice releases at most.
+  static constexpr size_t kHeapTrimSliceBytes = 2 * MB;
+  // How long we wait between two heap trim slices (nanoseconds).
+  static constexpr uint64_t kHeapTrimSliceWait = MsToNs(20);
   // How long we wait after a transition request to perform a collector transition (nanoseconds).
   static constexpr uint64_t kCollectorTransitionWait = MsToNs(5000);
 
@@ -183,7 +188,8 @@ class Heap {
        bool verify_post_gc_rosalloc,
        bool gc_stress_mode,
        bool use_homogeneous_space_compaction,
-       uint64_t min_interval_homogeneous_space_compaction_by_oom);
+       uint64_t min_interval_homogeneous_space_compaction_by_oom,
+       bool concurrent_monitor_deflation);
 
   ~Heap();
 
@@ -237,6 +243,15 @@ class Heap {
   void VisitObjectsPaused(ObjectCallback callback, void* arg)
       REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_, !*gc_complete_lock_);
 
+  // Visits a part of the live objects in the heap.
+  typedef std::function<void(ObjectCallback*, void*)> ObjectVisitUnit;
+  // Splits the objects visited by VisitObjectsPaused into units of about unit_bytes of a space
+  // which can be visited by different threads. Visiting the units in order visits the objects in
+  // the same order as VisitObjectsPaused. The units must be visited while the mutator lock is still
+  // held exclusively.
+  void GetObjectVisitUnitsPaused(size_t unit_bytes, std::vector<ObjectVisitUnit>* units)
+      REQUIRES(Locks::mutator_lock_, !Locks::heap_bitmap_lock_);
+
   void CheckPreconditionsForAllocObject(mirror::Class* c, size_t byte_count)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
@@ -297,6 +312,12 @@ class Heap {
   // Temporarily disable thread flip for JNI critical calls.
   void IncrementDisableThreadFlip(Thread* self) REQUIRES(!*thread_flip_lock_);
   void DecrementDisableThreadFlip(Thread* self) REQUIRES(!*thread_flip_lock_);
+
+  // Keeps a movable object in place for the CC collector by pinning its region of the region
+  // space. Unlike disabling the thread flip this never waits for or delays the GC, only the
+  // pinned regions are not evacuated.
+  void PinRegionSpaceObject(mirror::Object* obj) SHARED_REQUIRES(Locks::mutator_lock_);
+  void UnpinRegionSpaceObject(mirror::Object* obj) SHARED_REQUIRES(Locks::mutator_lock_);
   void ThreadFlipBegin(Thread* self) REQUIRES(!*thread_flip_lock_);
   void ThreadFlipEnd(Thread* self) REQUIRES(!*thread_flip_lock_);
 
@@ -433,6 +454,9 @@ class Heap {
   // Record the bytes freed by thread-local buffer revoke.
   void RecordFreeRevoke();
 
+  // Record how long the GC waited for the last thread to reach a suspension or a checkpoint.
+  void RecordTimeToSafepoint(uint64_t duration_ns) REQUIRES(!safepoint_histogram_lock_);
+
   // Must be called if a field of an Object in the heap changes, and before any GC safe-point.
   // The call is not needed if null is stored in the field.
   ALWAYS_INLINE void WriteBarrierField(const mirror::Object* dst,
@@ -532,13 +556,16 @@ class Heap {
   space::Space* FindSpaceFromObject(const mirror::Object*, bool fail_ok) const
       SHARED_REQUIRES(Locks::mutator_lock_);
 
-  void DumpForSigQuit(std::ostream& os) REQUIRES(!*gc_complete_lock_, !native_histogram_lock_);
+  void DumpForSigQuit(std::ostream& os)
+      REQUIRES(!*gc_complete_lock_, !native_histogram_lock_, !safepoint_histogram_lock_);
 
   // Do a pending collector transition.
   void DoPendingCollectorTransition() REQUIRES(!*gc_complete_lock_);
 
-  // Deflate monitors, ... and trim the spaces.
-  void Trim(Thread* self) REQUIRES(!*gc_complete_lock_);
+  // Deflate monitors, ... and trim the spaces. If incremental, the free pages of the RosAlloc space
+  // are released in slices of kHeapTrimSliceBytes by later heap tasks.
+  void Trim(Thread* self, bool incremental = false)
+      REQUIRES(!*gc_complete_lock_, !*pending_task_lock_);
 
   void RevokeThreadLocalBuffers(Thread* thread);
   void RevokeRosAllocThreadLocalBuffers(Thread* thread);
@@ -655,8 +682,8 @@ class Heap {
 
   // GC performance measuring
   void DumpGcPerformanceInfo(std::ostream& os)
-      REQUIRES(!*gc_complete_lock_, !native_histogram_lock_);
-  void ResetGcPerformanceInfo() REQUIRES(!*gc_complete_lock_);
+      REQUIRES(!*gc_complete_lock_, !native_histogram_lock_, !safepoint_histogram_lock_);
+  void ResetGcPerformanceInfo() REQUIRES(!*gc_complete_lock_, !safepoint_histogram_lock_);
 
   // Thread pool.
   void CreateThreadPool();
@@ -670,6 +697,9 @@ class Heap {
   size_t GetConcGCThreadCount() const {
     return conc_gc_threads_;
   }
+  // Number of threads, including the GC thread, used to sweep the system weaks and to clear the
+  // references, during a pause or concurrently with the mutators.
+  size_t GetWeakProcessingThreadCount(bool paused) const;
   accounting::ModUnionTable* FindModUnionTableFromSpace(space::Space* space);
   void AddModUnionTable(accounting::ModUnionTable* mod_union_table);
 
@@ -788,6 +818,7 @@ class Heap {
   class ConcurrentGCTask;
   class CollectorTransitionTask;
   class HeapTrimTask;
+  class HeapTrimSliceTask;
 
   // Compact source space to target space. Returns the collector used.
   collector::GarbageCollector* Compact(space::ContinuousMemMapAllocSpace* target_space,
@@ -990,6 +1021,8 @@ class Heap {
 
   void ClearConcurrentGCRequest();
   void ClearPendingTrim(Thread* self) REQUIRES(!*pending_task_lock_);
+  void ClearPendingTrimSlice(Thread* self) REQUIRES(!*pending_task_lock_);
+  void RequestTrimSlice(Thread* self) REQUIRES(!*pending_task_lock_);
   void ClearPendingCollectorTransition(Thread* self) REQUIRES(!*pending_task_lock_);
 
   // What kind of concurrency behavior is the runtime after? Currently true for concurrent mark
@@ -999,7 +1032,11 @@ class Heap {
   }
 
   // Trim the managed and native spaces by releasing unused memory back to the OS.
-  void TrimSpaces(Thread* self) REQUIRES(!*gc_complete_lock_);
+  void TrimSpaces(Thread* self, bool incremental)
+      REQUIRES(!*gc_complete_lock_, !*pending_task_lock_);
+  // Release the next slice of free pages of the RosAlloc space, requests another slice if there
+  // are pages left.
+  void TrimSpacesSlice(Thread* self) REQUIRES(!*gc_complete_lock_, !*pending_task_lock_);
 
   // Trim 0 pages at the end of reference tables.
   void TrimIndirectReferenceTables(Thread* self);
@@ -1162,6 +1199,10 @@ class Heap {
   Histogram<uint64_t> native_allocation_histogram_;
   Histogram<uint64_t> native_free_histogram_;
 
+  // Time from requesting a GC suspension or checkpoint until the last thread acknowledged it.
+  Mutex safepoint_histogram_lock_;
+  Histogram<uint64_t> time_to_safepoint_histogram_ GUARDED_BY(safepoint_histogram_lock_);
+
   // Number of bytes freed by thread local buffer revokes. This will
   // cancel out the ahead-of-time bulk counting of bytes allocated in
   // rosalloc thread-local buffers.  It is temporarily accumulated
@@ -1304,10 +1345,19 @@ class Heap {
   // Active tasks which we can modify (change target time, desired collector type, etc..).
   CollectorTransitionTask* pending_collector_transition_ GUARDED_BY(pending_task_lock_);
   HeapTrimTask* pending_heap_trim_ GUARDED_BY(pending_task_lock_);
+  HeapTrimSliceTask* pending_heap_trim_slice_ GUARDED_BY(pending_task_lock_);
+
+  // RosAlloc page map index the next heap trim slice resumes from. Only used by the heap task
+  // daemon.
+  size_t heap_trim_page_idx_;
 
   // Whether or not we use homogeneous space compaction to avoid OOM errors.
   bool use_homogeneous_space_compaction_for_oom_;
 
+  // Whether heap trims deflate the monitors without suspending all threads, which they then also
+  // do when we care about pause times.
+  const bool concurrent_monitor_deflation_;
+
   // True if the currently running collection has made some thread wait.
   bool running_collection_is_blocking_ GUARDED_BY(gc_complete_lock_);
   // The number of blocking GC runs.
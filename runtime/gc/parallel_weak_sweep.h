@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_PARALLEL_WEAK_SWEEP_H_
+#define ART_RUNTIME_GC_PARALLEL_WEAK_SWEEP_H_
+
+#include "base/macros.h"
+#include "thread_pool.h"
+
+namespace art {
+namespace gc {
+
+// Splits the sweep of a system weak table into chunks of entries. The owner is the thread sweeping
+// the table, it holds the table lock for the whole sweep. Helpers are ParallelForHelperTasks on the
+// heap thread pool which claim chunks while the owner is sweeping. Helpers never take the table
+// lock themselves, this is safe since the owner only returns (and releases the lock) once every
+// claimed chunk is done.
+class ParallelWeakSweep : public ParallelFor {
+ public:
+  ParallelWeakSweep() {}
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ParallelWeakSweep);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_PARALLEL_WEAK_SWEEP_H_
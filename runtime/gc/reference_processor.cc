@@ -16,6 +16,8 @@
 
 #include "reference_processor.h"
 
+#include <sstream>
+
 #include "base/time_utils.h"
 #include "collector/garbage_collector.h"
 #include "mirror/class-inl.h"
@@ -26,6 +28,7 @@
 #include "ScopedLocalRef.h"
 #include "scoped_thread_state_change.h"
 #include "task_processor.h"
+#include "thread_pool.h"
 #include "utils.h"
 #include "well_known_classes.h"
 
@@ -42,7 +45,8 @@ ReferenceProcessor::ReferenceProcessor()
       weak_reference_queue_(Locks::reference_queue_weak_references_lock_),
       finalizer_reference_queue_(Locks::reference_queue_finalizer_references_lock_),
       phantom_reference_queue_(Locks::reference_queue_phantom_references_lock_),
-      cleared_references_(Locks::reference_queue_cleared_references_lock_) {
+      cleared_references_(Locks::reference_queue_cleared_references_lock_),
+      processing_cycles_(0) {
 }
 
 void ReferenceProcessor::EnableSlowPath() {
@@ -121,6 +125,7 @@ void ReferenceProcessor::ProcessReferences(bool concurrent, TimingLogger* timing
                                            collector::GarbageCollector* collector) {
   TimingLogger::ScopedTiming t(concurrent ? __FUNCTION__ : "(Paused)ProcessReferences", timings);
   Thread* self = Thread::Current();
+  const uint64_t start_time = NanoTime();
   {
     MutexLock mu(self, *Locks::reference_processor_lock_);
     collector_ = collector;
@@ -131,6 +136,10 @@ void ReferenceProcessor::ProcessReferences(bool concurrent, TimingLogger* timing
       CHECK_EQ(!self->GetWeakRefAccessEnabled(), concurrent);
     }
   }
+  ThreadPool* const thread_pool = Runtime::Current()->GetHeap()->GetThreadPool();
+  const size_t thread_count = Runtime::Current()->GetHeap()->GetWeakProcessingThreadCount(
+      !concurrent);
+  ProcessingStats stats;
   // Unless required to clear soft references with white references, preserve some white referents.
   if (!clear_soft_references) {
     TimingLogger::ScopedTiming split(concurrent ? "ForwardSoftReferences" :
@@ -147,31 +156,58 @@ void ReferenceProcessor::ProcessReferences(bool concurrent, TimingLogger* timing
     }
   }
   // Clear all remaining soft and weak references with white referents.
-  soft_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
-  weak_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
+  {
+    TimingLogger::ScopedTiming split(concurrent ? "ClearWhiteReferences" :
+        "(Paused)ClearWhiteReferences", timings);
+    stats.soft.Add(soft_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count));
+    stats.weak.Add(weak_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count));
+  }
   {
     TimingLogger::ScopedTiming t2(concurrent ? "EnqueueFinalizerReferences" :
         "(Paused)EnqueueFinalizerReferences", timings);
     if (concurrent) {
       StartPreservingReferences(self);
     }
-    // Preserve all white objects with finalize methods and schedule them for finalization.
-    finalizer_reference_queue_.EnqueueFinalizerReferences(&cleared_references_, collector);
+    // Preserve all white objects with finalize methods and schedule them for finalization. This
+    // stays serial since marking the zombies pushes onto the collector's mark stack.
+    stats.finalizer = finalizer_reference_queue_.EnqueueFinalizerReferences(&cleared_references_,
+                                                                            collector);
     collector->ProcessMarkStack();
     if (concurrent) {
       StopPreservingReferences(self);
     }
   }
   // Clear all finalizer referent reachable soft and weak references with white referents.
-  soft_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
-  weak_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
-  // Clear all phantom references with white referents.
-  phantom_reference_queue_.ClearWhiteReferences(&cleared_references_, collector);
-  // At this point all reference queues other than the cleared references should be empty.
+  {
+    TimingLogger::ScopedTiming split(concurrent ? "ClearFinalizerReachableReferences" :
+        "(Paused)ClearFinalizerReachableReferences", timings);
+    stats.soft.Add(soft_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count));
+    stats.weak.Add(weak_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count));
+  }
   DCHECK(soft_reference_queue_.IsEmpty());
   DCHECK(weak_reference_queue_.IsEmpty());
   DCHECK(finalizer_reference_queue_.IsEmpty());
+  if (!kUseReadBarrier && concurrent) {
+    // Every soft, weak and finalizer reference has been resolved at this point. The remaining
+    // phantom references are never read through GetReferent (PhantomReference.get() always returns
+    // null) so mutators blocked in GetReferent can be released before clearing them.
+    MutexLock mu(self, *Locks::reference_processor_lock_);
+    DisableSlowPath(self);
+  }
+  // Clear all phantom references with white referents.
+  {
+    TimingLogger::ScopedTiming split(concurrent ? "ClearPhantomReferences" :
+        "(Paused)ClearPhantomReferences", timings);
+    stats.phantom = phantom_reference_queue_.ClearWhiteReferences(
+        &cleared_references_, collector, thread_pool, thread_count);
+  }
+  // At this point all reference queues other than the cleared references should be empty.
   DCHECK(phantom_reference_queue_.IsEmpty());
+  stats.duration_ns = NanoTime() - start_time;
   {
     MutexLock mu(self, *Locks::reference_processor_lock_);
     // Need to always do this since the next GC may be concurrent. Doing this for only concurrent
@@ -179,11 +215,45 @@ void ReferenceProcessor::ProcessReferences(bool concurrent, TimingLogger* timing
     // starts since there is a small window of time where slow_path_enabled_ is enabled but the
     // callback isn't yet set.
     collector_ = nullptr;
-    if (!kUseReadBarrier && concurrent) {
-      // Done processing, disable the slow path and broadcast to the waiters.
-      DisableSlowPath(self);
-    }
+    last_stats_ = stats;
+    cumulative_stats_.Add(stats);
+    ++processing_cycles_;
+  }
+  if (VLOG_IS_ON(gc)) {
+    std::ostringstream oss;
+    stats.Dump(oss);
+    LOG(INFO) << (concurrent ? "" : "(Paused)") << "ProcessReferences " << oss.str()
+              << " threads=" << thread_count;
+  }
+}
+
+void ReferenceProcessor::ProcessingStats::Add(const ProcessingStats& other) {
+  soft.Add(other.soft);
+  weak.Add(other.weak);
+  finalizer.Add(other.finalizer);
+  phantom.Add(other.phantom);
+  duration_ns += other.duration_ns;
+}
+
+void ReferenceProcessor::ProcessingStats::Dump(std::ostream& os) const {
+  os << "soft=" << soft.cleared << "/" << soft.processed
+     << " weak=" << weak.cleared << "/" << weak.processed
+     << " finalizer=" << finalizer.cleared << "/" << finalizer.processed
+     << " phantom=" << phantom.cleared << "/" << phantom.processed
+     << " (cleared/processed) in " << PrettyDuration(duration_ns);
+}
+
+void ReferenceProcessor::DumpStatistics(std::ostream& os) {
+  MutexLock mu(Thread::Current(), *Locks::reference_processor_lock_);
+  if (processing_cycles_ == 0) {
+    return;
   }
+  os << "Reference processing cycles: " << processing_cycles_ << "\n";
+  os << "Last reference processing: ";
+  last_stats_.Dump(os);
+  os << "\nTotal reference processing: ";
+  cumulative_stats_.Dump(os);
+  os << "\n";
 }
 
 // Process the "referent" field in a java.lang.ref.Reference.  If the referent has not yet been
@@ -17,6 +17,8 @@
 #ifndef ART_RUNTIME_GC_REFERENCE_PROCESSOR_H_
 #define ART_RUNTIME_GC_REFERENCE_PROCESSOR_H_
 
+#include <iosfwd>
+
 #include "base/mutex.h"
 #include "globals.h"
 #include "jni.h"
@@ -70,8 +72,22 @@ class ReferenceProcessor {
       SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!Locks::reference_processor_lock_,
                !Locks::reference_queue_finalizer_references_lock_);
+  // Dump the reference counts and timings of the last and of all reference processing cycles.
+  void DumpStatistics(std::ostream& os) REQUIRES(!Locks::reference_processor_lock_);
 
  private:
+  // Per kind reference counts and duration of reference processing.
+  struct ProcessingStats {
+    ReferenceQueueCounts soft;
+    ReferenceQueueCounts weak;
+    ReferenceQueueCounts finalizer;
+    ReferenceQueueCounts phantom;
+    uint64_t duration_ns = 0;
+
+    void Add(const ProcessingStats& other);
+    void Dump(std::ostream& os) const;
+  };
+
   bool SlowPathEnabled() SHARED_REQUIRES(Locks::mutator_lock_);
   // Called by ProcessReferences.
   void DisableSlowPath(Thread* self) REQUIRES(Locks::reference_processor_lock_)
@@ -96,6 +112,10 @@ class ReferenceProcessor {
   ReferenceQueue finalizer_reference_queue_;
   ReferenceQueue phantom_reference_queue_;
   ReferenceQueue cleared_references_;
+  // Statistics of the last reference processing cycle and of all cycles so far.
+  ProcessingStats last_stats_ GUARDED_BY(Locks::reference_processor_lock_);
+  ProcessingStats cumulative_stats_ GUARDED_BY(Locks::reference_processor_lock_);
+  size_t processing_cycles_ GUARDED_BY(Locks::reference_processor_lock_);
 
   DISALLOW_COPY_AND_ASSIGN(ReferenceProcessor);
 };
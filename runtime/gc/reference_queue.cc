@@ -134,10 +134,13 @@ size_t ReferenceQueue::GetLength() const {
   return count;
 }
 
-void ReferenceQueue::ClearWhiteReferences(ReferenceQueue* cleared_references,
-                                          collector::GarbageCollector* collector) {
+ReferenceQueueCounts ReferenceQueue::SerialClearWhiteReferences(
+    ReferenceQueue* cleared_references,
+    collector::GarbageCollector* collector) {
+  ReferenceQueueCounts counts;
   while (!IsEmpty()) {
     mirror::Reference* ref = DequeuePendingReference();
+    ++counts.processed;
     mirror::HeapReference<mirror::Object>* referent_addr = ref->GetReferentReferenceAddr();
     if (referent_addr->AsMirrorPtr() != nullptr &&
         !collector->IsMarkedHeapReference(referent_addr)) {
@@ -148,14 +151,94 @@ void ReferenceQueue::ClearWhiteReferences(ReferenceQueue* cleared_references,
         ref->ClearReferent<false>();
       }
       cleared_references->EnqueueReference(ref);
+      ++counts.cleared;
     }
   }
+  return counts;
 }
 
-void ReferenceQueue::EnqueueFinalizerReferences(ReferenceQueue* cleared_references,
-                                                collector::GarbageCollector* collector) {
+// Checks and clears the referents of a contiguous range of dequeued references. References whose
+// referent is still alive are replaced by null in the range so that the caller only enqueues the
+// cleared ones.
+class ReferenceQueue::ClearWhiteReferencesTask : public SelfDeletingTask {
+ public:
+  ClearWhiteReferencesTask(collector::GarbageCollector* collector,
+                           mirror::Reference** begin,
+                           mirror::Reference** end)
+      : collector_(collector), begin_(begin), end_(end) {}
+
+  // The calling GC thread holds the mutator lock on our behalf until the thread pool is drained.
+  virtual void Run(Thread* self ATTRIBUTE_UNUSED) NO_THREAD_SAFETY_ANALYSIS {
+    for (mirror::Reference** it = begin_; it != end_; ++it) {
+      mirror::Reference* ref = *it;
+      mirror::HeapReference<mirror::Object>* referent_addr = ref->GetReferentReferenceAddr();
+      if (referent_addr->AsMirrorPtr() != nullptr &&
+          !collector_->IsMarkedHeapReference(referent_addr)) {
+        ref->ClearReferent<false>();
+      } else {
+        *it = nullptr;
+      }
+    }
+  }
+
+ private:
+  collector::GarbageCollector* const collector_;
+  mirror::Reference** const begin_;
+  mirror::Reference** const end_;
+};
+
+ReferenceQueueCounts ReferenceQueue::ClearWhiteReferences(ReferenceQueue* cleared_references,
+                                                          collector::GarbageCollector* collector,
+                                                          ThreadPool* thread_pool,
+                                                          size_t thread_count) {
+  // Transactions record every field write and are not thread safe, clear serially instead.
+  if (thread_pool == nullptr || thread_count <= 1 || IsEmpty() ||
+      Runtime::Current()->IsActiveTransaction()) {
+    return SerialClearWhiteReferences(cleared_references, collector);
+  }
+  // Unlinking from the circular list is inherently serial and cheap, the expensive part is the
+  // IsMarked query and the referent write which touch unrelated cache lines.
+  std::vector<mirror::Reference*> refs;
+  while (!IsEmpty()) {
+    refs.push_back(DequeuePendingReference());
+  }
+  ReferenceQueueCounts counts;
+  counts.processed = refs.size();
+  if (refs.size() < 2 * kMinReferencesPerTask) {
+    ClearWhiteReferencesTask task(collector, refs.data(), refs.data() + refs.size());
+    task.Run(Thread::Current());
+  } else {
+    Thread* self = Thread::Current();
+    // Thread counts need not be powers of two, so do not use RoundUp here.
+    const size_t per_task = std::max(kMinReferencesPerTask,
+                                     (refs.size() + thread_count - 1) / thread_count);
+    for (size_t begin = 0; begin < refs.size(); begin += per_task) {
+      const size_t end = std::min(begin + per_task, refs.size());
+      thread_pool->AddTask(self, new ClearWhiteReferencesTask(collector,
+                                                              refs.data() + begin,
+                                                              refs.data() + end));
+    }
+    thread_pool->SetMaxActiveWorkers(thread_count - 1);
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, true, true);
+    thread_pool->StopWorkers(self);
+  }
+  for (mirror::Reference* ref : refs) {
+    if (ref != nullptr) {
+      cleared_references->EnqueueReference(ref);
+      ++counts.cleared;
+    }
+  }
+  return counts;
+}
+
+ReferenceQueueCounts ReferenceQueue::EnqueueFinalizerReferences(
+    ReferenceQueue* cleared_references,
+    collector::GarbageCollector* collector) {
+  ReferenceQueueCounts counts;
   while (!IsEmpty()) {
     mirror::FinalizerReference* ref = DequeuePendingReference()->AsFinalizerReference();
+    ++counts.processed;
     mirror::HeapReference<mirror::Object>* referent_addr = ref->GetReferentReferenceAddr();
     if (referent_addr->AsMirrorPtr() != nullptr &&
         !collector->IsMarkedHeapReference(referent_addr)) {
@@ -169,8 +252,10 @@ void ReferenceQueue::EnqueueFinalizerReferences(ReferenceQueue* cleared_referenc
         ref->ClearReferent<false>();
       }
       cleared_references->EnqueueReference(ref);
+      ++counts.cleared;
     }
   }
+  return counts;
 }
 
 void ReferenceQueue::ForwardSoftReferences(MarkObjectVisitor* visitor) {
@@ -43,6 +43,17 @@ class GarbageCollector;
 
 class Heap;
 
+// Number of references examined and cleared by a single pass over a reference queue.
+struct ReferenceQueueCounts {
+  size_t processed = 0;
+  size_t cleared = 0;
+
+  void Add(const ReferenceQueueCounts& other) {
+    processed += other.processed;
+    cleared += other.cleared;
+  }
+};
+
 // Used to temporarily store java.lang.ref.Reference(s) during GC and prior to queueing on the
 // appropriate java.lang.ref.ReferenceQueue. The linked list is maintained as an unordered,
 // circular, and singly-linked list using the pendingNext fields of the java.lang.ref.Reference
@@ -66,8 +77,8 @@ class ReferenceQueue {
 
   // Enqueues finalizer references with white referents.  White referents are blackened, moved to
   // the zombie field, and the referent field is cleared.
-  void EnqueueFinalizerReferences(ReferenceQueue* cleared_references,
-                                  collector::GarbageCollector* collector)
+  ReferenceQueueCounts EnqueueFinalizerReferences(ReferenceQueue* cleared_references,
+                                                  collector::GarbageCollector* collector)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   // Walks the reference list marking any references subject to the reference clearing policy.
@@ -78,8 +89,12 @@ class ReferenceQueue {
 
   // Unlink the reference list clearing references objects with white referents. Cleared references
   // registered to a reference queue are scheduled for appending by the heap worker thread.
-  void ClearWhiteReferences(ReferenceQueue* cleared_references,
-                            collector::GarbageCollector* collector)
+  // If a thread pool is passed and the queue is long enough, the referents are checked and
+  // cleared in parallel by thread_count threads (including the caller).
+  ReferenceQueueCounts ClearWhiteReferences(ReferenceQueue* cleared_references,
+                                            collector::GarbageCollector* collector,
+                                            ThreadPool* thread_pool = nullptr,
+                                            size_t thread_count = 1)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   void Dump(std::ostream& os) const SHARED_REQUIRES(Locks::mutator_lock_);
@@ -100,6 +115,17 @@ class ReferenceQueue {
       SHARED_REQUIRES(Locks::mutator_lock_);
 
  private:
+  class ClearWhiteReferencesTask;
+
+  // Minimum number of references given to a single ClearWhiteReferencesTask, below this the
+  // thread pool overhead outweighs the gain.
+  static constexpr size_t kMinReferencesPerTask = 1024;
+
+  // Serial version of ClearWhiteReferences.
+  ReferenceQueueCounts SerialClearWhiteReferences(ReferenceQueue* cleared_references,
+                                                  collector::GarbageCollector* collector)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   // Lock, used for parallel GC reference enqueuing. It allows for multiple threads simultaneously
   // calling AtomicEnqueueIfNotEnqueued.
   Mutex* const lock_;
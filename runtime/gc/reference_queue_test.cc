@@ -16,15 +16,59 @@
 
 #include "common_runtime_test.h"
 #include "reference_queue.h"
+#include "collector/garbage_collector.h"
 #include "handle_scope-inl.h"
 #include "mirror/class-inl.h"
+#include "mirror/object_array-inl.h"
 #include "scoped_thread_state_change.h"
+#include "thread_pool.h"
 
 namespace art {
 namespace gc {
 
 class ReferenceQueueTest : public CommonRuntimeTest {};
 
+// Only considers a single object marked, enough for clearing references.
+class MarkedObjectCollector : public collector::GarbageCollector {
+ public:
+  MarkedObjectCollector(Heap* heap, mirror::Object* marked)
+      : GarbageCollector(heap, "marked object collector"), marked_(marked) {}
+
+  collector::GcType GetGcType() const OVERRIDE {
+    return collector::kGcTypeFull;
+  }
+  CollectorType GetCollectorType() const OVERRIDE {
+    return kCollectorTypeMS;
+  }
+  mirror::Object* IsMarked(mirror::Object* obj) OVERRIDE {
+    return obj == marked_ ? obj : nullptr;
+  }
+  bool IsMarkedHeapReference(mirror::HeapReference<mirror::Object>* obj) OVERRIDE
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    return obj->AsMirrorPtr() == marked_;
+  }
+  void ProcessMarkStack() OVERRIDE {}
+  mirror::Object* MarkObject(mirror::Object* obj) OVERRIDE {
+    return obj;
+  }
+  void MarkHeapReference(mirror::HeapReference<mirror::Object>* obj ATTRIBUTE_UNUSED) OVERRIDE {}
+  void DelayReferenceReferent(mirror::Class* klass ATTRIBUTE_UNUSED,
+                              mirror::Reference* reference ATTRIBUTE_UNUSED) OVERRIDE {}
+  void VisitRoots(mirror::Object*** roots ATTRIBUTE_UNUSED,
+                  size_t count ATTRIBUTE_UNUSED,
+                  const RootInfo& info ATTRIBUTE_UNUSED) OVERRIDE {}
+  void VisitRoots(mirror::CompressedReference<mirror::Object>** roots ATTRIBUTE_UNUSED,
+                  size_t count ATTRIBUTE_UNUSED,
+                  const RootInfo& info ATTRIBUTE_UNUSED) OVERRIDE {}
+
+ protected:
+  void RunPhases() OVERRIDE {}
+  void RevokeAllThreadLocalBuffers() OVERRIDE {}
+
+ private:
+  mirror::Object* const marked_;
+};
+
 TEST_F(ReferenceQueueTest, EnqueueDequeue) {
   Thread* self = Thread::Current();
   ScopedObjectAccess soa(self);
@@ -84,5 +128,57 @@ TEST_F(ReferenceQueueTest, Dump) {
   queue.Dump(LOG(INFO));
 }
 
+// Three threads do not divide the references evenly, every reference must still be checked once.
+TEST_F(ReferenceQueueTest, ClearWhiteReferencesParallel) {
+  static constexpr size_t kNumReferences = 3 * 1024 + 1;
+  static constexpr size_t kThreadCount = 3;
+  Thread* self = Thread::Current();
+  ThreadPool thread_pool("reference queue test pool", kThreadCount - 1);
+  ScopedObjectAccess soa(self);
+  StackHandleScope<4> hs(self);
+  Mutex lock("Reference queue lock");
+  ReferenceQueue queue(&lock);
+  ReferenceQueue cleared(&lock);
+  auto ref_class = hs.NewHandle(
+      Runtime::Current()->GetClassLinker()->FindClass(self, "Ljava/lang/ref/WeakReference;",
+                                                      ScopedNullHandle<mirror::ClassLoader>()));
+  ASSERT_TRUE(ref_class.Get() != nullptr);
+  auto array_class = hs.NewHandle(class_linker_->FindSystemClass(self, "[Ljava/lang/Object;"));
+  ASSERT_TRUE(array_class.Get() != nullptr);
+  auto refs = hs.NewHandle(
+      mirror::ObjectArray<mirror::Object>::Alloc(self, array_class.Get(), kNumReferences));
+  ASSERT_TRUE(refs.Get() != nullptr);
+  auto marked = hs.NewHandle(ref_class->AllocObject(self));
+  ASSERT_TRUE(marked.Get() != nullptr);
+  // Every other referent is the marked object, the others are white.
+  for (size_t i = 0; i != kNumReferences; ++i) {
+    mirror::Reference* ref = ref_class->AllocObject(self)->AsReference();
+    ASSERT_TRUE(ref != nullptr);
+    refs->Set<false>(i, ref);
+    mirror::Object* referent = (i % 2 == 0) ? marked.Get() : ref_class->AllocObject(self);
+    ASSERT_TRUE(referent != nullptr);
+    refs->Get(i)->AsReference()->SetReferent<false>(referent);
+  }
+  for (size_t i = 0; i != kNumReferences; ++i) {
+    queue.EnqueueReference(refs->Get(i)->AsReference());
+  }
+
+  MarkedObjectCollector collector(Runtime::Current()->GetHeap(), marked.Get());
+  ReferenceQueueCounts counts =
+      queue.ClearWhiteReferences(&cleared, &collector, &thread_pool, kThreadCount);
+  EXPECT_TRUE(queue.IsEmpty());
+  EXPECT_EQ(kNumReferences, counts.processed);
+  EXPECT_EQ(kNumReferences / 2, counts.cleared);
+  EXPECT_EQ(kNumReferences / 2, cleared.GetLength());
+  for (size_t i = 0; i != kNumReferences; ++i) {
+    mirror::Object* referent = refs->Get(i)->AsReference()->GetReferent();
+    if (i % 2 == 0) {
+      EXPECT_EQ(marked.Get(), referent) << i;
+    } else {
+      EXPECT_TRUE(referent == nullptr) << i;
+    }
+  }
+}
+
 }  // namespace gc
 }  // namespace art
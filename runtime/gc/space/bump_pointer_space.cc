@@ -187,6 +187,74 @@ void BumpPointerSpace::Walk(ObjectCallback* callback, void* arg) {
     }
   }
   // Walk the other blocks (currently only TLABs).
+  WalkBlocks(pos, end, callback, arg);
+}
+
+void BumpPointerSpace::GetWalkRanges(size_t unit_bytes, std::vector<WalkRange>* ranges) {
+  DCHECK_NE(unit_bytes, 0u);
+  uint8_t* pos = Begin();
+  uint8_t* end = End();
+  uint8_t* main_end = pos;
+  {
+    MutexLock mu(Thread::Current(), block_lock_);
+    // Same as Walk().
+    if (num_blocks_ == 0) {
+      UpdateMainBlock();
+    }
+    main_end = Begin() + main_block_size_;
+    if (num_blocks_ == 0) {
+      end = main_end;
+    }
+  }
+  // The objects of the main block have no headers, so the ranges end at object boundaries.
+  uint8_t* range_begin = pos;
+  while (pos < main_end) {
+    mirror::Object* obj = reinterpret_cast<mirror::Object*>(pos);
+    // No read barrier because obj may not be a valid object.
+    if (obj->GetClass<kDefaultVerifyFlags, kWithoutReadBarrier>() == nullptr) {
+      // Walk() stops here, there are no other blocks.
+      end = pos;
+      break;
+    }
+    pos = reinterpret_cast<uint8_t*>(GetNextObject(obj));
+    if (static_cast<size_t>(pos - range_begin) >= unit_bytes) {
+      ranges->push_back({range_begin, pos, true});
+      range_begin = pos;
+    }
+  }
+  if (range_begin != pos) {
+    ranges->push_back({range_begin, pos, true});
+  }
+  // Group the other blocks.
+  range_begin = pos;
+  while (pos < end) {
+    pos += sizeof(BlockHeader) + reinterpret_cast<BlockHeader*>(pos)->size_;
+    if (static_cast<size_t>(pos - range_begin) >= unit_bytes) {
+      ranges->push_back({range_begin, pos, false});
+      range_begin = pos;
+    }
+  }
+  if (range_begin != pos) {
+    ranges->push_back({range_begin, pos, false});
+  }
+}
+
+void BumpPointerSpace::Walk(const WalkRange& range, ObjectCallback* callback, void* arg) {
+  if (!range.main_block) {
+    WalkBlocks(range.begin, range.end, callback, arg);
+    return;
+  }
+  uint8_t* pos = range.begin;
+  while (pos < range.end) {
+    mirror::Object* obj = reinterpret_cast<mirror::Object*>(pos);
+    callback(obj, arg);
+    pos = reinterpret_cast<uint8_t*>(GetNextObject(obj));
+  }
+}
+
+void BumpPointerSpace::WalkBlocks(uint8_t* begin, uint8_t* end, ObjectCallback* callback,
+                                  void* arg) {
+  uint8_t* pos = begin;
   while (pos < end) {
     BlockHeader* header = reinterpret_cast<BlockHeader*>(pos);
     size_t block_size = header->size_;
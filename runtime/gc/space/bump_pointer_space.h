@@ -145,6 +145,22 @@ class BumpPointerSpace FINAL : public ContinuousMemMapAllocSpace {
   void Walk(ObjectCallback* callback, void* arg)
       SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!block_lock_);
 
+  // A part of the objects visited by Walk(), either objects of the main block or whole blocks.
+  struct WalkRange {
+    uint8_t* begin;
+    uint8_t* end;
+    bool main_block;
+  };
+
+  // Splits Walk() into ranges of about unit_bytes which can be visited by different threads. The
+  // objects of the main block are visited once to find object boundaries.
+  void GetWalkRanges(size_t unit_bytes, std::vector<WalkRange>* ranges)
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!block_lock_);
+
+  // Visits the objects of a range returned by GetWalkRanges(), the space must not have changed.
+  void Walk(const WalkRange& range, ObjectCallback* callback, void* arg)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   accounting::ContinuousSpaceBitmap::SweepCallback* GetSweepCallback() OVERRIDE;
 
   // Record objects / bytes freed.
@@ -191,6 +207,10 @@ class BumpPointerSpace FINAL : public ContinuousMemMapAllocSpace {
   static_assert(sizeof(BlockHeader) % kAlignment == 0,
                 "continuous block must be kAlignment aligned");
 
+  // Visits the objects of the blocks from begin to end, which are block boundaries.
+  void WalkBlocks(uint8_t* begin, uint8_t* end, ObjectCallback* callback, void* arg)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   friend class collector::MarkSweep;
   DISALLOW_COPY_AND_ASSIGN(BumpPointerSpace);
 };
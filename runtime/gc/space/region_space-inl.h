@@ -228,7 +228,16 @@ void RegionSpace::WalkInternal(ObjectCallback* callback, void* arg) {
   // issues (the classloader classes lock and the monitor lock). We
   // call this with threads suspended.
   Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
-  for (size_t i = 0; i < num_regions_; ++i) {
+  WalkRegionsInternal<kToSpaceOnly>(0, num_regions_, callback, arg);
+}
+
+template<bool kToSpaceOnly>
+void RegionSpace::WalkRegionsInternal(size_t begin_region,
+                                      size_t end_region,
+                                      ObjectCallback* callback,
+                                      void* arg) {
+  DCHECK_LE(end_region, num_regions_);
+  for (size_t i = begin_region; i < end_region; ++i) {
     Region* r = &regions_[i];
     if (r->IsFree() || (kToSpaceOnly && !r->IsInToSpace())) {
       continue;
@@ -164,7 +164,8 @@ void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table, bool forc
         DCHECK((state == RegionState::kRegionStateAllocated ||
                 state == RegionState::kRegionStateLarge) &&
                type == RegionType::kRegionTypeToSpace);
-        bool should_evacuate = force_evacuate_all || r->ShouldBeEvacuated();
+        // Pinned regions stay in place even if all the others are evacuated.
+        bool should_evacuate = !r->IsPinned() && (force_evacuate_all || r->ShouldBeEvacuated());
         if (should_evacuate) {
           r->SetAsFromSpace();
           DCHECK(r->IsInFromSpace());
@@ -202,6 +203,22 @@ void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table, bool forc
   evac_region_ = &full_region_;
 }
 
+void RegionSpace::PinObject(mirror::Object* obj) {
+  MutexLock mu(Thread::Current(), region_lock_);
+  Region* r = RefToRegionLocked(obj);
+  // The caller got the object through a read barrier, so it is not in an evacuated region.
+  DCHECK(!r->IsInFromSpace()) << obj;
+  DCHECK(!r->IsLargeTail()) << obj;
+  ++r->pin_count_;
+}
+
+void RegionSpace::UnpinObject(mirror::Object* obj) {
+  MutexLock mu(Thread::Current(), region_lock_);
+  Region* r = RefToRegionLocked(obj);
+  CHECK(r->IsPinned()) << obj;
+  --r->pin_count_;
+}
+
 void RegionSpace::ClearFromSpace() {
   MutexLock mu(Thread::Current(), region_lock_);
   for (size_t i = 0; i < num_regions_; ++i) {
@@ -413,7 +430,8 @@ void RegionSpace::Region::Dump(std::ostream& os) const {
      << " state=" << static_cast<uint>(state_) << " type=" << static_cast<uint>(type_)
      << " objects_allocated=" << objects_allocated_
      << " alloc_time=" << alloc_time_ << " live_bytes=" << live_bytes_
-     << " is_newly_allocated=" << is_newly_allocated_ << " is_a_tlab=" << is_a_tlab_ << " thread=" << thread_ << "\n";
+     << " is_newly_allocated=" << is_newly_allocated_ << " is_a_tlab=" << is_a_tlab_
+     << " thread=" << thread_ << " pin_count=" << pin_count_ << "\n";
 }
 
 }  // namespace space
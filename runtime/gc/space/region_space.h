@@ -159,6 +159,17 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     WalkInternal<true>(callback, arg);
   }
 
+  // Visits the objects of the regions [begin_region, end_region), so that a walk can be split
+  // between threads. The mutator lock must be held exclusively, possibly by another thread.
+  void WalkRegions(size_t begin_region, size_t end_region, ObjectCallback* callback, void* arg)
+      NO_THREAD_SAFETY_ANALYSIS {
+    WalkRegionsInternal<false>(begin_region, end_region, callback, arg);
+  }
+
+  size_t GetNumRegions() const {
+    return num_regions_;
+  }
+
   accounting::ContinuousSpaceBitmap::SweepCallback* GetSweepCallback() OVERRIDE {
     return nullptr;
   }
@@ -205,6 +216,12 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
   void SetFromSpace(accounting::ReadBarrierTable* rb_table, bool force_evacuate_all)
       REQUIRES(!region_lock_);
 
+  // Pins the region of an object so that SetFromSpace() does not evacuate it until the object is
+  // unpinned, e.g. while native code accesses the elements of a primitive array. Pins nest. A
+  // large object is pinned through its first region, its tail regions follow it.
+  void PinObject(mirror::Object* obj) REQUIRES(!region_lock_);
+  void UnpinObject(mirror::Object* obj) REQUIRES(!region_lock_);
+
   size_t FromSpaceSize() REQUIRES(!region_lock_);
   size_t UnevacFromSpaceSize() REQUIRES(!region_lock_);
   size_t ToSpaceSize() REQUIRES(!region_lock_);
@@ -229,6 +246,9 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
 
   template<bool kToSpaceOnly>
   void WalkInternal(ObjectCallback* callback, void* arg) NO_THREAD_SAFETY_ANALYSIS;
+  template<bool kToSpaceOnly>
+  void WalkRegionsInternal(size_t begin_region, size_t end_region, ObjectCallback* callback,
+                           void* arg) NO_THREAD_SAFETY_ANALYSIS;
 
   class Region {
    public:
@@ -237,13 +257,13 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
           begin_(nullptr), top_(nullptr), end_(nullptr),
           state_(RegionState::kRegionStateAllocated), type_(RegionType::kRegionTypeToSpace),
           objects_allocated_(0), alloc_time_(0), live_bytes_(static_cast<size_t>(-1)),
-          is_newly_allocated_(false), is_a_tlab_(false), thread_(nullptr) {}
+          is_newly_allocated_(false), is_a_tlab_(false), thread_(nullptr), pin_count_(0) {}
 
     Region(size_t idx, uint8_t* begin, uint8_t* end)
         : idx_(idx), begin_(begin), top_(begin), end_(end),
           state_(RegionState::kRegionStateFree), type_(RegionType::kRegionTypeNone),
           objects_allocated_(0), alloc_time_(0), live_bytes_(static_cast<size_t>(-1)),
-          is_newly_allocated_(false), is_a_tlab_(false), thread_(nullptr) {
+          is_newly_allocated_(false), is_a_tlab_(false), thread_(nullptr), pin_count_(0) {
       DCHECK_LT(begin, end);
       DCHECK_EQ(static_cast<size_t>(end - begin), kRegionSize);
     }
@@ -257,6 +277,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     }
 
     void Clear() {
+      DCHECK_EQ(pin_count_, 0U);
       top_ = begin_;
       state_ = RegionState::kRegionStateFree;
       type_ = RegionType::kRegionTypeNone;
@@ -374,6 +395,10 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
 
     ALWAYS_INLINE bool ShouldBeEvacuated();
 
+    bool IsPinned() const {
+      return pin_count_ != 0;
+    }
+
     void AddLiveBytes(size_t live_bytes) {
       DCHECK(IsInUnevacFromSpace());
       DCHECK(!IsLargeTail());
@@ -474,6 +499,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     bool is_newly_allocated_;      // True if it's allocated after the last collection.
     bool is_a_tlab_;               // True if it's a tlab.
     Thread* thread_;               // The owning thread if it's a tlab.
+    size_t pin_count_;             // The number of pins keeping the region from being evacuated.
 
     friend class RegionSpace;
   };
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "region_space-inl.h"
+
+#include "common_runtime_test.h"
+#include "scoped_thread_state_change.h"
+
+namespace art {
+namespace gc {
+namespace space {
+
+class RegionSpaceTest : public CommonRuntimeTest {};
+
+TEST_F(RegionSpaceTest, PinnedRegionsAreNotEvacuated) {
+  if (kUseTableLookupReadBarrier) {
+    // SetFromSpace() needs the read barrier table of the heap.
+    return;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  std::unique_ptr<RegionSpace> space(RegionSpace::Create("test region space", 16 * MB, nullptr));
+  ASSERT_TRUE(space != nullptr);
+  size_t bytes_allocated;
+  size_t usable_size;
+  size_t bytes_tl_bulk_allocated;
+  mirror::Object* small = space->Alloc(soa.Self(), 64, &bytes_allocated, &usable_size,
+                                       &bytes_tl_bulk_allocated);
+  ASSERT_TRUE(small != nullptr);
+  const size_t large_size = RegionSpace::kRegionSize * 3 / 2;
+  mirror::Object* pinned_large = space->Alloc(soa.Self(), large_size, &bytes_allocated,
+                                              &usable_size, &bytes_tl_bulk_allocated);
+  ASSERT_TRUE(pinned_large != nullptr);
+  mirror::Object* large = space->Alloc(soa.Self(), large_size, &bytes_allocated, &usable_size,
+                                       &bytes_tl_bulk_allocated);
+  ASSERT_TRUE(large != nullptr);
+  mirror::Object* pinned_large_tail = reinterpret_cast<mirror::Object*>(
+      reinterpret_cast<uint8_t*>(pinned_large) + RegionSpace::kRegionSize);
+
+  space->PinObject(small);
+  space->PinObject(small);
+  space->PinObject(pinned_large);
+  space->SetFromSpace(nullptr, /* force_evacuate_all */ true);
+  EXPECT_TRUE(space->IsInUnevacFromSpace(small));
+  EXPECT_TRUE(space->IsInUnevacFromSpace(pinned_large));
+  EXPECT_TRUE(space->IsInUnevacFromSpace(pinned_large_tail));
+  EXPECT_TRUE(space->IsInFromSpace(large));
+  space->ClearFromSpace();
+  EXPECT_TRUE(space->IsInToSpace(small));
+  EXPECT_TRUE(space->IsInToSpace(pinned_large));
+  EXPECT_FALSE(space->IsInToSpace(large));
+
+  // Pins nest, the region stays pinned until the last unpin.
+  space->UnpinObject(small);
+  space->UnpinObject(pinned_large);
+  space->SetFromSpace(nullptr, /* force_evacuate_all */ true);
+  EXPECT_TRUE(space->IsInUnevacFromSpace(small));
+  EXPECT_TRUE(space->IsInFromSpace(pinned_large));
+  EXPECT_TRUE(space->IsInFromSpace(pinned_large_tail));
+  space->ClearFromSpace();
+
+  space->UnpinObject(small);
+  space->SetFromSpace(nullptr, /* force_evacuate_all */ true);
+  EXPECT_TRUE(space->IsInFromSpace(small));
+  space->ClearFromSpace();
+}
+
+}  // namespace space
+}  // namespace gc
+}  // namespace art
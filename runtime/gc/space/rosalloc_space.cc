@@ -258,6 +258,21 @@ size_t RosAllocSpace::Trim() {
   return 0;
 }
 
+bool RosAllocSpace::TrimSlice(size_t* page_idx, size_t max_bytes, size_t* reclaimed_bytes) {
+  if (*page_idx == 0) {
+    Thread* const self = Thread::Current();
+    // SOA required for Rosalloc::Trim() -> ArtRosAllocMoreCore() -> Heap::GetRosAllocSpace.
+    ScopedObjectAccess soa(self);
+    MutexLock mu(self, lock_);
+    // Trim to release memory at the end of the space.
+    rosalloc_->Trim();
+  }
+  if (rosalloc_->DoesReleaseAllPages()) {
+    return true;
+  }
+  return rosalloc_->ReleasePagesSlice(page_idx, max_bytes, reclaimed_bytes);
+}
+
 void RosAllocSpace::Walk(void(*callback)(void *start, void *end, size_t num_bytes, void* callback_arg),
                          void* arg) {
   InspectAllRosAlloc(callback, arg, true);
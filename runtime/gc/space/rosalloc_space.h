@@ -104,6 +104,9 @@ class RosAllocSpace : public MallocSpace {
   }
 
   size_t Trim() OVERRIDE;
+  // Trims the space incrementally, the first slice (*page_idx is 0) also trims the end of the
+  // space. See RosAlloc::ReleasePagesSlice. Returns true once the whole space was trimmed.
+  bool TrimSlice(size_t* page_idx, size_t max_bytes, size_t* reclaimed_bytes);
   void Walk(WalkCallback callback, void* arg) OVERRIDE REQUIRES(!lock_);
   size_t GetFootprint() OVERRIDE;
   size_t GetFootprintLimit() OVERRIDE;
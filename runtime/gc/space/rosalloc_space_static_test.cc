@@ -16,6 +16,11 @@
 
 #include "space_test.h"
 
+#include <vector>
+
+#include "base/memory_tool.h"
+#include "rosalloc_space.h"
+
 namespace art {
 namespace gc {
 namespace space {
@@ -28,6 +33,61 @@ MallocSpace* CreateRosAllocSpace(const std::string& name, size_t initial_size, s
 
 TEST_SPACE_CREATE_FN_STATIC(RosAllocSpace, CreateRosAllocSpace)
 
+// Trimming in slices smaller than the free page runs releases every empty page exactly once.
+TEST_F(RosAllocSpaceStaticTest, TrimSlices) {
+  static constexpr size_t kNumObjects = 65;
+  static constexpr size_t kObjectPages = 8;
+  static constexpr size_t kSliceBytes = 6 * kPageSize;
+  if (RUNNING_ON_MEMORY_TOOL != 0) {
+    // The red zones change the size of the free page runs.
+    return;
+  }
+  RosAllocSpace* space = RosAllocSpace::Create("test", 4 * MB, 8 * MB, 16 * MB, nullptr,
+                                               /* low_memory_mode */ false,
+                                               /* can_move_objects */ false);
+  ASSERT_TRUE(space != nullptr);
+  // Make space findable to the heap for RosAlloc::Trim, will also delete space when runtime is
+  // cleaned up.
+  AddSpace(space);
+  Thread* self = Thread::Current();
+  {
+    ScopedObjectAccess soa(self);
+    std::vector<mirror::Object*> objects;
+    for (size_t i = 0; i != kNumObjects; ++i) {
+      size_t bytes_allocated = 0;
+      size_t bytes_tl_bulk_allocated = 0;
+      mirror::Object* obj = Alloc(space, self, kObjectPages * kPageSize, &bytes_allocated, nullptr,
+                                  &bytes_tl_bulk_allocated);
+      ASSERT_TRUE(obj != nullptr);
+      objects.push_back(obj);
+    }
+    // Free every other object, the kept ones separate the free page runs.
+    for (size_t i = 1; i < kNumObjects; i += 2) {
+      space->Free(self, objects[i]);
+    }
+  }
+  const size_t num_free_runs = kNumObjects / 2;
+  // Debug builds keep the first page of a free page run, it holds a magic number.
+  const size_t released_pages_per_run = kObjectPages - (kIsDebugBuild ? 1u : 0u);
+  const size_t expected_bytes = num_free_runs * released_pages_per_run * kPageSize;
+
+  size_t page_idx = 0;
+  size_t reclaimed_bytes = 0;
+  size_t num_slices = 0;
+  bool done = false;
+  while (!done) {
+    size_t slice_bytes = 0;
+    done = space->TrimSlice(&page_idx, kSliceBytes, &slice_bytes);
+    EXPECT_LE(slice_bytes, kSliceBytes);
+    reclaimed_bytes += slice_bytes;
+    ++num_slices;
+    ASSERT_LE(num_slices, 2 * expected_bytes / kPageSize);
+  }
+  EXPECT_EQ(expected_bytes, reclaimed_bytes);
+  EXPECT_GE(num_slices, expected_bytes / kSliceBytes);
+  // Nothing is left to release by a full trim.
+  EXPECT_EQ(0u, space->Trim());
+}
 
 }  // namespace space
 }  // namespace gc
@@ -34,11 +34,14 @@
 #include <time.h>
 #include <time.h>
 #include <unistd.h>
+#include <zlib.h>
 
+#include <functional>
 #include <set>
 
 #include "art_field-inl.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/stringprintf.h"
 #include "base/time_utils.h"
 #include "base/unix_file/fd_file.h"
@@ -74,6 +77,14 @@ static constexpr uint32_t kHprofNullThread = 0;
 static constexpr size_t kMaxObjectsPerSegment = 128;
 static constexpr size_t kMaxBytesPerSegment = 4096;
 
+// The heap is dumped in units of about this many bytes of a space, see
+// Heap::GetObjectVisitUnitsPaused.
+static constexpr size_t kHeapUnitBytes = 16 * MB;
+// How many units may be dumped ahead of the next one to write out, each of them is buffered.
+static constexpr size_t kMaxPendingUnits = 16;
+// Size of the buffer (before compression) for writes to the dump file.
+static constexpr size_t kStreamBufferSize = 1 * MB;
+
 // The static field-name for the synthetic object generated to account for class static overhead.
 static constexpr const char* kClassOverheadName = "$classOverhead";
 
@@ -252,6 +263,21 @@ class EndianOutput {
     AddU1List((const uint8_t*)str, strlen(str));
   }
 
+  // Returns a new output for records which are later appended with AppendOutput.
+  virtual EndianOutput* NewSegmentOutput() const {
+    return new EndianOutput();
+  }
+
+  // Appends the records of an output returned by NewSegmentOutput. Neither output may have a
+  // record in progress.
+  void AppendOutput(EndianOutput* other) {
+    DCHECK_EQ(length_, 0U);
+    DCHECK_EQ(other->length_, 0U);
+    HandleAppend(other);
+    sum_length_ += other->sum_length_;
+    max_length_ = std::max(max_length_, other->max_length_);
+  }
+
   size_t Length() const {
     return length_;
   }
@@ -279,6 +305,8 @@ class EndianOutput {
   }
   virtual void HandleEndRecord() {
   }
+  virtual void HandleAppend(EndianOutput* other ATTRIBUTE_UNUSED) {
+  }
 
   size_t length_;      // Current record size.
   size_t sum_length_;  // Size of all data.
@@ -294,6 +322,8 @@ class EndianOutputBuffered : public EndianOutput {
   }
   virtual ~EndianOutputBuffered() {}
 
+  EndianOutput* NewSegmentOutput() const OVERRIDE;
+
   void UpdateU4(size_t offset, uint32_t new_value) OVERRIDE {
     DCHECK_LE(offset, length_ - 4);
     buffer_[offset + 0] = static_cast<uint8_t>((new_value >> 24) & 0xFF);
@@ -363,16 +393,66 @@ class EndianOutputBuffered : public EndianOutput {
   virtual void HandleFlush(const uint8_t* buffer ATTRIBUTE_UNUSED, size_t length ATTRIBUTE_UNUSED) {
   }
 
+  void HandleAppend(EndianOutput* other) OVERRIDE;
+
   std::vector<uint8_t> buffer_;
 };
 
+// Keeps the records of a part of the heap dump until they are appended to the actual output.
+class SegmentEndianOutput FINAL : public EndianOutputBuffered {
+ public:
+  SegmentEndianOutput() : EndianOutputBuffered(kMaxBytesPerSegment) {}
+  ~SegmentEndianOutput() {}
+
+  const std::vector<uint8_t>& Records() const {
+    return records_;
+  }
+
+ protected:
+  void HandleFlush(const uint8_t* buffer, size_t length) OVERRIDE {
+    records_.insert(records_.end(), buffer, buffer + length);
+  }
+
+ private:
+  std::vector<uint8_t> records_;
+};
+
+EndianOutput* EndianOutputBuffered::NewSegmentOutput() const {
+  return new SegmentEndianOutput();
+}
+
+void EndianOutputBuffered::HandleAppend(EndianOutput* other) {
+  const std::vector<uint8_t>& records = down_cast<SegmentEndianOutput*>(other)->Records();
+  if (!records.empty()) {
+    HandleFlush(records.data(), records.size());
+  }
+}
+
+// Streams the records to the file through a bounded buffer, optionally compressed with gzip.
 class FileEndianOutput FINAL : public EndianOutputBuffered {
  public:
-  FileEndianOutput(File* fp, size_t reserved_size)
-      : EndianOutputBuffered(reserved_size), fp_(fp), errors_(false) {
+  FileEndianOutput(File* fp, size_t reserved_size, bool compress)
+      : EndianOutputBuffered(reserved_size), fp_(fp), errors_(false), compress_(compress) {
     DCHECK(fp != nullptr);
+    stream_buffer_.reserve(kStreamBufferSize);
+    if (compress_) {
+      memset(&zstream_, 0, sizeof(zstream_));
+      // 16 + MAX_WBITS selects the gzip format. Favor speed, heap dumps compress well anyway.
+      errors_ = deflateInit2(&zstream_, Z_BEST_SPEED, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                             Z_DEFAULT_STRATEGY) != Z_OK;
+      compressed_buffer_.resize(kStreamBufferSize);
+    }
   }
   ~FileEndianOutput() {
+    if (compress_) {
+      deflateEnd(&zstream_);
+    }
+  }
+
+  // Writes the buffered data and ends the compressed stream. Must be called once done.
+  void Finish() {
+    Write(stream_buffer_.data(), stream_buffer_.size(), /* finish */ true);
+    stream_buffer_.clear();
   }
 
   bool Errors() {
@@ -381,14 +461,50 @@ class FileEndianOutput FINAL : public EndianOutputBuffered {
 
  protected:
   void HandleFlush(const uint8_t* buffer, size_t length) OVERRIDE {
-    if (!errors_) {
-      errors_ = !fp_->WriteFully(buffer, length);
+    if (stream_buffer_.size() + length > kStreamBufferSize) {
+      Write(stream_buffer_.data(), stream_buffer_.size(), /* finish */ false);
+      stream_buffer_.clear();
+    }
+    if (length >= kStreamBufferSize) {
+      Write(buffer, length, /* finish */ false);
+    } else {
+      stream_buffer_.insert(stream_buffer_.end(), buffer, buffer + length);
     }
   }
 
  private:
+  void Write(const uint8_t* data, size_t length, bool finish) {
+    if (errors_) {
+      return;
+    }
+    if (!compress_) {
+      errors_ = !fp_->WriteFully(data, length);
+      return;
+    }
+    zstream_.next_in = const_cast<uint8_t*>(data);
+    zstream_.avail_in = length;
+    do {
+      zstream_.next_out = compressed_buffer_.data();
+      zstream_.avail_out = compressed_buffer_.size();
+      if (deflate(&zstream_, finish ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR) {
+        errors_ = true;
+        return;
+      }
+      const size_t compressed_length = compressed_buffer_.size() - zstream_.avail_out;
+      if (compressed_length != 0 && !fp_->WriteFully(compressed_buffer_.data(),
+                                                     compressed_length)) {
+        errors_ = true;
+        return;
+      }
+    } while (zstream_.avail_out == 0);
+  }
+
   File* fp_;
   bool errors_;
+  const bool compress_;
+  std::vector<uint8_t> stream_buffer_;
+  std::vector<uint8_t> compressed_buffer_;
+  z_stream zstream_;
 };
 
 class NetStateEndianOutput FINAL : public EndianOutputBuffered {
@@ -412,20 +528,84 @@ class NetStateEndianOutput FINAL : public EndianOutputBuffered {
   JDWP::JdwpNetStateBase* net_state_;
 };
 
+class Hprof;
+
+// A root found while dumping an object.
+struct DeferredRoot {
+  const mirror::Object* obj;
+  HprofHeapTag heap_tag;
+  uint32_t thread_serial;
+};
+
+// A lookup of a class (if klass is not null) or of a string without an ID yet, made while dumping
+// an object.
+struct DeferredLookup {
+  mirror::Class* klass;
+  std::string string;
+};
+
+// State of a sequence of heap dump segments. The roots are written to the dump output directly.
+// Each unit of the heap is dumped into its own segment output, possibly by another thread, which is
+// then appended to the dump in order.
+struct SegmentWriter {
+  SegmentWriter(Hprof* hprof_in, EndianOutput* output_in, bool deferred_in)
+      : hprof(hprof_in), output(output_in), deferred(deferred_in) {}
+
+  Hprof* const hprof;
+  EndianOutput* const output;
+  HprofHeapId current_heap = HPROF_HEAP_DEFAULT;  // Which heap we're currently dumping.
+  size_t objects_in_segment = 0;
+  size_t total_objects = 0;
+  // Whether the roots found while dumping objects are kept in deferred_roots rather than written,
+  // and the classes and strings without an ID yet in deferred_lookups rather than given one. Both
+  // are handled when the unit is appended, so that duplicates are removed and IDs are assigned in
+  // the same order in both passes, whether or not the units are dumped in parallel.
+  const bool deferred;
+  std::vector<DeferredRoot> deferred_roots;
+  std::vector<DeferredLookup> deferred_lookups;
+};
+
+// Runs a function on a heap thread pool worker.
+class HprofTask : public SelfDeletingTask {
+ public:
+  explicit HprofTask(const std::function<void()>& function) : function_(function) {}
+
+  virtual void Run(Thread* self ATTRIBUTE_UNUSED) OVERRIDE {
+    function_();
+  }
+
+ private:
+  const std::function<void()> function_;
+};
+
 #define __ output_->
 
 class Hprof : public SingleRootVisitor {
  public:
-  Hprof(const char* output_filename, int fd, bool direct_to_ddms)
+  Hprof(const char* output_filename, int fd, bool direct_to_ddms, const DumpOptions& options)
       : filename_(output_filename),
         fd_(fd),
-        direct_to_ddms_(direct_to_ddms) {
-    LOG(INFO) << "hprof: heap dump \"" << filename_ << "\" starting...";
+        direct_to_ddms_(direct_to_ddms),
+        options_(options),
+        lookup_lock_("hprof lookup lock") {
+    LOG(INFO) << "hprof: heap " << (options_.histogram ? "histogram" : "dump") << " \""
+              << filename_ << "\" starting...";
+    gc::Heap* const heap = Runtime::Current()->GetHeap();
+    thread_pool_ = heap->GetThreadPool();
+    if (thread_pool_ != nullptr) {
+      thread_count_ = heap->GetParallelGCThreadCount() + 1;
+    }
   }
 
   void Dump()
     REQUIRES(Locks::mutator_lock_)
     REQUIRES(!Locks::heap_bitmap_lock_, !Locks::alloc_tracker_lock_) {
+    if (options_.histogram) {
+      // Only the class statistics, which do not need the header or the roots.
+      CHECK(!direct_to_ddms_);
+      DumpHistogram();
+      return;
+    }
     {
       MutexLock mu(Thread::Current(), *Locks::alloc_tracker_lock_);
       if (Runtime::Current()->GetHeap()->IsAllocTrackingEnabled()) {
@@ -461,36 +641,211 @@ class Hprof : public SingleRootVisitor {
       LOG(INFO) << "hprof: heap dump completed (" << PrettySize(RoundUp(overall_size, KB))
                 << ") in " << PrettyDuration(duration)
                 << " objects " << total_objects_
-                << " objects with stack traces " << total_objects_with_stack_trace_;
+                << " objects with stack traces " << total_objects_with_stack_trace_
+                << " threads " << thread_count_;
     }
   }
 
  private:
+  struct HistogramEntry {
+    size_t instances = 0;
+    size_t bytes = 0;
+  };
+  typedef std::unordered_map<mirror::Class*, HistogramEntry> Histogram;
+
   static void VisitObjectCallback(mirror::Object* obj, void* arg)
       SHARED_REQUIRES(Locks::mutator_lock_) {
     DCHECK(obj != nullptr);
     DCHECK(arg != nullptr);
-    reinterpret_cast<Hprof*>(arg)->DumpHeapObject(obj);
+    SegmentWriter* const writer = reinterpret_cast<SegmentWriter*>(arg);
+    writer->hprof->DumpHeapObject(obj, writer);
   }
 
-  void DumpHeapObject(mirror::Object* obj)
+  static void CountObjectCallback(mirror::Object* obj, void* arg)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    DCHECK(obj != nullptr);
+    DCHECK(arg != nullptr);
+    // Skip the same objects as DumpHeapObject.
+    mirror::Class* const klass = obj->GetClass();
+    if (klass == nullptr || (obj->IsClass() && obj->AsClass()->IsRetired())) {
+      return;
+    }
+    HistogramEntry& entry = (*reinterpret_cast<Histogram*>(arg))[klass];
+    ++entry.instances;
+    entry.bytes += obj->SizeOf();
+  }
+
+  void DumpHeapObject(mirror::Object* obj, SegmentWriter* writer)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
-  void DumpHeapClass(mirror::Class* klass)
+  void DumpHeapClass(mirror::Class* klass, SegmentWriter* writer)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
-  void DumpHeapArray(mirror::Array* obj, mirror::Class* klass)
+  void DumpHeapArray(mirror::Array* obj, mirror::Class* klass, SegmentWriter* writer)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
-  void DumpHeapInstanceObject(mirror::Object* obj, mirror::Class* klass)
+  void DumpHeapInstanceObject(mirror::Object* obj, mirror::Class* klass, SegmentWriter* writer)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
-  void ProcessHeap(bool header_first)
+  // Runs process(i) for the units i in [0, num_units) on the heap thread pool workers and on this
+  // thread, and merge(i) on this thread, in order, as soon as unit i is processed. Units are only
+  // processed up to kMaxPendingUnits ahead of the next one to merge, which bounds the memory used
+  // by their buffered output.
+  void ForEachUnitInOrder(size_t num_units,
+                          const std::function<void(size_t)>& process,
+                          const std::function<void(size_t)>& merge)
       REQUIRES(Locks::mutator_lock_) {
-    // Reset current heap and object count.
-    current_heap_ = HPROF_HEAP_DEFAULT;
-    objects_in_segment_ = 0;
+    Thread* const self = Thread::Current();
+    std::unique_ptr<Atomic<bool>[]> processed(new Atomic<bool>[num_units]);
+    Atomic<size_t> next_unit(0);
+    Atomic<size_t> merged_units(0);
+    // Processes the next unit if the window allows it. Returns false if there is nothing to do.
+    auto process_next_unit = [&]() NO_THREAD_SAFETY_ANALYSIS {
+      const size_t i = next_unit.LoadRelaxed();
+      if (i >= num_units || i >= merged_units.LoadAcquire() + kMaxPendingUnits) {
+        return false;
+      }
+      if (next_unit.CompareExchangeWeakSequentiallyConsistent(i, i + 1)) {
+        process(i);
+        processed[i].StoreRelease(true);
+      }
+      return true;
+    };
+    const size_t num_workers = std::min(thread_count_, num_units) - 1;
+    if (num_workers != 0) {
+      for (size_t i = 0; i < num_workers; ++i) {
+        // The workers run while this thread holds the mutator lock on their behalf.
+        thread_pool_->AddTask(self, new HprofTask([&]() {
+          while (next_unit.LoadRelaxed() < num_units) {
+            if (!process_next_unit()) {
+              sched_yield();
+            }
+          }
+        }));
+      }
+      thread_pool_->SetMaxActiveWorkers(num_workers);
+      thread_pool_->StartWorkers(self);
+    }
+    for (size_t i = 0; i < num_units; ++i) {
+      while (!processed[i].LoadAcquire()) {
+        if (!process_next_unit()) {
+          sched_yield();
+        }
+      }
+      merge(i);
+      merged_units.StoreRelease(i + 1);
+    }
+    if (num_workers != 0) {
+      thread_pool_->Wait(self, false, true);
+      thread_pool_->StopWorkers(self);
+    }
+  }
+
+  void DumpHeapObjects(SegmentWriter* writer) REQUIRES(Locks::mutator_lock_) {
+    std::vector<gc::Heap::ObjectVisitUnit> units;
+    Runtime::Current()->GetHeap()->GetObjectVisitUnitsPaused(kHeapUnitBytes, &units);
+    std::vector<std::unique_ptr<EndianOutput>> unit_outputs(units.size());
+    std::vector<std::unique_ptr<SegmentWriter>> unit_writers(units.size());
+    auto process = [&](size_t i) NO_THREAD_SAFETY_ANALYSIS {
+      unit_outputs[i].reset(output_->NewSegmentOutput());
+      unit_writers[i].reset(new SegmentWriter(this, unit_outputs[i].get(), true));
+      StartNewHeapDumpSegment(unit_writers[i].get());
+      units[i](VisitObjectCallback, unit_writers[i].get());
+      unit_outputs[i]->EndRecord();
+    };
+    auto merge = [&](size_t i) NO_THREAD_SAFETY_ANALYSIS {
+      SegmentWriter* const unit_writer = unit_writers[i].get();
+      // Skip the units without objects, their output is only an empty segment.
+      if (unit_writer->total_objects != 0) {
+        if (writer->output->Length() != 0) {
+          writer->output->EndRecord();
+        }
+        for (const DeferredLookup& lookup : unit_writer->deferred_lookups) {
+          if (lookup.klass != nullptr) {
+            LookupClassId(lookup.klass);
+          } else {
+            LookupStringId(lookup.string);
+          }
+        }
+        writer->output->AppendOutput(unit_outputs[i].get());
+        total_objects_ += unit_writer->total_objects;
+        if (!unit_writer->deferred_roots.empty()) {
+          StartNewHeapDumpSegment(writer);
+          for (const DeferredRoot& root : unit_writer->deferred_roots) {
+            MarkRootObject(root.obj, 0, root.heap_tag, root.thread_serial, writer);
+          }
+        }
+      }
+      unit_writers[i].reset();
+      unit_outputs[i].reset();
+    };
+    ForEachUnitInOrder(units.size(), process, merge);
+  }
+
+  void DumpHistogram() REQUIRES(Locks::mutator_lock_) {
+    std::vector<gc::Heap::ObjectVisitUnit> units;
+    Runtime::Current()->GetHeap()->GetObjectVisitUnitsPaused(kHeapUnitBytes, &units);
+    std::vector<Histogram> unit_histograms(units.size());
+    Histogram histogram;
+    ForEachUnitInOrder(
+        units.size(),
+        [&](size_t i) NO_THREAD_SAFETY_ANALYSIS {
+          units[i](CountObjectCallback, &unit_histograms[i]);
+        },
+        [&](size_t i) {
+          for (const auto& pair : unit_histograms[i]) {
+            HistogramEntry& entry = histogram[pair.first];
+            entry.instances += pair.second.instances;
+            entry.bytes += pair.second.bytes;
+          }
+          Histogram().swap(unit_histograms[i]);
+        });
+    // Largest classes first.
+    std::vector<std::pair<mirror::Class*, HistogramEntry>> entries(histogram.begin(),
+                                                                   histogram.end());
+    std::sort(entries.begin(),
+              entries.end(),
+              [](const std::pair<mirror::Class*, HistogramEntry>& a,
+                 const std::pair<mirror::Class*, HistogramEntry>& b) {
+                return a.second.bytes > b.second.bytes;
+              });
+
+    std::unique_ptr<File> file(OpenOutputFile());
+    if (file == nullptr) {
+      return;
+    }
+    bool okay;
+    size_t total_instances = 0;
+    size_t total_bytes = 0;
+    {
+      FileEndianOutput file_output(file.get(), KB, options_.compress);
+      // Text lines rather than records, each line is flushed like a record.
+      file_output.AddUtf8String("instances bytes class\n");
+      file_output.EndRecord();
+      for (const auto& pair : entries) {
+        file_output.AddUtf8String(StringPrintf("%zu %zu %s\n",
+                                               pair.second.instances,
+                                               pair.second.bytes,
+                                               PrettyDescriptor(pair.first).c_str()).c_str());
+        file_output.EndRecord();
+        total_instances += pair.second.instances;
+        total_bytes += pair.second.bytes;
+      }
+      file_output.AddUtf8String(
+          StringPrintf("%zu %zu total\n", total_instances, total_bytes).c_str());
+      file_output.EndRecord();
+      file_output.Finish();
+      okay = !file_output.Errors();
+    }
+    if (CloseOutputFile(file.get(), okay)) {
+      LOG(INFO) << "hprof: heap histogram completed (" << entries.size() << " classes, "
+                << total_instances << " objects, " << PrettySize(total_bytes) << ") in "
+                << PrettyDuration(NanoTime() - start_ns_) << " threads " << thread_count_;
+    }
+  }
 
+  void ProcessHeap(bool header_first)
+      REQUIRES(Locks::mutator_lock_) {
     if (header_first) {
       ProcessHeader(true);
       ProcessBody();
@@ -503,12 +858,15 @@ class Hprof : public SingleRootVisitor {
   void ProcessBody() REQUIRES(Locks::mutator_lock_) {
     Runtime* const runtime = Runtime::Current();
     // Walk the roots and the heap.
-    output_->StartNewRecord(HPROF_TAG_HEAP_DUMP_SEGMENT, kHprofTime);
+    SegmentWriter writer(this, output_, false);
+    StartNewHeapDumpSegment(&writer);
 
     simple_roots_.clear();
+    root_writer_ = &writer;
     runtime->VisitRoots(this);
     runtime->VisitImageRoots(this);
-    runtime->GetHeap()->VisitObjectsPaused(VisitObjectCallback, this);
+    root_writer_ = nullptr;
+    DumpHeapObjects(&writer);
 
     output_->StartNewRecord(HPROF_TAG_HEAP_DUMP_END, kHprofTime);
     output_->EndRecord();
@@ -567,34 +925,47 @@ class Hprof : public SingleRootVisitor {
     }
   }
 
-  void StartNewHeapDumpSegment() {
+  void StartNewHeapDumpSegment(SegmentWriter* writer) {
     // This flushes the old segment and starts a new one.
-    output_->StartNewRecord(HPROF_TAG_HEAP_DUMP_SEGMENT, kHprofTime);
-    objects_in_segment_ = 0;
+    writer->output->StartNewRecord(HPROF_TAG_HEAP_DUMP_SEGMENT, kHprofTime);
+    writer->objects_in_segment = 0;
     // Starting a new HEAP_DUMP resets the heap to default.
-    current_heap_ = HPROF_HEAP_DEFAULT;
+    writer->current_heap = HPROF_HEAP_DEFAULT;
   }
 
-  void CheckHeapSegmentConstraints() {
-    if (objects_in_segment_ >= kMaxObjectsPerSegment || output_->Length() >= kMaxBytesPerSegment) {
-      StartNewHeapDumpSegment();
+  void CheckHeapSegmentConstraints(SegmentWriter* writer) {
+    if (writer->objects_in_segment >= kMaxObjectsPerSegment ||
+        writer->output->Length() >= kMaxBytesPerSegment) {
+      StartNewHeapDumpSegment(writer);
     }
   }
 
   void VisitRoot(mirror::Object* obj, const RootInfo& root_info)
-      OVERRIDE SHARED_REQUIRES(Locks::mutator_lock_);
+      OVERRIDE SHARED_REQUIRES(Locks::mutator_lock_) {
+    VisitRoot(obj, root_info, root_writer_);
+  }
+  void VisitRoot(mirror::Object* obj, const RootInfo& root_info, SegmentWriter* writer)
+      SHARED_REQUIRES(Locks::mutator_lock_);
   void MarkRootObject(const mirror::Object* obj, jobject jni_obj, HprofHeapTag heap_tag,
-                      uint32_t thread_serial);
+                      uint32_t thread_serial, SegmentWriter* writer);
 
-  HprofClassObjectId LookupClassId(mirror::Class* c) SHARED_REQUIRES(Locks::mutator_lock_) {
+  // The lookups may be called by several threads while the heap is dumped. A lookup for a deferred
+  // writer does not assign IDs, the unit only gets the final IDs in the second pass.
+  HprofClassObjectId LookupClassId(mirror::Class* c, SegmentWriter* writer = nullptr)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
     if (c != nullptr) {
+      MutexLock mu(Thread::Current(), lookup_lock_);
       auto it = classes_.find(c);
       if (it == classes_.end()) {
-        // first time to see this class
-        HprofClassSerialNumber sn = next_class_serial_number_++;
-        classes_.Put(c, sn);
-        // Make sure that we've assigned a string ID for this class' name
-        LookupClassNameId(c);
+        if (writer != nullptr && writer->deferred) {
+          writer->deferred_lookups.push_back(DeferredLookup { c, std::string() });
+        } else {
+          // first time to see this class
+          HprofClassSerialNumber sn = next_class_serial_number_++;
+          classes_.Put(c, sn);
+          // Make sure that we've assigned a string ID for this class' name
+          LookupStringIdLocked(PrettyDescriptor(c));
+        }
       }
     }
     return PointerToLowMemUInt32(c);
@@ -613,15 +984,30 @@ class Hprof : public SingleRootVisitor {
     }
   }
 
-  HprofStringId LookupStringId(mirror::String* string) SHARED_REQUIRES(Locks::mutator_lock_) {
-    return LookupStringId(string->ToModifiedUtf8());
+  HprofStringId LookupStringId(mirror::String* string, SegmentWriter* writer = nullptr)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    return LookupStringId(string->ToModifiedUtf8(), writer);
+  }
+
+  HprofStringId LookupStringId(const char* string, SegmentWriter* writer = nullptr) {
+    return LookupStringId(std::string(string), writer);
   }
 
-  HprofStringId LookupStringId(const char* string) {
-    return LookupStringId(std::string(string));
+  HprofStringId LookupStringId(const std::string& string, SegmentWriter* writer = nullptr) {
+    MutexLock mu(Thread::Current(), lookup_lock_);
+    if (writer != nullptr && writer->deferred) {
+      auto it = strings_.find(string);
+      if (it != strings_.end()) {
+        return it->second;
+      }
+      writer->deferred_lookups.push_back(DeferredLookup { nullptr, string });
+      // Only written to the first pass, which just counts the bytes.
+      return 0;
+    }
+    return LookupStringIdLocked(string);
   }
 
-  HprofStringId LookupStringId(const std::string& string) {
+  HprofStringId LookupStringIdLocked(const std::string& string) REQUIRES(lookup_lock_) {
     auto it = strings_.find(string);
     if (it != strings_.end()) {
       return it->second;
@@ -734,31 +1120,54 @@ class Hprof : public SingleRootVisitor {
     //        Dbg::DdmSendChunkV(CHUNK_TYPE("HPDS"), iov, 2);
   }
 
-  bool DumpToFile(size_t overall_size, size_t max_length)
-      REQUIRES(Locks::mutator_lock_) {
+  // Returns null, with a pending exception, on failure.
+  File* OpenOutputFile() REQUIRES(Locks::mutator_lock_) {
     // Where exactly are we writing to?
     int out_fd;
     if (fd_ >= 0) {
       out_fd = dup(fd_);
       if (out_fd < 0) {
         ThrowRuntimeException("Couldn't dump heap; dup(%d) failed: %s", fd_, strerror(errno));
-        return false;
+        return nullptr;
       }
     } else {
       out_fd = open(filename_.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
       if (out_fd < 0) {
         ThrowRuntimeException("Couldn't dump heap; open(\"%s\") failed: %s", filename_.c_str(),
                               strerror(errno));
-        return false;
+        return nullptr;
       }
     }
+    return new File(out_fd, filename_, true);
+  }
 
-    std::unique_ptr<File> file(new File(out_fd, filename_, true));
+  bool CloseOutputFile(File* file, bool okay) REQUIRES(Locks::mutator_lock_) {
+    if (okay) {
+      okay = file->FlushCloseOrErase() == 0;
+    } else {
+      file->Erase();
+    }
+    if (!okay) {
+      std::string msg(StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
+                                   filename_.c_str(), strerror(errno)));
+      ThrowRuntimeException("%s", msg.c_str());
+      LOG(ERROR) << msg;
+    }
+    return okay;
+  }
+
+  bool DumpToFile(size_t overall_size, size_t max_length)
+      REQUIRES(Locks::mutator_lock_) {
+    std::unique_ptr<File> file(OpenOutputFile());
+    if (file == nullptr) {
+      return false;
+    }
     bool okay;
     {
-      FileEndianOutput file_output(file.get(), max_length);
+      FileEndianOutput file_output(file.get(), max_length, options_.compress);
       output_ = &file_output;
       ProcessHeap(true);
+      file_output.Finish();
       okay = !file_output.Errors();
 
       if (okay) {
@@ -769,19 +1178,7 @@ class Hprof : public SingleRootVisitor {
       output_ = nullptr;
     }
 
-    if (okay) {
-      okay = file->FlushCloseOrErase() == 0;
-    } else {
-      file->Erase();
-    }
-    if (!okay) {
-      std::string msg(StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
-                                   filename_.c_str(), strerror(errno)));
-      ThrowRuntimeException("%s", msg.c_str());
-      LOG(ERROR) << msg;
-    }
-
-    return okay;
+    return CloseOutputFile(file.get(), okay);
   }
 
   bool DumpToDdmsDirect(size_t overall_size, size_t max_length, uint32_t chunk_type)
@@ -861,17 +1258,24 @@ class Hprof : public SingleRootVisitor {
   std::string filename_;
   int fd_;
   bool direct_to_ddms_;
+  const DumpOptions options_;
 
   uint64_t start_ns_ = NanoTime();
 
-  EndianOutput* output_ = nullptr;
+  // The heap thread pool, if any, used to dump the units of the heap in parallel.
+  ThreadPool* thread_pool_ = nullptr;
+  size_t thread_count_ = 1;
 
-  HprofHeapId current_heap_ = HPROF_HEAP_DEFAULT;  // Which heap we're currently dumping.
-  size_t objects_in_segment_ = 0;
+  EndianOutput* output_ = nullptr;
+  // Where the roots are written while visiting the runtime roots.
+  SegmentWriter* root_writer_ = nullptr;
 
   size_t total_objects_ = 0u;
   size_t total_objects_with_stack_trace_ = 0u;
 
+  // Guards the string and class tables while the heap is dumped.
+  Mutex lookup_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+
   HprofStringId next_string_id_ = 0x400000;
   SafeMap<std::string, HprofStringId> strings_;
   HprofClassSerialNumber next_class_serial_number_ = 1;
@@ -897,6 +1301,10 @@ class Hprof : public SingleRootVisitor {
   DISALLOW_COPY_AND_ASSIGN(Hprof);
 };
 
+// The heap objects are dumped by several threads, each with its own writer.
+#undef __
+#define __ writer->output->
+
 static HprofBasicType SignatureToBasicTypeAndSize(const char* sig, size_t* size_out) {
   char c = sig[0];
   HprofBasicType ret;
@@ -957,12 +1365,12 @@ static HprofBasicType SignatureToBasicTypeAndSize(const char* sig, size_t* size_
 // only true when marking the root set or unreachable
 // objects.  Used to add rootset references to obj.
 void Hprof::MarkRootObject(const mirror::Object* obj, jobject jni_obj, HprofHeapTag heap_tag,
-                           uint32_t thread_serial) {
+                           uint32_t thread_serial, SegmentWriter* writer) {
   if (heap_tag == 0) {
     return;
   }
 
-  CheckHeapSegmentConstraints();
+  CheckHeapSegmentConstraints(writer);
 
   switch (heap_tag) {
     // ID: object ID
@@ -1035,13 +1443,13 @@ void Hprof::MarkRootObject(const mirror::Object* obj, jobject jni_obj, HprofHeap
       break;
   }
 
-  ++objects_in_segment_;
+  ++writer->objects_in_segment;
 }
 
 // Use for visiting the GcRoots held live by ArtFields, ArtMethods, and ClassLoaders.
 class GcRootVisitor {
  public:
-  explicit GcRootVisitor(Hprof* hprof) : hprof_(hprof) {}
+  GcRootVisitor(Hprof* hprof, SegmentWriter* writer) : hprof_(hprof), writer_(writer) {}
 
   void operator()(mirror::Object* obj ATTRIBUTE_UNUSED,
                   MemberOffset offset ATTRIBUTE_UNUSED,
@@ -1062,23 +1470,26 @@ class GcRootVisitor {
     // The two cases are either classes or dex cache arrays. If it is a dex cache array, then use
     // VM internal. Otherwise the object is a declaring class of an ArtField or ArtMethod or a
     // class from a ClassLoader.
-    hprof_->VisitRoot(obj, RootInfo(obj->IsClass() ? kRootStickyClass : kRootVMInternal));
+    hprof_->VisitRoot(obj,
+                      RootInfo(obj->IsClass() ? kRootStickyClass : kRootVMInternal),
+                      writer_);
   }
 
 
  private:
   Hprof* const hprof_;
+  SegmentWriter* const writer_;
 };
 
-void Hprof::DumpHeapObject(mirror::Object* obj) {
+void Hprof::DumpHeapObject(mirror::Object* obj, SegmentWriter* writer) {
   // Ignore classes that are retired.
   if (obj->IsClass() && obj->AsClass()->IsRetired()) {
     return;
   }
 
-  ++total_objects_;
+  ++writer->total_objects;
 
-  GcRootVisitor visitor(this);
+  GcRootVisitor visitor(this, writer);
   obj->VisitReferences(visitor, VoidFunctor());
 
   gc::Heap* const heap = Runtime::Current()->GetHeap();
@@ -1096,9 +1507,9 @@ void Hprof::DumpHeapObject(mirror::Object* obj) {
       heap_type = HPROF_HEAP_ZYGOTE;
     }
   }
-  CheckHeapSegmentConstraints();
+  CheckHeapSegmentConstraints(writer);
 
-  if (heap_type != current_heap_) {
+  if (heap_type != writer->current_heap) {
     HprofStringId nameId;
 
     // This object is in a different heap than the current one.
@@ -1107,22 +1518,22 @@ void Hprof::DumpHeapObject(mirror::Object* obj) {
     __ AddU4(static_cast<uint32_t>(heap_type));   // uint32_t: heap type
     switch (heap_type) {
     case HPROF_HEAP_APP:
-      nameId = LookupStringId("app");
+      nameId = LookupStringId("app", writer);
       break;
     case HPROF_HEAP_ZYGOTE:
-      nameId = LookupStringId("zygote");
+      nameId = LookupStringId("zygote", writer);
       break;
     case HPROF_HEAP_IMAGE:
-      nameId = LookupStringId("image");
+      nameId = LookupStringId("image", writer);
       break;
     default:
       // Internal error
       LOG(ERROR) << "Unexpected desiredHeap";
-      nameId = LookupStringId("<ILLEGAL>");
+      nameId = LookupStringId("<ILLEGAL>", writer);
       break;
     }
     __ AddStringId(nameId);
-    current_heap_ = heap_type;
+    writer->current_heap = heap_type;
   }
 
   mirror::Class* c = obj->GetClass();
@@ -1133,18 +1544,18 @@ void Hprof::DumpHeapObject(mirror::Object* obj) {
     // allocated which hasn't been initialized yet.
   } else {
     if (obj->IsClass()) {
-      DumpHeapClass(obj->AsClass());
+      DumpHeapClass(obj->AsClass(), writer);
     } else if (c->IsArrayClass()) {
-      DumpHeapArray(obj->AsArray(), c);
+      DumpHeapArray(obj->AsArray(), c, writer);
     } else {
-      DumpHeapInstanceObject(obj, c);
+      DumpHeapInstanceObject(obj, c, writer);
     }
   }
 
-  ++objects_in_segment_;
+  ++writer->objects_in_segment;
 }
 
-void Hprof::DumpHeapClass(mirror::Class* klass) {
+void Hprof::DumpHeapClass(mirror::Class* klass, SegmentWriter* writer) {
   if (!klass->IsLoaded() && !klass->IsErroneous()) {
     // Class is allocated but not yet loaded: we cannot access its fields or super class.
     return;
@@ -1171,9 +1582,9 @@ void Hprof::DumpHeapClass(mirror::Class* klass) {
   }
 
   __ AddU1(HPROF_CLASS_DUMP);
-  __ AddClassId(LookupClassId(klass));
+  __ AddClassId(LookupClassId(klass, writer));
   __ AddStackTraceSerialNumber(LookupStackTraceSerialNumber(klass));
-  __ AddClassId(LookupClassId(klass->GetSuperClass()));
+  __ AddClassId(LookupClassId(klass->GetSuperClass(), writer));
   __ AddObjectId(klass->GetClassLoader());
   __ AddObjectId(nullptr);    // no signer
   __ AddObjectId(nullptr);    // no prot domain
@@ -1200,7 +1611,7 @@ void Hprof::DumpHeapClass(mirror::Class* klass) {
     __ AddU2(static_cast<uint16_t>(0));
   } else {
     __ AddU2(static_cast<uint16_t>(num_static_fields + 1));
-    __ AddStringId(LookupStringId(kClassOverheadName));
+    __ AddStringId(LookupStringId(kClassOverheadName, writer));
     __ AddU1(hprof_basic_object);
     __ AddClassStaticsId(klass);
 
@@ -1209,7 +1620,7 @@ void Hprof::DumpHeapClass(mirror::Class* klass) {
 
       size_t size;
       HprofBasicType t = SignatureToBasicTypeAndSize(f->GetTypeDescriptor(), &size);
-      __ AddStringId(LookupStringId(f->GetName()));
+      __ AddStringId(LookupStringId(f->GetName(), writer));
       __ AddU1(t);
       switch (t) {
         case hprof_basic_byte:
@@ -1249,18 +1660,18 @@ void Hprof::DumpHeapClass(mirror::Class* klass) {
   }
   for (int i = 0; i < iFieldCount; ++i) {
     ArtField* f = klass->GetInstanceField(i);
-    __ AddStringId(LookupStringId(f->GetName()));
+    __ AddStringId(LookupStringId(f->GetName(), writer));
     HprofBasicType t = SignatureToBasicTypeAndSize(f->GetTypeDescriptor(), nullptr);
     __ AddU1(t);
   }
   // Add native value character array for strings.
   if (klass->IsStringClass()) {
-    __ AddStringId(LookupStringId("value"));
+    __ AddStringId(LookupStringId("value", writer));
     __ AddU1(hprof_basic_object);
   }
 }
 
-void Hprof::DumpHeapArray(mirror::Array* obj, mirror::Class* klass) {
+void Hprof::DumpHeapArray(mirror::Array* obj, mirror::Class* klass, SegmentWriter* writer) {
   uint32_t length = obj->GetLength();
 
   if (obj->IsObjectArray()) {
@@ -1270,7 +1681,7 @@ void Hprof::DumpHeapArray(mirror::Array* obj, mirror::Class* klass) {
     __ AddObjectId(obj);
     __ AddStackTraceSerialNumber(LookupStackTraceSerialNumber(obj));
     __ AddU4(length);
-    __ AddClassId(LookupClassId(klass));
+    __ AddClassId(LookupClassId(klass, writer));
 
     // Dump the elements, which are always objects or null.
     __ AddIdList(obj->AsObjectArray<mirror::Object>());
@@ -1300,16 +1711,18 @@ void Hprof::DumpHeapArray(mirror::Array* obj, mirror::Class* klass) {
   }
 }
 
-void Hprof::DumpHeapInstanceObject(mirror::Object* obj, mirror::Class* klass) {
+void Hprof::DumpHeapInstanceObject(mirror::Object* obj,
+                                   mirror::Class* klass,
+                                   SegmentWriter* writer) {
   // obj is an instance object.
   __ AddU1(HPROF_INSTANCE_DUMP);
   __ AddObjectId(obj);
   __ AddStackTraceSerialNumber(LookupStackTraceSerialNumber(obj));
-  __ AddClassId(LookupClassId(klass));
+  __ AddClassId(LookupClassId(klass, writer));
 
   // Reserve some space for the length of the instance data, which we won't
   // know until we're done writing it.
-  size_t size_patch_offset = output_->Length();
+  size_t size_patch_offset = writer->output->Length();
   __ AddU4(0x77777777);
 
   // What we will use for the string value if the object is a string.
@@ -1363,7 +1776,7 @@ void Hprof::DumpHeapInstanceObject(mirror::Object* obj, mirror::Class* klass) {
   } while (klass != nullptr);
 
   // Patch the instance field length.
-  __ UpdateU4(size_patch_offset, output_->Length() - (size_patch_offset + 4));
+  __ UpdateU4(size_patch_offset, writer->output->Length() - (size_patch_offset + 4));
 
   // Output native value character array for strings.
   CHECK_EQ(obj->IsString(), string_value != nullptr);
@@ -1378,7 +1791,7 @@ void Hprof::DumpHeapInstanceObject(mirror::Object* obj, mirror::Class* klass) {
   }
 }
 
-void Hprof::VisitRoot(mirror::Object* obj, const RootInfo& info) {
+void Hprof::VisitRoot(mirror::Object* obj, const RootInfo& info, SegmentWriter* writer) {
   static const HprofHeapTag xlate[] = {
     HPROF_ROOT_UNKNOWN,
     HPROF_ROOT_JNI_GLOBAL,
@@ -1400,7 +1813,12 @@ void Hprof::VisitRoot(mirror::Object* obj, const RootInfo& info) {
   if (obj == nullptr) {
     return;
   }
-  MarkRootObject(obj, 0, xlate[info.GetType()], info.GetThreadId());
+  const HprofHeapTag heap_tag = xlate[info.GetType()];
+  if (writer->deferred) {
+    writer->deferred_roots.push_back(DeferredRoot { obj, heap_tag, info.GetThreadId() });
+    return;
+  }
+  MarkRootObject(obj, 0, heap_tag, info.GetThreadId(), writer);
 }
 
 // If "direct_to_ddms" is true, the other arguments are ignored, and data is
@@ -1408,7 +1826,15 @@ void Hprof::VisitRoot(mirror::Object* obj, const RootInfo& info) {
 // If "fd" is >= 0, the output will be written to that file descriptor.
 // Otherwise, "filename" is used to create an output file.
 void DumpHeap(const char* filename, int fd, bool direct_to_ddms) {
+  DumpHeap(filename,
+           fd,
+           direct_to_ddms,
+           direct_to_ddms ? DumpOptions() : Runtime::Current()->GetHprofDumpOptions());
+}
+
+void DumpHeap(const char* filename, int fd, bool direct_to_ddms, const DumpOptions& options) {
   CHECK(filename != nullptr);
+  CHECK(!direct_to_ddms || (!options.compress && !options.histogram));
 
   Thread* self = Thread::Current();
   gc::Heap* heap = Runtime::Current()->GetHeap();
@@ -1419,7 +1845,7 @@ void DumpHeap(const char* filename, int fd, bool direct_to_ddms) {
   }
   {
     ScopedSuspendAll ssa(__FUNCTION__, true /* long suspend */);
-    Hprof hprof(filename, fd, direct_to_ddms);
+    Hprof hprof(filename, fd, direct_to_ddms, options);
     hprof.Dump();
   }
   if (heap->IsGcConcurrentAndMoving()) {
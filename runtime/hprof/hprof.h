@@ -21,8 +21,19 @@ namespace art {
 
 namespace hprof {
 
+struct DumpOptions {
+  // Compress the file with gzip.
+  bool compress = false;
+  // Write a text histogram of the instances and bytes per class instead of a heap dump.
+  bool histogram = false;
+};
+
+// Uses the dump options of the runtime, see Runtime::GetHprofDumpOptions. They do not apply to
+// dumps sent to DDMS.
 void DumpHeap(const char* filename, int fd, bool direct_to_ddms);
 
+void DumpHeap(const char* filename, int fd, bool direct_to_ddms, const DumpOptions& options);
+
 }  // namespace hprof
 
 }  // namespace art
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hprof.h"
+
+#include <zlib.h>
+
+#include <string>
+
+#include "base/unix_file/fd_file.h"
+#include "common_runtime_test.h"
+#include "gc/heap.h"
+#include "os.h"
+#include "runtime.h"
+
+namespace art {
+namespace hprof {
+
+static constexpr const char* kHprofHeader = "JAVA PROFILE 1.0.3";
+
+class HprofTest : public CommonRuntimeTest {
+ protected:
+  std::string ReadFile(const ScratchFile& file) {
+    std::unique_ptr<File> input(OS::OpenFileForReading(file.GetFilename().c_str()));
+    EXPECT_TRUE(input != nullptr);
+    std::string content(input->GetLength(), '\0');
+    EXPECT_TRUE(input->ReadFully(&content[0], content.size()));
+    return content;
+  }
+
+  std::string ReadCompressedFile(const ScratchFile& file) {
+    gzFile input = gzopen(file.GetFilename().c_str(), "rb");
+    EXPECT_TRUE(input != nullptr);
+    std::string content;
+    char buffer[4096];
+    int bytes_read;
+    while ((bytes_read = gzread(input, buffer, sizeof(buffer))) > 0) {
+      content.append(buffer, bytes_read);
+    }
+    EXPECT_EQ(0, bytes_read);
+    gzclose(input);
+    return content;
+  }
+};
+
+TEST_F(HprofTest, DumpHeap) {
+  ScratchFile file;
+  DumpHeap(file.GetFilename().c_str(), -1, false, DumpOptions());
+  std::string content = ReadFile(file);
+  EXPECT_EQ(0u, content.compare(0, strlen(kHprofHeader), kHprofHeader));
+}
+
+TEST_F(HprofTest, DumpHeapCompressed) {
+  ScratchFile file;
+  DumpOptions options;
+  options.compress = true;
+  DumpHeap(file.GetFilename().c_str(), -1, false, options);
+  std::string raw = ReadFile(file);
+  ASSERT_GE(raw.size(), 2u);
+  // The gzip magic.
+  EXPECT_EQ(0x1f, static_cast<uint8_t>(raw[0]));
+  EXPECT_EQ(0x8b, static_cast<uint8_t>(raw[1]));
+  std::string content = ReadCompressedFile(file);
+  EXPECT_GT(content.size(), raw.size());
+  EXPECT_EQ(0u, content.compare(0, strlen(kHprofHeader), kHprofHeader));
+}
+
+TEST_F(HprofTest, DumpHistogram) {
+  ScratchFile file;
+  DumpOptions options;
+  options.histogram = true;
+  DumpHeap(file.GetFilename().c_str(), -1, false, options);
+  std::string content = ReadFile(file);
+  EXPECT_EQ(0u, content.find("instances bytes class\n"));
+  EXPECT_NE(std::string::npos, content.find(" java.lang.String\n"));
+  EXPECT_NE(std::string::npos, content.find(" total\n"));
+}
+
+TEST_F(HprofTest, DumpHistogramCompressed) {
+  ScratchFile file;
+  DumpOptions options;
+  options.compress = true;
+  options.histogram = true;
+  DumpHeap(file.GetFilename().c_str(), -1, false, options);
+  std::string content = ReadCompressedFile(file);
+  EXPECT_EQ(0u, content.find("instances bytes class\n"));
+  EXPECT_NE(std::string::npos, content.find(" java.lang.String\n"));
+}
+
+class HprofHistogramTest : public HprofTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    HprofTest::SetUpRuntimeOptions(options);
+    options->push_back(std::make_pair("-Xhprof-histogram", nullptr));
+  }
+};
+
+TEST_F(HprofHistogramTest, DefaultDumpOptions) {
+  ASSERT_TRUE(Runtime::Current()->GetHprofDumpOptions().histogram);
+  ScratchFile file;
+  DumpHeap(file.GetFilename().c_str(), -1, false);
+  std::string content = ReadFile(file);
+  EXPECT_EQ(0u, content.find("instances bytes class\n"));
+}
+
+class HprofParallelTest : public HprofTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    HprofTest::SetUpRuntimeOptions(options);
+    options->push_back(std::make_pair("-XX:ParallelGCThreads=3", nullptr));
+  }
+};
+
+// The units of the heap are appended in order and the IDs are assigned in the order of the serial
+// dump, so the parallel dump is the same as the serial one.
+TEST_F(HprofParallelTest, SameAsSerialDump) {
+  gc::Heap* const heap = Runtime::Current()->GetHeap();
+  ASSERT_TRUE(heap->GetThreadPool() != nullptr);
+  ScratchFile parallel_file;
+  DumpHeap(parallel_file.GetFilename().c_str(), -1, false, DumpOptions());
+  // Without the heap thread pool the units are dumped by the calling thread.
+  heap->DeleteThreadPool();
+  ScratchFile serial_file;
+  DumpHeap(serial_file.GetFilename().c_str(), -1, false, DumpOptions());
+  heap->CreateThreadPool();
+
+  std::string parallel = ReadFile(parallel_file);
+  std::string serial = ReadFile(serial_file);
+  // The header is followed by the identifier size and the time of the dump, which may differ.
+  const size_t time_offset = strlen(kHprofHeader) + 1 + sizeof(uint32_t);
+  const size_t time_size = 2 * sizeof(uint32_t);
+  ASSERT_GT(serial.size(), time_offset + time_size);
+  ASSERT_EQ(serial.size(), parallel.size());
+  serial.replace(time_offset, time_size, time_size, '\0');
+  parallel.replace(time_offset, time_size, time_size, '\0');
+  EXPECT_TRUE(serial == parallel);
+}
+
+}  // namespace hprof
+}  // namespace art
@@ -26,12 +26,17 @@
 #include "utils.h"
 #include "verify_object-inl.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 
 namespace art {
 
 static constexpr bool kDumpStackOnNonLocalReference = false;
 
+// holes_ is compacted when it has this many more indices than twice the number of holes.
+static constexpr size_t kMinHolesToCompact = 16;
+
 const char* GetIndirectRefKindString(const IndirectRefKind& kind) {
   switch (kind) {
     case kHandleScopeOrInvalid:
@@ -92,8 +97,11 @@ IndirectReferenceTable::IndirectReferenceTable(size_t initialCount,
   CHECK_LE(initialCount, maxCount);
   CHECK_NE(desiredKind, kHandleScopeOrInvalid);
 
+  // Use the whole pages of the initial mapping, the table grows from there.
+  alloc_entries_ = std::min(RoundUp(initialCount * sizeof(IrtEntry), kPageSize) / sizeof(IrtEntry),
+                            maxCount);
   std::string error_str;
-  const size_t table_bytes = maxCount * sizeof(IrtEntry);
+  const size_t table_bytes = alloc_entries_ * sizeof(IrtEntry);
   table_mem_map_.reset(MemMap::MapAnonymous("indirect ref table", nullptr, table_bytes,
                                             PROT_READ | PROT_WRITE, false, false, &error_str));
   if (abort_on_error) {
@@ -118,6 +126,56 @@ bool IndirectReferenceTable::IsValid() const {
   return table_mem_map_.get() != nullptr;
 }
 
+bool IndirectReferenceTable::Resize(size_t new_size, std::string* error_msg) {
+  DCHECK_GT(new_size, alloc_entries_);
+  DCHECK_LE(new_size, max_entries_);
+  const size_t table_bytes = new_size * sizeof(IrtEntry);
+  std::unique_ptr<MemMap> new_map(MemMap::MapAnonymous("indirect ref table", nullptr, table_bytes,
+                                                       PROT_READ | PROT_WRITE, false, false,
+                                                       error_msg));
+  if (new_map.get() == nullptr) {
+    return false;
+  }
+  // Copy the entries past the top too, their serials keep detecting stale references.
+  memcpy(new_map->Begin(), table_mem_map_->Begin(), table_mem_map_->Size());
+  table_mem_map_ = std::move(new_map);
+  table_ = reinterpret_cast<IrtEntry*>(table_mem_map_->Begin());
+  alloc_entries_ = new_size;
+  return true;
+}
+
+size_t IndirectReferenceTable::PopHole(size_t bottom_index, size_t top_index) {
+  while (!holes_.empty()) {
+    const size_t index = holes_.back();
+    if (index < bottom_index) {
+      // A hole of an outer segment, the current one has none left.
+      break;
+    }
+    holes_.pop_back();
+    if (index < top_index && table_[index].GetReference()->IsNull()) {
+      return index;
+    }
+  }
+  LOG(FATAL) << "Missing hole in " << kind_ << " table (bottom=" << bottom_index
+             << " top=" << top_index << " holes=" << segment_state_.parts.numHoles << ")";
+  UNREACHABLE();
+}
+
+void IndirectReferenceTable::CompactHoles() {
+  const size_t top_index = segment_state_.parts.topIndex;
+  std::vector<bool> seen(top_index, false);
+  // Walk from the most recent hole, keeping the last time each one was made.
+  size_t begin = holes_.size();
+  for (size_t i = holes_.size(); i != 0; --i) {
+    const uint32_t index = holes_[i - 1];
+    if (index < top_index && !seen[index] && table_[index].GetReference()->IsNull()) {
+      seen[index] = true;
+      holes_[--begin] = index;
+    }
+  }
+  holes_.erase(holes_.begin(), holes_.begin() + begin);
+}
+
 IndirectRef IndirectReferenceTable::Add(uint32_t cookie, mirror::Object* obj) {
   IRTSegmentState prevState;
   prevState.all = cookie;
@@ -128,31 +186,30 @@ IndirectRef IndirectReferenceTable::Add(uint32_t cookie, mirror::Object* obj) {
   DCHECK(table_ != nullptr);
   DCHECK_GE(segment_state_.parts.numHoles, prevState.parts.numHoles);
 
-  if (topIndex == max_entries_) {
-    LOG(FATAL) << "JNI ERROR (app bug): " << kind_ << " table overflow "
-               << "(max=" << max_entries_ << ")\n"
-               << MutatorLockedDumpable<IndirectReferenceTable>(*this);
-  }
-
   // We know there's enough room in the table.  Now we just need to find
-  // the right spot.  If there's a hole, find it and fill it; otherwise,
-  // add to the end of the list.
+  // the right spot.  If there's a hole, fill it; otherwise, add to the end
+  // of the list, growing the table if needed.
   IndirectRef result;
   int numHoles = segment_state_.parts.numHoles - prevState.parts.numHoles;
   size_t index;
   if (numHoles > 0) {
     DCHECK_GT(topIndex, 1U);
-    // Find the first hole; likely to be near the end of the list.
-    IrtEntry* pScan = &table_[topIndex - 1];
-    DCHECK(!pScan->GetReference()->IsNull());
-    --pScan;
-    while (!pScan->GetReference()->IsNull()) {
-      DCHECK_GE(pScan, table_ + prevState.parts.topIndex);
-      --pScan;
-    }
-    index = pScan - table_;
+    DCHECK(!table_[topIndex - 1].GetReference()->IsNull());
+    index = PopHole(prevState.parts.topIndex, topIndex);
     segment_state_.parts.numHoles--;
   } else {
+    if (topIndex == alloc_entries_) {
+      if (topIndex == max_entries_) {
+        LOG(FATAL) << "JNI ERROR (app bug): " << kind_ << " table overflow "
+                   << "(max=" << max_entries_ << ")\n"
+                   << MutatorLockedDumpable<IndirectReferenceTable>(*this);
+      }
+      std::string error_msg;
+      if (!Resize(std::min(2 * alloc_entries_, max_entries_), &error_msg)) {
+        LOG(FATAL) << "Failed to grow " << kind_ << " table from " << alloc_entries_
+                   << " entries: " << error_msg;
+      }
+    }
     // Add to the end.
     index = topIndex++;
     segment_state_.parts.topIndex = topIndex;
@@ -269,6 +326,11 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
 
     *table_[idx].GetReference() = GcRoot<mirror::Object>(nullptr);
     segment_state_.parts.numHoles++;
+    // Bound the stale indices left by popped segments.
+    if (holes_.size() >= 2 * segment_state_.parts.numHoles + kMinHolesToCompact) {
+      CompactHoles();
+    }
+    holes_.push_back(idx);
     if ((false)) {
       LOG(INFO) << "+++ left hole at " << idx << ", holes=" << segment_state_.parts.numHoles;
     }
@@ -277,6 +339,62 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
   return true;
 }
 
+size_t IndirectReferenceTable::GrowSlots(size_t count, uint32_t* slots) {
+  DCHECK(table_ != nullptr);
+  CHECK_EQ(alloc_entries_, max_entries_) << "Slots of a " << kind_ << " table which may move";
+  size_t top_index = segment_state_.parts.topIndex;
+  if (top_index == max_entries_) {
+    LOG(FATAL) << "JNI ERROR (app bug): " << kind_ << " table overflow "
+               << "(max=" << max_entries_ << ")\n"
+               << MutatorLockedDumpable<IndirectReferenceTable>(*this);
+  }
+  const size_t num_slots = std::min(count, max_entries_ - top_index);
+  for (size_t i = 0; i != num_slots; ++i) {
+    DCHECK(table_[top_index].GetReference()->IsNull());
+    slots[i] = top_index++;
+  }
+  segment_state_.parts.topIndex = top_index;
+  return num_slots;
+}
+
+IndirectRef IndirectReferenceTable::AddAt(uint32_t index, mirror::Object* obj) {
+  CHECK(obj != nullptr);
+  VerifyObject(obj);
+  DCHECK(table_ != nullptr);
+  DCHECK_LT(index, Capacity());
+  DCHECK(table_[index].GetReference()->IsNull());
+  table_[index].Add(obj);
+  return ToIndirectRef(index);
+}
+
+bool IndirectReferenceTable::RemoveSlot(IndirectRef iref, uint32_t* index) {
+  DCHECK(table_ != nullptr);
+  const uint32_t idx = ExtractIndex(iref);
+  if (GetIndirectRefKind(iref) != kind_ || idx >= Capacity()) {
+    LOG(WARNING) << "Attempt to remove invalid " << kind_ << " " << iref
+                 << " (top=" << Capacity() << ")";
+    return false;
+  }
+  if (!CheckEntry("remove", iref, idx)) {
+    return false;
+  }
+  auto* root = reinterpret_cast<Atomic<mirror::CompressedReference<mirror::Object>>*>(
+      table_[idx].GetReference()->AddressWithoutBarrier());
+  const mirror::CompressedReference<mirror::Object> null_ref =
+      mirror::CompressedReference<mirror::Object>::FromMirrorPtr(nullptr);
+  // Only one of several threads removing the same reference frees the slot.
+  mirror::CompressedReference<mirror::Object> old_ref;
+  do {
+    old_ref = root->LoadRelaxed();
+    if (old_ref.IsNull()) {
+      LOG(WARNING) << "Attempt to remove deleted " << kind_ << " " << iref;
+      return false;
+    }
+  } while (!root->CompareExchangeWeakSequentiallyConsistent(old_ref, null_ref));
+  *index = idx;
+  return true;
+}
+
 void IndirectReferenceTable::Trim() {
   ScopedTrace trace(__PRETTY_FUNCTION__);
   const size_t top_index = Capacity();
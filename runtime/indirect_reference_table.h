@@ -21,6 +21,7 @@
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/mutex.h"
@@ -146,7 +147,9 @@ static const uint32_t IRT_FIRST_SEGMENT = 0;
  *
  * If we delete entries from the middle of the list, we will be left with
  * "holes".  We track the number of holes so that, when adding new elements,
- * we can quickly decide to do a trivial append or go slot-hunting.
+ * we can quickly decide to do a trivial append or fill a hole.  The indices
+ * of the holes are also pushed on "holes_" as they are made, so a hole is
+ * found without scanning the table.
  *
  * When the top-most entry is removed, any holes immediately below it are
  * also removed.  Thus, deletion of an entry may reduce "topIndex" by more
@@ -176,10 +179,11 @@ static const uint32_t IRT_FIRST_SEGMENT = 0;
  * stale references aren't possible (though we may be able to get similar
  * benefits with other approaches).
  *
- * TODO: consider a "lastDeleteIndex" for quick hole-filling when an
- * add immediately follows a delete; must invalidate after segment pop
- * (which could increase the cost/complexity of method call/return).
- * Might be worth only using it for JNI globals.
+ * Segment pops only reset the segment state, so "holes_" may have stale
+ * indices, above the top or refilled since.  They are dropped lazily when
+ * looking for a hole.  The holes of the current segment were all made
+ * after the ones of the outer segments, so they are the last valid indices
+ * of "holes_".
  *
  * TODO: may want completely different add/remove algorithms for global
  * and local refs to improve performance.  A large circular buffer might
@@ -226,6 +230,44 @@ class IrtEntry {
 static_assert(sizeof(IrtEntry) == (1 + kIRTPrevCount) * sizeof(uint32_t),
               "Unexpected sizeof(IrtEntry)");
 
+// Free slots of a table used through the slot interface of IndirectReferenceTable, cached by
+// one thread. The JNI global tables keep one per thread in the JNIEnvExt so that adding and
+// removing a global reference does not need the table lock in the common case.
+class IrtSlotCache {
+ public:
+  static constexpr size_t kCapacity = 32;
+
+  IrtSlotCache() : size_(0) {}
+
+  bool IsEmpty() const {
+    return size_ == 0;
+  }
+
+  bool IsFull() const {
+    return size_ == kCapacity;
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+  uint32_t Pop() {
+    DCHECK(!IsEmpty());
+    return slots_[--size_];
+  }
+
+  void Push(uint32_t index) {
+    DCHECK(!IsFull());
+    slots_[size_++] = index;
+  }
+
+ private:
+  size_t size_;
+  uint32_t slots_[kCapacity];
+
+  DISALLOW_COPY_AND_ASSIGN(IrtSlotCache);
+};
+
 class IrtIterator {
  public:
   IrtIterator(IrtEntry* table, size_t i, size_t capacity) SHARED_REQUIRES(Locks::mutator_lock_)
@@ -334,6 +376,12 @@ class IndirectReferenceTable {
     return IrtIterator(table_, Capacity(), Capacity());
   }
 
+  // Iterator starting at the given index, used to split an iteration into ranges.
+  IrtIterator IteratorAt(size_t index) {
+    DCHECK_LE(index, Capacity());
+    return IrtIterator(table_, index, Capacity());
+  }
+
   void VisitRoots(RootVisitor* visitor, const RootInfo& root_info)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
@@ -355,6 +403,31 @@ class IndirectReferenceTable {
   // Release pages past the end of the table that may have previously held references.
   void Trim() SHARED_REQUIRES(Locks::mutator_lock_);
 
+  /*
+   * Slot interface, used instead of Add and Remove by the JNI global tables. The caller keeps
+   * track of the free slots, which are the null entries below the top index, and the table never
+   * shrinks. Holes are not counted and segments are not supported.
+   *
+   * AddAt and RemoveSlot do not need to be serialized with each other or with the GC visiting
+   * the roots, as long as the caller is runnable: a free entry only has null references, so a
+   * racing visitor sees either null or the added object, and entries are cleared with a CAS so
+   * that a root updated concurrently by the GC is not lost. GrowSlots must be serialized with
+   * Trim. For the same reason the table must not move, so it has to be created with its maximum
+   * size.
+   */
+
+  // Appends up to `count` slots to the table and stores their indices in `slots`. Returns the
+  // number of slots appended, which is only less than `count` when the table fills up. Aborts if
+  // the table is already full.
+  size_t GrowSlots(size_t count, uint32_t* slots) SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Adds `obj` to the free slot at `index`.
+  IndirectRef AddAt(uint32_t index, mirror::Object* obj) SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Removes `iref` and stores the index of its slot, which is then free, in `index`. Returns
+  // "false" if `iref` is not a live entry of the table, in particular if it was already removed.
+  bool RemoveSlot(IndirectRef iref, uint32_t* index) SHARED_REQUIRES(Locks::mutator_lock_);
+
  private:
   // Extract the table index from an indirect reference.
   static uint32_t ExtractIndex(IndirectRef iref) {
@@ -373,6 +446,15 @@ class IndirectReferenceTable {
     return reinterpret_cast<IndirectRef>(uref);
   }
 
+  // Grows the table to `new_size` entries, moving the entries to a new mem map.
+  bool Resize(size_t new_size, std::string* error_msg);
+
+  // Returns the most recent hole in [bottom_index, top_index), dropping the stale indices above it.
+  size_t PopHole(size_t bottom_index, size_t top_index);
+
+  // Drops the stale and duplicate indices from holes_, keeping the most recent ones in order.
+  void CompactHoles();
+
   // Abort if check_jni is not enabled. Otherwise, just log as an error.
   static void AbortIfNoCheckJNI(const std::string& msg);
 
@@ -390,8 +472,12 @@ class IndirectReferenceTable {
   IrtEntry* table_;
   /* bit mask, ORed into all irefs */
   const IndirectRefKind kind_;
+  /* #of entries the table has room for, grows up to max_entries_ */
+  size_t alloc_entries_;
   /* max #of entries allowed */
   const size_t max_entries_;
+  /* indices of the holes made by Remove, most recent last; may be stale */
+  std::vector<uint32_t> holes_;
 };
 
 }  // namespace art
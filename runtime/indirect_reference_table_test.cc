@@ -254,4 +254,159 @@ TEST_F(IndirectReferenceTableTest, BasicTest) {
   CheckDump(&irt, 0, 0);
 }
 
+TEST_F(IndirectReferenceTableTest, Resize) {
+  ScopedObjectAccess soa(Thread::Current());
+  static const size_t kTableInitial = 10;
+  static const size_t kTableMax = 2000;
+  IndirectReferenceTable irt(kTableInitial, kTableMax, kLocal);
+
+  mirror::Class* c = class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;");
+  ASSERT_TRUE(c != nullptr);
+  mirror::Object* obj0 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj0 != nullptr);
+  mirror::Object* obj1 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj1 != nullptr);
+
+  const uint32_t cookie = IRT_FIRST_SEGMENT;
+  std::vector<IndirectRef> refs;
+  for (size_t i = 0; i < kTableMax; ++i) {
+    refs.push_back(irt.Add(cookie, (i % 2 == 0) ? obj0 : obj1));
+    ASSERT_TRUE(refs.back() != nullptr) << "Failed adding " << i;
+  }
+  ASSERT_EQ(kTableMax, irt.Capacity());
+  CheckDump(&irt, kTableMax, 2);
+  // The references added before the table moved are still valid.
+  for (size_t i = 0; i < kTableMax; ++i) {
+    ASSERT_EQ((i % 2 == 0) ? obj0 : obj1, irt.Get(refs[i])) << i;
+  }
+  for (size_t i = kTableMax; i != 0; --i) {
+    ASSERT_TRUE(irt.Remove(cookie, refs[i - 1])) << "failed removing " << i - 1;
+  }
+  ASSERT_EQ(0U, irt.Capacity());
+}
+
+TEST_F(IndirectReferenceTableTest, HolesInSegments) {
+  ScopedObjectAccess soa(Thread::Current());
+  static const size_t kTableInitial = 10;
+  static const size_t kTableMax = 20;
+  IndirectReferenceTable irt(kTableInitial, kTableMax, kLocal);
+
+  mirror::Class* c = class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;");
+  ASSERT_TRUE(c != nullptr);
+  mirror::Object* obj0 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj0 != nullptr);
+  mirror::Object* obj1 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj1 != nullptr);
+  mirror::Object* obj2 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj2 != nullptr);
+  mirror::Object* obj3 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj3 != nullptr);
+
+  // Leave a hole in the outer segment.
+  const uint32_t cookie0 = IRT_FIRST_SEGMENT;
+  IndirectRef iref0 = irt.Add(cookie0, obj0);
+  IndirectRef iref1 = irt.Add(cookie0, obj1);
+  IndirectRef iref2 = irt.Add(cookie0, obj2);
+  ASSERT_TRUE(irt.Remove(cookie0, iref0));
+  CheckDump(&irt, 2, 2);
+
+  // Additions to a new segment do not fill the holes of the outer one.
+  const uint32_t cookie1 = irt.GetSegmentState();
+  IndirectRef iref3 = irt.Add(cookie1, obj3);
+  IndirectRef iref4 = irt.Add(cookie1, obj0);
+  IndirectRef iref5 = irt.Add(cookie1, obj1);
+  ASSERT_EQ(6U, irt.Capacity());
+  ASSERT_TRUE(iref5 != nullptr);
+
+  // The holes of the new segment are filled, most recent first.
+  ASSERT_TRUE(irt.Remove(cookie1, iref3));
+  ASSERT_TRUE(irt.Remove(cookie1, iref4));
+  IndirectRef iref6 = irt.Add(cookie1, obj2);
+  IndirectRef iref7 = irt.Add(cookie1, obj3);
+  EXPECT_EQ(6U, irt.Capacity()) << "holes not filled";
+  EXPECT_EQ(obj2, irt.Get(iref6));
+  EXPECT_EQ(obj3, irt.Get(iref7));
+  IndirectRef iref8 = irt.Add(cookie1, obj0);
+  EXPECT_EQ(7U, irt.Capacity());
+  EXPECT_EQ(obj0, irt.Get(iref8));
+
+  // Pop the segment with a hole in it, then fill the hole of the outer segment.
+  ASSERT_TRUE(irt.Remove(cookie1, iref6));
+  irt.SetSegmentState(cookie1);
+  ASSERT_EQ(3U, irt.Capacity());
+  IndirectRef iref9 = irt.Add(cookie0, obj3);
+  EXPECT_EQ(3U, irt.Capacity()) << "outer hole not filled";
+  EXPECT_EQ(obj3, irt.Get(iref9));
+  EXPECT_EQ(obj1, irt.Get(iref1));
+  EXPECT_EQ(obj2, irt.Get(iref2));
+  CheckDump(&irt, 3, 3);
+
+  // Segments repeatedly popped with holes in them do not confuse the outer segment.
+  for (size_t i = 0; i < 100; ++i) {
+    const uint32_t cookie = irt.GetSegmentState();
+    IndirectRef first = irt.Add(cookie, obj0);
+    irt.Add(cookie, obj1);
+    ASSERT_TRUE(irt.Remove(cookie, first));
+    irt.SetSegmentState(cookie);
+  }
+  ASSERT_TRUE(irt.Remove(cookie0, iref1));
+  IndirectRef iref10 = irt.Add(cookie0, obj0);
+  EXPECT_EQ(3U, irt.Capacity());
+  EXPECT_EQ(obj0, irt.Get(iref10));
+}
+
+TEST_F(IndirectReferenceTableTest, SlotInterface) {
+  // This will lead to error messages in the log.
+  ScopedLogSeverity sls(LogSeverity::FATAL);
+
+  ScopedObjectAccess soa(Thread::Current());
+  static const size_t kTableInitial = 10;
+  static const size_t kTableMax = 20;
+  IndirectReferenceTable irt(kTableInitial, kTableMax, kGlobal);
+
+  mirror::Class* c = class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;");
+  ASSERT_TRUE(c != nullptr);
+  mirror::Object* obj0 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj0 != nullptr);
+  mirror::Object* obj1 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj1 != nullptr);
+
+  uint32_t slots[kTableMax];
+  ASSERT_EQ(4U, irt.GrowSlots(4, slots));
+  EXPECT_EQ(4U, irt.Capacity());
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(i, slots[i]);
+  }
+  // Free slots are null entries.
+  CheckDump(&irt, 0, 0);
+
+  IndirectRef iref0 = irt.AddAt(slots[2], obj0);
+  IndirectRef iref1 = irt.AddAt(slots[0], obj1);
+  EXPECT_EQ(obj0, irt.Get(iref0));
+  EXPECT_EQ(obj1, irt.Get(iref1));
+  CheckDump(&irt, 2, 2);
+
+  uint32_t index;
+  ASSERT_TRUE(irt.RemoveSlot(iref0, &index));
+  EXPECT_EQ(slots[2], index);
+  CheckDump(&irt, 1, 1);
+  // The table does not shrink, and removing twice fails.
+  EXPECT_EQ(4U, irt.Capacity());
+  EXPECT_FALSE(irt.RemoveSlot(iref0, &index));
+
+  // A reused slot gets a new serial, so the stale reference does not match it.
+  IndirectRef iref2 = irt.AddAt(index, obj1);
+  EXPECT_NE(iref0, iref2);
+  EXPECT_EQ(obj1, irt.Get(iref2));
+  CheckDump(&irt, 2, 1);
+
+  // Growing stops at the maximum size.
+  EXPECT_EQ(kTableMax - 4, irt.GrowSlots(kTableMax, slots));
+  EXPECT_EQ(kTableMax, irt.Capacity());
+
+  ASSERT_TRUE(irt.RemoveSlot(iref1, &index));
+  ASSERT_TRUE(irt.RemoveSlot(iref2, &index));
+  CheckDump(&irt, 0, 0);
+}
+
 }  // namespace art
@@ -20,6 +20,7 @@
 
 #include "gc_root-inl.h"
 #include "gc/collector/garbage_collector.h"
+#include "gc/parallel_weak_sweep.h"
 #include "gc/space/image_space.h"
 #include "gc/weak_root_state.h"
 #include "image-inl.h"
@@ -34,24 +35,46 @@ namespace art {
 
 InternTable::InternTable()
     : images_added_to_intern_table_(false),
-      log_new_roots_(false),
       weak_intern_condition_("New intern condition", *Locks::intern_table_lock_),
+      image_tables_(nullptr),
       weak_root_state_(gc::kWeakRootStateNormal) {
+  owned_image_table_lists_.emplace_back(new ImageTables());
+  image_tables_.StoreRelaxed(owned_image_table_lists_.back().get());
+}
+
+InternTable::Shard::Shard() : lock_("InternTable shard lock", kInternTableShardLock),
+                              log_new_roots_(false) {
+}
+
+InternTable::Shard& InternTable::GetShard(mirror::String* s) {
+  return GetShard(s->GetHashCode());
 }
 
 size_t InternTable::Size() const {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  return strong_interns_.Size() + weak_interns_.Size();
+  return StrongSize() + WeakSize();
 }
 
 size_t InternTable::StrongSize() const {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  return strong_interns_.Size();
+  size_t size = 0;
+  for (const UnorderedSet* table : *image_tables_.LoadAcquire()) {
+    size += table->Size();
+  }
+  Thread* const self = Thread::Current();
+  for (const Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock_);
+    size += shard.strong_interns_.Size();
+  }
+  return size;
 }
 
 size_t InternTable::WeakSize() const {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  return weak_interns_.Size();
+  size_t size = 0;
+  Thread* const self = Thread::Current();
+  for (const Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock_);
+    size += shard.weak_interns_.Size();
+  }
+  return size;
 }
 
 void InternTable::DumpForSigQuit(std::ostream& os) const {
@@ -59,42 +82,68 @@ void InternTable::DumpForSigQuit(std::ostream& os) const {
 }
 
 void InternTable::VisitRoots(RootVisitor* visitor, VisitRootFlags flags) {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
   if ((flags & kVisitRootFlagAllRoots) != 0) {
-    strong_interns_.VisitRoots(visitor);
-  } else if ((flags & kVisitRootFlagNewRoots) != 0) {
-    for (auto& root : new_strong_intern_roots_) {
-      mirror::String* old_ref = root.Read<kWithoutReadBarrier>();
-      root.VisitRoot(visitor, RootInfo(kRootInternedString));
-      mirror::String* new_ref = root.Read<kWithoutReadBarrier>();
-      if (new_ref != old_ref) {
-        // The GC moved a root in the log. Need to search the strong interns and update the
-        // corresponding object. This is slow, but luckily for us, this may only happen with a
-        // concurrent moving GC.
-        strong_interns_.Remove(old_ref);
-        strong_interns_.Insert(new_ref);
+    // The image tables are only visited for the image writer and patchoat, which relocate them.
+    BufferedRootVisitor<kDefaultBufferedRootCount> buffered_visitor(
+        visitor, RootInfo(kRootInternedString));
+    for (UnorderedSet* table : *image_tables_.LoadAcquire()) {
+      for (auto& intern : *table) {
+        buffered_visitor.VisitRoot(intern);
       }
     }
   }
-  if ((flags & kVisitRootFlagClearRootLog) != 0) {
-    new_strong_intern_roots_.clear();
+  Thread* const self = Thread::Current();
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock_);
+    if ((flags & kVisitRootFlagAllRoots) != 0) {
+      shard.strong_interns_.VisitRoots(visitor);
+    } else if ((flags & kVisitRootFlagNewRoots) != 0) {
+      for (auto& root : shard.new_strong_intern_roots_) {
+        mirror::String* old_ref = root.Read<kWithoutReadBarrier>();
+        root.VisitRoot(visitor, RootInfo(kRootInternedString));
+        mirror::String* new_ref = root.Read<kWithoutReadBarrier>();
+        if (new_ref != old_ref) {
+          // The GC moved a root in the log. Need to search the strong interns and update the
+          // corresponding object. This is slow, but luckily for us, this may only happen with a
+          // concurrent moving GC.
+          shard.strong_interns_.Remove(old_ref);
+          shard.strong_interns_.Insert(new_ref);
+        }
+      }
+    }
+    if ((flags & kVisitRootFlagClearRootLog) != 0) {
+      shard.new_strong_intern_roots_.clear();
+    }
+    if ((flags & kVisitRootFlagStartLoggingNewRoots) != 0) {
+      shard.log_new_roots_ = true;
+    } else if ((flags & kVisitRootFlagStopLoggingNewRoots) != 0) {
+      shard.log_new_roots_ = false;
+    }
   }
-  if ((flags & kVisitRootFlagStartLoggingNewRoots) != 0) {
-    log_new_roots_ = true;
-  } else if ((flags & kVisitRootFlagStopLoggingNewRoots) != 0) {
-    log_new_roots_ = false;
+  // Note: we deliberately don't visit the weak_interns_ tables and the immutable image roots.
+}
+
+template <typename Key>
+mirror::String* InternTable::LookupImageTables(const Key& key) {
+  for (UnorderedSet* table : *image_tables_.LoadAcquire()) {
+    auto it = table->Find(key);
+    if (it != table->end()) {
+      return it->Read();
+    }
   }
-  // Note: we deliberately don't visit the weak_interns_ table and the immutable image roots.
+  return nullptr;
 }
 
 mirror::String* InternTable::LookupWeak(Thread* self, mirror::String* s) {
-  MutexLock mu(self, *Locks::intern_table_lock_);
-  return LookupWeakLocked(s);
+  Shard* const shard = &GetShard(s);
+  MutexLock mu(self, shard->lock_);
+  return LookupWeakLocked(shard, s);
 }
 
 mirror::String* InternTable::LookupStrong(Thread* self, mirror::String* s) {
-  MutexLock mu(self, *Locks::intern_table_lock_);
-  return LookupStrongLocked(s);
+  Shard* const shard = &GetShard(s);
+  MutexLock mu(self, shard->lock_);
+  return LookupStrongLocked(shard, s);
 }
 
 mirror::String* InternTable::LookupStrong(Thread* self,
@@ -104,77 +153,98 @@ mirror::String* InternTable::LookupStrong(Thread* self,
   Utf8String string(utf16_length,
                     utf8_data,
                     ComputeUtf16HashFromModifiedUtf8(utf8_data, utf16_length));
-  MutexLock mu(self, *Locks::intern_table_lock_);
-  return strong_interns_.Find(string);
+  mirror::String* image_string = LookupImageTables(string);
+  if (image_string != nullptr) {
+    return image_string;
+  }
+  Shard& shard = GetShard(string.GetHash());
+  MutexLock mu(self, shard.lock_);
+  return shard.strong_interns_.Find(string);
 }
 
-mirror::String* InternTable::LookupWeakLocked(mirror::String* s) {
-  return weak_interns_.Find(s);
+mirror::String* InternTable::LookupWeakLocked(Shard* shard, mirror::String* s) {
+  return shard->weak_interns_.Find(s);
 }
 
-mirror::String* InternTable::LookupStrongLocked(mirror::String* s) {
-  return strong_interns_.Find(s);
+mirror::String* InternTable::LookupStrongLocked(Shard* shard, mirror::String* s) {
+  mirror::String* image_string = LookupImageTables(GcRoot<mirror::String>(s));
+  if (image_string != nullptr) {
+    return image_string;
+  }
+  return shard->strong_interns_.Find(s);
 }
 
 void InternTable::AddNewTable() {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  weak_interns_.AddNewTable();
-  strong_interns_.AddNewTable();
+  Thread* const self = Thread::Current();
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock_);
+    shard.weak_interns_.AddNewTable();
+    shard.strong_interns_.AddNewTable();
+  }
 }
 
-mirror::String* InternTable::InsertStrong(mirror::String* s) {
+mirror::String* InternTable::InsertStrong(Shard* shard, mirror::String* s) {
   Runtime* runtime = Runtime::Current();
   if (runtime->IsActiveTransaction()) {
     runtime->RecordStrongStringInsertion(s);
   }
-  if (log_new_roots_) {
-    new_strong_intern_roots_.push_back(GcRoot<mirror::String>(s));
+  if (shard->log_new_roots_) {
+    shard->new_strong_intern_roots_.push_back(GcRoot<mirror::String>(s));
   }
-  strong_interns_.Insert(s);
+  shard->strong_interns_.Insert(s);
   return s;
 }
 
-mirror::String* InternTable::InsertWeak(mirror::String* s) {
+mirror::String* InternTable::InsertWeak(Shard* shard, mirror::String* s) {
   Runtime* runtime = Runtime::Current();
   if (runtime->IsActiveTransaction()) {
     runtime->RecordWeakStringInsertion(s);
   }
-  weak_interns_.Insert(s);
+  shard->weak_interns_.Insert(s);
   return s;
 }
 
-void InternTable::RemoveStrong(mirror::String* s) {
-  strong_interns_.Remove(s);
+void InternTable::RemoveStrong(Shard* shard, mirror::String* s) {
+  shard->strong_interns_.Remove(s);
 }
 
-void InternTable::RemoveWeak(mirror::String* s) {
+void InternTable::RemoveWeak(Shard* shard, mirror::String* s) {
   Runtime* runtime = Runtime::Current();
   if (runtime->IsActiveTransaction()) {
     runtime->RecordWeakStringRemoval(s);
   }
-  weak_interns_.Remove(s);
+  shard->weak_interns_.Remove(s);
 }
 
 // Insert/remove methods used to undo changes made during an aborted transaction.
 mirror::String* InternTable::InsertStrongFromTransaction(mirror::String* s) {
   DCHECK(!Runtime::Current()->IsActiveTransaction());
-  return InsertStrong(s);
+  Shard* const shard = &GetShard(s);
+  MutexLock mu(Thread::Current(), shard->lock_);
+  return InsertStrong(shard, s);
 }
 mirror::String* InternTable::InsertWeakFromTransaction(mirror::String* s) {
   DCHECK(!Runtime::Current()->IsActiveTransaction());
-  return InsertWeak(s);
+  Shard* const shard = &GetShard(s);
+  MutexLock mu(Thread::Current(), shard->lock_);
+  return InsertWeak(shard, s);
 }
 void InternTable::RemoveStrongFromTransaction(mirror::String* s) {
   DCHECK(!Runtime::Current()->IsActiveTransaction());
-  RemoveStrong(s);
+  Shard* const shard = &GetShard(s);
+  MutexLock mu(Thread::Current(), shard->lock_);
+  RemoveStrong(shard, s);
 }
 void InternTable::RemoveWeakFromTransaction(mirror::String* s) {
   DCHECK(!Runtime::Current()->IsActiveTransaction());
-  RemoveWeak(s);
+  Shard* const shard = &GetShard(s);
+  MutexLock mu(Thread::Current(), shard->lock_);
+  RemoveWeak(shard, s);
 }
 
 void InternTable::AddImagesStringsToTable(const std::vector<gc::space::ImageSpace*>& image_spaces) {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
+  Thread* const self = Thread::Current();
+  MutexLock mu(self, *Locks::intern_table_lock_);
   for (gc::space::ImageSpace* image_space : image_spaces) {
     const ImageHeader* const header = &image_space->GetImageHeader();
     // Check if we have the interned strings section.
@@ -191,9 +261,11 @@ void InternTable::AddImagesStringsToTable(const std::vector<gc::space::ImageSpac
         for (size_t j = 0; j < num_strings; ++j) {
           mirror::String* image_string = dex_cache->GetResolvedString(j);
           if (image_string != nullptr) {
-            mirror::String* found = LookupStrongLocked(image_string);
+            Shard* const shard = &GetShard(image_string);
+            MutexLock mu2(self, shard->lock_);
+            mirror::String* found = LookupStrongLocked(shard, image_string);
             if (found == nullptr) {
-              InsertStrong(image_string);
+              InsertStrong(shard, image_string);
             } else {
               DCHECK_EQ(found, image_string);
             }
@@ -202,11 +274,11 @@ void InternTable::AddImagesStringsToTable(const std::vector<gc::space::ImageSpac
       }
     }
   }
-  images_added_to_intern_table_ = true;
+  images_added_to_intern_table_.StoreRelease(true);
 }
 
 mirror::String* InternTable::LookupStringFromImage(mirror::String* s) {
-  DCHECK(!images_added_to_intern_table_);
+  DCHECK(!images_added_to_intern_table_.LoadRelaxed());
   const std::vector<gc::space::ImageSpace*>& image_spaces =
       Runtime::Current()->GetHeap()->GetBootImageSpaces();
   if (image_spaces.empty()) {
@@ -241,16 +313,16 @@ void InternTable::BroadcastForNewInterns() {
   weak_intern_condition_.Broadcast(self);
 }
 
-void InternTable::WaitUntilAccessible(Thread* self) {
-  Locks::intern_table_lock_->ExclusiveUnlock(self);
+void InternTable::WaitUntilAccessible(Thread* self, Shard* shard) {
+  shard->lock_.ExclusiveUnlock(self);
   {
     ScopedThreadSuspension sts(self, kWaitingWeakGcRootRead);
     MutexLock mu(self, *Locks::intern_table_lock_);
-    while (weak_root_state_ == gc::kWeakRootStateNoReadsOrWrites) {
+    while (weak_root_state_.LoadRelaxed() == gc::kWeakRootStateNoReadsOrWrites) {
       weak_intern_condition_.Wait(self);
     }
   }
-  Locks::intern_table_lock_->ExclusiveLock(self);
+  shard->lock_.ExclusiveLock(self);
 }
 
 mirror::String* InternTable::Insert(mirror::String* s, bool is_strong, bool holding_locks) {
@@ -258,7 +330,9 @@ mirror::String* InternTable::Insert(mirror::String* s, bool is_strong, bool hold
     return nullptr;
   }
   Thread* const self = Thread::Current();
-  MutexLock mu(self, *Locks::intern_table_lock_);
+  // The shard only depends on the hash, so it does not change if s is moved while waiting.
+  Shard* const shard = &GetShard(s);
+  MutexLock mu(self, shard->lock_);
   if (kDebugLocking && !holding_locks) {
     Locks::mutator_lock_->AssertSharedHeld(self);
     CHECK_EQ(2u, self->NumberOfHeldMutexes()) << "may only safely hold the mutator lock";
@@ -266,17 +340,18 @@ mirror::String* InternTable::Insert(mirror::String* s, bool is_strong, bool hold
   while (true) {
     if (holding_locks) {
       if (!kUseReadBarrier) {
-        CHECK_EQ(weak_root_state_, gc::kWeakRootStateNormal);
+        CHECK_EQ(weak_root_state_.LoadAcquire(), gc::kWeakRootStateNormal);
       } else {
         CHECK(self->GetWeakRefAccessEnabled());
       }
     }
     // Check the strong table for a match.
-    mirror::String* strong = LookupStrongLocked(s);
+    mirror::String* strong = LookupStrongLocked(shard, s);
     if (strong != nullptr) {
       return strong;
     }
-    if ((!kUseReadBarrier && weak_root_state_ != gc::kWeakRootStateNoReadsOrWrites) ||
+    if ((!kUseReadBarrier &&
+         weak_root_state_.LoadAcquire() != gc::kWeakRootStateNoReadsOrWrites) ||
         (kUseReadBarrier && self->GetWeakRefAccessEnabled())) {
       break;
     }
@@ -286,32 +361,32 @@ mirror::String* InternTable::Insert(mirror::String* s, bool is_strong, bool hold
     CHECK(!holding_locks);
     StackHandleScope<1> hs(self);
     auto h = hs.NewHandleWrapper(&s);
-    WaitUntilAccessible(self);
+    WaitUntilAccessible(self, shard);
   }
   if (!kUseReadBarrier) {
-    CHECK_EQ(weak_root_state_, gc::kWeakRootStateNormal);
+    CHECK_EQ(weak_root_state_.LoadAcquire(), gc::kWeakRootStateNormal);
   } else {
     CHECK(self->GetWeakRefAccessEnabled());
   }
   // There is no match in the strong table, check the weak table.
-  mirror::String* weak = LookupWeakLocked(s);
+  mirror::String* weak = LookupWeakLocked(shard, s);
   if (weak != nullptr) {
     if (is_strong) {
       // A match was found in the weak table. Promote to the strong table.
-      RemoveWeak(weak);
-      return InsertStrong(weak);
+      RemoveWeak(shard, weak);
+      return InsertStrong(shard, weak);
     }
     return weak;
   }
   // Check the image for a match.
-  if (!images_added_to_intern_table_) {
+  if (!images_added_to_intern_table_.LoadAcquire()) {
     mirror::String* const image_string = LookupStringFromImage(s);
     if (image_string != nullptr) {
-      return is_strong ? InsertStrong(image_string) : InsertWeak(image_string);
+      return is_strong ? InsertStrong(shard, image_string) : InsertWeak(shard, image_string);
     }
   }
   // No match in the strong table or the weak table. Insert into the strong / weak table.
-  return is_strong ? InsertStrong(s) : InsertWeak(s);
+  return is_strong ? InsertStrong(shard, s) : InsertWeak(shard, s);
 }
 
 mirror::String* InternTable::InternStrong(int32_t utf16_length, const char* utf8_data) {
@@ -342,9 +417,37 @@ bool InternTable::ContainsWeak(mirror::String* s) {
   return LookupWeak(Thread::Current(), s) == s;
 }
 
-void InternTable::SweepInternTableWeaks(IsMarkedVisitor* visitor) {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  weak_interns_.SweepWeaks(visitor);
+void InternTable::SweepInternTableWeaks(IsMarkedVisitor* visitor,
+                                        gc::ParallelWeakSweep* parallel) {
+  Thread* const self = Thread::Current();
+  if (parallel == nullptr) {
+    for (Shard& shard : shards_) {
+      MutexLock mu(self, shard.lock_);
+      shard.weak_interns_.SweepWeaks(visitor);
+    }
+    return;
+  }
+  // Each chunk of the parallel sweep is a shard. The helpers only query the visitor and update the
+  // moved strings, which is the bulk of the work. Erasing hashes the strings, which needs the
+  // mutator lock, so this thread erases the dead strings once all the shards are done. Weak interns
+  // cannot be read meanwhile, the system weaks are disallowed while they are swept.
+  std::vector<mirror::String*> dead_strings[kNumShards];
+  gc::ParallelWeakSweep::ChunkVisitor sweep_chunk =
+      [&](size_t begin, size_t end) NO_THREAD_SAFETY_ANALYSIS {
+    for (size_t i = begin; i != end; ++i) {
+      MutexLock mu(Thread::Current(), shards_[i].lock_);
+      shards_[i].weak_interns_.FindDeadWeaks(visitor, &dead_strings[i]);
+    }
+  };
+  parallel->Run(kNumShards, 1, sweep_chunk);
+  for (size_t i = 0; i != kNumShards; ++i) {
+    if (!dead_strings[i].empty()) {
+      MutexLock mu(self, shards_[i].lock_);
+      for (mirror::String* s : dead_strings[i]) {
+        shards_[i].weak_interns_.Remove(s);
+      }
+    }
+  }
 }
 
 size_t InternTable::AddTableFromMemory(const uint8_t* ptr) {
@@ -353,12 +456,51 @@ size_t InternTable::AddTableFromMemory(const uint8_t* ptr) {
 }
 
 size_t InternTable::AddTableFromMemoryLocked(const uint8_t* ptr) {
-  return strong_interns_.AddTableFromMemory(ptr);
+  size_t read_count = 0;
+  std::unique_ptr<UnorderedSet> set(new UnorderedSet(ptr, /*make copy*/false, &read_count));
+  if (set->Empty()) {
+    // Avoid inserting empty sets.
+    return read_count;
+  }
+  // TODO: Disable this for app images if app images have intern tables.
+  static constexpr bool kCheckDuplicates = true;
+  // Do not hash the strings if the table is empty, the image writer and patchoat read tables
+  // whose strings are not mapped at their addresses.
+  if (kCheckDuplicates && StrongSize() != 0) {
+    Thread* const self = Thread::Current();
+    for (GcRoot<mirror::String>& string : *set) {
+      mirror::String* const s = string.Read();
+      Shard* const shard = &GetShard(s);
+      MutexLock mu(self, shard->lock_);
+      CHECK(LookupStrongLocked(shard, s) == nullptr) << "Already found " << s->ToModifiedUtf8();
+    }
+  }
+  // Publish a new list of image tables, lookups may still be reading the current one. Insert at
+  // the front, like the tables of the images added before.
+  ImageTables* const tables = new ImageTables(*image_tables_.LoadRelaxed());
+  tables->insert(tables->begin(), set.get());
+  owned_image_tables_.push_back(std::move(set));
+  owned_image_table_lists_.emplace_back(tables);
+  image_tables_.StoreRelease(tables);
+  return read_count;
 }
 
 size_t InternTable::WriteToMemory(uint8_t* ptr) {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
-  return strong_interns_.WriteToMemory(ptr);
+  Runtime* const runtime = Runtime::Current();
+  UnorderedSet combined;
+  combined.SetLoadFactor(runtime->GetHashTableMinLoadFactor(),
+                         runtime->GetHashTableMaxLoadFactor());
+  for (UnorderedSet* table : *image_tables_.LoadAcquire()) {
+    for (GcRoot<mirror::String>& string : *table) {
+      combined.Insert(string);
+    }
+  }
+  Thread* const self = Thread::Current();
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock_);
+    shard.strong_interns_.CopyTo(&combined);
+  }
+  return combined.WriteToMemory(ptr);
 }
 
 std::size_t InternTable::StringHashEquals::operator()(const GcRoot<mirror::String>& root) const {
@@ -390,44 +532,6 @@ bool InternTable::StringHashEquals::operator()(const GcRoot<mirror::String>& a,
   return CompareModifiedUtf8ToUtf16AsCodePointValues(b.GetUtf8Data(), a_value, a_length) == 0;
 }
 
-size_t InternTable::Table::AddTableFromMemory(const uint8_t* ptr) {
-  size_t read_count = 0;
-  UnorderedSet set(ptr, /*make copy*/false, &read_count);
-  if (set.Empty()) {
-    // Avoid inserting empty sets.
-    return read_count;
-  }
-  // TODO: Disable this for app images if app images have intern tables.
-  static constexpr bool kCheckDuplicates = true;
-  if (kCheckDuplicates) {
-    for (GcRoot<mirror::String>& string : set) {
-      CHECK(Find(string.Read()) == nullptr) << "Already found " << string.Read()->ToModifiedUtf8();
-    }
-  }
-  // Insert at the front since we add new interns into the back.
-  tables_.insert(tables_.begin(), std::move(set));
-  return read_count;
-}
-
-size_t InternTable::Table::WriteToMemory(uint8_t* ptr) {
-  if (tables_.empty()) {
-    return 0;
-  }
-  UnorderedSet* table_to_write;
-  UnorderedSet combined;
-  if (tables_.size() > 1) {
-    table_to_write = &combined;
-    for (UnorderedSet& table : tables_) {
-      for (GcRoot<mirror::String>& string : table) {
-        combined.Insert(string);
-      }
-    }
-  } else {
-    table_to_write = &tables_.back();
-  }
-  return table_to_write->WriteToMemory(ptr);
-}
-
 void InternTable::Table::Remove(mirror::String* s) {
   for (UnorderedSet& table : tables_) {
     auto it = table.Find(GcRoot<mirror::String>(s));
@@ -440,7 +544,6 @@ void InternTable::Table::Remove(mirror::String* s) {
 }
 
 mirror::String* InternTable::Table::Find(mirror::String* s) {
-  Locks::intern_table_lock_->AssertHeld(Thread::Current());
   for (UnorderedSet& table : tables_) {
     auto it = table.Find(GcRoot<mirror::String>(s));
     if (it != table.end()) {
@@ -451,7 +554,6 @@ mirror::String* InternTable::Table::Find(mirror::String* s) {
 }
 
 mirror::String* InternTable::Table::Find(const Utf8String& string) {
-  Locks::intern_table_lock_->AssertHeld(Thread::Current());
   for (UnorderedSet& table : tables_) {
     auto it = table.Find(string);
     if (it != table.end()) {
@@ -466,12 +568,20 @@ void InternTable::Table::AddNewTable() {
 }
 
 void InternTable::Table::Insert(mirror::String* s) {
-  // Always insert the last table, the image tables are before and we avoid inserting into these
+  // Always insert the last table, the zygote tables are before and we avoid inserting into these
   // to prevent dirty pages.
   DCHECK(!tables_.empty());
   tables_.back().Insert(GcRoot<mirror::String>(s));
 }
 
+void InternTable::Table::CopyTo(UnorderedSet* set) {
+  for (UnorderedSet& table : tables_) {
+    for (GcRoot<mirror::String>& string : table) {
+      set->Insert(string);
+    }
+  }
+}
+
 void InternTable::Table::VisitRoots(RootVisitor* visitor) {
   BufferedRootVisitor<kDefaultBufferedRootCount> buffered_visitor(
       visitor, RootInfo(kRootInternedString));
@@ -502,6 +612,22 @@ void InternTable::Table::SweepWeaks(UnorderedSet* set, IsMarkedVisitor* visitor)
   }
 }
 
+void InternTable::Table::FindDeadWeaks(IsMarkedVisitor* visitor,
+                                       std::vector<mirror::String*>* dead_strings) {
+  for (UnorderedSet& table : tables_) {
+    for (GcRoot<mirror::String>& root : table) {
+      // This does not need a read barrier because this is called by GC.
+      mirror::String* const object = root.Read<kWithoutReadBarrier>();
+      mirror::Object* const new_object = visitor->IsMarked(object);
+      if (new_object == nullptr) {
+        dead_strings->push_back(object);
+      } else {
+        root = GcRoot<mirror::String>(down_cast<mirror::String*>(new_object));
+      }
+    }
+  }
+}
+
 size_t InternTable::Table::Size() const {
   return std::accumulate(tables_.begin(),
                          tables_.end(),
@@ -518,7 +644,7 @@ void InternTable::ChangeWeakRootState(gc::WeakRootState new_state) {
 
 void InternTable::ChangeWeakRootStateLocked(gc::WeakRootState new_state) {
   CHECK(!kUseReadBarrier);
-  weak_root_state_ = new_state;
+  weak_root_state_.StoreRelease(new_state);
   if (new_state != gc::kWeakRootStateNoReadsOrWrites) {
     weak_intern_condition_.Broadcast(Thread::Current());
   }
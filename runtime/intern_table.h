@@ -17,7 +17,9 @@
 #ifndef ART_RUNTIME_INTERN_TABLE_H_
 #define ART_RUNTIME_INTERN_TABLE_H_
 
+#include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "atomic.h"
 #include "base/allocator.h"
@@ -30,6 +32,7 @@
 namespace art {
 
 namespace gc {
+class ParallelWeakSweep;
 namespace space {
 class ImageSpace;
 }  // namespace space
@@ -51,6 +54,10 @@ class Transaction;
  * String.intern. Some code (XML parsers being a prime example) relies on being able to intern
  * arbitrarily many strings for the duration of a parse without permanently increasing the memory
  * footprint.
+ *
+ * Both tables are split into shards by string hash, each shard with its own lock, so that threads
+ * interning different strings rarely contend. The strong interns read from images are kept apart
+ * from the shards and searched without locking.
  */
 class InternTable {
  public:
@@ -78,38 +85,36 @@ class InternTable {
   mirror::String* InternWeak(mirror::String* s) SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!Roles::uninterruptible_);
 
-  void SweepInternTableWeaks(IsMarkedVisitor* visitor) SHARED_REQUIRES(Locks::mutator_lock_)
-      REQUIRES(!Locks::intern_table_lock_);
+  // Sweeps the weak interns. If parallel is not null, the parallel sweep helpers find the dead
+  // strings of the shards and update the moved ones, the calling thread then erases the dead ones.
+  void SweepInternTableWeaks(IsMarkedVisitor* visitor, gc::ParallelWeakSweep* parallel = nullptr)
+      SHARED_REQUIRES(Locks::mutator_lock_);
 
-  bool ContainsWeak(mirror::String* s) SHARED_REQUIRES(Locks::mutator_lock_)
-      REQUIRES(!Locks::intern_table_lock_);
+  bool ContainsWeak(mirror::String* s) SHARED_REQUIRES(Locks::mutator_lock_);
 
   // Lookup a strong intern, returns null if not found.
   mirror::String* LookupStrong(Thread* self, mirror::String* s)
-      REQUIRES(!Locks::intern_table_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
   mirror::String* LookupStrong(Thread* self, uint32_t utf16_length, const char* utf8_data)
-      REQUIRES(!Locks::intern_table_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   // Lookup a weak intern, returns null if not found.
   mirror::String* LookupWeak(Thread* self, mirror::String* s)
-      REQUIRES(!Locks::intern_table_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   // Total number of interned strings.
-  size_t Size() const REQUIRES(!Locks::intern_table_lock_);
+  size_t Size() const;
 
   // Total number of weakly live interned strings.
-  size_t StrongSize() const REQUIRES(!Locks::intern_table_lock_);
+  size_t StrongSize() const;
 
   // Total number of strongly live interned strings.
-  size_t WeakSize() const REQUIRES(!Locks::intern_table_lock_);
+  size_t WeakSize() const;
 
   void VisitRoots(RootVisitor* visitor, VisitRootFlags flags)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!Locks::intern_table_lock_);
+      SHARED_REQUIRES(Locks::mutator_lock_);
 
-  void DumpForSigQuit(std::ostream& os) const REQUIRES(!Locks::intern_table_lock_);
+  void DumpForSigQuit(std::ostream& os) const;
 
   void BroadcastForNewInterns() SHARED_REQUIRES(Locks::mutator_lock_);
 
@@ -121,8 +126,7 @@ class InternTable {
 
   // Add a new intern table for inserting to, previous intern tables are still there but no
   // longer inserted into and ideally unmodified. This is done to prevent dirty pages.
-  void AddNewTable()
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!Locks::intern_table_lock_);
+  void AddNewTable() SHARED_REQUIRES(Locks::mutator_lock_);
 
   // Read the intern table from memory. The elements aren't copied, the intern hash set data will
   // point to somewhere within ptr. Only reads the strong interns.
@@ -130,9 +134,9 @@ class InternTable {
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   // Write the post zygote intern table to a pointer. Only writes the strong interns since it is
-  // expected that there is no weak interns since this is called from the image writer.
-  size_t WriteToMemory(uint8_t* ptr) SHARED_REQUIRES(Locks::mutator_lock_)
-      REQUIRES(!Locks::intern_table_lock_);
+  // expected that there is no weak interns since this is called from the image writer. The
+  // strong interns of all the shards are combined into a single table.
+  size_t WriteToMemory(uint8_t* ptr) SHARED_REQUIRES(Locks::mutator_lock_);
 
   // Change the weak root state. May broadcast to waiters.
   void ChangeWeakRootState(gc::WeakRootState new_state)
@@ -176,78 +180,110 @@ class InternTable {
     }
   };
 
+  typedef HashSet<GcRoot<mirror::String>, GcRootEmptyFn, StringHashEquals, StringHashEquals,
+      TrackingAllocator<GcRoot<mirror::String>, kAllocatorTagInternTable>> UnorderedSet;
+
   // Table which holds pre zygote and post zygote interned strings. There is one instance for
-  // weak interns and strong interns.
+  // weak interns and strong interns in each shard. Guarded by the lock of the shard.
   class Table {
    public:
     Table();
-    mirror::String* Find(mirror::String* s) SHARED_REQUIRES(Locks::mutator_lock_)
-        REQUIRES(Locks::intern_table_lock_);
-    mirror::String* Find(const Utf8String& string) SHARED_REQUIRES(Locks::mutator_lock_)
-        REQUIRES(Locks::intern_table_lock_);
-    void Insert(mirror::String* s) SHARED_REQUIRES(Locks::mutator_lock_)
-        REQUIRES(Locks::intern_table_lock_);
-    void Remove(mirror::String* s)
-        SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
-    void VisitRoots(RootVisitor* visitor)
-        SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
-    void SweepWeaks(IsMarkedVisitor* visitor)
-        SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
+    mirror::String* Find(mirror::String* s) SHARED_REQUIRES(Locks::mutator_lock_);
+    mirror::String* Find(const Utf8String& string) SHARED_REQUIRES(Locks::mutator_lock_);
+    void Insert(mirror::String* s) SHARED_REQUIRES(Locks::mutator_lock_);
+    void Remove(mirror::String* s) SHARED_REQUIRES(Locks::mutator_lock_);
+    void VisitRoots(RootVisitor* visitor) SHARED_REQUIRES(Locks::mutator_lock_);
+    void SweepWeaks(IsMarkedVisitor* visitor) SHARED_REQUIRES(Locks::mutator_lock_);
+    // Updates the moved strings in place and appends the dead ones to dead_strings without erasing
+    // them, erasing rehashes the following strings. Does not hash, so may be called by heap thread
+    // pool workers which do not hold the mutator lock themselves.
+    void FindDeadWeaks(IsMarkedVisitor* visitor, std::vector<mirror::String*>* dead_strings);
     // Add a new intern table that will only be inserted into from now on.
-    void AddNewTable() REQUIRES(Locks::intern_table_lock_);
-    size_t Size() const REQUIRES(Locks::intern_table_lock_);
-    // Read and add an intern table from ptr.
-    // Tables read are inserted at the front of the table array. Only checks for conflicts in
-    // debug builds. Returns how many bytes were read.
-    size_t AddTableFromMemory(const uint8_t* ptr)
-        REQUIRES(Locks::intern_table_lock_) SHARED_REQUIRES(Locks::mutator_lock_);
-    // Write the intern tables to ptr, if there are multiple tables they are combined into a single
-    // one. Returns how many bytes were written.
-    size_t WriteToMemory(uint8_t* ptr)
-        REQUIRES(Locks::intern_table_lock_) SHARED_REQUIRES(Locks::mutator_lock_);
+    void AddNewTable();
+    size_t Size() const;
+    // Insert all the strings into `set`.
+    void CopyTo(UnorderedSet* set) SHARED_REQUIRES(Locks::mutator_lock_);
 
    private:
-    typedef HashSet<GcRoot<mirror::String>, GcRootEmptyFn, StringHashEquals, StringHashEquals,
-        TrackingAllocator<GcRoot<mirror::String>, kAllocatorTagInternTable>> UnorderedSet;
-
     void SweepWeaks(UnorderedSet* set, IsMarkedVisitor* visitor)
-        SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
+        SHARED_REQUIRES(Locks::mutator_lock_);
 
     // We call AddNewTable when we create the zygote to reduce private dirty pages caused by
     // modifying the zygote intern table. The back of table is modified when strings are interned.
     std::vector<UnorderedSet> tables_;
   };
 
+  // The interns whose hash selects the shard, and the lock guarding them. Interning only locks
+  // the shard of the string, so threads interning different strings rarely contend.
+  class Shard {
+   public:
+    Shard();
+
+    mutable Mutex lock_;
+    // Since this contains (strong) roots, they need a read barrier to
+    // enable concurrent intern table (strong) root scan. Do not
+    // directly access the strings in it. Use functions that contain
+    // read barriers.
+    Table strong_interns_ GUARDED_BY(lock_);
+    std::vector<GcRoot<mirror::String>> new_strong_intern_roots_ GUARDED_BY(lock_);
+    bool log_new_roots_ GUARDED_BY(lock_);
+    // Since this contains (weak) roots, they need a read barrier. Do
+    // not directly access the strings in it. Use functions that contain
+    // read barriers.
+    Table weak_interns_ GUARDED_BY(lock_);
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(Shard);
+  };
+
+  // Strong intern tables read from images, searched before the shards. They point into the
+  // images, so they are shared by all the shards rather than split.
+  typedef std::vector<UnorderedSet*> ImageTables;
+
+  static constexpr size_t kNumShards = 16;
+
+  Shard& GetShard(int32_t hash) {
+    // Mix in the high bits, the hash of short strings only has a few low bits set.
+    const uint32_t bits = static_cast<uint32_t>(hash);
+    return shards_[(bits ^ (bits >> 16)) % kNumShards];
+  }
+
+  Shard& GetShard(mirror::String* s) SHARED_REQUIRES(Locks::mutator_lock_);
+
   // Insert if non null, otherwise return null. Must be called holding the mutator lock.
   // If holding_locks is true, then we may also hold other locks. If holding_locks is true, then we
   // require GC is not running since it is not safe to wait while holding locks.
   mirror::String* Insert(mirror::String* s, bool is_strong, bool holding_locks)
-      REQUIRES(!Locks::intern_table_lock_) SHARED_REQUIRES(Locks::mutator_lock_);
-
-  mirror::String* LookupStrongLocked(mirror::String* s)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
-  mirror::String* LookupWeakLocked(mirror::String* s)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
-  mirror::String* InsertStrong(mirror::String* s)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
-  mirror::String* InsertWeak(mirror::String* s)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
-  void RemoveStrong(mirror::String* s)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
-  void RemoveWeak(mirror::String* s)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Finds a string in the image tables, which does not need any lock.
+  template <typename Key>
+  mirror::String* LookupImageTables(const Key& key) SHARED_REQUIRES(Locks::mutator_lock_);
+
+  mirror::String* LookupStrongLocked(Shard* shard, mirror::String* s)
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(shard->lock_);
+  mirror::String* LookupWeakLocked(Shard* shard, mirror::String* s)
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(shard->lock_);
+  mirror::String* InsertStrong(Shard* shard, mirror::String* s)
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(shard->lock_);
+  mirror::String* InsertWeak(Shard* shard, mirror::String* s)
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(shard->lock_);
+  void RemoveStrong(Shard* shard, mirror::String* s)
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(shard->lock_);
+  void RemoveWeak(Shard* shard, mirror::String* s)
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(shard->lock_);
 
   // Transaction rollback access.
   mirror::String* LookupStringFromImage(mirror::String* s)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
+      SHARED_REQUIRES(Locks::mutator_lock_);
   mirror::String* InsertStrongFromTransaction(mirror::String* s)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
+      SHARED_REQUIRES(Locks::mutator_lock_);
   mirror::String* InsertWeakFromTransaction(mirror::String* s)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
+      SHARED_REQUIRES(Locks::mutator_lock_);
   void RemoveStrongFromTransaction(mirror::String* s)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
+      SHARED_REQUIRES(Locks::mutator_lock_);
   void RemoveWeakFromTransaction(mirror::String* s)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::intern_table_lock_);
+      SHARED_REQUIRES(Locks::mutator_lock_);
 
   size_t AddTableFromMemoryLocked(const uint8_t* ptr)
       REQUIRES(Locks::intern_table_lock_) SHARED_REQUIRES(Locks::mutator_lock_);
@@ -256,26 +292,25 @@ class InternTable {
   void ChangeWeakRootStateLocked(gc::WeakRootState new_state)
       REQUIRES(Locks::intern_table_lock_);
 
-  // Wait until we can read weak roots.
-  void WaitUntilAccessible(Thread* self)
-      REQUIRES(Locks::intern_table_lock_) SHARED_REQUIRES(Locks::mutator_lock_);
+  // Wait until we can read weak roots. Releases the lock of the shard while waiting.
+  void WaitUntilAccessible(Thread* self, Shard* shard)
+      REQUIRES(shard->lock_) SHARED_REQUIRES(Locks::mutator_lock_);
 
-  bool images_added_to_intern_table_ GUARDED_BY(Locks::intern_table_lock_);
-  bool log_new_roots_ GUARDED_BY(Locks::intern_table_lock_);
+  Shard shards_[kNumShards];
+  // Written once the images are added, read without locking when interning.
+  Atomic<bool> images_added_to_intern_table_;
   ConditionVariable weak_intern_condition_ GUARDED_BY(Locks::intern_table_lock_);
-  // Since this contains (strong) roots, they need a read barrier to
-  // enable concurrent intern table (strong) root scan. Do not
-  // directly access the strings in it. Use functions that contain
-  // read barriers.
-  Table strong_interns_ GUARDED_BY(Locks::intern_table_lock_);
-  std::vector<GcRoot<mirror::String>> new_strong_intern_roots_
+  // The image tables currently searched, published as a whole when an image is added. The
+  // replaced lists are kept since lookups may still be reading them. The tables themselves are
+  // never modified.
+  Atomic<const ImageTables*> image_tables_;
+  std::vector<std::unique_ptr<UnorderedSet>> owned_image_tables_
+      GUARDED_BY(Locks::intern_table_lock_);
+  std::vector<std::unique_ptr<const ImageTables>> owned_image_table_lists_
       GUARDED_BY(Locks::intern_table_lock_);
-  // Since this contains (weak) roots, they need a read barrier. Do
-  // not directly access the strings in it. Use functions that contain
-  // read barriers.
-  Table weak_interns_ GUARDED_BY(Locks::intern_table_lock_);
-  // Weak root state, used for concurrent system weak processing and more.
-  gc::WeakRootState weak_root_state_ GUARDED_BY(Locks::intern_table_lock_);
+  // Weak root state, used for concurrent system weak processing and more. Written with
+  // Locks::intern_table_lock_ held, read without it when interning.
+  Atomic<gc::WeakRootState> weak_root_state_;
 
   friend class Transaction;
   DISALLOW_COPY_AND_ASSIGN(InternTable);
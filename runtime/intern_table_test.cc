@@ -16,11 +16,15 @@
 
 #include "intern_table.h"
 
+#include "base/stringprintf.h"
 #include "common_runtime_test.h"
+#include "gc/parallel_weak_sweep.h"
 #include "mirror/object.h"
 #include "handle_scope-inl.h"
+#include "mirror/object_array-inl.h"
 #include "mirror/string.h"
 #include "scoped_thread_state_change.h"
+#include "thread_pool.h"
 
 namespace art {
 
@@ -122,6 +126,111 @@ TEST_F(InternTableTest, SweepInternTableWeaks) {
   EXPECT_EQ(3U, t.Size());
 }
 
+// Called concurrently by the parallel sweep, only keeps the strings of even length.
+class EvenLengthPredicate : public IsMarkedVisitor {
+ public:
+  mirror::Object* IsMarked(mirror::Object* s) OVERRIDE SHARED_REQUIRES(Locks::mutator_lock_) {
+    return s->AsString()->GetLength() % 2 == 0 ? s : nullptr;
+  }
+};
+
+TEST_F(InternTableTest, ParallelSweepInternTableWeaks) {
+  // Enough strings for the weak interns to span several chunks of the parallel sweep.
+  static constexpr size_t kNumStrings = 20000;
+  ThreadPool thread_pool("Intern table sweep test thread pool", 3);
+  ScopedObjectAccess soa(Thread::Current());
+  InternTable t;
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::ObjectArray<mirror::String>> strings(hs.NewHandle(
+      mirror::ObjectArray<mirror::String>::Alloc(
+          soa.Self(),
+          class_linker_->GetClassRoot(ClassLinker::kJavaLangStringArrayClass),
+          kNumStrings)));
+  ASSERT_TRUE(strings.Get() != nullptr);
+  size_t expected_size = 0;
+  for (size_t i = 0; i < kNumStrings; ++i) {
+    const std::string s = StringPrintf("%zu", i);
+    mirror::String* str = mirror::String::AllocFromModifiedUtf8(soa.Self(), s.c_str());
+    ASSERT_TRUE(str != nullptr);
+    strings->Set<false>(i, t.InternWeak(str));
+    if (s.length() % 2 == 0) {
+      ++expected_size;
+    }
+  }
+  EXPECT_EQ(kNumStrings, t.Size());
+
+  gc::ParallelWeakSweep parallel;
+  for (size_t i = 0; i < thread_pool.GetThreadCount(); ++i) {
+    thread_pool.AddTask(soa.Self(), new ParallelForHelperTask(&parallel));
+  }
+  thread_pool.StartWorkers(soa.Self());
+  EvenLengthPredicate p;
+  {
+    ReaderMutexLock mu(soa.Self(), *Locks::heap_bitmap_lock_);
+    t.SweepInternTableWeaks(&p, &parallel);
+  }
+  thread_pool.Wait(soa.Self(), false, false);
+
+  EXPECT_EQ(expected_size, t.Size());
+  for (size_t i = 0; i < kNumStrings; ++i) {
+    EXPECT_EQ(strings->Get(i)->GetLength() % 2 == 0, t.ContainsWeak(strings->Get(i)));
+  }
+}
+
+class InternTask : public Task {
+ public:
+  InternTask(InternTable* intern_table, size_t num_strings, bool is_strong)
+      : intern_table_(intern_table), num_strings_(num_strings), is_strong_(is_strong) {}
+
+  void Run(Thread* self) OVERRIDE {
+    ScopedObjectAccess soa(self);
+    for (size_t i = 0; i < num_strings_; ++i) {
+      const std::string s = StringPrintf("ConcurrentIntern%zu", i);
+      mirror::String* str = mirror::String::AllocFromModifiedUtf8(self, s.c_str());
+      ASSERT_TRUE(str != nullptr);
+      mirror::String* interned =
+          is_strong_ ? intern_table_->InternStrong(str) : intern_table_->InternWeak(str);
+      ASSERT_TRUE(interned != nullptr);
+      EXPECT_TRUE(interned->Equals(str));
+    }
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  InternTable* const intern_table_;
+  const size_t num_strings_;
+  const bool is_strong_;
+};
+
+TEST_F(InternTableTest, ConcurrentIntern) {
+  static constexpr size_t kNumStrings = 5000;
+  static constexpr size_t kNumThreads = 4;
+  Thread* const self = Thread::Current();
+  // Use the runtime intern table, the strong interns of other tables are not GC roots.
+  InternTable* const t = runtime_->GetInternTable();
+  const size_t strong_size = t->StrongSize();
+  const size_t weak_size = t->WeakSize();
+  ThreadPool thread_pool("Intern table test thread pool", kNumThreads);
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    // Half of the threads promote the weak interns of the others.
+    thread_pool.AddTask(self, new InternTask(t, kNumStrings, i % 2 == 0));
+  }
+  thread_pool.StartWorkers(self);
+  thread_pool.Wait(self, false, false);
+
+  // Each string is interned exactly once, and strongly since some threads interned it so.
+  EXPECT_EQ(strong_size + kNumStrings, t->StrongSize());
+  EXPECT_EQ(weak_size, t->WeakSize());
+  ScopedObjectAccess soa(self);
+  for (size_t i = 0; i < kNumStrings; ++i) {
+    const std::string s = StringPrintf("ConcurrentIntern%zu", i);
+    EXPECT_TRUE(t->LookupStrong(self, s.length(), s.c_str()) != nullptr) << s;
+  }
+}
+
 TEST_F(InternTableTest, ContainsWeak) {
   ScopedObjectAccess soa(Thread::Current());
   {
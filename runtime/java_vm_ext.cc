@@ -18,6 +18,8 @@
 
 #include <dlfcn.h>
 
+#include <algorithm>
+
 #include "art_method.h"
 #include "base/dumpable.h"
 #include "base/mutex.h"
@@ -26,7 +28,9 @@
 #include "check_jni.h"
 #include "dex_file-inl.h"
 #include "fault_handler.h"
+#include "gc/parallel_weak_sweep.h"
 #include "indirect_reference_table-inl.h"
+#include "jni_env_ext.h"
 #include "mirror/class-inl.h"
 #include "mirror/class_loader.h"
 #include "nativebridge/native_bridge.h"
@@ -42,10 +46,10 @@
 
 namespace art {
 
-static size_t gGlobalsInitial = 512;  // Arbitrary.
+// The global tables are created with their maximum size since their entries are accessed without
+// a lock, see AddGlobalRef. Only the pages in use are committed.
 static size_t gGlobalsMax = 51200;  // Arbitrary sanity check. (Must fit in 16 bits.)
 
-static const size_t kWeakGlobalsInitial = 16;  // Arbitrary.
 static const size_t kWeakGlobalsMax = 51200;  // Arbitrary sanity check. (Must fit in 16 bits.)
 
 static bool IsBadJniVersion(int version) {
@@ -430,11 +434,11 @@ JavaVMExt::JavaVMExt(Runtime* runtime, const RuntimeArgumentMap& runtime_options
                        || VLOG_IS_ON(third_party_jni)),
       trace_(runtime_options.GetOrDefault(RuntimeArgumentMap::JniTrace)),
       globals_lock_("JNI global reference table lock"),
-      globals_(gGlobalsInitial, gGlobalsMax, kGlobal),
+      globals_(gGlobalsMax, gGlobalsMax, kGlobal),
       libraries_(new Libraries),
       unchecked_functions_(&gJniInvokeInterface),
       weak_globals_lock_("JNI weak global reference table lock", kJniWeakGlobalsLock),
-      weak_globals_(kWeakGlobalsInitial, kWeakGlobalsMax, kWeakGlobal),
+      weak_globals_(kWeakGlobalsMax, kWeakGlobalsMax, kWeakGlobal),
       allow_accessing_weak_globals_(true),
       weak_globals_add_condition_("weak globals add condition", weak_globals_lock_) {
   functions = unchecked_functions_;
@@ -518,13 +522,52 @@ bool JavaVMExt::ShouldTrace(ArtMethod* method) {
   return true;
 }
 
+// Number of free slots moved at once between a global table and the slot cache of a thread.
+static constexpr size_t kGlobalRefSlotBatch = IrtSlotCache::kCapacity / 2;
+
+// Refills an empty slot cache from the free slots of a global table, growing the table if there
+// are none. Slots cached by other threads are not reclaimed, so the table may overflow a little
+// before all of its entries are in use. Requires the lock of the table.
+static void RefillSlotCache(IndirectReferenceTable* table,
+                            std::vector<uint32_t>* free_slots,
+                            IrtSlotCache* cache) SHARED_REQUIRES(Locks::mutator_lock_) {
+  DCHECK(cache->IsEmpty());
+  if (free_slots->empty()) {
+    uint32_t slots[kGlobalRefSlotBatch];
+    size_t num_slots = table->GrowSlots(kGlobalRefSlotBatch, slots);
+    // Push in reverse order so that the lowest slots are used first.
+    while (num_slots != 0) {
+      cache->Push(slots[--num_slots]);
+    }
+  } else {
+    const size_t num_slots = std::min(kGlobalRefSlotBatch, free_slots->size());
+    for (size_t i = 0; i != num_slots; ++i) {
+      cache->Push(free_slots->back());
+      free_slots->pop_back();
+    }
+  }
+}
+
+// Moves `count` slots from a slot cache to the free slots of a global table. Requires the lock of
+// the table.
+static void SpillSlotCache(IrtSlotCache* cache, std::vector<uint32_t>* free_slots, size_t count) {
+  for (; count != 0; --count) {
+    free_slots->push_back(cache->Pop());
+  }
+}
+
 jobject JavaVMExt::AddGlobalRef(Thread* self, mirror::Object* obj) {
   // Check for null after decoding the object to handle cleared weak globals.
   if (obj == nullptr) {
     return nullptr;
   }
-  WriterMutexLock mu(self, globals_lock_);
-  IndirectRef ref = globals_.Add(IRT_FIRST_SEGMENT, obj);
+  // The lock is only needed to refill the slots cached by self, see IndirectReferenceTable::AddAt.
+  IrtSlotCache* const cache = &self->GetJniEnv()->global_ref_slots;
+  if (UNLIKELY(cache->IsEmpty())) {
+    WriterMutexLock mu(self, globals_lock_);
+    RefillSlotCache(&globals_, &free_global_slots_, cache);
+  }
+  IndirectRef ref = globals_.AddAt(cache->Pop(), obj);
   return reinterpret_cast<jobject>(ref);
 }
 
@@ -532,11 +575,20 @@ jweak JavaVMExt::AddWeakGlobalRef(Thread* self, mirror::Object* obj) {
   if (obj == nullptr) {
     return nullptr;
   }
+  IrtSlotCache* const cache = &self->GetJniEnv()->weak_global_ref_slots;
+  // Weak globals may not be added while the GC sweeps them. This cannot start until self is
+  // suspended or has run a checkpoint, so it is enough to check that it has not started.
+  if (LIKELY(MayAccessWeakGlobalsUnlocked(self) && !cache->IsEmpty())) {
+    return reinterpret_cast<jweak>(weak_globals_.AddAt(cache->Pop(), obj));
+  }
   MutexLock mu(self, weak_globals_lock_);
   while (UNLIKELY(!MayAccessWeakGlobals(self))) {
     weak_globals_add_condition_.WaitHoldingLocks(self);
   }
-  IndirectRef ref = weak_globals_.Add(IRT_FIRST_SEGMENT, obj);
+  if (cache->IsEmpty()) {
+    RefillSlotCache(&weak_globals_, &free_weak_global_slots_, cache);
+  }
+  IndirectRef ref = weak_globals_.AddAt(cache->Pop(), obj);
   return reinterpret_cast<jweak>(ref);
 }
 
@@ -544,21 +596,60 @@ void JavaVMExt::DeleteGlobalRef(Thread* self, jobject obj) {
   if (obj == nullptr) {
     return;
   }
-  WriterMutexLock mu(self, globals_lock_);
-  if (!globals_.Remove(IRT_FIRST_SEGMENT, obj)) {
+  // Removing without the lock is only safe against the GC visiting the roots while runnable.
+  ScopedObjectAccess soa(self);
+  uint32_t index;
+  if (!globals_.RemoveSlot(reinterpret_cast<IndirectRef>(obj), &index)) {
     LOG(WARNING) << "JNI WARNING: DeleteGlobalRef(" << obj << ") "
                  << "failed to find entry";
+    return;
   }
+  IrtSlotCache* const cache = &self->GetJniEnv()->global_ref_slots;
+  if (UNLIKELY(cache->IsFull())) {
+    WriterMutexLock mu(self, globals_lock_);
+    SpillSlotCache(cache, &free_global_slots_, kGlobalRefSlotBatch);
+  }
+  cache->Push(index);
 }
 
 void JavaVMExt::DeleteWeakGlobalRef(Thread* self, jweak obj) {
   if (obj == nullptr) {
     return;
   }
-  MutexLock mu(self, weak_globals_lock_);
-  if (!weak_globals_.Remove(IRT_FIRST_SEGMENT, obj)) {
+  ScopedObjectAccess soa(self);
+  uint32_t index;
+  bool removed;
+  if (LIKELY(MayAccessWeakGlobalsUnlocked(self))) {
+    removed = weak_globals_.RemoveSlot(reinterpret_cast<IndirectRef>(obj), &index);
+  } else {
+    // The GC may be sweeping the table, which it does holding the lock.
+    MutexLock mu(self, weak_globals_lock_);
+    removed = weak_globals_.RemoveSlot(reinterpret_cast<IndirectRef>(obj), &index);
+  }
+  if (!removed) {
     LOG(WARNING) << "JNI WARNING: DeleteWeakGlobalRef(" << obj << ") "
                  << "failed to find entry";
+    return;
+  }
+  IrtSlotCache* const cache = &self->GetJniEnv()->weak_global_ref_slots;
+  if (UNLIKELY(cache->IsFull())) {
+    MutexLock mu(self, weak_globals_lock_);
+    SpillSlotCache(cache, &free_weak_global_slots_, kGlobalRefSlotBatch);
+  }
+  cache->Push(index);
+}
+
+void JavaVMExt::ReleaseGlobalRefSlots(Thread* self) {
+  JNIEnvExt* const env = self->GetJniEnv();
+  {
+    WriterMutexLock mu(self, globals_lock_);
+    SpillSlotCache(&env->global_ref_slots, &free_global_slots_, env->global_ref_slots.Size());
+  }
+  {
+    MutexLock mu(self, weak_globals_lock_);
+    SpillSlotCache(&env->weak_global_ref_slots,
+                   &free_weak_global_slots_,
+                   env->weak_global_ref_slots.Size());
   }
 }
 
@@ -905,20 +996,32 @@ void* JavaVMExt::FindCodeForNativeMethod(ArtMethod* m) {
   return native_method;
 }
 
-void JavaVMExt::SweepJniWeakGlobals(IsMarkedVisitor* visitor) {
+void JavaVMExt::SweepJniWeakGlobals(IsMarkedVisitor* visitor, gc::ParallelWeakSweep* parallel) {
+  static constexpr size_t kEntriesPerChunk = 4096;
   MutexLock mu(Thread::Current(), weak_globals_lock_);
-  Runtime* const runtime = Runtime::Current();
-  for (auto* entry : weak_globals_) {
-    // Need to skip null here to distinguish between null entries and cleared weak ref entries.
-    if (!entry->IsNull()) {
-      // Since this is called by the GC, we don't need a read barrier.
-      mirror::Object* obj = entry->Read<kWithoutReadBarrier>();
-      mirror::Object* new_obj = visitor->IsMarked(obj);
-      if (new_obj == nullptr) {
-        new_obj = runtime->GetClearedJniWeakGlobal();
+  mirror::Object* const cleared = Runtime::Current()->GetClearedJniWeakGlobal();
+  // Entries are swept in place, so chunks of the table can be swept concurrently.
+  auto sweep_entries = [&](size_t begin, size_t end) NO_THREAD_SAFETY_ANALYSIS {
+    for (auto it = weak_globals_.IteratorAt(begin), it_end = weak_globals_.IteratorAt(end);
+         it != it_end;
+         ++it) {
+      GcRoot<mirror::Object>* entry = *it;
+      // Need to skip null here to distinguish between null entries and cleared weak ref entries.
+      if (!entry->IsNull()) {
+        // Since this is called by the GC, we don't need a read barrier.
+        mirror::Object* obj = entry->Read<kWithoutReadBarrier>();
+        mirror::Object* new_obj = visitor->IsMarked(obj);
+        if (new_obj == nullptr) {
+          new_obj = cleared;
+        }
+        *entry = GcRoot<mirror::Object>(new_obj);
       }
-      *entry = GcRoot<mirror::Object>(new_obj);
     }
+  };
+  if (parallel != nullptr) {
+    parallel->Run(weak_globals_.Capacity(), kEntriesPerChunk, sweep_entries);
+  } else {
+    sweep_entries(0, weak_globals_.Capacity());
   }
 }
 
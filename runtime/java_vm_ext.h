@@ -19,6 +19,8 @@
 
 #include "jni.h"
 
+#include <vector>
+
 #include "base/macros.h"
 #include "base/mutex.h"
 #include "indirect_reference_table.h"
@@ -26,6 +28,10 @@
 
 namespace art {
 
+namespace gc {
+  class ParallelWeakSweep;
+}  // namespace gc
+
 namespace mirror {
   class Array;
 }  // namespace mirror
@@ -129,7 +135,12 @@ class JavaVMExt : public JavaVM {
 
   void DeleteWeakGlobalRef(Thread* self, jweak obj) REQUIRES(!weak_globals_lock_);
 
-  void SweepJniWeakGlobals(IsMarkedVisitor* visitor)
+  // Returns the free global and weak global slots cached by self to the tables, when self
+  // detaches.
+  void ReleaseGlobalRefSlots(Thread* self) REQUIRES(!globals_lock_, !weak_globals_lock_);
+
+  // If parallel is not null, the table is swept with the help of the parallel sweep helpers.
+  void SweepJniWeakGlobals(IsMarkedVisitor* visitor, gc::ParallelWeakSweep* parallel = nullptr)
       SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!weak_globals_lock_);
 
   mirror::Object* DecodeGlobal(IndirectRef ref)
@@ -196,6 +207,8 @@ class JavaVMExt : public JavaVM {
   ReaderWriterMutex globals_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   // Not guarded by globals_lock since we sometimes use SynchronizedGet in Thread::DecodeJObject.
   IndirectReferenceTable globals_;
+  // Free slots of globals_ which are not cached by a thread.
+  std::vector<uint32_t> free_global_slots_ GUARDED_BY(globals_lock_);
 
   // No lock annotation since UnloadNativeLibraries is called on libraries_ but locks the
   // jni_libraries_lock_ internally.
@@ -211,6 +224,8 @@ class JavaVMExt : public JavaVM {
   // read barrier enabled.
   // Not guarded by weak_globals_lock since we may use SynchronizedGet in DecodeWeakGlobal.
   IndirectReferenceTable weak_globals_;
+  // Free slots of weak_globals_ which are not cached by a thread.
+  std::vector<uint32_t> free_weak_global_slots_ GUARDED_BY(weak_globals_lock_);
   // Not guarded by weak_globals_lock since we may use SynchronizedGet in DecodeWeakGlobal.
   Atomic<bool> allow_accessing_weak_globals_;
   ConditionVariable weak_globals_add_condition_ GUARDED_BY(weak_globals_lock_);
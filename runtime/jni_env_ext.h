@@ -29,9 +29,9 @@ namespace art {
 
 class JavaVMExt;
 
-// Maximum number of local references in the indirect reference table. The value is arbitrary but
-// low enough that it forces sanity checks.
-static constexpr size_t kLocalsMax = 512;
+// Maximum number of local references in the indirect reference table. The table starts small and
+// grows on demand, so the value only needs to be low enough to catch leaks. (Must fit in 16 bits.)
+static constexpr size_t kLocalsMax = 32768;
 
 struct JNIEnvExt : public JNIEnv {
   static JNIEnvExt* Create(Thread* self, JavaVMExt* vm);
@@ -86,6 +86,10 @@ struct JNIEnvExt : public JNIEnv {
   // Used by -Xcheck:jni.
   const JNINativeInterface* unchecked_functions;
 
+  // Free slots of the global and weak global tables of the JavaVMExt cached by this thread.
+  IrtSlotCache global_ref_slots;
+  IrtSlotCache weak_global_ref_slots;
+
   // Functions to keep track of monitor lock and unlock operations. Used to ensure proper locking
   // rules in CheckJNI mode.
 
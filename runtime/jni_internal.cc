@@ -1900,13 +1900,13 @@ class JNI {
     if (heap->IsMovableObject(array)) {
       if (!kUseReadBarrier) {
         heap->IncrementDisableMovingGC(soa.Self());
+        // Re-decode in case the object moved since IncrementDisableGC waits for GC to complete.
+        array = soa.Decode<mirror::Array*>(java_array);
       } else {
-        // For the CC collector, we only need to wait for the thread flip rather than the whole GC
-        // to occur thanks to the to-space invariant.
-        heap->IncrementDisableThreadFlip(soa.Self());
+        // For the CC collector, pinning the region of the array keeps it in place without
+        // waiting for the thread flip. The decoded array is already a to-space reference.
+        heap->PinRegionSpaceObject(array);
       }
-      // Re-decode in case the object moved since IncrementDisableGC waits for GC to complete.
-      array = soa.Decode<mirror::Array*>(java_array);
     }
     if (is_copy != nullptr) {
       *is_copy = JNI_FALSE;
@@ -2390,21 +2390,26 @@ class JNI {
       return nullptr;
     }
     // Only make a copy if necessary.
-    if (Runtime::Current()->GetHeap()->IsMovableObject(array)) {
-      if (is_copy != nullptr) {
-        *is_copy = JNI_TRUE;
-      }
-      const size_t component_size = sizeof(ElementT);
-      size_t size = array->GetLength() * component_size;
-      void* data = new uint64_t[RoundUp(size, 8) / 8];
-      memcpy(data, array->GetData(), size);
-      return reinterpret_cast<ElementT*>(data);
-    } else {
-      if (is_copy != nullptr) {
-        *is_copy = JNI_FALSE;
+    gc::Heap* heap = Runtime::Current()->GetHeap();
+    if (heap->IsMovableObject(array)) {
+      if (!kUseReadBarrier) {
+        if (is_copy != nullptr) {
+          *is_copy = JNI_TRUE;
+        }
+        const size_t component_size = sizeof(ElementT);
+        size_t size = array->GetLength() * component_size;
+        void* data = new uint64_t[RoundUp(size, 8) / 8];
+        memcpy(data, array->GetData(), size);
+        return reinterpret_cast<ElementT*>(data);
       }
-      return reinterpret_cast<ElementT*>(array->GetData());
+      // The CC collector keeps the array in place while its region is pinned, which is much
+      // cheaper than copying a large array.
+      heap->PinRegionSpaceObject(array);
+    }
+    if (is_copy != nullptr) {
+      *is_copy = JNI_FALSE;
     }
+    return reinterpret_cast<ElementT*>(array->GetData());
   }
 
   template <typename ArrayT, typename ElementT, typename ArtArrayT>
@@ -2449,11 +2454,12 @@ class JNI {
       if (is_copy) {
         delete[] reinterpret_cast<uint64_t*>(elements);
       } else if (heap->IsMovableObject(array)) {
-        // Non copy to a movable object must means that we had disabled the moving GC.
+        // Non copy to a movable object must means that we had disabled the moving GC, or pinned
+        // the region of the array for the CC collector.
         if (!kUseReadBarrier) {
           heap->DecrementDisableMovingGC(soa.Self());
         } else {
-          heap->DecrementDisableThreadFlip(soa.Self());
+          heap->UnpinRegionSpaceObject(array);
         }
       }
     }
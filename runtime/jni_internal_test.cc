@@ -1868,8 +1868,10 @@ TEST_F(JniInternalTest, PushLocalFrame_10395422) {
   // Negative capacities are not allowed.
   ASSERT_EQ(JNI_ERR, env_->PushLocalFrame(-1));
 
-  // And it's okay to have an upper limit. Ours is currently 512.
-  ASSERT_EQ(JNI_ERR, env_->PushLocalFrame(8192));
+  // And it's okay to have an upper limit. Ours is kLocalsMax, the table grows up to it on demand.
+  ASSERT_EQ(JNI_OK, env_->PushLocalFrame(8192));
+  env_->PopLocalFrame(nullptr);
+  ASSERT_EQ(JNI_ERR, env_->PushLocalFrame(static_cast<jint>(kLocalsMax) + 1));
 }
 
 TEST_F(JniInternalTest, PushLocalFrame_PopLocalFrame) {
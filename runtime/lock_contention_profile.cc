@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lock_contention_profile.h"
+
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "art_method-inl.h"
+#include "base/bit_utils.h"
+#include "base/stringprintf.h"
+#include "base/time_utils.h"
+#include "utils.h"
+
+namespace art {
+
+// Number of entries to look at for a key before giving up, the table does not grow.
+static constexpr size_t kMaxProbes = 32;
+
+LockContentionProfile* LockContentionProfile::current_ = nullptr;
+
+LockContentionProfile::LockContentionProfile() : entries_(new Entry[kNumEntries]) {}
+
+void LockContentionProfile::Enable() {
+  if (current_ == nullptr) {
+    // Leaked on purpose, see Current().
+    current_ = new LockContentionProfile();
+  }
+}
+
+size_t LockContentionProfile::GetHistogramBucket(uint64_t wait_ns) {
+  const uint64_t wait_us = wait_ns / 1000;
+  if (wait_us == 0) {
+    return 0;
+  }
+  return std::min(static_cast<size_t>(MostSignificantBit(wait_us)) + 1, kNumHistogramBuckets - 1);
+}
+
+LockContentionProfile::Entry* LockContentionProfile::Find(const Key& key,
+                                                          bool add,
+                                                          std::string* waiter_description,
+                                                          std::string* owner_description) {
+  size_t hash = reinterpret_cast<uintptr_t>(key.waiter_site) ^
+      (reinterpret_cast<uintptr_t>(key.owner_site) * 31) ^
+      (reinterpret_cast<uintptr_t>(key.lock_name) * 17) ^
+      (key.waiter_dex_pc * 7) ^ key.owner_dex_pc ^ key.kind;
+  hash *= 0x9e3779b1u;
+  for (size_t i = 0; i != kMaxProbes; ++i) {
+    Entry* entry = &entries_[(hash + i) % kNumEntries];
+    uint32_t state = entry->state.LoadAcquire();
+    if (state == kEmpty) {
+      if (!add) {
+        return nullptr;
+      }
+      if (entry->state.CompareExchangeStrongSequentiallyConsistent(kEmpty, kClaimed)) {
+        // Nothing in here may record contention, the claimed entry would block the lookup.
+        entry->key = key;
+        if (waiter_description != nullptr) {
+          entry->waiter_description.swap(*waiter_description);
+        }
+        if (owner_description != nullptr) {
+          entry->owner_description.swap(*owner_description);
+        }
+        entry->state.StoreRelease(kPublished);
+        return entry;
+      }
+      state = entry->state.LoadAcquire();
+    }
+    // The entry is being filled in by another thread, wait until we can compare its key.
+    while (state == kClaimed) {
+      state = entry->state.LoadAcquire();
+    }
+    if (entry->key == key) {
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+void LockContentionProfile::Record(Entry* entry, uint64_t wait_ns) {
+  if (entry == nullptr) {
+    num_dropped_.FetchAndAddRelaxed(1);
+    return;
+  }
+  entry->count.FetchAndAddRelaxed(1);
+  entry->total_wait_ns.FetchAndAddRelaxed(wait_ns);
+  entry->histogram[GetHistogramBucket(wait_ns)].FetchAndAddRelaxed(1);
+  uint64_t max_wait_ns = entry->max_wait_ns.LoadRelaxed();
+  while (wait_ns > max_wait_ns &&
+         !entry->max_wait_ns.CompareExchangeWeakRelaxed(max_wait_ns, wait_ns)) {
+    max_wait_ns = entry->max_wait_ns.LoadRelaxed();
+  }
+}
+
+void LockContentionProfile::RecordMutexContention(LockKind kind,
+                                                  const char* lock_name,
+                                                  const void* waiter_pc,
+                                                  const void* owner_pc,
+                                                  uint64_t wait_ns) {
+  DCHECK_NE(kind, kMonitor);
+  const Key key = { kind, lock_name, waiter_pc, 0u, owner_pc, 0u };
+  Record(Find(key, /* add */ true, nullptr, nullptr), wait_ns);
+}
+
+static std::string DescribeMonitorSite(ArtMethod* method, uint32_t dex_pc)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  if (method == nullptr) {
+    return "<unknown>";
+  }
+  const char* source_file = method->GetDeclaringClassSourceFile();
+  return StringPrintf("%s (%s:%d)",
+                      PrettyMethod(method).c_str(),
+                      source_file != nullptr ? source_file : "",
+                      method->GetLineNumFromDexPC(dex_pc));
+}
+
+void LockContentionProfile::RecordMonitorContention(ArtMethod* waiter_method,
+                                                    uint32_t waiter_dex_pc,
+                                                    ArtMethod* owner_method,
+                                                    uint32_t owner_dex_pc,
+                                                    uint64_t wait_ns) {
+  const Key key = {
+      kMonitor, nullptr, waiter_method, waiter_dex_pc, owner_method, owner_dex_pc };
+  Entry* entry = Find(key, /* add */ false, nullptr, nullptr);
+  if (entry == nullptr) {
+    // Describe the sites before claiming an entry, this may contend on other locks.
+    std::string waiter_description = DescribeMonitorSite(waiter_method, waiter_dex_pc);
+    std::string owner_description = DescribeMonitorSite(owner_method, owner_dex_pc);
+    entry = Find(key, /* add */ true, &waiter_description, &owner_description);
+  }
+  Record(entry, wait_ns);
+}
+
+std::string LockContentionProfile::DescribeNativeSite(const void* pc) {
+  if (pc == nullptr) {
+    return "<unknown>";
+  }
+  Dl_info info;
+  if (dladdr(pc, &info) != 0 && info.dli_sname != nullptr) {
+    return StringPrintf("%s+%#zx",
+                        info.dli_sname,
+                        reinterpret_cast<uintptr_t>(pc) -
+                            reinterpret_cast<uintptr_t>(info.dli_saddr));
+  }
+  return StringPrintf("%p", pc);
+}
+
+void LockContentionProfile::Dump(std::ostream& os) const {
+  std::vector<const Entry*> entries;
+  for (size_t i = 0; i != kNumEntries; ++i) {
+    if (entries_[i].state.LoadAcquire() == kPublished) {
+      entries.push_back(&entries_[i]);
+    }
+  }
+  std::sort(entries.begin(), entries.end(), [](const Entry* lhs, const Entry* rhs) {
+    return lhs->total_wait_ns.LoadRelaxed() > rhs->total_wait_ns.LoadRelaxed();
+  });
+  os << "Lock contention profile: " << entries.size() << " sites";
+  const uint64_t num_dropped = num_dropped_.LoadRelaxed();
+  if (num_dropped != 0) {
+    os << ", " << num_dropped << " contentions dropped";
+  }
+  os << "\n";
+  for (const Entry* entry : entries) {
+    const Key& key = entry->key;
+    switch (key.kind) {
+      case kMonitor:
+        os << "  monitor: waiter " << entry->waiter_description
+           << ", owner " << entry->owner_description << "\n";
+        break;
+      case kMutex:
+      case kReaderWriterMutex:
+        os << "  " << (key.kind == kMutex ? "mutex" : "rw mutex") << " \"" << key.lock_name
+           << "\": waiter " << DescribeNativeSite(key.waiter_site)
+           << ", owner "
+           << ((key.kind == kReaderWriterMutex && key.owner_site == nullptr)
+                   ? "<shared holders>"
+                   : DescribeNativeSite(key.owner_site))
+           << "\n";
+        break;
+    }
+    const uint64_t count = entry->count.LoadRelaxed();
+    const uint64_t total_wait_ns = entry->total_wait_ns.LoadRelaxed();
+    os << "    count=" << count
+       << " total wait=" << PrettyDuration(total_wait_ns)
+       << " mean wait=" << PrettyDuration(count != 0 ? total_wait_ns / count : 0)
+       << " max wait=" << PrettyDuration(entry->max_wait_ns.LoadRelaxed()) << "\n";
+    os << "    wait histogram:";
+    for (size_t i = 0; i != kNumHistogramBuckets; ++i) {
+      const uint64_t bucket_count = entry->histogram[i].LoadRelaxed();
+      if (bucket_count != 0) {
+        if (i == kNumHistogramBuckets - 1) {
+          os << " >=" << (UINT64_C(1) << (i - 1)) << "us:" << bucket_count;
+        } else {
+          os << " <" << (UINT64_C(1) << i) << "us:" << bucket_count;
+        }
+      }
+    }
+    os << "\n";
+  }
+}
+
+}  // namespace art
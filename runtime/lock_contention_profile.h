@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_LOCK_CONTENTION_PROFILE_H_
+#define ART_RUNTIME_LOCK_CONTENTION_PROFILE_H_
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class ArtMethod;
+
+// In-memory profile of lock contention, aggregated by the site where the waiting thread tried to
+// acquire the lock and the site where the owner acquired it. For each pair of sites it keeps the
+// number of contended acquisitions, the total wait time and a histogram of the wait times.
+//
+// Monitors record their contention with the methods and dex pcs of the waiter and the owner,
+// Mutex and ReaderWriterMutex with the name of the lock and the native return addresses of the
+// waiting and owning lock calls. Recording never takes a lock, since it is called from the slow
+// paths of the runtime mutexes themselves: the profile is a fixed-size hash table whose entries
+// are claimed with a CAS and updated with atomic adds.
+class LockContentionProfile {
+ public:
+  enum LockKind : uint8_t {
+    kMonitor,
+    kMutex,
+    kReaderWriterMutex,
+  };
+
+  static constexpr size_t kNumEntries = 512;
+  // Bucket 0 counts waits under 1us, bucket i > 0 waits in [2^(i-1)us, 2^i us), the last bucket
+  // also counts all the longer waits.
+  static constexpr size_t kNumHistogramBuckets = 20;
+
+  LockContentionProfile();
+
+  // The profile of the runtime, null if lock contention profiling is disabled.
+  static LockContentionProfile* Current() {
+    return current_;
+  }
+
+  // Enables the profile of the runtime. It lives as long as the process, since mutexes may
+  // record into it until the very end.
+  static void Enable();
+
+  // Records a contended acquisition of a Mutex or ReaderWriterMutex. The owner pc is null if
+  // unknown, or for a ReaderWriterMutex held by readers.
+  void RecordMutexContention(LockKind kind,
+                             const char* lock_name,
+                             const void* waiter_pc,
+                             const void* owner_pc,
+                             uint64_t wait_ns);
+
+  // Records a contended monitor enter. The owner method may be null if unknown.
+  void RecordMonitorContention(ArtMethod* waiter_method,
+                               uint32_t waiter_dex_pc,
+                               ArtMethod* owner_method,
+                               uint32_t owner_dex_pc,
+                               uint64_t wait_ns)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Dumps the sites sorted by total wait time, for SIGQUIT and VMDebug.
+  void Dump(std::ostream& os) const;
+
+  static size_t GetHistogramBucket(uint64_t wait_ns);
+
+ private:
+  struct Key {
+    LockKind kind;
+    // Null for monitors.
+    const char* lock_name;
+    // The ArtMethod of a monitor site, or the native return address of a mutex site.
+    const void* waiter_site;
+    uint32_t waiter_dex_pc;
+    const void* owner_site;
+    uint32_t owner_dex_pc;
+
+    bool operator==(const Key& other) const {
+      return kind == other.kind && lock_name == other.lock_name &&
+          waiter_site == other.waiter_site && waiter_dex_pc == other.waiter_dex_pc &&
+          owner_site == other.owner_site && owner_dex_pc == other.owner_dex_pc;
+    }
+  };
+
+  enum EntryState : uint32_t {
+    kEmpty,
+    kClaimed,  // Being filled in by the thread which claimed it.
+    kPublished,
+  };
+
+  struct Entry {
+    Atomic<uint32_t> state;
+    Key key;
+    // Descriptions of the sites of a monitor, computed when the entry is added since the methods
+    // may be unloaded before the dump.
+    std::string waiter_description;
+    std::string owner_description;
+    Atomic<uint64_t> count;
+    Atomic<uint64_t> total_wait_ns;
+    Atomic<uint64_t> max_wait_ns;
+    Atomic<uint64_t> histogram[kNumHistogramBuckets];
+  };
+
+  // Returns the entry of `key`, or null if it does not exist and `add` is false or the table is
+  // full. Added entries take the descriptions.
+  Entry* Find(const Key& key,
+              bool add,
+              std::string* waiter_description,
+              std::string* owner_description);
+
+  void Record(Entry* entry, uint64_t wait_ns);
+
+  static std::string DescribeNativeSite(const void* pc);
+
+  static LockContentionProfile* current_;
+
+  std::unique_ptr<Entry[]> entries_;
+  // Contended acquisitions which did not fit in the table.
+  Atomic<uint64_t> num_dropped_;
+
+  DISALLOW_COPY_AND_ASSIGN(LockContentionProfile);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_LOCK_CONTENTION_PROFILE_H_
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lock_contention_profile.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <sstream>
+
+#include "atomic.h"
+#include "base/mutex.h"
+#include "base/time_utils.h"
+#include "common_runtime_test.h"
+#include "thread.h"
+
+namespace art {
+
+TEST(LockContentionProfile, HistogramBuckets) {
+  EXPECT_EQ(0u, LockContentionProfile::GetHistogramBucket(0));
+  EXPECT_EQ(0u, LockContentionProfile::GetHistogramBucket(999));
+  EXPECT_EQ(1u, LockContentionProfile::GetHistogramBucket(1000));
+  EXPECT_EQ(2u, LockContentionProfile::GetHistogramBucket(2000));
+  EXPECT_EQ(2u, LockContentionProfile::GetHistogramBucket(3999));
+  EXPECT_EQ(3u, LockContentionProfile::GetHistogramBucket(4000));
+  EXPECT_EQ(LockContentionProfile::kNumHistogramBuckets - 1,
+            LockContentionProfile::GetHistogramBucket(UINT64_C(1) << 62));
+}
+
+TEST(LockContentionProfile, RecordMutexContention) {
+  LockContentionProfile profile;
+  int sites[3];
+  profile.RecordMutexContention(LockContentionProfile::kMutex, "test lock", &sites[0], &sites[1],
+                                1500);
+  profile.RecordMutexContention(LockContentionProfile::kMutex, "test lock", &sites[0], &sites[1],
+                                2500);
+  profile.RecordMutexContention(LockContentionProfile::kReaderWriterMutex, "test rw lock",
+                                &sites[2], nullptr, 100);
+  std::ostringstream oss;
+  profile.Dump(oss);
+  const std::string dump = oss.str();
+  EXPECT_NE(std::string::npos, dump.find("2 sites")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("mutex \"test lock\"")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("rw mutex \"test rw lock\"")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("owner <shared holders>")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("count=2")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("<2us:1 <4us:1")) << dump;
+  // Sorted by total wait time.
+  EXPECT_LT(dump.find("test lock"), dump.find("test rw lock")) << dump;
+  EXPECT_EQ(std::string::npos, dump.find("dropped")) << dump;
+}
+
+TEST(LockContentionProfile, DropsWhenFull) {
+  LockContentionProfile profile;
+  std::unique_ptr<char[]> sites(new char[2 * LockContentionProfile::kNumEntries]);
+  for (size_t i = 0; i != 2 * LockContentionProfile::kNumEntries; ++i) {
+    profile.RecordMutexContention(LockContentionProfile::kMutex, "test lock", &sites[i], nullptr,
+                                  1000);
+  }
+  std::ostringstream oss;
+  profile.Dump(oss);
+  EXPECT_NE(std::string::npos, oss.str().find("contentions dropped")) << oss.str();
+}
+
+class LockContentionProfileTest : public CommonRuntimeTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    options->push_back(std::make_pair("-Xlockcontentionprofile", nullptr));
+  }
+
+  // Returns the line of the runtime profile which describes the sites of `lock_name`.
+  static std::string GetSitesLine(const std::string& lock_name) {
+    LockContentionProfile* const profile = LockContentionProfile::Current();
+    EXPECT_TRUE(profile != nullptr);
+    if (profile == nullptr) {
+      return "";
+    }
+    std::ostringstream oss;
+    profile->Dump(oss);
+    const std::string dump = oss.str();
+    const size_t name_pos = dump.find("\"" + lock_name + "\"");
+    if (name_pos == std::string::npos) {
+      return "";
+    }
+    const size_t start = dump.rfind('\n', name_pos) + 1;
+    return dump.substr(start, dump.find('\n', name_pos) - start);
+  }
+};
+
+struct ContendedLockState {
+  ContendedLockState()
+      : mu("lock contention profile test mutex"),
+        rw_mu("lock contention profile test rw mutex"),
+        started(false) {}
+
+  Mutex mu;
+  ReaderWriterMutex rw_mu;
+  Atomic<bool> started;
+};
+
+static void* LockMutexCallback(void* arg) {
+  ContendedLockState* state = reinterpret_cast<ContendedLockState*>(arg);
+  state->started.StoreSequentiallyConsistent(true);
+  state->mu.ExclusiveLock(Thread::Current());
+  state->mu.ExclusiveUnlock(Thread::Current());
+  return nullptr;
+}
+
+static void* LockReaderWriterMutexCallback(void* arg) {
+  ContendedLockState* state = reinterpret_cast<ContendedLockState*>(arg);
+  state->started.StoreSequentiallyConsistent(true);
+  state->rw_mu.ExclusiveLock(Thread::Current());
+  state->rw_mu.ExclusiveUnlock(Thread::Current());
+  return nullptr;
+}
+
+// Gives the contender started by the caller time to block on the lock.
+static void WaitForContender(ContendedLockState* state) {
+  while (!state->started.LoadSequentiallyConsistent()) {
+    sched_yield();
+  }
+  NanoSleep(MsToNs(10));
+}
+
+// GCC has trouble with our mutex tests, so we have to turn off thread safety analysis.
+static void ContendedMutexTest() NO_THREAD_SAFETY_ANALYSIS {
+  ContendedLockState state;
+  state.mu.ExclusiveLock(Thread::Current());
+  pthread_t pthread;
+  ASSERT_EQ(0, pthread_create(&pthread, nullptr, LockMutexCallback, &state));
+  WaitForContender(&state);
+  state.mu.ExclusiveUnlock(Thread::Current());
+  EXPECT_EQ(0, pthread_join(pthread, nullptr));
+}
+
+static void ContendedSharedHoldersTest() NO_THREAD_SAFETY_ANALYSIS {
+  ContendedLockState state;
+  state.rw_mu.SharedLock(Thread::Current());
+  pthread_t pthread;
+  ASSERT_EQ(0, pthread_create(&pthread, nullptr, LockReaderWriterMutexCallback, &state));
+  WaitForContender(&state);
+  state.rw_mu.SharedUnlock(Thread::Current());
+  EXPECT_EQ(0, pthread_join(pthread, nullptr));
+}
+
+TEST_F(LockContentionProfileTest, ContendedMutex) {
+  ContendedMutexTest();
+  const std::string sites = GetSitesLine("lock contention profile test mutex");
+  EXPECT_EQ(0u, sites.find("  mutex ")) << sites;
+  // The owner recorded where it locked the mutex.
+  EXPECT_EQ(std::string::npos, sites.find("<unknown>")) << sites;
+}
+
+TEST_F(LockContentionProfileTest, ContendedSharedHolders) {
+  ContendedSharedHoldersTest();
+  const std::string sites = GetSitesLine("lock contention profile test rw mutex");
+  EXPECT_EQ(0u, sites.find("  rw mutex ")) << sites;
+  EXPECT_NE(std::string::npos, sites.find("owner <shared holders>")) << sites;
+}
+
+}  // namespace art
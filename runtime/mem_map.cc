@@ -900,6 +900,30 @@ std::ostream& operator<<(std::ostream& os, const MemMap& mem_map) {
   return os;
 }
 
+#ifdef MADV_FREE
+// Kernels before 4.5 reject MADV_FREE, probe once with a private anonymous page.
+static bool KernelSupportsMadviseFree() {
+  void* page = mmap(nullptr, kPageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (page == MAP_FAILED) {
+    return false;
+  }
+  const bool supported = madvise(page, kPageSize, MADV_FREE) == 0;
+  munmap(page, kPageSize);
+  return supported;
+}
+#endif
+
+int MadviseFree(void* begin, size_t byte_count) {
+#ifdef MADV_FREE
+  static const bool madvise_free_supported = KernelSupportsMadviseFree();
+  // Shared mappings such as ashmem regions also reject MADV_FREE.
+  if (madvise_free_supported && madvise(begin, byte_count, MADV_FREE) == 0) {
+    return 0;
+  }
+#endif
+  return madvise(begin, byte_count, MADV_DONTNEED);
+}
+
 void MemMap::TryReadable() {
   if (base_begin_ == nullptr && base_size_ == 0) {
     return;
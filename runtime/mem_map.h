@@ -244,6 +244,13 @@ class MemMap {
 std::ostream& operator<<(std::ostream& os, const MemMap& mem_map);
 std::ostream& operator<<(std::ostream& os, const MemMap::Maps& mem_maps);
 
+// Advises the kernel that the pages in [begin, begin + byte_count) are not needed anymore. Uses the
+// lazy MADV_FREE where the kernel and the mapping support it: the pages are only reclaimed under
+// memory pressure, so reusing them before that does not fault. Falls back to MADV_DONTNEED
+// otherwise. A lazily freed page may keep its contents, callers must not rely on reading zeroes
+// back unless the pages were already zero. Returns the result of madvise.
+int MadviseFree(void* begin, size_t byte_count);
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_MEM_MAP_H_
@@ -431,4 +431,27 @@ TEST_F(MemMapTest, CheckNoGaps) {
   ASSERT_FALSE(MemMap::CheckNoGaps(map0.get(), map2.get()));
 }
 
+TEST_F(MemMapTest, MadviseFree) {
+  CommonInit();
+  std::string error_msg;
+  std::unique_ptr<MemMap> map(MemMap::MapAnonymous("MadviseFree",
+                                                   nullptr,
+                                                   4 * kPageSize,
+                                                   PROT_READ | PROT_WRITE,
+                                                   false,
+                                                   false,
+                                                   &error_msg));
+  ASSERT_TRUE(map.get() != nullptr) << error_msg;
+  // Touch the pages, then release the zero ones.
+  memset(map->Begin(), 0, map->Size());
+  ASSERT_EQ(0, MadviseFree(map->Begin(), map->Size()));
+  // The pages stay mapped and read back as zeroes whether or not they were reclaimed.
+  for (size_t i = 0; i < map->Size(); ++i) {
+    ASSERT_EQ(0u, map->Begin()[i]);
+  }
+  // And they can be reused.
+  map->Begin()[kPageSize] = 1u;
+  ASSERT_EQ(1u, map->Begin()[kPageSize]);
+}
+
 }  // namespace art
@@ -191,10 +191,15 @@ int32_t Object::IdentityHashCode() const {
         break;
       }
       case LockWord::kFatLocked: {
-        // Already inflated, return the hash stored in the monitor.
+        // Already inflated, return the hash stored in the monitor unless it was deflated
+        // concurrently.
         Monitor* monitor = lw.FatLockMonitor();
         DCHECK(monitor != nullptr);
-        return monitor->GetHashCode();
+        int32_t hash_code;
+        if (monitor->TryGetHashCode(Thread::Current(), &hash_code)) {
+          return hash_code;
+        }
+        break;
       }
       case LockWord::kHashCode: {
         return lw.GetHashCode();
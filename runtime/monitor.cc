@@ -19,6 +19,7 @@
 #include <vector>
 
 #include "art_method-inl.h"
+#include "barrier.h"
 #include "base/mutex.h"
 #include "base/stl_util.h"
 #include "base/systrace.h"
@@ -26,6 +27,8 @@
 #include "class_linker.h"
 #include "dex_file-inl.h"
 #include "dex_instruction-inl.h"
+#include "gc/parallel_weak_sweep.h"
+#include "lock_contention_profile.h"
 #include "lock_word-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
@@ -40,6 +43,29 @@ namespace art {
 
 static constexpr uint64_t kLongWaitMs = 100;
 
+// Contenders of a fat lock spin instead of blocking at most for about the cost of blocking and
+// being woken up again, two context switches.
+static constexpr uint64_t kMaxMonitorSpinNs = 20000;
+// Spin duration when the hold times of a monitor are not known yet.
+static constexpr uint64_t kDefaultMonitorSpinNs = 2000;
+// Weight of the latest hold time in the moving average, as a power of two.
+static constexpr size_t kHoldTimeHistoryShift = 3;
+// Only one acquisition out of this many is timed, reading the clock on every acquisition and
+// release would cost more than most short critical sections.
+static constexpr uint32_t kHoldTimeSamplingInterval = 8;
+
+// Tells the CPU that we are in a spin-wait loop, which saves power and frees resources for the
+// other hardware thread of the core.
+static inline void SpinWaitPause() {
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__("pause" ::: "memory");
+#elif defined(__arm__) || defined(__aarch64__)
+  __asm__ __volatile__("yield" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
 /*
  * Every Object has a monitor associated with it, but not every Object is actually locked.  Even
  * the ones that are locked do not need a full-fledged monitor until a) there is actual contention
@@ -84,6 +110,9 @@ Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_
       hash_code_(hash_code),
       locking_method_(nullptr),
       locking_dex_pc_(0),
+      lock_acquire_ns_(0),
+      average_hold_ns_(0),
+      num_acquisitions_(0),
       monitor_id_(MonitorPool::ComputeMonitorId(this, self)) {
 #ifdef __LP64__
   DCHECK(false) << "Should not be reached in 64b";
@@ -107,6 +136,9 @@ Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_
       hash_code_(hash_code),
       locking_method_(nullptr),
       locking_dex_pc_(0),
+      lock_acquire_ns_(0),
+      average_hold_ns_(0),
+      num_acquisitions_(0),
       monitor_id_(id) {
 #ifdef __LP64__
   next_free_ = nullptr;
@@ -127,6 +159,20 @@ int32_t Monitor::GetHashCode() {
   return hash_code_.LoadRelaxed();
 }
 
+bool Monitor::TryGetHashCode(Thread* self, int32_t* hash_code) {
+  if (!HasHashCode()) {
+    // Generate the hash code under the monitor lock, so that a concurrent deflation either sees
+    // it and keeps it in the lock word, or happens first and we retry with the new lock word.
+    MutexLock mu(self, monitor_lock_);
+    if (IsDeflated()) {
+      return false;
+    }
+    GetHashCode();
+  }
+  *hash_code = hash_code_.LoadRelaxed();
+  return true;
+}
+
 bool Monitor::Install(Thread* self) {
   MutexLock mu(self, monitor_lock_);  // Uncontended mutex acquisition as monitor isn't yet public.
   CHECK(owner_ == nullptr || owner_ == self || owner_->IsSuspended());
@@ -159,7 +205,8 @@ bool Monitor::Install(Thread* self) {
   // Publish the updated lock word, which may race with other threads.
   bool success = GetObject()->CasLockWordWeakSequentiallyConsistent(lw, fat);
   // Lock profiling.
-  if (success && owner_ != nullptr && lock_profiling_threshold_ != 0) {
+  if (success && owner_ != nullptr &&
+      (lock_profiling_threshold_ != 0 || LockContentionProfile::Current() != nullptr)) {
     // Do not abort on dex pc errors. This can easily happen when we want to dump a stack trace on
     // abort.
     locking_method_ = owner_->GetCurrentMethod(&locking_dex_pc_, false);
@@ -318,9 +365,12 @@ bool Monitor::TryLockLocked(Thread* self) {
   if (owner_ == nullptr) {  // Unowned.
     owner_ = self;
     CHECK_EQ(lock_count_, 0);
+    if (++num_acquisitions_ % kHoldTimeSamplingInterval == 0) {
+      lock_acquire_ns_ = NanoTime();
+    }
     // When debugging, save the current monitor holder for future
     // acquisition failures to use in sampled logging.
-    if (lock_profiling_threshold_ != 0) {
+    if (lock_profiling_threshold_ != 0 || LockContentionProfile::Current() != nullptr) {
       locking_method_ = self->GetCurrentMethod(&locking_dex_pc_);
     }
   } else if (owner_ == self) {  // Recursive.
@@ -334,18 +384,90 @@ bool Monitor::TryLockLocked(Thread* self) {
 
 bool Monitor::TryLock(Thread* self) {
   MutexLock mu(self, monitor_lock_);
-  return TryLockLocked(self);
+  return !IsDeflated() && TryLockLocked(self);
+}
+
+uint64_t Monitor::GetSpinDurationNs() {
+  Thread* const owner = owner_;
+  // Spinning only pays off while the owner is running and can release the lock.
+  if (owner == nullptr || owner->GetState() != kRunnable) {
+    return 0u;
+  }
+  if (average_hold_ns_ == 0u) {
+    return kDefaultMonitorSpinNs;
+  }
+  // Wait for about twice the usual hold time, long holds are not worth spinning for.
+  return (average_hold_ns_ <= kMaxMonitorSpinNs / 2) ? 2 * average_hold_ns_ : 0u;
+}
+
+bool Monitor::SpinUntilUnowned(Thread* self, Thread* owner, uint64_t spin_ns) const {
+  static constexpr size_t kSpinsBetweenClockReads = 16;
+  const uint64_t end_ns = NanoTime() + spin_ns;
+  for (size_t i = 1; ; ++i) {
+    // Racy without monitor_lock_, the caller tries to acquire the lock properly afterwards.
+    if (GetOwner() != owner) {
+      return true;
+    }
+    // Stop as soon as the owner blocks or is suspended, it cannot release the lock meanwhile.
+    // The owner is still alive, a thread has to release its monitors before it can exit.
+    if (owner->GetState() != kRunnable) {
+      return false;
+    }
+    // Do not delay suspension requests and checkpoints.
+    if (self->TestAllFlags()) {
+      return false;
+    }
+    if (i % kSpinsBetweenClockReads == 0 && NanoTime() >= end_ns) {
+      return false;
+    }
+    SpinWaitPause();
+  }
 }
 
-void Monitor::Lock(Thread* self) {
+bool Monitor::Lock(Thread* self) {
   MutexLock mu(self, monitor_lock_);
+  bool spun = false;
   while (true) {
+    // Checked on every iteration since we may have released monitor_lock_ to spin. Blocked
+    // contenders count as waiters, which prevents the deflation.
+    if (IsDeflated()) {
+      return false;
+    }
     if (TryLockLocked(self)) {
-      return;
+      return true;
+    }
+    // Contended. Spin once before blocking if the owner is likely to release the lock soon.
+    // Since we stay runnable, the monitor cannot be freed meanwhile. Spinners are not waiters, so
+    // it may be deflated concurrently, which is checked at the top of the loop.
+    const uint64_t spin_ns = spun ? 0u : GetSpinDurationNs();
+    if (spin_ns != 0u) {
+      spun = true;
+      Thread* const owner = owner_;
+      ArtMethod* const owners_method = locking_method_;
+      const uint32_t owners_dex_pc = locking_dex_pc_;
+      LockContentionProfile* const profile = LockContentionProfile::Current();
+      const uint64_t spin_start_ns = (profile != nullptr) ? NanoTime() : 0;
+      monitor_lock_.Unlock(self);
+      SpinUntilUnowned(self, owner, spin_ns);
+      monitor_lock_.Lock(self);
+      if (!IsDeflated() && TryLockLocked(self)) {
+        if (profile != nullptr) {
+          // Contended even though we did not block. Describing the sites may take other locks.
+          const uint64_t wait_ns = NanoTime() - spin_start_ns;
+          monitor_lock_.Unlock(self);
+          uint32_t pc;
+          ArtMethod* m = self->GetCurrentMethod(&pc);
+          profile->RecordMonitorContention(m, pc, owners_method, owners_dex_pc, wait_ns);
+          monitor_lock_.Lock(self);
+        }
+        return true;
+      }
+      continue;
     }
-    // Contended.
     const bool log_contention = (lock_profiling_threshold_ != 0);
     uint64_t wait_start_ms = log_contention ? MilliTime() : 0;
+    LockContentionProfile* const profile = LockContentionProfile::Current();
+    uint64_t wait_start_ns = (profile != nullptr) ? NanoTime() : 0;
     ArtMethod* owners_method = locking_method_;
     uint32_t owners_dex_pc = locking_dex_pc_;
     // Do this before releasing the lock so that we don't get deflated.
@@ -353,8 +475,8 @@ void Monitor::Lock(Thread* self) {
     ++num_waiters_;
     monitor_lock_.Unlock(self);  // Let go of locks in order.
     self->SetMonitorEnterObject(GetObject());
+    uint32_t original_owner_thread_id = 0u;
     {
-      uint32_t original_owner_thread_id = 0u;
       ScopedThreadStateChange tsc(self, kBlocked);  // Change to blocked and give up mutator_lock_.
       {
         // Reacquire monitor_lock_ without mutator_lock_ for Wait.
@@ -440,6 +562,16 @@ void Monitor::Lock(Thread* self) {
       }
     }
     self->SetMonitorEnterObject(nullptr);
+    if (profile != nullptr && original_owner_thread_id != 0u) {
+      // Back to runnable, so the methods cannot be unloaded while we describe them.
+      uint32_t pc;
+      ArtMethod* m = self->GetCurrentMethod(&pc);
+      profile->RecordMonitorContention(m,
+                                       pc,
+                                       owners_method,
+                                       owners_dex_pc,
+                                       NanoTime() - wait_start_ns);
+    }
     monitor_lock_.Lock(self);  // Reacquire locks in order.
     --num_waiters_;
   }
@@ -554,6 +686,15 @@ bool Monitor::Unlock(Thread* self) {
       // We own the monitor, so nobody else can be in here.
       AtraceMonitorUnlock();
       if (lock_count_ == 0) {
+        if (lock_acquire_ns_ != 0u) {
+          // Update the hold time history used for spinning.
+          const uint64_t hold_ns = NanoTime() - lock_acquire_ns_;
+          average_hold_ns_ = (average_hold_ns_ == 0u)
+              ? hold_ns
+              : average_hold_ns_ - (average_hold_ns_ >> kHoldTimeHistoryShift) +
+                    (hold_ns >> kHoldTimeHistoryShift);
+          lock_acquire_ns_ = 0u;
+        }
         owner_ = nullptr;
         locking_method_ = nullptr;
         locking_dex_pc_ = 0;
@@ -689,8 +830,9 @@ void Monitor::Wait(Thread* self, int64_t ms, int32_t ns,
 
   AtraceMonitorUnlock();  // End Wait().
 
-  // Re-acquire the monitor and lock.
-  Lock(self);
+  // Re-acquire the monitor and lock. We still count as a waiter, so the monitor was not deflated.
+  bool locked = Lock(self);
+  DCHECK(locked);
   monitor_lock_.Lock(self);
   self->GetWaitMutex()->AssertNotHeld(self);
 
@@ -799,6 +941,33 @@ bool Monitor::Deflate(Thread* self, mirror::Object* obj) {
   return true;
 }
 
+bool Monitor::DeflateConcurrently(Thread* self) {
+  MutexLock mu(self, monitor_lock_);
+  // Only deflate unused monitors, a thread which is about to lock the monitor sees that it was
+  // deflated and retries with the new lock word.
+  if (IsDeflated() || owner_ != nullptr || num_waiters_ > 0 || wait_set_ != nullptr) {
+    return false;
+  }
+  mirror::Object* obj = GetObject();
+  while (true) {
+    LockWord lw(obj->GetLockWord(true));
+    if (lw.GetState() != LockWord::kFatLocked || lw.FatLockMonitor() != this) {
+      return false;
+    }
+    // The hash code cannot change anymore, TryGetHashCode generates it under the monitor lock.
+    LockWord new_lw = HasHashCode()
+        ? LockWord::FromHashCode(hash_code_.LoadRelaxed(), lw.ReadBarrierState())
+        : LockWord::FromDefault(lw.ReadBarrierState());
+    // May fail spuriously or because the read barrier state changed.
+    if (obj->CasLockWordWeakSequentiallyConsistent(lw, new_lw)) {
+      break;
+    }
+  }
+  VLOG(monitor) << "Deflated " << obj << " concurrently";
+  obj_ = GcRoot<mirror::Object>(nullptr);
+  return true;
+}
+
 void Monitor::Inflate(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_code) {
   DCHECK(self != nullptr);
   DCHECK(obj != nullptr);
@@ -931,11 +1100,20 @@ mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj, bool tr
       case LockWord::kFatLocked: {
         Monitor* mon = lock_word.FatLockMonitor();
         if (trylock) {
-          return mon->TryLock(self) ? h_obj.Get() : nullptr;
-        } else {
-          mon->Lock(self);
+          if (mon->TryLock(self)) {
+            return h_obj.Get();
+          }
+          // The monitor may have been deflated concurrently, retry if the lock word changed.
+          LockWord new_lock_word = h_obj->GetLockWord(true);
+          if (new_lock_word.GetState() == LockWord::kFatLocked &&
+              new_lock_word.FatLockMonitor() == mon) {
+            return nullptr;
+          }
+          continue;  // Start from the beginning.
+        } else if (mon->Lock(self)) {
           return h_obj.Get();  // Success!
         }
+        continue;  // Deflated concurrently, start from the beginning.
       }
       case LockWord::kHashCode:
         // Inflate with the existing hashcode.
@@ -1336,15 +1514,34 @@ void MonitorList::Add(Monitor* m) {
   list_.push_front(m);
 }
 
-void MonitorList::SweepMonitorList(IsMarkedVisitor* visitor) {
+void MonitorList::SweepMonitorList(IsMarkedVisitor* visitor, gc::ParallelWeakSweep* parallel) {
+  static constexpr size_t kMonitorsPerChunk = 4096;
   Thread* self = Thread::Current();
   MutexLock mu(self, monitor_list_lock_);
+  if (parallel != nullptr) {
+    // Sweep the objects of the monitors in parallel, the dead ones are set to null and their
+    // monitors are released below.
+    std::vector<Monitor*> monitors(list_.begin(), list_.end());
+    parallel->Run(monitors.size(),
+                  kMonitorsPerChunk,
+                  [&](size_t begin, size_t end) NO_THREAD_SAFETY_ANALYSIS {
+      for (size_t i = begin; i != end; ++i) {
+        Monitor* m = monitors[i];
+        mirror::Object* obj = m->GetObject<kWithoutReadBarrier>();
+        if (obj != nullptr) {
+          m->SetObject(visitor->IsMarked(obj));
+        }
+      }
+    });
+  }
   for (auto it = list_.begin(); it != list_.end(); ) {
     Monitor* m = *it;
     // Disable the read barrier in GetObject() as this is called by GC.
     mirror::Object* obj = m->GetObject<kWithoutReadBarrier>();
-    // The object of a monitor can be null if we have deflated it.
-    mirror::Object* new_obj = obj != nullptr ? visitor->IsMarked(obj) : nullptr;
+    // The object of a monitor can be null if we have deflated it, or if it was found dead by the
+    // parallel sweep.
+    mirror::Object* new_obj = obj == nullptr ? nullptr :
+        (parallel != nullptr ? obj : visitor->IsMarked(obj));
     if (new_obj == nullptr) {
       VLOG(monitor) << "freeing monitor " << m << " belonging to unmarked object "
                     << obj;
@@ -1383,6 +1580,55 @@ size_t MonitorList::DeflateMonitors() {
   return visitor.deflate_count_;
 }
 
+class MonitorDeflationCheckpoint : public Closure {
+ public:
+  explicit MonitorDeflationCheckpoint(Barrier* barrier) : barrier_(barrier) {}
+
+  virtual void Run(Thread* thread ATTRIBUTE_UNUSED) OVERRIDE {
+    // Nothing to do, the thread holds no pointer to a deflated monitor once it gets here.
+    barrier_->Pass(Thread::Current());
+  }
+
+ private:
+  Barrier* const barrier_;
+};
+
+size_t MonitorList::DeflateMonitorsConcurrently(Thread* self) {
+  Monitors deflated;
+  {
+    ScopedObjectAccess soa(self);
+    MutexLock mu(self, monitor_list_lock_);
+    // Do not race with the sweeping of the monitors, which may not know yet whether the objects
+    // are alive.
+    if ((!kUseReadBarrier && !allow_new_monitors_) ||
+        (kUseReadBarrier && !self->GetWeakRefAccessEnabled())) {
+      return 0u;
+    }
+    for (auto it = list_.begin(); it != list_.end(); ) {
+      auto cur = it++;
+      if ((*cur)->DeflateConcurrently(self)) {
+        deflated.splice(deflated.end(), list_, cur);
+      }
+    }
+  }
+  const size_t deflate_count = deflated.size();
+  if (deflate_count != 0u) {
+    // Threads which read the lock word of an object before its monitor was deflated may still use
+    // the monitor until their next suspend point.
+    Barrier barrier(0);
+    MonitorDeflationCheckpoint closure(&barrier);
+    {
+      ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+      size_t barrier_count = Runtime::Current()->GetThreadList()->RunCheckpoint(&closure);
+      if (barrier_count != 0) {
+        barrier.Increment(self, barrier_count);
+      }
+    }
+    MonitorPool::ReleaseMonitors(self, &deflated);
+  }
+  return deflate_count;
+}
+
 MonitorInfo::MonitorInfo(mirror::Object* obj) : owner_(nullptr), entry_count_(0) {
   DCHECK(obj != nullptr);
   LockWord lock_word = obj->GetLockWord(true);
@@ -43,6 +43,10 @@ class StackVisitor;
 class Thread;
 typedef uint32_t MonitorId;
 
+namespace gc {
+  class ParallelWeakSweep;
+}  // namespace gc
+
 namespace mirror {
   class Object;
 }  // namespace mirror
@@ -119,6 +123,10 @@ class Monitor {
 
   int32_t GetHashCode();
 
+  // Like GetHashCode(), but fails if the monitor was deflated concurrently, the caller then has to
+  // read the hash code from the lock word again.
+  bool TryGetHashCode(Thread* self, int32_t* hash_code) REQUIRES(!monitor_lock_);
+
   bool IsLocked() SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!monitor_lock_);
 
   bool HasHashCode() const {
@@ -202,9 +210,32 @@ class Monitor {
       REQUIRES(monitor_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
-  void Lock(Thread* self)
+  // Returns false without locking if the monitor was deflated concurrently, the caller then has
+  // to retry with the new lock word of the object.
+  bool Lock(Thread* self)
       REQUIRES(!monitor_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Deflated monitors have a null object, other threads may still reach them through a lock word
+  // they read before the deflation.
+  bool IsDeflated() const REQUIRES(monitor_lock_) {
+    return obj_.IsNull();
+  }
+
+  // Deflates the monitor while other threads run, if it is not in use. Unlike Deflate, the lock
+  // word is replaced with a CAS so that concurrent read barrier state changes are not lost.
+  bool DeflateConcurrently(Thread* self)
+      REQUIRES(!monitor_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Returns how long a contender should spin before blocking, or 0 if it should block right away
+  // since the owner is not running or usually holds the lock for longer than blocking costs.
+  uint64_t GetSpinDurationNs()
+      REQUIRES(monitor_lock_);
+  // Spins until `owner` no longer holds the lock, stops running, the spin duration elapsed or
+  // `self` is requested to suspend. Returns true if the lock changed hands.
+  bool SpinUntilUnowned(Thread* self, Thread* owner, uint64_t spin_ns) const
+      REQUIRES(!monitor_lock_);
   bool Unlock(Thread* thread)
       REQUIRES(!monitor_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
@@ -302,6 +333,14 @@ class Monitor {
   ArtMethod* locking_method_ GUARDED_BY(monitor_lock_);
   uint32_t locking_dex_pc_ GUARDED_BY(monitor_lock_);
 
+  // When the owner acquired the lock, 0 if the acquisition is not timed or unknown such as for a
+  // lock inflated while held.
+  uint64_t lock_acquire_ns_ GUARDED_BY(monitor_lock_);
+  // Moving average of the recent hold times, 0 if none is known yet.
+  uint64_t average_hold_ns_ GUARDED_BY(monitor_lock_);
+  // Number of acquisitions, used to time only some of them.
+  uint32_t num_acquisitions_ GUARDED_BY(monitor_lock_);
+
   // The denser encoded version of this monitor as stored in the lock word.
   MonitorId monitor_id_;
 
@@ -324,13 +363,21 @@ class MonitorList {
 
   void Add(Monitor* m) SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!monitor_list_lock_);
 
-  void SweepMonitorList(IsMarkedVisitor* visitor)
+  // If parallel is not null, the objects of the monitors are swept with the help of the parallel
+  // sweep helpers, the calling thread then releases the monitors of the dead objects.
+  void SweepMonitorList(IsMarkedVisitor* visitor, gc::ParallelWeakSweep* parallel = nullptr)
       REQUIRES(!monitor_list_lock_) SHARED_REQUIRES(Locks::mutator_lock_);
   void DisallowNewMonitors() REQUIRES(!monitor_list_lock_);
   void AllowNewMonitors() REQUIRES(!monitor_list_lock_);
   void BroadcastForNewMonitors() REQUIRES(!monitor_list_lock_);
   // Returns how many monitors were deflated.
   size_t DeflateMonitors() REQUIRES(!monitor_list_lock_) REQUIRES(Locks::mutator_lock_);
+  // Deflates the unused monitors without suspending all threads. The deflated monitors are
+  // released to the monitor pool in one batch once every thread has passed a checkpoint, since
+  // until then a thread may still use a monitor it found through the old lock word. Returns how
+  // many monitors were deflated.
+  size_t DeflateMonitorsConcurrently(Thread* self)
+      REQUIRES(!monitor_list_lock_, !Locks::mutator_lock_);
 
   typedef std::list<Monitor*, TrackingAllocator<Monitor*, kAllocatorTagMonitorList>> Monitors;
 
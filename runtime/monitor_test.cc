@@ -17,6 +17,7 @@
 #include "barrier.h"
 #include "monitor.h"
 
+#include <sstream>
 #include <string>
 
 #include "atomic.h"
@@ -24,6 +25,7 @@
 #include "class_linker-inl.h"
 #include "common_runtime_test.h"
 #include "handle_scope-inl.h"
+#include "lock_contention_profile.h"
 #include "mirror/class-inl.h"
 #include "mirror/string-inl.h"  // Strings are easiest to allocate
 #include "object_lock.h"
@@ -430,5 +432,165 @@ TEST_F(MonitorTest, TestTryLock) {
   thread_pool.StopWorkers(self);
 }
 
+class ContendTask : public Task {
+ public:
+  ContendTask(Handle<mirror::Object> obj, size_t iterations, size_t* counter)
+      : obj_(obj), iterations_(iterations), counter_(counter) {}
+
+  void Run(Thread* self) {
+    ScopedObjectAccess soa(self);
+    for (size_t i = 0; i != iterations_; ++i) {
+      ObjectLock<mirror::Object> lock(self, obj_);
+      // A short critical section, not atomic so that a broken lock shows in the count.
+      *counter_ = *counter_ + 1;
+    }
+  }
+
+  void Finalize() {
+    delete this;
+  }
+
+ private:
+  Handle<mirror::Object> obj_;
+  const size_t iterations_;
+  size_t* const counter_;
+};
+
+// Short critical sections on a contended fat lock, which contenders spin for.
+TEST_F(MonitorTest, ContendedFatLock) {
+  static constexpr size_t kIterations = 2000;
+  Thread* const self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<1> hs(self);
+  Handle<mirror::Object> obj(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "hello, world!")));
+  // Locking an object with a hash code inflates its lock.
+  obj->IdentityHashCode();
+  {
+    ObjectLock<mirror::Object> lock(self, obj);
+  }
+  ASSERT_EQ(LockWord::kFatLocked, obj->GetLockWord(false).GetState());
+
+  for (size_t num_threads = 2; num_threads <= 32; num_threads *= 2) {
+    size_t counter = 0;
+    {
+      ScopedThreadSuspension sts(self, kSuspended);
+      ThreadPool thread_pool("contention pool", num_threads);
+      for (size_t i = 0; i != num_threads; ++i) {
+        thread_pool.AddTask(self, new ContendTask(obj, kIterations, &counter));
+      }
+      thread_pool.StartWorkers(self);
+      thread_pool.Wait(self, /*do_work*/false, /*may_hold_locks*/false);
+      thread_pool.StopWorkers(self);
+    }
+    EXPECT_EQ(num_threads * kIterations, counter);
+  }
+}
+
+class MonitorContentionProfileTest : public MonitorTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    MonitorTest::SetUpRuntimeOptions(options);
+    options->push_back(std::make_pair("-Xlockcontentionprofile", nullptr));
+  }
+
+  // Returns the number of contended monitor enters in the runtime profile.
+  static uint64_t CountMonitorContentions() {
+    std::ostringstream oss;
+    LockContentionProfile::Current()->Dump(oss);
+    std::istringstream iss(oss.str());
+    uint64_t count = 0;
+    bool monitor_sites = false;
+    for (std::string line; std::getline(iss, line); ) {
+      if (line.find("  monitor: ") == 0) {
+        monitor_sites = true;
+      } else if (monitor_sites && line.find("    count=") == 0) {
+        count += strtoull(line.c_str() + strlen("    count="), nullptr, 10);
+        monitor_sites = false;
+      }
+    }
+    return count;
+  }
+};
+
+// Contended enters are profiled whether the contender blocks or gets the lock while spinning.
+TEST_F(MonitorContentionProfileTest, ContendedFatLock) {
+  static constexpr size_t kNumThreads = 4;
+  static constexpr size_t kIterations = 2000;
+  Thread* const self = Thread::Current();
+  ThreadPool thread_pool("contention pool", kNumThreads);
+  ScopedObjectAccess soa(self);
+  ASSERT_TRUE(LockContentionProfile::Current() != nullptr);
+  StackHandleScope<1> hs(self);
+  Handle<mirror::Object> obj(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "hello, world!")));
+  // Locking an object with a hash code inflates its lock.
+  obj->IdentityHashCode();
+  const uint64_t initial_count = CountMonitorContentions();
+
+  // The owner is suspended, so the contender blocks right away.
+  size_t counter = 0;
+  {
+    ObjectLock<mirror::Object> lock(self, obj);
+    ASSERT_EQ(LockWord::kFatLocked, obj->GetLockWord(false).GetState());
+    thread_pool.AddTask(self, new ContendTask(obj, 1, &counter));
+    ScopedThreadSuspension sts(self, kSuspended);
+    thread_pool.StartWorkers(self);
+    NanoSleep(MsToNs(10));
+  }
+  {
+    ScopedThreadSuspension sts(self, kSuspended);
+    thread_pool.Wait(self, /*do_work*/false, /*may_hold_locks*/false);
+  }
+  EXPECT_EQ(1u, counter);
+  const uint64_t blocked_count = CountMonitorContentions();
+  EXPECT_EQ(initial_count + 1, blocked_count);
+
+  // Short critical sections, most contenders get the lock while spinning.
+  for (size_t i = 0; i != kNumThreads; ++i) {
+    thread_pool.AddTask(self, new ContendTask(obj, kIterations, &counter));
+  }
+  {
+    ScopedThreadSuspension sts(self, kSuspended);
+    thread_pool.Wait(self, /*do_work*/false, /*may_hold_locks*/false);
+    thread_pool.StopWorkers(self);
+  }
+  EXPECT_EQ(1u + kNumThreads * kIterations, counter);
+  EXPECT_GT(CountMonitorContentions(), blocked_count);
+}
+
+TEST_F(MonitorTest, DeflateMonitorsConcurrently) {
+  Thread* const self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<2> hs(self);
+  Handle<mirror::Object> unused(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "hello, world!")));
+  Handle<mirror::Object> held(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "hello, world!")));
+  // Locking an object with a hash code inflates its lock.
+  const int32_t unused_hash_code = unused->IdentityHashCode();
+  {
+    ObjectLock<mirror::Object> lock(self, unused);
+  }
+  ASSERT_EQ(LockWord::kFatLocked, unused->GetLockWord(false).GetState());
+  held->IdentityHashCode();
+  ObjectLock<mirror::Object> lock(self, held);
+  ASSERT_EQ(LockWord::kFatLocked, held->GetLockWord(false).GetState());
+
+  size_t count;
+  {
+    ScopedThreadSuspension sts(self, kNative);
+    count = Runtime::Current()->GetMonitorList()->DeflateMonitorsConcurrently(self);
+  }
+  EXPECT_GE(count, 1u);
+  // The unused monitor is deflated to its hash code, the held one stays.
+  EXPECT_EQ(LockWord::kHashCode, unused->GetLockWord(false).GetState());
+  EXPECT_EQ(unused_hash_code, unused->IdentityHashCode());
+  EXPECT_EQ(LockWord::kFatLocked, held->GetLockWord(false).GetState());
+  {
+    ObjectLock<mirror::Object> relock(self, unused);
+    EXPECT_EQ(LockWord::kFatLocked, unused->GetLockWord(false).GetState());
+  }
+}
 
 }  // namespace art
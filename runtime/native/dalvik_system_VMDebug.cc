@@ -33,6 +33,7 @@
 #include "gc/space/zygote_space.h"
 #include "hprof/hprof.h"
 #include "jni_internal.h"
+#include "lock_contention_profile.h"
 #include "mirror/class.h"
 #include "ScopedLocalRef.h"
 #include "ScopedUtfChars.h"
@@ -358,6 +359,14 @@ static void VMDebug_getHeapSpaceStats(JNIEnv* env, jclass, jlongArray data) {
   env->ReleasePrimitiveArrayCritical(data, arr, 0);
 }
 
+// Empty if lock contention profiling (-Xlockcontentionprofile) is disabled.
+static void DumpLockContentionProfile(std::ostream& os) {
+  LockContentionProfile* profile = LockContentionProfile::Current();
+  if (profile != nullptr) {
+    profile->Dump(os);
+  }
+}
+
 // The runtime stat names for VMDebug.getRuntimeStat().
 enum class VMDebugRuntimeStatId {
   kArtGcGcCount = 0,
@@ -368,6 +377,7 @@ enum class VMDebugRuntimeStatId {
   kArtGcBlockingGcTime,
   kArtGcGcCountRateHistogram,
   kArtGcBlockingGcCountRateHistogram,
+  kArtLockContentionProfile,
   kNumRuntimeStats,
 };
 
@@ -408,6 +418,11 @@ static jobject VMDebug_getRuntimeStatInternal(JNIEnv* env, jclass, jint statId)
       heap->DumpBlockingGcCountRateHistogram(output);
       return env->NewStringUTF(output.str().c_str());
     }
+    case VMDebugRuntimeStatId::kArtLockContentionProfile: {
+      std::ostringstream output;
+      DumpLockContentionProfile(output);
+      return env->NewStringUTF(output.str().c_str());
+    }
     default:
       return nullptr;
   }
@@ -472,6 +487,14 @@ static jobjectArray VMDebug_getRuntimeStatsInternal(JNIEnv* env, jclass) {
       return nullptr;
     }
   }
+  {
+    std::ostringstream output;
+    DumpLockContentionProfile(output);
+    if (!SetRuntimeStatValue(env, result, VMDebugRuntimeStatId::kArtLockContentionProfile,
+                             output.str())) {
+      return nullptr;
+    }
+  }
   return result;
 }
 
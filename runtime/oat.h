@@ -32,7 +32,7 @@ class InstructionSetFeatures;
 class PACKED(4) OatHeader {
  public:
   static constexpr uint8_t kOatMagic[] = { 'o', 'a', 't', '\n' };
-  static constexpr uint8_t kOatVersion[] = { '0', '8', '8', '\0' };
+  static constexpr uint8_t kOatVersion[] = { '0', '8', '9', '\0' };
 
   static constexpr const char* kImageLocationKey = "image-location";
   static constexpr const char* kDex2OatCmdLineKey = "dex2oat-cmdline";
@@ -180,6 +180,35 @@ class PACKED(4) OatMethodOffsets {
   uint32_t code_offset_;
 };
 
+// Field layout and sizes of a class as linked by the compiler, stored in its OatClass so that
+// loading the class does not have to lay out its fields again. The layout only holds as long as
+// the super class has the same object size and the class has the same embedded vtable length at
+// runtime, the fields are laid out after them. It is followed by the offsets of the static fields
+// and then of the instance fields, in the order of the class data of the dex file.
+class PACKED(4) OatClassLinkSnapshot {
+ public:
+  const uint32_t* GetStaticFieldOffsets() const {
+    return reinterpret_cast<const uint32_t*>(this + 1);
+  }
+
+  const uint32_t* GetInstanceFieldOffsets() const {
+    return GetStaticFieldOffsets() + num_static_fields_;
+  }
+
+  size_t SizeOf() const {
+    return sizeof(*this) + (num_static_fields_ + num_instance_fields_) * sizeof(uint32_t);
+  }
+
+  uint32_t super_object_size_;
+  uint32_t embedded_vtable_length_;  // Zero if the class has no embedded vtable.
+  uint32_t object_size_;
+  uint32_t class_size_;
+  uint32_t num_static_fields_;
+  uint32_t num_instance_fields_;
+  uint32_t num_reference_static_fields_;
+  uint32_t num_reference_instance_fields_;
+};
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_OAT_H_
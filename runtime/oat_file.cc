@@ -1238,7 +1238,23 @@ OatFile::OatClass OatFile::OatDexFile::GetOatClass(uint16_t class_def_index) con
   OatClassType type = static_cast<OatClassType>(*reinterpret_cast<const uint16_t*>(type_pointer));
   CHECK_LT(type, kOatClassMax);
 
-  const uint8_t* after_type_pointer = type_pointer + sizeof(int16_t);
+  const uint8_t* link_snapshot_size_pointer = type_pointer + sizeof(int16_t);
+  CHECK_LE(link_snapshot_size_pointer + sizeof(uint32_t), oat_file_->End())
+      << oat_file_->GetLocation();
+  uint32_t link_snapshot_size = *reinterpret_cast<const uint32_t*>(link_snapshot_size_pointer);
+  const uint8_t* link_snapshot_pointer = link_snapshot_size_pointer + sizeof(link_snapshot_size);
+  // Compare sizes rather than pointers, a bad size must not wrap the snapshot end around.
+  CHECK_LE(link_snapshot_size, static_cast<size_t>(oat_file_->End() - link_snapshot_pointer))
+      << oat_file_->GetLocation();
+  const OatClassLinkSnapshot* link_snapshot = nullptr;
+  if (link_snapshot_size != 0u) {
+    // The header holds the field counts which SizeOf() reads.
+    CHECK_GE(link_snapshot_size, sizeof(OatClassLinkSnapshot)) << oat_file_->GetLocation();
+    link_snapshot = reinterpret_cast<const OatClassLinkSnapshot*>(link_snapshot_pointer);
+    CHECK_EQ(link_snapshot_size, link_snapshot->SizeOf()) << oat_file_->GetLocation();
+  }
+
+  const uint8_t* after_type_pointer = link_snapshot_pointer + link_snapshot_size;
   CHECK_LE(after_type_pointer, oat_file_->End()) << oat_file_->GetLocation();
 
   uint32_t bitmap_size = 0;
@@ -1261,7 +1277,8 @@ OatFile::OatClass OatFile::OatDexFile::GetOatClass(uint16_t class_def_index) con
                            type,
                            bitmap_size,
                            reinterpret_cast<const uint32_t*>(bitmap_pointer),
-                           reinterpret_cast<const OatMethodOffsets*>(methods_pointer));
+                           reinterpret_cast<const OatMethodOffsets*>(methods_pointer),
+                           link_snapshot);
 }
 
 OatFile::OatClass::OatClass(const OatFile* oat_file,
@@ -1269,9 +1286,10 @@ OatFile::OatClass::OatClass(const OatFile* oat_file,
                             OatClassType type,
                             uint32_t bitmap_size,
                             const uint32_t* bitmap_pointer,
-                            const OatMethodOffsets* methods_pointer)
+                            const OatMethodOffsets* methods_pointer,
+                            const OatClassLinkSnapshot* link_snapshot)
     : oat_file_(oat_file), status_(status), type_(type),
-      bitmap_(bitmap_pointer), methods_pointer_(methods_pointer) {
+      bitmap_(bitmap_pointer), methods_pointer_(methods_pointer), link_snapshot_(link_snapshot) {
     switch (type_) {
       case kOatClassAllCompiled: {
         CHECK_EQ(0U, bitmap_size);
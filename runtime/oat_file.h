@@ -200,11 +200,17 @@ class OatFile {
     // is present. Note that most callers should use GetOatMethod.
     uint32_t GetOatMethodOffsetsOffset(uint32_t method_index) const;
 
+    // Return the field layout computed by the compiler, or null if the compiler did not link the
+    // class. The ClassLinker still has to check that it holds before using it.
+    const OatClassLinkSnapshot* GetLinkSnapshot() const {
+      return link_snapshot_;
+    }
+
     // A representation of an invalid OatClass, used when an OatClass can't be found.
     // See ClassLinker::FindOatClass.
     static OatClass Invalid() {
       return OatClass(nullptr, mirror::Class::kStatusError, kOatClassNoneCompiled, 0, nullptr,
-                      nullptr);
+                      nullptr, nullptr);
     }
 
    private:
@@ -213,7 +219,8 @@ class OatFile {
              OatClassType type,
              uint32_t bitmap_size,
              const uint32_t* bitmap_pointer,
-             const OatMethodOffsets* methods_pointer);
+             const OatMethodOffsets* methods_pointer,
+             const OatClassLinkSnapshot* link_snapshot);
 
     const OatFile* const oat_file_;
 
@@ -225,6 +232,8 @@ class OatFile {
 
     const OatMethodOffsets* const methods_pointer_;
 
+    const OatClassLinkSnapshot* const link_snapshot_;
+
     friend class art::OatDexFile;
   };
   const OatDexFile* GetOatDexFile(const char* dex_location,
@@ -140,6 +140,8 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
           .IntoKey(M::IgnoreMaxFootprint)
       .Define("-XX:LowMemoryMode")
           .IntoKey(M::LowMemoryMode)
+      .Define("-XX:ConcurrentMonitorDeflation")
+          .IntoKey(M::ConcurrentMonitorDeflation)
       .Define("-XX:UseTLAB")
           .WithValue(true)
           .IntoKey(M::UseTLAB)
@@ -225,9 +227,15 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-Xlockprofthreshold:_")
           .WithType<unsigned int>()
           .IntoKey(M::LockProfThreshold)
+      .Define("-Xlockcontentionprofile")
+          .IntoKey(M::LockContentionProfile)
       .Define("-Xstacktracefile:_")
           .WithType<std::string>()
           .IntoKey(M::StackTraceFile)
+      .Define("-Xhprof-compress")
+          .IntoKey(M::HprofCompress)
+      .Define("-Xhprof-histogram")
+          .IntoKey(M::HprofHistogram)
       .Define("-Xmethod-trace")
           .IntoKey(M::MethodTrace)
       .Define("-Xmethod-trace-file:_")
@@ -238,6 +246,10 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
           .IntoKey(M::MethodTraceFileSize)
       .Define("-Xmethod-trace-stream")
           .IntoKey(M::MethodTraceStreaming)
+      .Define("-Xmethod-trace-thread-buffers")
+          .IntoKey(M::MethodTraceThreadBuffers)
+      .Define("-Xcheckpoint-sampling")
+          .IntoKey(M::CheckpointSampling)
       .Define("-Xprofile:_")
           .WithType<TraceClockSource>()
           .WithValueMap({{"threadcpuclock", TraceClockSource::kThreadCpu},
@@ -270,6 +282,12 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
                          {"all",      verifier::VerifyMode::kEnable},
                          {"softfail", verifier::VerifyMode::kSoftFail}})
           .IntoKey(M::Verify)
+      .Define("-Xverifiercachedir:_")
+          .WithType<std::string>()
+          .IntoKey(M::VerifierCacheDirectory)
+      .Define("-Xlazylinkthreshold:_")
+          .WithType<unsigned int>()
+          .IntoKey(M::LazyLinkThreshold)
       .Define("-XX:NativeBridge=_")
           .WithType<std::string>()
           .IntoKey(M::NativeBridge)
@@ -655,6 +673,8 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -Xzygote\n");
   UsageMessage(stream, "  -Xjnitrace:substring (eg NativeClass or nativeMethod)\n");
   UsageMessage(stream, "  -Xstacktracefile:<filename>\n");
+  UsageMessage(stream, "  -Xhprof-compress (Compress heap dump files with gzip)\n");
+  UsageMessage(stream, "  -Xhprof-histogram (Write class histograms instead of heap dumps)\n");
   UsageMessage(stream, "  -Xgc:[no]preverify\n");
   UsageMessage(stream, "  -Xgc:[no]postverify\n");
   UsageMessage(stream, "  -XX:HeapGrowthLimit=N\n");
@@ -686,6 +706,7 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -XX:DumpJITInfoOnShutdown\n");
   UsageMessage(stream, "  -XX:IgnoreMaxFootprint\n");
   UsageMessage(stream, "  -XX:UseTLAB\n");
+  UsageMessage(stream, "  -XX:ConcurrentMonitorDeflation\n");
   UsageMessage(stream, "  -XX:BackgroundGC=none\n");
   UsageMessage(stream, "  -XX:LargeObjectSpace={disabled,map,freelist}\n");
   UsageMessage(stream, "  -XX:LargeObjectThreshold=N\n");
@@ -693,6 +714,9 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -Xmethod-trace\n");
   UsageMessage(stream, "  -Xmethod-trace-file:filename");
   UsageMessage(stream, "  -Xmethod-trace-file-size:integervalue\n");
+  UsageMessage(stream, "  -Xmethod-trace-thread-buffers (Buffer trace events per thread)\n");
+  UsageMessage(stream, "  -Xcheckpoint-sampling (Sample without suspending all threads)\n");
+  UsageMessage(stream, "  -Xlockcontentionprofile (Profile lock contention, dumped on SIGQUIT)\n");
   UsageMessage(stream, "  -Xenable-profiler\n");
   UsageMessage(stream, "  -Xprofile-filename:filename\n");
   UsageMessage(stream, "  -Xprofile-period:integervalue\n");
@@ -719,6 +743,10 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -X[no]image-dex2oat (Whether to create and use a boot image)\n");
   UsageMessage(stream, "  -Xno-dex-file-fallback "
                        "(Don't fall back to dex files without oat files)\n");
+  UsageMessage(stream, "  -Xverifiercachedir:directory "
+                       "(Cache runtime verification results in the directory)\n");
+  UsageMessage(stream, "  -Xlazylinkthreshold:integervalue "
+                       "(Build the IMT of classes with at least this many methods lazily)\n");
   UsageMessage(stream, "  -Xexperimental:lambdas "
                        "(Enable new and experimental dalvik opcodes and semantics)\n");
   UsageMessage(stream, "\n");
@@ -72,9 +72,11 @@
 #include "fault_handler.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/heap.h"
+#include "gc/parallel_weak_sweep.h"
 #include "gc/space/image_space.h"
 #include "gc/space/space-inl.h"
 #include "handle_scope-inl.h"
+#include "hprof/hprof.h"
 #include "image-inl.h"
 #include "instrumentation.h"
 #include "intern_table.h"
@@ -82,6 +84,7 @@
 #include "jit/jit.h"
 #include "jni_internal.h"
 #include "linear_alloc.h"
+#include "lock_contention_profile.h"
 #include "lambda/box_table.h"
 #include "mirror/array.h"
 #include "mirror/class-inl.h"
@@ -464,12 +467,61 @@ void Runtime::CallExitHook(jint status) {
   }
 }
 
+// Sweeps one system weak table on a heap thread pool worker.
+class SweepSystemWeakTableTask : public SelfDeletingTask {
+ public:
+  explicit SweepSystemWeakTableTask(const std::function<void()>& sweep) : sweep_(sweep) {}
+
+  virtual void Run(Thread* self ATTRIBUTE_UNUSED) OVERRIDE {
+    sweep_();
+  }
+
+ private:
+  const std::function<void()> sweep_;
+};
+
 void Runtime::SweepSystemWeaks(IsMarkedVisitor* visitor) {
-  GetInternTable()->SweepInternTableWeaks(visitor);
-  GetMonitorList()->SweepMonitorList(visitor);
-  GetJavaVM()->SweepJniWeakGlobals(visitor);
-  GetHeap()->SweepAllocationRecords(visitor);
+  Thread* const self = Thread::Current();
+  gc::Heap* const heap = GetHeap();
+  ThreadPool* const thread_pool = heap->GetThreadPool();
+  const size_t thread_count =
+      heap->GetWeakProcessingThreadCount(Locks::mutator_lock_->IsExclusiveHeld(self));
+  if (thread_count <= 1) {
+    GetInternTable()->SweepInternTableWeaks(visitor);
+    GetMonitorList()->SweepMonitorList(visitor);
+    GetJavaVM()->SweepJniWeakGlobals(visitor);
+    heap->SweepAllocationRecords(visitor);
+    GetLambdaBoxTable()->SweepWeakBoxedLambdas(visitor);
+    return;
+  }
+  // The workers sweep the monitor list, the JNI weak globals and the allocation records while this
+  // thread sweeps the intern table and the lambda box table, which hash their entries and thus
+  // need the mutator lock. The large tables are split into chunks and the remaining helper tasks
+  // sweep chunks of them. For the intern table, the helpers only find the dead strings and update
+  // the moved ones, this thread erases the dead strings.
+  gc::ParallelWeakSweep intern_sweep;
+  gc::ParallelWeakSweep monitor_sweep;
+  gc::ParallelWeakSweep jni_weak_sweep;
+  thread_pool->AddTask(self, new SweepSystemWeakTableTask([&]() NO_THREAD_SAFETY_ANALYSIS {
+    GetMonitorList()->SweepMonitorList(visitor, &monitor_sweep);
+  }));
+  thread_pool->AddTask(self, new SweepSystemWeakTableTask([&]() NO_THREAD_SAFETY_ANALYSIS {
+    GetJavaVM()->SweepJniWeakGlobals(visitor, &jni_weak_sweep);
+  }));
+  thread_pool->AddTask(self, new SweepSystemWeakTableTask([&]() NO_THREAD_SAFETY_ANALYSIS {
+    heap->SweepAllocationRecords(visitor);
+  }));
+  for (gc::ParallelWeakSweep* sweep : { &monitor_sweep, &jni_weak_sweep, &intern_sweep }) {
+    for (size_t i = 0; i < thread_count - 1; ++i) {
+      thread_pool->AddTask(self, new ParallelForHelperTask(sweep));
+    }
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  thread_pool->StartWorkers(self);
+  GetInternTable()->SweepInternTableWeaks(visitor, &intern_sweep);
   GetLambdaBoxTable()->SweepWeakBoxedLambdas(visitor);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
 }
 
 bool Runtime::ParseOptions(const RuntimeOptions& raw_options,
@@ -1185,6 +1237,9 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
 
   Thread::SetSensitiveThreadHook(runtime_options.GetOrDefault(Opt::HookIsSensitiveThread));
   Monitor::Init(runtime_options.GetOrDefault(Opt::LockProfThreshold));
+  if (runtime_options.Exists(Opt::LockContentionProfile)) {
+    LockContentionProfile::Enable();
+  }
 
   boot_class_path_string_ = runtime_options.ReleaseOrDefault(Opt::BootClassPath);
   class_path_string_ = runtime_options.ReleaseOrDefault(Opt::ClassPath);
@@ -1277,7 +1332,8 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
                        xgc_option.verify_post_gc_rosalloc_,
                        xgc_option.gcstress_,
                        runtime_options.GetOrDefault(Opt::EnableHSpaceCompactForOOM),
-                       runtime_options.GetOrDefault(Opt::HSpaceCompactForOOMMinIntervalsMs));
+                       runtime_options.GetOrDefault(Opt::HSpaceCompactForOOMMinIntervalsMs),
+                       runtime_options.Exists(Opt::ConcurrentMonitorDeflation));
 
   if (!heap_->HasBootImageSpace() && !allow_dex_file_fallback_) {
     LOG(ERROR) << "Dex file fallback disabled, cannot continue without image.";
@@ -1398,6 +1454,10 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
 
   CHECK_GE(GetHeap()->GetContinuousSpaces().size(), 1U);
   class_linker_ = new ClassLinker(intern_table_);
+  if (runtime_options.Exists(Opt::VerifierCacheDirectory)) {
+    class_linker_->SetVerificationCacheDirectory(
+        runtime_options.GetOrDefault(Opt::VerifierCacheDirectory));
+  }
   if (GetHeap()->HasBootImageSpace()) {
     std::string error_msg;
     bool result = class_linker_->InitFromBootImage(&error_msg);
@@ -1467,6 +1527,10 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
   }
 
   CHECK(class_linker_ != nullptr);
+  const unsigned int lazy_link_threshold = runtime_options.GetOrDefault(Opt::LazyLinkThreshold);
+  if (lazy_link_threshold != 0u && !IsAotCompiler()) {
+    class_linker_->EnableLazyLinking(lazy_link_threshold);
+  }
 
   verifier::MethodVerifier::Init();
 
@@ -1502,6 +1566,17 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
 
   // TODO: move this to just be an Trace::Start argument
   Trace::SetDefaultClockSource(runtime_options.GetOrDefault(Opt::ProfileClock));
+  int default_trace_flags = 0;
+  if (runtime_options.Exists(Opt::MethodTraceThreadBuffers)) {
+    default_trace_flags |= Trace::kTraceThreadBuffers;
+  }
+  if (runtime_options.Exists(Opt::CheckpointSampling)) {
+    default_trace_flags |= Trace::kTraceCheckpointSampling;
+  }
+  Trace::SetDefaultFlags(default_trace_flags);
+
+  hprof_dump_options_.compress = runtime_options.Exists(Opt::HprofCompress);
+  hprof_dump_options_.histogram = runtime_options.Exists(Opt::HprofHistogram);
 
   // Pre-allocate an OutOfMemoryError for the double-OOME case.
   self->ThrowNewException("Ljava/lang/OutOfMemoryError;",
@@ -1678,6 +1753,9 @@ void Runtime::DumpForSigQuit(std::ostream& os) {
 
   thread_list_->DumpForSigQuit(os);
   BaseMutex::DumpAll(os);
+  if (LockContentionProfile::Current() != nullptr) {
+    LockContentionProfile::Current()->Dump(os);
+  }
 }
 
 void Runtime::DumpLockHolders(std::ostream& os) {
@@ -2016,6 +2094,15 @@ void Runtime::RegisterAppInfo(const std::vector<std::string>& code_paths,
                               const std::string& profile_output_filename,
                               const std::string& foreign_dex_profile_path,
                               const std::string& app_dir) {
+  if (!app_dir.empty() && !IsAotCompiler()) {
+    // Cache the results of verifying the app at runtime in its code cache directory, unless
+    // a directory was given on the command line.
+    std::string code_cache_dir = app_dir + "/code_cache";
+    if (OS::DirectoryExists(code_cache_dir.c_str())) {
+      class_linker_->SetVerificationCacheDirectory(code_cache_dir);
+    }
+  }
+
   if (jit_.get() == nullptr) {
     // We are not JITing. Nothing to do.
     return;
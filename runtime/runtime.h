@@ -30,6 +30,7 @@
 #include "base/macros.h"
 #include "experimental_flags.h"
 #include "gc_root.h"
+#include "hprof/hprof.h"
 #include "instrumentation.h"
 #include "jobject_comparator.h"
 #include "method_reference.h"
@@ -194,6 +195,11 @@ class Runtime {
     return profiler_options_;
   }
 
+  // The options of heap dumps not sent to DDMS, from -Xhprof-compress and -Xhprof-histogram.
+  const hprof::DumpOptions& GetHprofDumpOptions() const {
+    return hprof_dump_options_;
+  }
+
   // Starts a runtime, which may cause threads to be started and code to run.
   bool Start() UNLOCK_FUNCTION(Locks::mutator_lock_);
 
@@ -504,14 +510,10 @@ class Runtime {
                                  mirror::Object* value, bool is_volatile) const;
   void RecordWriteArray(mirror::Array* array, size_t index, uint64_t value) const
       SHARED_REQUIRES(Locks::mutator_lock_);
-  void RecordStrongStringInsertion(mirror::String* s) const
-      REQUIRES(Locks::intern_table_lock_);
-  void RecordWeakStringInsertion(mirror::String* s) const
-      REQUIRES(Locks::intern_table_lock_);
-  void RecordStrongStringRemoval(mirror::String* s) const
-      REQUIRES(Locks::intern_table_lock_);
-  void RecordWeakStringRemoval(mirror::String* s) const
-      REQUIRES(Locks::intern_table_lock_);
+  void RecordStrongStringInsertion(mirror::String* s) const;
+  void RecordWeakStringInsertion(mirror::String* s) const;
+  void RecordStrongStringRemoval(mirror::String* s) const;
+  void RecordWeakStringRemoval(mirror::String* s) const;
 
   void SetFaultMessage(const std::string& message) REQUIRES(!fault_message_lock_);
   // Only read by the signal handler, NO_THREAD_SAFETY_ANALYSIS to prevent lock order violations
@@ -789,6 +791,8 @@ class Runtime {
   std::string profile_output_filename_;
   ProfilerOptions profiler_options_;
 
+  hprof::DumpOptions hprof_dump_options_;
+
   std::unique_ptr<TraceConfig> trace_config_;
 
   instrumentation::Instrumentation instrumentation_;
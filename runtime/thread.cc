@@ -68,6 +68,7 @@
 #include "stack_map.h"
 #include "thread_list.h"
 #include "thread-inl.h"
+#include "trace.h"
 #include "utils.h"
 #include "verifier/method_verifier.h"
 #include "verify_object-inl.h"
@@ -1712,6 +1713,7 @@ void Thread::Destroy() {
       tlsPtr_.jni_env->DeleteGlobalRef(tlsPtr_.class_loader_override);
       tlsPtr_.class_loader_override = nullptr;
     }
+    tlsPtr_.jni_env->vm->ReleaseGlobalRefSlots(self);
   }
 
   if (tlsPtr_.opeer != nullptr) {
@@ -1795,6 +1797,7 @@ Thread::~Thread() {
   delete tlsPtr_.instrumentation_stack;
   delete tlsPtr_.name;
   delete tlsPtr_.stack_trace_sample;
+  delete tlsPtr_.trace_sample_buffer;
   free(tlsPtr_.nested_signal_state);
 
   Runtime::Current()->GetHeap()->AssertThreadLocalBuffersAreRevoked(this);
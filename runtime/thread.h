@@ -70,6 +70,7 @@ namespace mirror {
 
 namespace verifier {
 class MethodVerifier;
+class VerifierDeps;
 }  // namespace verifier
 
 class ArtMethod;
@@ -91,6 +92,8 @@ class SingleStepControl;
 class StackedShadowFrameRecord;
 class Thread;
 class ThreadList;
+class TraceEventBuffer;
+class TraceSampleBuffer;
 
 // Thread priorities. These must match the Thread.MIN_PRIORITY,
 // Thread.NORM_PRIORITY, and Thread.MAX_PRIORITY constants.
@@ -946,6 +949,22 @@ class Thread {
     tlsPtr_.stack_trace_sample = sample;
   }
 
+  TraceSampleBuffer* GetTraceSampleBuffer() const {
+    return tlsPtr_.trace_sample_buffer;
+  }
+
+  void SetTraceSampleBuffer(TraceSampleBuffer* buffer) {
+    tlsPtr_.trace_sample_buffer = buffer;
+  }
+
+  TraceEventBuffer* GetTraceEventBuffer() const {
+    return tlsPtr_.trace_event_buffer;
+  }
+
+  void SetTraceEventBuffer(TraceEventBuffer* buffer) {
+    tlsPtr_.trace_event_buffer = buffer;
+  }
+
   uint64_t GetTraceClockBase() const {
     return tls64_.trace_clock_base;
   }
@@ -1092,6 +1111,13 @@ class Thread {
   void PushVerifier(verifier::MethodVerifier* verifier);
   void PopVerifier(verifier::MethodVerifier* verifier);
 
+  verifier::VerifierDeps* GetVerifierDeps() const {
+    return tlsPtr_.verifier_deps;
+  }
+  void SetVerifierDeps(verifier::VerifierDeps* deps) {
+    tlsPtr_.verifier_deps = deps;
+  }
+
   void InitStringEntryPoints();
 
   void ModifyDebugDisallowReadBarrier(int8_t delta) {
@@ -1367,7 +1393,8 @@ class Thread {
       mterp_current_ibase(nullptr), mterp_default_ibase(nullptr), mterp_alt_ibase(nullptr),
       thread_local_alloc_stack_top(nullptr), thread_local_alloc_stack_end(nullptr),
       nested_signal_state(nullptr), flip_function(nullptr), method_verifier(nullptr),
-      thread_local_mark_stack(nullptr) {
+      thread_local_mark_stack(nullptr), verifier_deps(nullptr), trace_sample_buffer(nullptr),
+      trace_event_buffer(nullptr) {
       std::fill(held_mutexes, held_mutexes + kLockLevelCount, nullptr);
     }
 
@@ -1511,6 +1538,15 @@ class Thread {
 
     // Thread-local mark stack for the concurrent copying collector.
     gc::accounting::AtomicStack<mirror::Object>* thread_local_mark_stack;
+
+    // Dependencies recorded by the class verification running on this thread, if any.
+    verifier::VerifierDeps* verifier_deps;
+
+    // Stack samples recorded by the checkpoint sampling profiler, not yet collected.
+    TraceSampleBuffer* trace_sample_buffer;
+
+    // Method trace events recorded by this thread, owned by the trace.
+    TraceEventBuffer* trace_event_buffer;
   } tlsPtr_;
 
   // Guards the 'interrupted_' and 'wait_monitor_' members.
@@ -23,6 +23,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <sstream>
 
 #include "base/histogram-inl.h"
@@ -37,6 +38,7 @@
 #include "monitor.h"
 #include "scoped_thread_state_change.h"
 #include "thread.h"
+#include "thread_pool.h"
 #include "trace.h"
 #include "well_known_classes.h"
 
@@ -56,6 +58,12 @@ static constexpr uint64_t kThreadSuspendTimeoutMs = 30 * 1000;  // 30s.
 static constexpr useconds_t kThreadSuspendInitialSleepUs = 0;
 static constexpr useconds_t kThreadSuspendMaxYieldUs = 3000;
 static constexpr useconds_t kThreadSuspendMaxSleepUs = 5000;
+// How many threads get their suspend or checkpoint request per acquisition of the
+// thread_suspend_count_lock_. The threads which got their request can pass their suspend barrier
+// or run their checkpoint, which both need the lock, while we are requesting the other threads.
+static constexpr size_t kSuspendRequestBatchSize = 32;
+// Minimum number of suspended threads to use the helper pool for their checkpoints.
+static constexpr size_t kMinParallelCheckpointThreads = 8;
 
 // Whether we should try to dump the native stack of unattached threads. See commit ed8b723 for
 // some history.
@@ -67,6 +75,7 @@ ThreadList::ThreadList()
       debug_suspend_all_count_(0),
       unregistering_count_(0),
       suspend_all_historam_("suspend all histogram", 16, 64),
+      suspend_all_time_to_safepoint_ns_(0),
       long_suspend_(false) {
   CHECK(Monitor::IsValidLockWord(LockWord::FromThinLockId(kMaxThreadId, 1, 0U)));
 }
@@ -283,7 +292,7 @@ static void ThreadSuspendSleep(useconds_t delay_us) {
   }
 }
 
-size_t ThreadList::RunCheckpoint(Closure* checkpoint_function) {
+size_t ThreadList::RunCheckpoint(Closure* checkpoint_function, ThreadPool* helper_pool) {
   Thread* self = Thread::Current();
   Locks::mutator_lock_->AssertNotExclusiveHeld(self);
   Locks::thread_list_lock_->AssertNotHeld(self);
@@ -297,6 +306,7 @@ size_t ThreadList::RunCheckpoint(Closure* checkpoint_function) {
     MutexLock mu(self, *Locks::thread_list_lock_);
     MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
     count = list_.size();
+    size_t batch_count = 0;
     for (const auto& thread : list_) {
       if (thread != self) {
         while (true) {
@@ -315,6 +325,13 @@ size_t ThreadList::RunCheckpoint(Closure* checkpoint_function) {
             break;
           }
         }
+        if (++batch_count == kSuspendRequestBatchSize) {
+          // Let the requested threads run their checkpoints. The list cannot change since we hold
+          // the thread_list_lock_.
+          batch_count = 0;
+          Locks::thread_suspend_count_lock_->ExclusiveUnlock(self);
+          Locks::thread_suspend_count_lock_->ExclusiveLock(self);
+        }
       }
     }
   }
@@ -322,33 +339,18 @@ size_t ThreadList::RunCheckpoint(Closure* checkpoint_function) {
   // Run the checkpoint on ourself while we wait for threads to suspend.
   checkpoint_function->Run(self);
 
-  // Run the checkpoint on the suspended threads.
-  for (const auto& thread : suspended_count_modified_threads) {
-    if (!thread->IsSuspended()) {
-      if (ATRACE_ENABLED()) {
-        std::ostringstream oss;
-        thread->ShortDump(oss);
-        ATRACE_BEGIN((std::string("Waiting for suspension of thread ") + oss.str()).c_str());
-      }
-      // Busy wait until the thread is suspended.
-      const uint64_t start_time = NanoTime();
-      do {
-        ThreadSuspendSleep(kThreadSuspendInitialSleepUs);
-      } while (!thread->IsSuspended());
-      const uint64_t total_delay = NanoTime() - start_time;
-      // Shouldn't need to wait for longer than 1000 microseconds.
-      constexpr uint64_t kLongWaitThreshold = MsToNs(1);
-      ATRACE_END();
-      if (UNLIKELY(total_delay > kLongWaitThreshold)) {
-        LOG(WARNING) << "Long wait of " << PrettyDuration(total_delay) << " for "
-            << *thread << " suspension!";
-      }
-    }
-    // We know for sure that the thread is suspended at this point.
-    checkpoint_function->Run(thread);
-    {
-      MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
-      thread->ModifySuspendCount(self, -1, nullptr, false);
+  // Run the checkpoint on the suspended threads. The helpers only hold the mutator lock if we do,
+  // closures walking the stack need it.
+  if (helper_pool != nullptr &&
+      suspended_count_modified_threads.size() >= kMinParallelCheckpointThreads &&
+      Locks::mutator_lock_->IsSharedHeld(self)) {
+    RunCheckpointForSuspendedThreadsInParallel(self,
+                                               &suspended_count_modified_threads,
+                                               checkpoint_function,
+                                               helper_pool);
+  } else {
+    for (const auto& thread : suspended_count_modified_threads) {
+      RunCheckpointForSuspendedThread(self, thread, checkpoint_function);
     }
   }
 
@@ -362,6 +364,95 @@ size_t ThreadList::RunCheckpoint(Closure* checkpoint_function) {
   return count;
 }
 
+// Runs the checkpoints of suspended threads for a ParallelFor. Holds the mutator lock like the
+// thread which requested the checkpoint, which keeps holding it until the helpers are done, so this
+// never blocks.
+class SuspendedThreadCheckpointTask : public SelfDeletingTask {
+ public:
+  explicit SuspendedThreadCheckpointTask(ParallelFor* parallel) : parallel_(parallel) {}
+
+  virtual void Run(Thread* self) OVERRIDE {
+    ReaderMutexLock mu(self, *Locks::mutator_lock_);
+    parallel_->Help();
+  }
+
+ private:
+  ParallelFor* const parallel_;
+};
+
+void ThreadList::RunCheckpointForSuspendedThreadsInParallel(Thread* self,
+                                                            std::vector<Thread*>* threads,
+                                                            Closure* checkpoint_function,
+                                                            ThreadPool* helper_pool) {
+  Locks::mutator_lock_->AssertSharedHeld(self);
+  // The workers of the helper pool may be among the suspended threads. Run their checkpoints first
+  // and let them resume, otherwise a helper switching to runnable would wait for its own
+  // checkpoint.
+  auto it = std::partition(threads->begin(), threads->end(), [&](Thread* thread) {
+    return !helper_pool->HasWorker(thread);
+  });
+  for (auto helper_it = it; helper_it != threads->end(); ++helper_it) {
+    RunCheckpointForSuspendedThread(self, *helper_it, checkpoint_function);
+  }
+  if (it != threads->end()) {
+    threads->erase(it, threads->end());
+    MutexLock mu(self, *Locks::thread_suspend_count_lock_);
+    Thread::resume_cond_->Broadcast(self);
+  }
+
+  // The chunks are single suspended threads.
+  ParallelFor parallel;
+  const size_t num_helpers =
+      std::min(helper_pool->GetThreadCount(), threads->size() / kMinParallelCheckpointThreads);
+  for (size_t i = 0; i != num_helpers; ++i) {
+    helper_pool->AddTask(self, new SuspendedThreadCheckpointTask(&parallel));
+  }
+  const size_t max_active_workers = helper_pool->GetMaxActiveWorkers(self);
+  helper_pool->SetMaxActiveWorkers(num_helpers);
+  helper_pool->StartWorkers(self);
+  parallel.Run(threads->size(),
+               /* chunk_size */ 1,
+               [&](size_t begin, size_t end) NO_THREAD_SAFETY_ANALYSIS {
+    for (size_t i = begin; i != end; ++i) {
+      RunCheckpointForSuspendedThread(Thread::Current(), (*threads)[i], checkpoint_function);
+    }
+  });
+  helper_pool->Wait(self, /* do_work */ true, /* may_hold_locks */ true);
+  helper_pool->StopWorkers(self);
+  helper_pool->SetMaxActiveWorkers(max_active_workers);
+}
+
+void ThreadList::RunCheckpointForSuspendedThread(Thread* self,
+                                                 Thread* thread,
+                                                 Closure* checkpoint_function) {
+  if (!thread->IsSuspended()) {
+    if (ATRACE_ENABLED()) {
+      std::ostringstream oss;
+      thread->ShortDump(oss);
+      ATRACE_BEGIN((std::string("Waiting for suspension of thread ") + oss.str()).c_str());
+    }
+    // Busy wait until the thread is suspended.
+    const uint64_t start_time = NanoTime();
+    do {
+      ThreadSuspendSleep(kThreadSuspendInitialSleepUs);
+    } while (!thread->IsSuspended());
+    const uint64_t total_delay = NanoTime() - start_time;
+    // Shouldn't need to wait for longer than 1000 microseconds.
+    constexpr uint64_t kLongWaitThreshold = MsToNs(1);
+    ATRACE_END();
+    if (UNLIKELY(total_delay > kLongWaitThreshold)) {
+      LOG(WARNING) << "Long wait of " << PrettyDuration(total_delay) << " for "
+          << *thread << " suspension!";
+    }
+  }
+  // We know for sure that the thread is suspended at this point.
+  checkpoint_function->Run(thread);
+  {
+    MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
+    thread->ModifySuspendCount(self, -1, nullptr, false);
+  }
+}
+
 // Request that a checkpoint function be run on all active (non-suspended)
 // threads.  Returns the number of successful requests.
 size_t ThreadList::RunCheckpointOnRunnableThreads(Closure* checkpoint_function) {
@@ -405,13 +496,14 @@ size_t ThreadList::FlipThreadRoots(Closure* thread_flip_visitor,
   Locks::thread_suspend_count_lock_->AssertNotHeld(self);
   CHECK_NE(self->GetState(), kRunnable);
 
-  SuspendAllInternal(self, self, nullptr);
+  const uint64_t time_to_safepoint = SuspendAllInternal(self, self, nullptr);
 
   // Run the flip callback for the collector.
   Locks::mutator_lock_->ExclusiveLock(self);
   flip_callback->Run(self);
   Locks::mutator_lock_->ExclusiveUnlock(self);
   collector->RegisterPause(NanoTime() - start_time);
+  collector->GetHeap()->RecordTimeToSafepoint(time_to_safepoint);
 
   // Resume runnable threads.
   std::vector<Thread*> runnable_threads;
@@ -478,7 +570,7 @@ void ThreadList::SuspendAll(const char* cause, bool long_suspend) {
     ScopedTrace trace("Suspending mutator threads");
     const uint64_t start_time = NanoTime();
 
-    SuspendAllInternal(self, self);
+    const uint64_t time_to_safepoint = SuspendAllInternal(self, self);
     // All threads are known to have suspended (but a thread may still own the mutator lock)
     // Make sure this thread grabs exclusive access to the mutator lock and its protected data.
 #if HAVE_TIMED_RWLOCK
@@ -497,6 +589,7 @@ void ThreadList::SuspendAll(const char* cause, bool long_suspend) {
 #endif
 
     long_suspend_ = long_suspend;
+    suspend_all_time_to_safepoint_ns_ = time_to_safepoint;
 
     const uint64_t end_time = NanoTime();
     const uint64_t suspend_time = end_time - start_time;
@@ -523,10 +616,11 @@ void ThreadList::SuspendAll(const char* cause, bool long_suspend) {
 // Debugger thread might be set to kRunnable for a short period of time after the
 // SuspendAllInternal. This is safe because it will be set back to suspended state before
 // the SuspendAll returns.
-void ThreadList::SuspendAllInternal(Thread* self,
-                                    Thread* ignore1,
-                                    Thread* ignore2,
-                                    bool debug_suspend) {
+uint64_t ThreadList::SuspendAllInternal(Thread* self,
+                                        Thread* ignore1,
+                                        Thread* ignore2,
+                                        bool debug_suspend) {
+  const uint64_t start_time = NanoTime();
   Locks::mutator_lock_->AssertNotExclusiveHeld(self);
   Locks::thread_list_lock_->AssertNotHeld(self);
   Locks::thread_suspend_count_lock_->AssertNotHeld(self);
@@ -560,6 +654,7 @@ void ThreadList::SuspendAllInternal(Thread* self,
       ++debug_suspend_all_count_;
     pending_threads.StoreRelaxed(list_.size() - num_ignored);
     // Increment everybody's suspend count (except those that should be ignored).
+    size_t batch_count = 0;
     for (const auto& thread : list_) {
       if (thread == ignore1 || thread == ignore2) {
         continue;
@@ -592,6 +687,15 @@ void ThreadList::SuspendAllInternal(Thread* self,
         thread->ClearSuspendBarrier(&pending_threads);
         pending_threads.FetchAndSubSequentiallyConsistent(1);
       }
+
+      if (++batch_count == kSuspendRequestBatchSize) {
+        // Let the requested threads pass their suspend barriers while we request the others. As
+        // when the suspend barriers are full above, the list cannot change since we hold the
+        // thread_list_lock_ and attaching threads see the raised suspend_all_count_.
+        batch_count = 0;
+        Locks::thread_suspend_count_lock_->ExclusiveUnlock(self);
+        Locks::thread_suspend_count_lock_->ExclusiveLock(self);
+      }
     }
   }
 
@@ -627,6 +731,7 @@ void ThreadList::SuspendAllInternal(Thread* self,
       break;
     }
   }
+  return NanoTime() - start_time;
 }
 
 void ThreadList::ResumeAll() {
@@ -26,6 +26,7 @@
 
 #include <bitset>
 #include <list>
+#include <vector>
 
 namespace art {
 namespace gc {
@@ -35,6 +36,7 @@ namespace gc {
 }  // namespace gc
 class Closure;
 class Thread;
+class ThreadPool;
 class TimingLogger;
 
 class ThreadList {
@@ -69,6 +71,11 @@ class ThreadList {
                !Locks::thread_suspend_count_lock_,
                !Locks::mutator_lock_);
 
+  // Returns how long the last SuspendAll waited for the threads to reach their suspend barrier.
+  uint64_t GetSuspendAllTimeToSafepoint() const REQUIRES(Locks::mutator_lock_) {
+    return suspend_all_time_to_safepoint_ns_;
+  }
+
   // Suspend a thread using a peer, typically used by the debugger. Returns the thread on success,
   // else null. The peer is used to identify the thread to avoid races with the thread terminating.
   // If the thread should be suspended then value of request_suspension should be true otherwise
@@ -94,8 +101,11 @@ class ThreadList {
 
   // Run a checkpoint on threads, running threads are not suspended but run the checkpoint inside
   // of the suspend check. Returns how many checkpoints that are expected to run, including for
-  // already suspended threads for b/24191051.
-  size_t RunCheckpoint(Closure* checkpoint_function)
+  // already suspended threads for b/24191051. If `helper_pool` is not null and the caller holds the
+  // mutator lock, its idle workers help running the checkpoints of the suspended threads while
+  // holding the mutator lock too. The checkpoint function must then be safe to run on several
+  // threads at once, as it is for running threads anyway.
+  size_t RunCheckpoint(Closure* checkpoint_function, ThreadPool* helper_pool = nullptr)
       REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_);
 
   size_t RunCheckpointOnRunnableThreads(Closure* checkpoint_function)
@@ -158,8 +168,20 @@ class ThreadList {
 
   bool Contains(Thread* thread) REQUIRES(Locks::thread_list_lock_);
   bool Contains(pid_t tid) REQUIRES(Locks::thread_list_lock_);
-  size_t RunCheckpoint(Closure* checkpoint_function, bool includeSuspended)
-      REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_);
+  // Waits for `thread`, whose suspend count we raised, to suspend, runs the checkpoint on its
+  // behalf and lowers the suspend count again.
+  static void RunCheckpointForSuspendedThread(Thread* self,
+                                              Thread* thread,
+                                              Closure* checkpoint_function)
+      REQUIRES(!Locks::thread_suspend_count_lock_);
+
+  // Runs the checkpoints of the suspended threads on this thread and the helper pool, the caller
+  // holds the mutator lock.
+  static void RunCheckpointForSuspendedThreadsInParallel(Thread* self,
+                                                         std::vector<Thread*>* threads,
+                                                         Closure* checkpoint_function,
+                                                         ThreadPool* helper_pool)
+      REQUIRES(!Locks::thread_suspend_count_lock_);
 
   void DumpUnattachedThreads(std::ostream& os, bool dump_native_stack)
       REQUIRES(!Locks::thread_list_lock_);
@@ -169,10 +191,11 @@ class ThreadList {
   void WaitForOtherNonDaemonThreadsToExit()
       REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_);
 
-  void SuspendAllInternal(Thread* self,
-                          Thread* ignore1,
-                          Thread* ignore2 = nullptr,
-                          bool debug_suspend = false)
+  // Returns the time from the request until the last thread passed its suspend barrier.
+  uint64_t SuspendAllInternal(Thread* self,
+                              Thread* ignore1,
+                              Thread* ignore2 = nullptr,
+                              bool debug_suspend = false)
       REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_);
 
   void AssertThreadsAreSuspended(Thread* self, Thread* ignore1, Thread* ignore2 = nullptr)
@@ -194,6 +217,9 @@ class ThreadList {
   // by mutator lock ensures no thread can read when another thread is modifying it.
   Histogram<uint64_t> suspend_all_historam_ GUARDED_BY(Locks::mutator_lock_);
 
+  // The time to safepoint of the current suspend all, guarded like suspend_all_historam_.
+  uint64_t suspend_all_time_to_safepoint_ns_ GUARDED_BY(Locks::mutator_lock_);
+
   // Whether or not the current thread suspension is long.
   bool long_suspend_;
 
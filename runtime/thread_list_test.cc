@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "thread_list.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "art_method-inl.h"
+#include "atomic.h"
+#include "barrier.h"
+#include "base/mutex.h"
+#include "common_runtime_test.h"
+#include "scoped_thread_state_change.h"
+#include "stack.h"
+#include "thread-inl.h"
+#include "thread_pool.h"
+
+namespace art {
+
+class ThreadListTest : public CommonRuntimeTest {};
+
+// Records the threads it runs for and passes the barrier, like the checkpoints of the GC.
+class RecordingCheckpoint : public Closure {
+ public:
+  explicit RecordingCheckpoint(Barrier* barrier)
+      : lock_("recording checkpoint lock"), barrier_(barrier) {}
+
+  void Run(Thread* thread) OVERRIDE {
+    Thread* const self = Thread::Current();
+    {
+      MutexLock mu(self, lock_);
+      threads_.push_back(thread);
+    }
+    barrier_->Pass(self);
+  }
+
+  std::vector<Thread*> GetThreads() REQUIRES(!lock_) {
+    MutexLock mu(Thread::Current(), lock_);
+    return threads_;
+  }
+
+ private:
+  Mutex lock_;
+  std::vector<Thread*> threads_ GUARDED_BY(lock_);
+  Barrier* const barrier_;
+};
+
+class RunnableTask : public Task {
+ public:
+  explicit RunnableTask(AtomicInteger* count) : count_(count) {}
+
+  void Run(Thread* self) {
+    // Blocks if the checkpoint left the suspend count of the worker raised.
+    ScopedObjectAccess soa(self);
+    ++*count_;
+  }
+
+  void Finalize() {
+    delete this;
+  }
+
+ private:
+  AtomicInteger* const count_;
+};
+
+TEST_F(ThreadListTest, RunCheckpointWithHelperPool) {
+  // More suspended threads than fit in a batch of suspend requests.
+  static constexpr size_t kNumSuspendedThreads = 40;
+  static constexpr size_t kNumHelpers = 4;
+  Thread* const self = Thread::Current();
+  // Idle workers wait for tasks in native state, so their checkpoints are run on their behalf.
+  ThreadPool idle_pool("idle pool", kNumSuspendedThreads);
+  ThreadPool helper_pool("helper pool", kNumHelpers);
+  ThreadList* const thread_list = Runtime::Current()->GetThreadList();
+
+  Barrier barrier(0);
+  RecordingCheckpoint checkpoint(&barrier);
+  size_t count;
+  {
+    // The helpers are only used if we hold the mutator lock.
+    ScopedObjectAccess soa(self);
+    count = thread_list->RunCheckpoint(&checkpoint, &helper_pool);
+  }
+  EXPECT_EQ(kNumHelpers, helper_pool.GetMaxActiveWorkers(self));
+  {
+    ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+    barrier.Increment(self, count);
+  }
+
+  // The checkpoint ran once for every thread.
+  std::vector<Thread*> threads = checkpoint.GetThreads();
+  ASSERT_EQ(count, threads.size());
+  std::sort(threads.begin(), threads.end());
+  EXPECT_TRUE(std::adjacent_find(threads.begin(), threads.end()) == threads.end());
+  {
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    std::list<Thread*> list = thread_list->GetList();
+    EXPECT_EQ(list.size(), count);
+    for (Thread* thread : list) {
+      EXPECT_TRUE(std::binary_search(threads.begin(), threads.end(), thread)) << *thread;
+    }
+  }
+
+  // The suspend counts of the suspended threads, helpers included, were lowered again.
+  AtomicInteger runnable_count(0);
+  for (size_t i = 0; i != kNumSuspendedThreads; ++i) {
+    idle_pool.AddTask(self, new RunnableTask(&runnable_count));
+  }
+  for (size_t i = 0; i != kNumHelpers; ++i) {
+    helper_pool.AddTask(self, new RunnableTask(&runnable_count));
+  }
+  idle_pool.StartWorkers(self);
+  helper_pool.StartWorkers(self);
+  idle_pool.Wait(self, /* do_work */ false, /* may_hold_locks */ false);
+  helper_pool.Wait(self, /* do_work */ false, /* may_hold_locks */ false);
+  EXPECT_EQ(static_cast<int32_t>(kNumSuspendedThreads + kNumHelpers),
+            runnable_count.LoadSequentiallyConsistent());
+}
+
+// Walks the stack of the thread, like the root marking checkpoint of the GC.
+class StackWalkingCheckpoint : public Closure {
+ public:
+  explicit StackWalkingCheckpoint(Barrier* barrier) : barrier_(barrier) {}
+
+  void Run(Thread* thread) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    Thread* const self = Thread::Current();
+    // Like ArtMethod::GetAccessFlags in debug builds, which blocks if the thread running the
+    // checkpoint has its own suspend count raised.
+    if (!Locks::mutator_lock_->IsSharedHeld(self)) {
+      ScopedObjectAccess soa(self);
+      WalkStack(thread);
+    } else {
+      WalkStack(thread);
+    }
+    barrier_->Pass(self);
+  }
+
+ private:
+  class FrameVisitor : public StackVisitor {
+   public:
+    explicit FrameVisitor(Thread* thread) SHARED_REQUIRES(Locks::mutator_lock_)
+        : StackVisitor(thread, nullptr, StackVisitor::StackWalkKind::kIncludeInlinedFrames) {}
+
+    bool VisitFrame() OVERRIDE SHARED_REQUIRES(Locks::mutator_lock_) {
+      ArtMethod* const method = GetMethod();
+      if (!method->IsRuntimeMethod()) {
+        method->GetAccessFlags();
+      }
+      return true;
+    }
+  };
+
+  static void WalkStack(Thread* thread) SHARED_REQUIRES(Locks::mutator_lock_) {
+    FrameVisitor visitor(thread);
+    visitor.WalkStack();
+  }
+
+  Barrier* const barrier_;
+};
+
+TEST_F(ThreadListTest, StackWalkingCheckpointWithHelperPool) {
+  static constexpr size_t kNumSuspendedThreads = 40;
+  static constexpr size_t kNumHelpers = 4;
+  Thread* const self = Thread::Current();
+  ThreadPool idle_pool("idle pool", kNumSuspendedThreads);
+  ThreadPool helper_pool("helper pool", kNumHelpers);
+  ThreadList* const thread_list = Runtime::Current()->GetThreadList();
+
+  // The workers of the helper pool are suspended threads too, their checkpoints must have run and
+  // their suspend counts lowered before they help.
+  Barrier barrier(0);
+  StackWalkingCheckpoint checkpoint(&barrier);
+  size_t count;
+  {
+    ScopedObjectAccess soa(self);
+    count = thread_list->RunCheckpoint(&checkpoint, &helper_pool);
+  }
+  {
+    ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+    barrier.Increment(self, count);
+  }
+  EXPECT_EQ(kNumHelpers, helper_pool.GetMaxActiveWorkers(self));
+}
+
+}  // namespace art
@@ -88,6 +88,7 @@ void* ThreadPoolWorker::Callback(void* arg) {
                                      true,
                                      nullptr,
                                      worker->thread_pool_->create_peers_));
+  worker->thread_ = Thread::Current();
   // Thread pool workers cannot call into java.
   Thread::Current()->SetCanCallIntoJava(false);
   // Do work until its time to shut down.
@@ -141,6 +142,20 @@ void ThreadPool::SetMaxActiveWorkers(size_t threads) {
   max_active_workers_ = threads;
 }
 
+size_t ThreadPool::GetMaxActiveWorkers(Thread* self) {
+  MutexLock mu(self, task_queue_lock_);
+  return max_active_workers_;
+}
+
+bool ThreadPool::HasWorker(Thread* thread) const {
+  for (ThreadPoolWorker* worker : threads_) {
+    if (worker->thread_ == thread) {
+      return true;
+    }
+  }
+  return false;
+}
+
 ThreadPool::~ThreadPool() {
   {
     Thread* self = Thread::Current();
@@ -17,9 +17,14 @@
 #ifndef ART_RUNTIME_THREAD_POOL_H_
 #define ART_RUNTIME_THREAD_POOL_H_
 
+#include <sched.h>
+
+#include <algorithm>
 #include <deque>
+#include <functional>
 #include <vector>
 
+#include "atomic.h"
 #include "barrier.h"
 #include "base/mutex.h"
 #include "mem_map.h"
@@ -71,6 +76,8 @@ class ThreadPoolWorker {
   const std::string name_;
   std::unique_ptr<MemMap> stack_;
   pthread_t pthread_;
+  // Set once the worker is attached, before the thread pool constructor returns.
+  Thread* thread_ = nullptr;
 
  private:
   friend class ThreadPool;
@@ -122,6 +129,11 @@ class ThreadPool {
   // thread count of the thread pool.
   void SetMaxActiveWorkers(size_t threads) REQUIRES(!task_queue_lock_);
 
+  size_t GetMaxActiveWorkers(Thread* self) REQUIRES(!task_queue_lock_);
+
+  // Returns true if the thread is one of the workers of this thread pool.
+  bool HasWorker(Thread* thread) const;
+
   // Set the "nice" priorty for threads in the pool.
   void SetPthreadPriority(int priority);
 
@@ -166,6 +178,85 @@ class ThreadPool {
   DISALLOW_COPY_AND_ASSIGN(ThreadPool);
 };
 
+// Splits a range of items into chunks which are processed by an owner thread, together with
+// helper tasks running on a thread pool meanwhile. The owner calls Run and only returns once every
+// chunk is processed, so the visitor may rely on the state (e.g. locks) of the owner. A helper
+// which runs before the owner started or after it finished does nothing, so helpers never wait
+// for the owner to be scheduled.
+class ParallelFor {
+ public:
+  // Processes items [begin, end).
+  typedef std::function<void(size_t, size_t)> ChunkVisitor;
+
+  ParallelFor()
+      : started_(false), next_chunk_(0), active_helpers_(0), num_items_(0), chunk_size_(1) {}
+
+  // Called by the owner. Processes all the items, using the helpers which are running
+  // concurrently, and returns once all of them are processed.
+  void Run(size_t num_items, size_t chunk_size, const ChunkVisitor& visitor) {
+    DCHECK_NE(chunk_size, 0u);
+    num_items_ = num_items;
+    chunk_size_ = chunk_size;
+    visitor_ = &visitor;
+    started_.StoreRelease(true);
+    ProcessChunks();
+    // No chunk is left to claim, wait for the helpers still processing their last chunk.
+    while (active_helpers_.LoadSequentiallyConsistent() != 0) {
+      sched_yield();
+    }
+  }
+
+  // Called by helper tasks.
+  void Help() {
+    // Give the owner a short chance to start, it may be blocked on a lock.
+    for (size_t i = 0; !started_.LoadAcquire(); ++i) {
+      if (i == kMaxHelperSpins) {
+        return;
+      }
+      sched_yield();
+    }
+    active_helpers_.FetchAndAddSequentiallyConsistent(1);
+    ProcessChunks();
+    active_helpers_.FetchAndSubSequentiallyConsistent(1);
+  }
+
+ private:
+  static constexpr size_t kMaxHelperSpins = 100;
+
+  void ProcessChunks() {
+    while (true) {
+      const size_t begin = next_chunk_.FetchAndAddSequentiallyConsistent(1) * chunk_size_;
+      if (begin >= num_items_) {
+        return;
+      }
+      (*visitor_)(begin, std::min(begin + chunk_size_, num_items_));
+    }
+  }
+
+  Atomic<bool> started_;
+  Atomic<size_t> next_chunk_;
+  Atomic<size_t> active_helpers_;
+  // Only written by the owner before started_ is set.
+  size_t num_items_;
+  size_t chunk_size_;
+  const ChunkVisitor* visitor_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelFor);
+};
+
+// Helper task for a ParallelFor.
+class ParallelForHelperTask : public SelfDeletingTask {
+ public:
+  explicit ParallelForHelperTask(ParallelFor* parallel) : parallel_(parallel) {}
+
+  virtual void Run(Thread* self ATTRIBUTE_UNUSED) OVERRIDE {
+    parallel_->Help();
+  }
+
+ private:
+  ParallelFor* const parallel_;
+};
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_THREAD_POOL_H_
@@ -20,6 +20,7 @@
 #include <unistd.h>
 
 #include "art_method-inl.h"
+#include "barrier.h"
 #include "base/casts.h"
 #include "base/stl_util.h"
 #include "base/systrace.h"
@@ -56,6 +57,10 @@ class BuildStackTraceVisitor : public StackVisitor {
       : StackVisitor(thread, nullptr, StackVisitor::StackWalkKind::kIncludeInlinedFrames),
         method_trace_(Trace::AllocStackTrace()) {}
 
+  BuildStackTraceVisitor(Thread* thread, std::vector<ArtMethod*>* method_trace)
+      : StackVisitor(thread, nullptr, StackVisitor::StackWalkKind::kIncludeInlinedFrames),
+        method_trace_(method_trace) {}
+
   bool VisitFrame() SHARED_REQUIRES(Locks::mutator_lock_) {
     ArtMethod* m = GetMethod();
     // Ignore runtime frames (in particular callee save).
@@ -83,11 +88,16 @@ static const uint16_t kTraceVersionSingleClock    = 2;
 static const uint16_t kTraceVersionDualClock      = 3;
 static const uint16_t kTraceRecordSizeSingleClock = 10;  // using v2
 static const uint16_t kTraceRecordSizeDualClock   = 14;  // using v3 with two timestamps
+static constexpr size_t kStreamingPacketSize      = 14U;  // The maximum size of data in a packet.
+// How often the writer thread flushes the per-thread buffers of a kTraceThreadBuffers trace.
+static constexpr useconds_t kTraceWriterIntervalUs = 2000;
 
 TraceClockSource Trace::default_clock_source_ = kDefaultTraceClockSource;
+int Trace::default_flags_ = 0;
 
 Trace* volatile Trace::the_trace_ = nullptr;
 pthread_t Trace::sampling_pthread_ = 0U;
+pthread_t Trace::writer_pthread_ = 0U;
 std::unique_ptr<std::vector<ArtMethod*>> Trace::temp_stack_trace_;
 
 // The key identifying the tracer to update instrumentation.
@@ -144,6 +154,10 @@ void Trace::SetDefaultClockSource(TraceClockSource clock_source) {
 #endif
 }
 
+void Trace::SetDefaultFlags(int flags) {
+  default_flags_ = flags;
+}
+
 static uint16_t GetTraceVersion(TraceClockSource clock_source) {
   return (clock_source == TraceClockSource::kDual) ? kTraceVersionDualClock
                                                     : kTraceVersionSingleClock;
@@ -232,18 +246,112 @@ static void ClearThreadStackTraceAndClockBase(Thread* thread, void* arg ATTRIBUT
   std::vector<ArtMethod*>* stack_trace = thread->GetStackTraceSample();
   thread->SetStackTraceSample(nullptr);
   delete stack_trace;
+  TraceSampleBuffer* sample_buffer = thread->GetTraceSampleBuffer();
+  thread->SetTraceSampleBuffer(nullptr);
+  delete sample_buffer;
+}
+
+static void ClearThreadEventBuffer(Thread* thread, void* arg ATTRIBUTE_UNUSED) {
+  // The buffer is owned by the trace.
+  thread->SetTraceEventBuffer(nullptr);
+}
+
+static void CollectThreadSamples(Thread* thread, void* arg) SHARED_REQUIRES(Locks::mutator_lock_) {
+  reinterpret_cast<Trace*>(arg)->CollectSamples(thread);
+}
+
+// A closure run by the threads in a checkpoint, recording their own stack.
+class TraceSampleCheckpoint FINAL : public Closure {
+ public:
+  explicit TraceSampleCheckpoint(Trace* trace) : trace_(trace), barrier_(0) {}
+
+  void Run(Thread* thread) OVERRIDE {
+    Thread* self = Thread::Current();
+    {
+      ScopedObjectAccess soa(self);
+      trace_->RecordSample(thread);
+    }
+    barrier_.Pass(self);
+  }
+
+  void WaitForThreadsToRunThroughCheckpoint(size_t threads_running_checkpoint) {
+    Thread* self = Thread::Current();
+    ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+    barrier_.Increment(self, threads_running_checkpoint);
+  }
+
+ private:
+  Trace* const trace_;
+  // The barrier to be passed through and for the sampling thread to wait upon.
+  Barrier barrier_;
+};
+
+void Trace::RecordSample(Thread* thread) {
+  TraceSampleBuffer* buffer = thread->GetTraceSampleBuffer();
+  if (UNLIKELY(buffer == nullptr)) {
+    buffer = new TraceSampleBuffer();
+    thread->SetTraceSampleBuffer(buffer);
+  }
+  TraceSampleBuffer::Sample* sample = buffer->BeginWrite();
+  if (sample == nullptr) {
+    // The sampling thread has not collected the previous samples yet, drop this one.
+    return;
+  }
+  BuildStackTraceVisitor build_trace_visitor(thread, &sample->stack_trace);
+  build_trace_visitor.WalkStack();
+  ReadClocks(thread, &sample->thread_clock_diff, &sample->wall_clock_diff);
+  buffer->EndWrite();
+}
+
+void Trace::CollectSamples(Thread* thread) {
+  TraceSampleBuffer* buffer = thread->GetTraceSampleBuffer();
+  if (buffer == nullptr) {
+    return;
+  }
+  for (TraceSampleBuffer::Sample* sample = buffer->BeginRead();
+       sample != nullptr;
+       sample = buffer->BeginRead()) {
+    // Hand the recorded vector over to the trace and leave a cleared one for the next sample.
+    std::vector<ArtMethod*>* stack_trace = AllocStackTrace();
+    stack_trace->swap(sample->stack_trace);
+    const uint32_t thread_clock_diff = sample->thread_clock_diff;
+    const uint32_t wall_clock_diff = sample->wall_clock_diff;
+    buffer->EndRead();
+    CompareAndUpdateStackTrace(thread, stack_trace, thread_clock_diff, wall_clock_diff);
+  }
+}
+
+void Trace::SampleWithCheckpoint(Thread* self) {
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  // Suspended threads cannot change their managed stack, their last sample is still current.
+  TraceSampleCheckpoint checkpoint(this);
+  const size_t threads_running_checkpoint =
+      thread_list->RunCheckpointOnRunnableThreads(&checkpoint);
+  if (threads_running_checkpoint != 0) {
+    checkpoint.WaitForThreadsToRunThroughCheckpoint(threads_running_checkpoint);
+  }
+  ScopedObjectAccess soa(self);
+  MutexLock mu(self, *Locks::thread_list_lock_);
+  thread_list->ForEach(CollectThreadSamples, this);
 }
 
 void Trace::CompareAndUpdateStackTrace(Thread* thread,
                                        std::vector<ArtMethod*>* stack_trace) {
-  CHECK_EQ(pthread_self(), sampling_pthread_);
-  std::vector<ArtMethod*>* old_stack_trace = thread->GetStackTraceSample();
-  // Update the thread's stack trace sample.
-  thread->SetStackTraceSample(stack_trace);
   // Read timer clocks to use for all events in this trace.
   uint32_t thread_clock_diff = 0;
   uint32_t wall_clock_diff = 0;
   ReadClocks(thread, &thread_clock_diff, &wall_clock_diff);
+  CompareAndUpdateStackTrace(thread, stack_trace, thread_clock_diff, wall_clock_diff);
+}
+
+void Trace::CompareAndUpdateStackTrace(Thread* thread,
+                                       std::vector<ArtMethod*>* stack_trace,
+                                       uint32_t thread_clock_diff,
+                                       uint32_t wall_clock_diff) {
+  CHECK_EQ(pthread_self(), sampling_pthread_);
+  std::vector<ArtMethod*>* old_stack_trace = thread->GetStackTraceSample();
+  // Update the thread's stack trace sample.
+  thread->SetStackTraceSample(stack_trace);
   if (old_stack_trace == nullptr) {
     // If there's no previous stack trace sample for this thread, log an entry event for all
     // methods in the trace.
@@ -294,7 +402,9 @@ void* Trace::RunSamplingThread(void* arg) {
         break;
       }
     }
-    {
+    if ((the_trace->flags_ & kTraceCheckpointSampling) != 0) {
+      the_trace->SampleWithCheckpoint(self);
+    } else {
       ScopedSuspendAll ssa(__FUNCTION__);
       MutexLock mu(self, *Locks::thread_list_lock_);
       runtime->GetThreadList()->ForEach(GetSample, the_trace);
@@ -305,6 +415,30 @@ void* Trace::RunSamplingThread(void* arg) {
   return nullptr;
 }
 
+void* Trace::RunWriterThread(void* arg ATTRIBUTE_UNUSED) {
+  Runtime* runtime = Runtime::Current();
+  CHECK(runtime->AttachCurrentThread("Method Trace Writer", true, runtime->GetSystemThreadGroup(),
+                                     !runtime->IsAotCompiler()));
+  Thread* self = Thread::Current();
+  while (true) {
+    usleep(kTraceWriterIntervalUs);
+    ScopedTrace trace("Method trace flush");
+    Trace* the_trace;
+    {
+      MutexLock mu(self, *Locks::trace_lock_);
+      the_trace = the_trace_;
+      if (the_trace == nullptr) {
+        break;
+      }
+    }
+    ScopedObjectAccess soa(self);
+    the_trace->FlushEventBuffers(self, nullptr);
+  }
+
+  runtime->DetachCurrentThread();
+  return nullptr;
+}
+
 void Trace::Start(const char* trace_filename, int trace_fd, size_t buffer_size, int flags,
                   TraceOutputMode output_mode, TraceMode trace_mode, int interval_us) {
   Thread* self = Thread::Current();
@@ -358,6 +492,7 @@ void Trace::Start(const char* trace_filename, int trace_fd, size_t buffer_size,
       LOG(ERROR) << "Trace already in progress, ignoring this request";
     } else {
       enable_stats = (flags && kTraceCountAllocs) != 0;
+      flags |= default_flags_;
       the_trace_ = new Trace(trace_file.release(), trace_filename, buffer_size, flags, output_mode,
                              trace_mode);
       if (trace_mode == TraceMode::kSampling) {
@@ -372,6 +507,10 @@ void Trace::Start(const char* trace_filename, int trace_fd, size_t buffer_size,
                                                    instrumentation::Instrumentation::kMethodUnwind);
         // TODO: In full-PIC mode, we don't need to fully deopt.
         runtime->GetInstrumentation()->EnableMethodTracing(kTracerInstrumentationKey);
+        if ((flags & kTraceThreadBuffers) != 0) {
+          CHECK_PTHREAD_CALL(pthread_create, (&writer_pthread_, nullptr, &RunWriterThread, nullptr),
+                             "Method trace writer thread");
+        }
       }
     }
   }
@@ -388,6 +527,7 @@ void Trace::StopTracing(bool finish_tracing, bool flush_file) {
   Trace* the_trace = nullptr;
   Thread* const self = Thread::Current();
   pthread_t sampling_pthread = 0U;
+  pthread_t writer_pthread = 0U;
   {
     MutexLock mu(self, *Locks::trace_lock_);
     if (the_trace_ == nullptr) {
@@ -396,15 +536,20 @@ void Trace::StopTracing(bool finish_tracing, bool flush_file) {
       the_trace = the_trace_;
       the_trace_ = nullptr;
       sampling_pthread = sampling_pthread_;
+      writer_pthread = writer_pthread_;
     }
   }
   // Make sure that we join before we delete the trace since we don't want to have
   // the sampling thread access a stale pointer. This finishes since the sampling thread exits when
-  // the_trace_ is null.
+  // the_trace_ is null. The same holds for the writer thread.
   if (sampling_pthread != 0U) {
     CHECK_PTHREAD_CALL(pthread_join, (sampling_pthread, nullptr), "sampling thread shutdown");
     sampling_pthread_ = 0U;
   }
+  if (writer_pthread != 0U) {
+    CHECK_PTHREAD_CALL(pthread_join, (writer_pthread, nullptr), "trace writer thread shutdown");
+    writer_pthread_ = 0U;
+  }
 
   {
     gc::ScopedGCCriticalSection gcs(self,
@@ -413,6 +558,12 @@ void Trace::StopTracing(bool finish_tracing, bool flush_file) {
     ScopedSuspendAll ssa(__FUNCTION__);
     if (the_trace != nullptr) {
       stop_alloc_counting = (the_trace->flags_ & Trace::kTraceCountAllocs) != 0;
+      if ((the_trace->flags_ & Trace::kTraceThreadBuffers) != 0) {
+        // Write the events left in the thread buffers and detach the buffers from the threads.
+        the_trace->FlushEventBuffers(self, nullptr);
+        MutexLock mu(self, *Locks::thread_list_lock_);
+        runtime->GetThreadList()->ForEach(ClearThreadEventBuffer, nullptr);
+      }
       if (finish_tracing) {
         the_trace->FinishTracing();
       }
@@ -472,6 +623,7 @@ void Trace::Pause() {
 
   Thread* const self = Thread::Current();
   pthread_t sampling_pthread = 0U;
+  pthread_t writer_pthread = 0U;
   {
     MutexLock mu(self, *Locks::trace_lock_);
     if (the_trace_ == nullptr) {
@@ -480,16 +632,23 @@ void Trace::Pause() {
     } else {
       the_trace = the_trace_;
       sampling_pthread = sampling_pthread_;
+      writer_pthread = writer_pthread_;
     }
   }
 
-  if (sampling_pthread != 0U) {
+  if (sampling_pthread != 0U || writer_pthread != 0U) {
     {
       MutexLock mu(self, *Locks::trace_lock_);
       the_trace_ = nullptr;
     }
-    CHECK_PTHREAD_CALL(pthread_join, (sampling_pthread, nullptr), "sampling thread shutdown");
-    sampling_pthread_ = 0U;
+    if (sampling_pthread != 0U) {
+      CHECK_PTHREAD_CALL(pthread_join, (sampling_pthread, nullptr), "sampling thread shutdown");
+      sampling_pthread_ = 0U;
+    }
+    if (writer_pthread != 0U) {
+      CHECK_PTHREAD_CALL(pthread_join, (writer_pthread, nullptr), "trace writer thread shutdown");
+      writer_pthread_ = 0U;
+    }
     {
       MutexLock mu(self, *Locks::trace_lock_);
       the_trace_ = the_trace;
@@ -556,6 +715,10 @@ void Trace::Resume() {
                                                  instrumentation::Instrumentation::kMethodUnwind);
       // TODO: In full-PIC mode, we don't need to fully deopt.
       runtime->GetInstrumentation()->EnableMethodTracing(kTracerInstrumentationKey);
+      if ((the_trace->flags_ & kTraceThreadBuffers) != 0) {
+        CHECK_PTHREAD_CALL(pthread_create, (&writer_pthread_, nullptr, &RunWriterThread, nullptr),
+                           "Method trace writer thread");
+      }
     }
   }
 
@@ -592,7 +755,8 @@ Trace::Trace(File* trace_file, const char* trace_name, size_t buffer_size, int f
       buffer_size_(std::max(kMinBufSize, buffer_size)),
       start_time_(MicroTime()), clock_overhead_ns_(GetClockOverheadNanoSeconds()), cur_offset_(0),
       overflow_(false), interval_us_(0), streaming_lock_(nullptr),
-      unique_methods_lock_(new Mutex("unique methods lock", kTracingUniqueMethodsLock)) {
+      unique_methods_lock_(new Mutex("unique methods lock", kTracingUniqueMethodsLock)),
+      flush_lock_(new Mutex("trace flush lock", kTracingFlushLock)) {
   uint16_t trace_version = GetTraceVersion(clock_source_);
   if (output_mode == TraceOutputMode::kStreaming) {
     trace_version |= 0xF0U;
@@ -622,6 +786,7 @@ Trace::Trace(File* trace_file, const char* trace_name, size_t buffer_size, int f
 Trace::~Trace() {
   delete streaming_lock_;
   delete unique_methods_lock_;
+  delete flush_lock_;
 }
 
 static uint64_t ReadBytes(uint8_t* buf, size_t bytes) {
@@ -866,8 +1031,7 @@ bool Trace::RegisterMethod(ArtMethod* method) {
   return false;
 }
 
-bool Trace::RegisterThread(Thread* thread) {
-  pid_t tid = thread->GetTid();
+bool Trace::RegisterThread(pid_t tid) {
   CHECK_LT(0U, static_cast<uint32_t>(tid));
   CHECK_LT(static_cast<uint32_t>(tid), 65536U);
 
@@ -912,9 +1076,30 @@ void Trace::WriteToBuf(const uint8_t* src, size_t src_size) {
   memcpy(buf_.get() + old_offset, src, src_size);
 }
 
+static TraceAction GetTraceAction(instrumentation::Instrumentation::InstrumentationEvent event) {
+  switch (event) {
+    case instrumentation::Instrumentation::kMethodEntered:
+      return kTraceMethodEnter;
+    case instrumentation::Instrumentation::kMethodExited:
+      return kTraceMethodExit;
+    case instrumentation::Instrumentation::kMethodUnwind:
+      return kTraceUnroll;
+    default:
+      UNIMPLEMENTED(FATAL) << "Unexpected event: " << event;
+      UNREACHABLE();
+  }
+}
+
 void Trace::LogMethodTraceEvent(Thread* thread, ArtMethod* method,
                                 instrumentation::Instrumentation::InstrumentationEvent event,
                                 uint32_t thread_clock_diff, uint32_t wall_clock_diff) {
+  if ((flags_ & kTraceThreadBuffers) != 0) {
+    TraceEventBuffer::Event buffered_event = {
+        method, GetTraceAction(event), thread_clock_diff, wall_clock_diff };
+    LogBufferedEvent(thread, buffered_event);
+    return;
+  }
+
   // Advance cur_offset_ atomically.
   int32_t new_offset;
   int32_t old_offset = 0;
@@ -931,34 +1116,37 @@ void Trace::LogMethodTraceEvent(Thread* thread, ArtMethod* method,
     } while (!cur_offset_.CompareExchangeWeakSequentiallyConsistent(old_offset, new_offset));
   }
 
-  TraceAction action = kTraceMethodEnter;
-  switch (event) {
-    case instrumentation::Instrumentation::kMethodEntered:
-      action = kTraceMethodEnter;
-      break;
-    case instrumentation::Instrumentation::kMethodExited:
-      action = kTraceMethodExit;
-      break;
-    case instrumentation::Instrumentation::kMethodUnwind:
-      action = kTraceUnroll;
-      break;
-    default:
-      UNIMPLEMENTED(FATAL) << "Unexpected event: " << event;
-  }
-
-  uint32_t method_value = EncodeTraceMethodAndAction(method, action);
+  uint32_t method_value = EncodeTraceMethodAndAction(method, GetTraceAction(event));
 
   // Write data
   uint8_t* ptr;
-  static constexpr size_t kPacketSize = 14U;  // The maximum size of data in a packet.
-  uint8_t stack_buf[kPacketSize];             // Space to store a packet when in streaming mode.
+  uint8_t stack_buf[kStreamingPacketSize];  // Space to store a packet when in streaming mode.
   if (trace_output_mode_ == TraceOutputMode::kStreaming) {
     ptr = stack_buf;
   } else {
     ptr = buf_.get() + old_offset;
   }
+  WriteRecord(ptr, thread->GetTid(), method_value, thread_clock_diff, wall_clock_diff);
 
-  Append2LE(ptr, thread->GetTid());
+  if (trace_output_mode_ == TraceOutputMode::kStreaming) {
+    MutexLock mu(Thread::Current(), *streaming_lock_);  // To serialize writing.
+    WriteMethodName(method);
+    if (RegisterThread(thread->GetTid())) {
+      // It might be better to postpone this. Threads might not have received names...
+      std::string thread_name;
+      thread->GetThreadName(thread_name);
+      WriteThreadName(thread->GetTid(), thread_name);
+    }
+    WriteToBuf(stack_buf, sizeof(stack_buf));
+  }
+}
+
+void Trace::WriteRecord(uint8_t* ptr,
+                        pid_t tid,
+                        uint32_t method_value,
+                        uint32_t thread_clock_diff,
+                        uint32_t wall_clock_diff) {
+  Append2LE(ptr, tid);
   Append4LE(ptr + 2, method_value);
   ptr += 6;
 
@@ -969,33 +1157,113 @@ void Trace::LogMethodTraceEvent(Thread* thread, ArtMethod* method,
   if (UseWallClock()) {
     Append4LE(ptr, wall_clock_diff);
   }
-  static_assert(kPacketSize == 2 + 4 + 4 + 4, "Packet size incorrect.");
+  static_assert(kStreamingPacketSize == 2 + 4 + 4 + 4, "Packet size incorrect.");
+}
+
+void Trace::WriteMethodName(ArtMethod* method) {
+  if (RegisterMethod(method)) {
+    // Write a special block with the name.
+    std::string method_line(GetMethodLine(method));
+    uint8_t buf2[5];
+    Append2LE(buf2, 0);
+    buf2[2] = kOpNewMethod;
+    Append2LE(buf2 + 3, static_cast<uint16_t>(method_line.length()));
+    WriteToBuf(buf2, sizeof(buf2));
+    WriteToBuf(reinterpret_cast<const uint8_t*>(method_line.c_str()), method_line.length());
+  }
+}
+
+void Trace::WriteThreadName(pid_t tid, const std::string& thread_name) {
+  uint8_t buf2[7];
+  Append2LE(buf2, 0);
+  buf2[2] = kOpNewThread;
+  Append2LE(buf2 + 3, static_cast<uint16_t>(tid));
+  Append2LE(buf2 + 5, static_cast<uint16_t>(thread_name.length()));
+  WriteToBuf(buf2, sizeof(buf2));
+  WriteToBuf(reinterpret_cast<const uint8_t*>(thread_name.c_str()), thread_name.length());
+}
+
+void Trace::LogBufferedEvent(Thread* thread, const TraceEventBuffer::Event& event) {
+  TraceEventBuffer* buffer = thread->GetTraceEventBuffer();
+  if (UNLIKELY(buffer == nullptr)) {
+    std::string thread_name;
+    thread->GetThreadName(thread_name);
+    buffer = new TraceEventBuffer(thread->GetTid(), thread_name);
+    {
+      MutexLock mu(thread, *flush_lock_);
+      event_buffers_.emplace_back(buffer);
+    }
+    thread->SetTraceEventBuffer(buffer);
+  }
+  if (UNLIKELY(!buffer->Add(event))) {
+    // The writer thread is behind, make room by writing out the buffer ourselves.
+    FlushEventBuffers(thread, buffer);
+    CHECK(buffer->Add(event));
+  }
+}
+
+void Trace::FlushEventBuffers(Thread* self, TraceEventBuffer* buffer) {
+  MutexLock mu(self, *flush_lock_);
+  // The events to write, each with the buffer of the thread which recorded it.
+  typedef std::pair<const TraceEventBuffer*, TraceEventBuffer::Event> BufferedEvent;
+  std::vector<BufferedEvent> events;
+  std::vector<TraceEventBuffer::Event> drained;
+  for (const std::unique_ptr<TraceEventBuffer>& event_buffer : event_buffers_) {
+    if (buffer == nullptr || buffer == event_buffer.get()) {
+      drained.clear();
+      event_buffer->Drain(&drained);
+      for (const TraceEventBuffer::Event& event : drained) {
+        events.emplace_back(event_buffer.get(), event);
+      }
+    }
+  }
+  if (events.empty()) {
+    return;
+  }
+  if (buffer == nullptr && UseWallClock()) {
+    // Merge the threads in time order. The events of each thread stay in the recorded order.
+    std::stable_sort(events.begin(),
+                     events.end(),
+                     [](const BufferedEvent& lhs, const BufferedEvent& rhs) {
+                       return lhs.second.wall_clock_diff < rhs.second.wall_clock_diff;
+                     });
+  }
 
   if (trace_output_mode_ == TraceOutputMode::kStreaming) {
-    MutexLock mu(Thread::Current(), *streaming_lock_);  // To serialize writing.
-    if (RegisterMethod(method)) {
-      // Write a special block with the name.
-      std::string method_line(GetMethodLine(method));
-      uint8_t buf2[5];
-      Append2LE(buf2, 0);
-      buf2[2] = kOpNewMethod;
-      Append2LE(buf2 + 3, static_cast<uint16_t>(method_line.length()));
-      WriteToBuf(buf2, sizeof(buf2));
-      WriteToBuf(reinterpret_cast<const uint8_t*>(method_line.c_str()), method_line.length());
+    MutexLock mu2(self, *streaming_lock_);
+    for (const BufferedEvent& entry : events) {
+      const TraceEventBuffer::Event& event = entry.second;
+      const pid_t tid = entry.first->GetTid();
+      WriteMethodName(event.method);
+      if (RegisterThread(tid)) {
+        WriteThreadName(tid, entry.first->GetThreadName());
+      }
+      uint8_t packet[kStreamingPacketSize];
+      WriteRecord(packet,
+                  tid,
+                  EncodeTraceMethodAndAction(event.method, event.action),
+                  event.thread_clock_diff,
+                  event.wall_clock_diff);
+      WriteToBuf(packet, sizeof(packet));
     }
-    if (RegisterThread(thread)) {
-      // It might be better to postpone this. Threads might not have received names...
-      std::string thread_name;
-      thread->GetThreadName(thread_name);
-      uint8_t buf2[7];
-      Append2LE(buf2, 0);
-      buf2[2] = kOpNewThread;
-      Append2LE(buf2 + 3, static_cast<uint16_t>(thread->GetTid()));
-      Append2LE(buf2 + 5, static_cast<uint16_t>(thread_name.length()));
-      WriteToBuf(buf2, sizeof(buf2));
-      WriteToBuf(reinterpret_cast<const uint8_t*>(thread_name.c_str()), thread_name.length());
+  } else {
+    // Only flushes write to buf_ with thread buffers, the flush lock serializes them.
+    const size_t record_size = GetRecordSize(clock_source_);
+    size_t offset = cur_offset_.LoadRelaxed();
+    for (const BufferedEvent& entry : events) {
+      const TraceEventBuffer::Event& event = entry.second;
+      if (offset + record_size > buffer_size_) {
+        overflow_ = true;
+        break;
+      }
+      WriteRecord(buf_.get() + offset,
+                  entry.first->GetTid(),
+                  EncodeTraceMethodAndAction(event.method, event.action),
+                  event.thread_clock_diff,
+                  event.wall_clock_diff);
+      offset += record_size;
     }
-    WriteToBuf(stack_buf, sizeof(stack_buf));
+    cur_offset_.StoreRelease(offset);
   }
 }
 
@@ -91,10 +91,135 @@ enum TraceAction {
     kTraceMethodActionMask = 0x03,  // two bits
 };
 
+// Stack samples of one thread, taken by the thread itself in a checkpoint and collected by the
+// sampling thread. There is a single writer, the checkpoint, and a single reader, the collector,
+// so neither needs a lock. Samples are dropped when the buffer is full.
+class TraceSampleBuffer {
+ public:
+  static constexpr size_t kCapacity = 4;
+
+  struct Sample {
+    // Topmost frame first, like the stack traces of the suspend-all sampling.
+    std::vector<ArtMethod*> stack_trace;
+    uint32_t thread_clock_diff;
+    uint32_t wall_clock_diff;
+  };
+
+  TraceSampleBuffer() : write_index_(0), read_index_(0) {}
+
+  // Returns the slot to record the next sample into, or null if the buffer is full.
+  Sample* BeginWrite() {
+    const size_t write_index = write_index_.LoadRelaxed();
+    if (write_index - read_index_.LoadAcquire() == kCapacity) {
+      return nullptr;
+    }
+    Sample* sample = &samples_[write_index % kCapacity];
+    sample->stack_trace.clear();
+    sample->thread_clock_diff = 0;
+    sample->wall_clock_diff = 0;
+    return sample;
+  }
+
+  // Publishes the slot returned by BeginWrite().
+  void EndWrite() {
+    write_index_.StoreRelease(write_index_.LoadRelaxed() + 1);
+  }
+
+  // Returns the oldest sample not collected yet, or null if there is none.
+  Sample* BeginRead() {
+    const size_t read_index = read_index_.LoadRelaxed();
+    if (read_index == write_index_.LoadAcquire()) {
+      return nullptr;
+    }
+    return &samples_[read_index % kCapacity];
+  }
+
+  // Gives the slot returned by BeginRead() back to the writer.
+  void EndRead() {
+    read_index_.StoreRelease(read_index_.LoadRelaxed() + 1);
+  }
+
+ private:
+  Sample samples_[kCapacity];
+  Atomic<size_t> write_index_;
+  Atomic<size_t> read_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceSampleBuffer);
+};
+
+// Method trace events of one thread. The thread records its events itself, without touching any
+// state shared with other threads, and the events are moved to the trace in bulk by the trace
+// writer thread, or by the thread itself when the buffer is full. Flushes are serialized by the
+// flush lock of the trace, so there is a single reader.
+//
+// The events of a thread are written in the order it recorded them, but the trace is only in time
+// order within a flush: the periodic batches of the writer thread and the flushes of a thread with
+// a full buffer are written in the order they are flushed. An event of one thread may therefore
+// follow a later event of another thread, readers of the trace have to order the events of
+// different threads by their timestamps.
+class TraceEventBuffer {
+ public:
+  static constexpr size_t kCapacity = 2048;
+
+  struct Event {
+    ArtMethod* method;
+    TraceAction action;
+    uint32_t thread_clock_diff;
+    uint32_t wall_clock_diff;
+  };
+
+  TraceEventBuffer(pid_t tid, const std::string& thread_name)
+      : tid_(tid), thread_name_(thread_name), write_index_(0), read_index_(0) {}
+
+  // Called by the thread owning the buffer. Returns false if the buffer is full.
+  bool Add(const Event& event) {
+    const size_t write_index = write_index_.LoadRelaxed();
+    if (write_index - read_index_.LoadAcquire() == kCapacity) {
+      return false;
+    }
+    events_[write_index % kCapacity] = event;
+    write_index_.StoreRelease(write_index + 1);
+    return true;
+  }
+
+  // Moves the events recorded so far to `events`. Called with the flush lock held.
+  void Drain(std::vector<Event>* events) {
+    const size_t read_index = read_index_.LoadRelaxed();
+    const size_t write_index = write_index_.LoadAcquire();
+    for (size_t i = read_index; i != write_index; ++i) {
+      events->push_back(events_[i % kCapacity]);
+    }
+    read_index_.StoreRelease(write_index);
+  }
+
+  pid_t GetTid() const {
+    return tid_;
+  }
+
+  // The name of the thread when it recorded its first event.
+  const std::string& GetThreadName() const {
+    return thread_name_;
+  }
+
+ private:
+  const pid_t tid_;
+  const std::string thread_name_;
+  Event events_[kCapacity];
+  Atomic<size_t> write_index_;
+  Atomic<size_t> read_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceEventBuffer);
+};
+
 class Trace FINAL : public instrumentation::InstrumentationListener {
  public:
   enum TraceFlag {
     kTraceCountAllocs = 1,
+    // Sample with checkpoints run by each thread instead of suspending all threads.
+    kTraceCheckpointSampling = 2,
+    // Record method trace events in per-thread buffers written to the trace by a background
+    // thread.
+    kTraceThreadBuffers = 4,
   };
 
   enum class TraceOutputMode {
@@ -112,6 +237,9 @@ class Trace FINAL : public instrumentation::InstrumentationListener {
 
   static void SetDefaultClockSource(TraceClockSource clock_source);
 
+  // Flags added to the flags passed to Start(), such as kTraceCheckpointSampling.
+  static void SetDefaultFlags(int flags);
+
   static void Start(const char* trace_filename, int trace_fd, size_t buffer_size, int flags,
                     TraceOutputMode output_mode, TraceMode trace_mode, int interval_us)
       REQUIRES(!Locks::mutator_lock_, !Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_,
@@ -135,25 +263,46 @@ class Trace FINAL : public instrumentation::InstrumentationListener {
   uint32_t GetClockOverheadNanoSeconds();
 
   void CompareAndUpdateStackTrace(Thread* thread, std::vector<ArtMethod*>* stack_trace)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!*unique_methods_lock_, !*streaming_lock_);
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!*unique_methods_lock_, !*streaming_lock_, !*flush_lock_);
+  void CompareAndUpdateStackTrace(Thread* thread,
+                                  std::vector<ArtMethod*>* stack_trace,
+                                  uint32_t thread_clock_diff,
+                                  uint32_t wall_clock_diff)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!*unique_methods_lock_, !*streaming_lock_, !*flush_lock_);
+
+  // Records the stack of `thread` into its sample buffer. Called by the sampling checkpoint, which
+  // only runs on runnable threads. Suspended threads are not sampled: they cannot change their
+  // managed stack, so their last sample is still current.
+  void RecordSample(Thread* thread) SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Moves the samples recorded by `thread` into the trace.
+  void CollectSamples(Thread* thread)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!*unique_methods_lock_, !*streaming_lock_, !*flush_lock_);
 
   // InstrumentationListener implementation.
   void MethodEntered(Thread* thread, mirror::Object* this_object,
                      ArtMethod* method, uint32_t dex_pc)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!*unique_methods_lock_, !*streaming_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!*unique_methods_lock_, !*streaming_lock_, !*flush_lock_)
       OVERRIDE;
   void MethodExited(Thread* thread, mirror::Object* this_object,
                     ArtMethod* method, uint32_t dex_pc,
                     const JValue& return_value)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!*unique_methods_lock_, !*streaming_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!*unique_methods_lock_, !*streaming_lock_, !*flush_lock_)
       OVERRIDE;
   void MethodUnwind(Thread* thread, mirror::Object* this_object,
                     ArtMethod* method, uint32_t dex_pc)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!*unique_methods_lock_, !*streaming_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!*unique_methods_lock_, !*streaming_lock_, !*flush_lock_)
       OVERRIDE;
   void DexPcMoved(Thread* thread, mirror::Object* this_object,
                   ArtMethod* method, uint32_t new_dex_pc)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!*unique_methods_lock_, !*streaming_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!*unique_methods_lock_, !*streaming_lock_, !*flush_lock_)
       OVERRIDE;
   void FieldRead(Thread* thread, mirror::Object* this_object,
                  ArtMethod* method, uint32_t dex_pc, ArtField* field)
@@ -193,6 +342,11 @@ class Trace FINAL : public instrumentation::InstrumentationListener {
   // The sampling interval in microseconds is passed as an argument.
   static void* RunSamplingThread(void* arg) REQUIRES(!Locks::trace_lock_);
 
+  // Takes one sample of every thread with a checkpoint and collects the samples.
+  void SampleWithCheckpoint(Thread* self)
+      REQUIRES(!Locks::mutator_lock_, !Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_,
+               !*unique_methods_lock_, !*streaming_lock_, !*flush_lock_);
+
   static void StopTracing(bool finish_tracing, bool flush_file)
       REQUIRES(!Locks::mutator_lock_, !Locks::thread_list_lock_, !Locks::trace_lock_)
       // There is an annoying issue with static functions that create a new object and call into
@@ -207,7 +361,25 @@ class Trace FINAL : public instrumentation::InstrumentationListener {
   void LogMethodTraceEvent(Thread* thread, ArtMethod* method,
                            instrumentation::Instrumentation::InstrumentationEvent event,
                            uint32_t thread_clock_diff, uint32_t wall_clock_diff)
-      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!*unique_methods_lock_, !*streaming_lock_);
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!*unique_methods_lock_, !*streaming_lock_, !*flush_lock_);
+  void LogBufferedEvent(Thread* thread, const TraceEventBuffer::Event& event)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!*flush_lock_, !*unique_methods_lock_, !*streaming_lock_);
+
+  // Writes the events of `buffer`, or of all the thread buffers if it is null, to the trace.
+  // With a wall clock, the events of all the threads are merged in time order, but only within
+  // this flush, see TraceEventBuffer.
+  void FlushEventBuffers(Thread* self, TraceEventBuffer* buffer)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!*flush_lock_, !*unique_methods_lock_, !*streaming_lock_);
+
+  // Flushes the thread buffers periodically until tracing stops.
+  static void* RunWriterThread(void* arg) REQUIRES(!Locks::trace_lock_);
+
+  // Writes the record of an event to `ptr`, the trace buffer or a streaming packet.
+  void WriteRecord(uint8_t* ptr, pid_t tid, uint32_t method_value, uint32_t thread_clock_diff,
+                   uint32_t wall_clock_diff);
 
   // Methods to output traced methods and threads.
   void GetVisitedMethods(size_t end_offset, std::set<ArtMethod*>* visited_methods)
@@ -220,7 +392,13 @@ class Trace FINAL : public instrumentation::InstrumentationListener {
   // is newly discovered.
   bool RegisterMethod(ArtMethod* method)
       SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(streaming_lock_);
-  bool RegisterThread(Thread* thread)
+  bool RegisterThread(pid_t tid)
+      REQUIRES(streaming_lock_);
+
+  // Write the name blocks of newly seen methods and threads in streaming mode.
+  void WriteMethodName(ArtMethod* method)
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(streaming_lock_);
+  void WriteThreadName(pid_t tid, const std::string& thread_name)
       REQUIRES(streaming_lock_);
 
   // Copy a temporary buffer to the main buffer. Used for streaming. Exposed here for lock
@@ -244,9 +422,15 @@ class Trace FINAL : public instrumentation::InstrumentationListener {
   // The default profiler clock source.
   static TraceClockSource default_clock_source_;
 
+  // Flags added to the flags of every trace.
+  static int default_flags_;
+
   // Sampling thread, non-zero when sampling.
   static pthread_t sampling_pthread_;
 
+  // Thread flushing the per-thread buffers, non-zero when method tracing with kTraceThreadBuffers.
+  static pthread_t writer_pthread_;
+
   // Used to remember an unused stack trace to avoid re-allocation during sampling.
   static std::unique_ptr<std::vector<ArtMethod*>> temp_stack_trace_;
 
@@ -300,6 +484,10 @@ class Trace FINAL : public instrumentation::InstrumentationListener {
   std::unordered_map<ArtMethod*, uint32_t> art_method_id_map_ GUARDED_BY(unique_methods_lock_);
   std::vector<ArtMethod*> unique_methods_ GUARDED_BY(unique_methods_lock_);
 
+  // Per-thread event buffers, including the buffers of threads which exited since.
+  Mutex* flush_lock_ ACQUIRED_BEFORE(streaming_lock_);
+  std::vector<std::unique_ptr<TraceEventBuffer>> event_buffers_ GUARDED_BY(flush_lock_);
+
   DISALLOW_COPY_AND_ASSIGN(Trace);
 };
 
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trace.h"
+
+#include <pthread.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+static TraceEventBuffer::Event MakeEvent(uint32_t index) {
+  TraceEventBuffer::Event event = {
+      nullptr,
+      (index % 2 == 0) ? kTraceMethodEnter : kTraceMethodExit,
+      index,
+      index
+  };
+  return event;
+}
+
+static void ExpectEvents(const std::vector<TraceEventBuffer::Event>& events,
+                         uint32_t first,
+                         size_t count) {
+  ASSERT_EQ(count, events.size());
+  for (size_t i = 0; i != count; ++i) {
+    const uint32_t index = first + static_cast<uint32_t>(i);
+    EXPECT_EQ(MakeEvent(index).action, events[i].action);
+    EXPECT_EQ(index, events[i].thread_clock_diff);
+    EXPECT_EQ(index, events[i].wall_clock_diff);
+  }
+}
+
+TEST(TraceEventBuffer, Thread) {
+  TraceEventBuffer buffer(1234, "worker");
+  EXPECT_EQ(1234, buffer.GetTid());
+  EXPECT_EQ("worker", buffer.GetThreadName());
+}
+
+TEST(TraceEventBuffer, DrainInOrder) {
+  TraceEventBuffer buffer(1, "main");
+  std::vector<TraceEventBuffer::Event> events;
+  buffer.Drain(&events);
+  EXPECT_TRUE(events.empty());
+
+  for (uint32_t i = 0; i != 10; ++i) {
+    ASSERT_TRUE(buffer.Add(MakeEvent(i)));
+  }
+  buffer.Drain(&events);
+  ExpectEvents(events, 0, 10);
+
+  // A drained buffer only returns the events added since.
+  events.clear();
+  buffer.Drain(&events);
+  EXPECT_TRUE(events.empty());
+  ASSERT_TRUE(buffer.Add(MakeEvent(10)));
+  buffer.Drain(&events);
+  ExpectEvents(events, 10, 1);
+}
+
+TEST(TraceEventBuffer, Full) {
+  TraceEventBuffer buffer(1, "main");
+  for (uint32_t i = 0; i != TraceEventBuffer::kCapacity; ++i) {
+    ASSERT_TRUE(buffer.Add(MakeEvent(i)));
+  }
+  EXPECT_FALSE(buffer.Add(MakeEvent(TraceEventBuffer::kCapacity)));
+
+  std::vector<TraceEventBuffer::Event> events;
+  buffer.Drain(&events);
+  ExpectEvents(events, 0, TraceEventBuffer::kCapacity);
+}
+
+TEST(TraceEventBuffer, WrapAround) {
+  static constexpr size_t kHalf = TraceEventBuffer::kCapacity / 2;
+  TraceEventBuffer buffer(1, "main");
+  std::vector<TraceEventBuffer::Event> events;
+  for (uint32_t i = 0; i != kHalf; ++i) {
+    ASSERT_TRUE(buffer.Add(MakeEvent(i)));
+  }
+  buffer.Drain(&events);
+  ExpectEvents(events, 0, kHalf);
+
+  // Fill the buffer again, past the end of the storage.
+  for (uint32_t i = 0; i != TraceEventBuffer::kCapacity; ++i) {
+    ASSERT_TRUE(buffer.Add(MakeEvent(kHalf + i)));
+  }
+  EXPECT_FALSE(buffer.Add(MakeEvent(kHalf + TraceEventBuffer::kCapacity)));
+  events.clear();
+  buffer.Drain(&events);
+  ExpectEvents(events, kHalf, TraceEventBuffer::kCapacity);
+}
+
+struct ConcurrentWriterState {
+  TraceEventBuffer* buffer;
+  uint32_t num_events;
+};
+
+static void* ConcurrentWriterCallback(void* arg) {
+  ConcurrentWriterState* state = reinterpret_cast<ConcurrentWriterState*>(arg);
+  for (uint32_t i = 0; i != state->num_events; ) {
+    // Retry until the reader made room, like a thread waiting for its own flush.
+    if (state->buffer->Add(MakeEvent(i))) {
+      ++i;
+    }
+  }
+  return nullptr;
+}
+
+// The owning thread keeps recording while the buffer is drained, no event is lost or reordered.
+TEST(TraceEventBuffer, ConcurrentDrain) {
+  static constexpr uint32_t kNumEvents = 16 * TraceEventBuffer::kCapacity;
+  TraceEventBuffer buffer(1, "main");
+  ConcurrentWriterState state = { &buffer, kNumEvents };
+  pthread_t pthread;
+  ASSERT_EQ(0, pthread_create(&pthread, nullptr, ConcurrentWriterCallback, &state));
+  std::vector<TraceEventBuffer::Event> events;
+  while (events.size() != kNumEvents) {
+    buffer.Drain(&events);
+  }
+  EXPECT_EQ(0, pthread_join(pthread, nullptr));
+  buffer.Drain(&events);
+  ExpectEvents(events, 0, kNumEvents);
+}
+
+}  // namespace art
@@ -186,7 +186,6 @@ void Transaction::RecordWeakStringRemoval(mirror::String* s) {
 }
 
 void Transaction::LogInternedString(const InternStringLog& log) {
-  Locks::intern_table_lock_->AssertExclusiveHeld(Thread::Current());
   MutexLock mu(Thread::Current(), log_lock_);
   intern_string_logs_.push_front(log);
 }
@@ -195,10 +194,11 @@ void Transaction::Rollback() {
   CHECK(!Runtime::Current()->IsActiveTransaction());
   Thread* self = Thread::Current();
   self->AssertNoPendingException();
-  MutexLock mu1(self, *Locks::intern_table_lock_);
-  MutexLock mu2(self, log_lock_);
-  UndoObjectModifications();
-  UndoArrayModifications();
+  {
+    MutexLock mu(self, log_lock_);
+    UndoObjectModifications();
+    UndoArrayModifications();
+  }
   UndoInternStringTableModifications();
 }
 
@@ -222,12 +222,16 @@ void Transaction::UndoArrayModifications() {
 
 void Transaction::UndoInternStringTableModifications() {
   InternTable* const intern_table = Runtime::Current()->GetInternTable();
+  std::list<InternStringLog> intern_string_logs;
+  {
+    MutexLock mu(Thread::Current(), log_lock_);
+    intern_string_logs.swap(intern_string_logs_);
+  }
   // We want to undo each operation from the most recent to the oldest. List has been filled so the
   // most recent operation is at list begin so just have to iterate over it.
-  for (InternStringLog& string_log : intern_string_logs_) {
+  for (InternStringLog& string_log : intern_string_logs) {
     string_log.Undo(intern_table);
   }
-  intern_string_logs_.clear();
 }
 
 void Transaction::VisitRoots(RootVisitor* visitor) {
@@ -83,16 +83,12 @@ class Transaction FINAL {
 
   // Record intern string table changes.
   void RecordStrongStringInsertion(mirror::String* s)
-      REQUIRES(Locks::intern_table_lock_)
       REQUIRES(!log_lock_);
   void RecordWeakStringInsertion(mirror::String* s)
-      REQUIRES(Locks::intern_table_lock_)
       REQUIRES(!log_lock_);
   void RecordStrongStringRemoval(mirror::String* s)
-      REQUIRES(Locks::intern_table_lock_)
       REQUIRES(!log_lock_);
   void RecordWeakStringRemoval(mirror::String* s)
-      REQUIRES(Locks::intern_table_lock_)
       REQUIRES(!log_lock_);
 
   // Abort transaction by undoing all recorded changes.
@@ -182,8 +178,7 @@ class Transaction FINAL {
     }
 
     void Undo(InternTable* intern_table)
-        SHARED_REQUIRES(Locks::mutator_lock_)
-        REQUIRES(Locks::intern_table_lock_);
+        SHARED_REQUIRES(Locks::mutator_lock_);
     void VisitRoots(RootVisitor* visitor) SHARED_REQUIRES(Locks::mutator_lock_);
 
    private:
@@ -193,7 +188,6 @@ class Transaction FINAL {
   };
 
   void LogInternedString(const InternStringLog& log)
-      REQUIRES(Locks::intern_table_lock_)
       REQUIRES(!log_lock_);
 
   void UndoObjectModifications()
@@ -202,9 +196,9 @@ class Transaction FINAL {
   void UndoArrayModifications()
       REQUIRES(log_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
+  // Takes the logs before undoing them, the intern table locks are acquired before log_lock_.
   void UndoInternStringTableModifications()
-      REQUIRES(Locks::intern_table_lock_)
-      REQUIRES(log_lock_)
+      REQUIRES(!log_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   void VisitObjectLogs(RootVisitor* visitor)
@@ -47,6 +47,7 @@
 #include "scoped_thread_state_change.h"
 #include "utils.h"
 #include "handle_scope-inl.h"
+#include "verifier/verification_cache.h"
 
 namespace art {
 namespace verifier {
@@ -408,6 +409,11 @@ MethodVerifier::FailureData MethodVerifier::VerifyMethod(Thread* self,
       if ((verifier.encountered_failure_types_ & VerifyError::VERIFY_ERROR_LOCKING) != 0) {
         method->SetAccessFlags(method->GetAccessFlags() | kAccMustCountLocks);
       }
+      VerifierDeps* deps = self->GetVerifierDeps();
+      if (deps != nullptr) {
+        const uint32_t verifier_flags = kAccCompileDontBother | kAccMustCountLocks;
+        deps->AddMethodFlags(method_idx, method->GetAccessFlags() & verifier_flags);
+      }
     }
   } else {
     // Bad method data.
@@ -3740,6 +3746,23 @@ const RegType& MethodVerifier::GetCaughtExceptionType() {
   return *common_super;
 }
 
+ArtMethod* MethodVerifier::FindInvokedMethod(mirror::Class* klass,
+                                             const char* name,
+                                             const Signature& signature,
+                                             MethodType method_type,
+                                             size_t pointer_size) {
+  if (method_type == METHOD_DIRECT || method_type == METHOD_STATIC) {
+    return klass->FindDirectMethod(name, signature, pointer_size);
+  } else if (method_type == METHOD_INTERFACE) {
+    return klass->FindInterfaceMethod(name, signature, pointer_size);
+  } else if (method_type == METHOD_SUPER && klass->IsInterface()) {
+    return klass->FindInterfaceMethod(name, signature, pointer_size);
+  } else {
+    DCHECK(method_type == METHOD_VIRTUAL || method_type == METHOD_SUPER);
+    return klass->FindVirtualMethod(name, signature, pointer_size);
+  }
+}
+
 ArtMethod* MethodVerifier::ResolveMethodAndCheckAccess(
     uint32_t dex_method_idx, MethodType method_type) {
   const DexFile::MethodId& method_id = dex_file_->GetMethodId(dex_method_idx);
@@ -3764,16 +3787,7 @@ ArtMethod* MethodVerifier::ResolveMethodAndCheckAccess(
     const char* name = dex_file_->GetMethodName(method_id);
     const Signature signature = dex_file_->GetMethodSignature(method_id);
 
-    if (method_type == METHOD_DIRECT || method_type == METHOD_STATIC) {
-      res_method = klass->FindDirectMethod(name, signature, pointer_size);
-    } else if (method_type == METHOD_INTERFACE) {
-      res_method = klass->FindInterfaceMethod(name, signature, pointer_size);
-    } else if (method_type == METHOD_SUPER && klass->IsInterface()) {
-      res_method = klass->FindInterfaceMethod(name, signature, pointer_size);
-    } else {
-      DCHECK(method_type == METHOD_VIRTUAL || method_type == METHOD_SUPER);
-      res_method = klass->FindVirtualMethod(name, signature, pointer_size);
-    }
+    res_method = FindInvokedMethod(klass, name, signature, method_type, pointer_size);
     if (res_method != nullptr) {
       stash_method = true;
     } else {
@@ -3786,6 +3800,10 @@ ArtMethod* MethodVerifier::ResolveMethodAndCheckAccess(
         res_method = klass->FindDirectMethod(name, signature, pointer_size);
       }
       if (res_method == nullptr) {
+        VerifierDeps* deps = self_->GetVerifierDeps();
+        if (deps != nullptr) {
+          deps->AddMethod(dex_method_idx, method_type, nullptr);
+        }
         Fail(VERIFY_ERROR_NO_METHOD) << "couldn't find method "
                                      << PrettyDescriptor(klass) << "." << name
                                      << " " << signature;
@@ -3793,6 +3811,10 @@ ArtMethod* MethodVerifier::ResolveMethodAndCheckAccess(
       }
     }
   }
+  VerifierDeps* deps = self_->GetVerifierDeps();
+  if (deps != nullptr) {
+    deps->AddMethod(dex_method_idx, method_type, res_method);
+  }
   // Make sure calls to constructors are "direct". There are additional restrictions but we don't
   // enforce them here.
   if (res_method->IsConstructor() && method_type != METHOD_DIRECT) {
@@ -4085,9 +4107,13 @@ ArtMethod* MethodVerifier::VerifyInvocationArgs(
         Fail(VERIFY_ERROR_NO_CLASS) << "Unable to resolve the full class of 'this' used in an"
                                     << "interface invoke-super";
         return nullptr;
-      } else if (!reference_class->IsAssignableFrom(GetDeclaringClass().GetClass())) {
+      }
+      mirror::Class* declaring_class = GetDeclaringClass().GetClass();
+      const bool is_assignable = reference_class->IsAssignableFrom(declaring_class);
+      VerifierDeps::MaybeAddAssignability(reference_class, declaring_class, is_assignable);
+      if (!is_assignable) {
         Fail(VERIFY_ERROR_CLASS_CHANGE)
-            << "invoke-super in " << PrettyClass(GetDeclaringClass().GetClass()) << " in method "
+            << "invoke-super in " << PrettyClass(declaring_class) << " in method "
             << PrettyMethod(dex_method_idx_, *dex_file_) << " to method "
             << PrettyMethod(method_idx, *dex_file_) << " references "
             << "non-super-interface type " << PrettyClass(reference_class);
@@ -4101,8 +4127,16 @@ ArtMethod* MethodVerifier::VerifyInvocationArgs(
                                     << " to super " << PrettyMethod(res_method);
         return nullptr;
       }
-      if (!reference_class->IsAssignableFrom(GetDeclaringClass().GetClass()) ||
-          (res_method->GetMethodIndex() >= super.GetClass()->GetVTableLength())) {
+      mirror::Class* declaring_class = GetDeclaringClass().GetClass();
+      const bool is_assignable = reference_class->IsAssignableFrom(declaring_class);
+      VerifierDeps::MaybeAddAssignability(reference_class, declaring_class, is_assignable);
+      const bool has_vtable_entry =
+          res_method->GetMethodIndex() < super.GetClass()->GetVTableLength();
+      VerifierDeps* deps = self_->GetVerifierDeps();
+      if (deps != nullptr) {
+        deps->AddSuperVTableEntry(super.GetClass(), method_idx, has_vtable_entry);
+      }
+      if (!is_assignable || !has_vtable_entry) {
         Fail(VERIFY_ERROR_NO_METHOD) << "invalid invoke-super from "
                                     << PrettyMethod(dex_method_idx_, *dex_file_)
                                     << " to super " << super
@@ -4530,6 +4564,10 @@ ArtField* MethodVerifier::GetStaticField(int field_idx) {
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   ArtField* field = class_linker->ResolveFieldJLS(*dex_file_, field_idx, dex_cache_,
                                                   class_loader_);
+  VerifierDeps* deps = self_->GetVerifierDeps();
+  if (deps != nullptr) {
+    deps->AddField(field_idx, field);
+  }
   if (field == nullptr) {
     VLOG(verifier) << "Unable to resolve static field " << field_idx << " ("
               << dex_file_->GetFieldName(field_id) << ") in "
@@ -4565,6 +4603,10 @@ ArtField* MethodVerifier::GetInstanceField(const RegType& obj_type, int field_id
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   ArtField* field = class_linker->ResolveFieldJLS(*dex_file_, field_idx, dex_cache_,
                                                   class_loader_);
+  VerifierDeps* deps = self_->GetVerifierDeps();
+  if (deps != nullptr) {
+    deps->AddField(field_idx, field);
+  }
   if (field == nullptr) {
     VLOG(verifier) << "Unable to resolve instance field " << field_idx << " ("
               << dex_file_->GetFieldName(field_id) << ") in "
@@ -169,6 +169,15 @@ class MethodVerifier {
                                  std::string* error)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Looks up the method `name` with `signature` in `klass` the way an invoke of `method_type`
+  // does. Returns null if there is no such method.
+  static ArtMethod* FindInvokedMethod(mirror::Class* klass,
+                                      const char* name,
+                                      const Signature& signature,
+                                      MethodType method_type,
+                                      size_t pointer_size)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   static MethodVerifier* VerifyMethodAndDump(Thread* self,
                                              VariableIndentationOutputStream* vios,
                                              uint32_t method_idx,
@@ -22,6 +22,7 @@
 #include "base/casts.h"
 #include "base/scoped_arena_allocator.h"
 #include "mirror/class.h"
+#include "verification_cache.h"
 
 namespace art {
 namespace verifier {
@@ -104,10 +105,11 @@ inline bool RegType::AssignableFrom(const RegType& lhs, const RegType& rhs, bool
         return true;
       } else if (lhs.IsJavaLangObjectArray()) {
         return rhs.IsObjectArrayTypes();  // All reference arrays may be assigned to Object[]
-      } else if (lhs.HasClass() && rhs.HasClass() &&
-                 lhs.GetClass()->IsAssignableFrom(rhs.GetClass())) {
-        // We're assignable from the Class point-of-view.
-        return true;
+      } else if (lhs.HasClass() && rhs.HasClass()) {
+        // We're assignable if we are from the Class point-of-view.
+        bool is_assignable = lhs.GetClass()->IsAssignableFrom(rhs.GetClass());
+        VerifierDeps::MaybeAddAssignability(lhs.GetClass(), rhs.GetClass(), is_assignable);
+        return is_assignable;
       } else {
         // Unresolved types are only assignable for null and equality.
         return false;
@@ -703,6 +703,10 @@ const RegType& RegType::Merge(const RegType& incoming_type, RegTypeCache* reg_ty
       DCHECK(c1 != nullptr && !c1->IsPrimitive());
       DCHECK(c2 != nullptr && !c2->IsPrimitive());
       mirror::Class* join_class = ClassJoin(c1, c2);
+      // A different class path can only make the join more precise as long as both classes are
+      // still assignable to it.
+      VerifierDeps::MaybeAddAssignability(join_class, c1, true);
+      VerifierDeps::MaybeAddAssignability(join_class, c2, true);
       if (c1 == join_class && !IsPreciseReference()) {
         return *this;
       } else if (c2 == join_class && !incoming_type.IsPreciseReference()) {
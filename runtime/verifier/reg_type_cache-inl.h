@@ -121,11 +121,23 @@ inline const RegType& RegTypeCache::JavaLangObject(bool precise) {
 template <class RegTypeType>
 inline RegTypeType& RegTypeCache::AddEntry(RegTypeType* new_entry) {
   DCHECK(new_entry != nullptr);
+  DCHECK_EQ(new_entry->GetId(), entries_.size());
   entries_.push_back(new_entry);
+  // Only the reference types are looked up by descriptor, uninitialized types share the
+  // descriptor of the type they were created from.
+  if (!new_entry->descriptor_.empty() &&
+      (new_entry->IsReference() ||
+       new_entry->IsPreciseReference() ||
+       new_entry->IsUnresolvedReference())) {
+    descriptor_index_.emplace(new_entry->descriptor_, new_entry->GetId());
+  }
   if (new_entry->HasClass()) {
     mirror::Class* klass = new_entry->GetClass();
     DCHECK(!klass->IsPrimitive());
     klass_entries_.push_back(std::make_pair(GcRoot<mirror::Class>(klass), new_entry));
+    if (!klass_index_stale_) {
+      klass_index_.emplace(klass, new_entry->GetId());
+    }
   }
   return *new_entry;
 }
@@ -26,6 +26,7 @@
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
 #include "reg_type-inl.h"
+#include "verification_cache.h"
 
 namespace art {
 namespace verifier {
@@ -175,15 +176,25 @@ const RegType& RegTypeCache::From(mirror::ClassLoader* loader,
                                   bool precise) {
   StringPiece sp_descriptor(descriptor);
   // Try looking up the class in the cache first. We use a StringPiece to avoid continual strlen
-  // operations on the descriptor.
-  for (size_t i = primitive_count_; i < entries_.size(); i++) {
-    if (MatchDescriptor(i, sp_descriptor, precise)) {
-      return *(entries_[i]);
+  // operations on the descriptor. Return the oldest match, as a scan of the entries would.
+  const RegType* match = nullptr;
+  auto range = descriptor_index_.equal_range(sp_descriptor);
+  for (auto it = range.first; it != range.second; ++it) {
+    const uint16_t id = it->second;
+    if ((match == nullptr || id < match->GetId()) && MatchDescriptor(id, sp_descriptor, precise)) {
+      match = entries_[id];
     }
   }
+  if (match != nullptr) {
+    return *match;
+  }
   // Class not found in the cache, will create a new type for that.
   // Try resolving class.
   mirror::Class* klass = ResolveClass(descriptor, loader);
+  VerifierDeps* deps = VerifierDeps::Current();
+  if (deps != nullptr) {
+    deps->AddClass(sp_descriptor, klass);
+  }
   if (klass != nullptr) {
     // Class resolved, first look for the class in the list of entries
     // Class was not found, must create new type.
@@ -230,16 +241,36 @@ const RegType* RegTypeCache::FindClass(mirror::Class* klass, bool precise) const
     // primitive classes are final.
     return &RegTypeFromPrimitiveType(klass->GetPrimitiveType());
   }
-  for (auto& pair : klass_entries_) {
-    mirror::Class* const reg_klass = pair.first.Read();
-    if (reg_klass == klass) {
-      const RegType* reg_type = pair.second;
-      if (MatchingPrecisionForClass(reg_type, precise)) {
-        return reg_type;
-      }
+  if (klass_index_stale_) {
+    RebuildClassIndex();
+  }
+  const RegType* match = nullptr;
+  auto range = klass_index_.equal_range(klass);
+  for (auto it = range.first; it != range.second; ++it) {
+    const RegType* reg_type = entries_[it->second];
+    if ((match == nullptr || reg_type->GetId() < match->GetId()) &&
+        MatchingPrecisionForClass(reg_type, precise)) {
+      match = reg_type;
     }
   }
-  return nullptr;
+  return match;
+}
+
+void RegTypeCache::RebuildClassIndex() const {
+  klass_index_.clear();
+  for (auto& pair : klass_entries_) {
+    klass_index_.emplace(pair.first.Read(), pair.second->GetId());
+  }
+  klass_index_stale_ = false;
+}
+
+size_t RegTypeCache::DescriptorHash::operator()(const StringPiece& descriptor) const {
+  // Same as ComputeModifiedUtf8Hash(), which needs a null terminated string.
+  uint32_t hash = 0;
+  for (char c : descriptor) {
+    hash = hash * 31 + c;
+  }
+  return hash;
 }
 
 const RegType* RegTypeCache::InsertClass(const StringPiece& descriptor,
@@ -247,6 +278,10 @@ const RegType* RegTypeCache::InsertClass(const StringPiece& descriptor,
                                          bool precise) {
   // No reference to the class was found, create new reference.
   DCHECK(FindClass(klass, precise) == nullptr);
+  VerifierDeps* deps = VerifierDeps::Current();
+  if (deps != nullptr && !descriptor.empty()) {
+    deps->AddClass(descriptor, klass);
+  }
   RegType* const reg_type = precise
       ? static_cast<RegType*>(
           new (&arena_) PreciseReferenceType(klass, descriptor, entries_.size()))
@@ -266,13 +301,21 @@ const RegType& RegTypeCache::FromClass(const char* descriptor, mirror::Class* kl
 RegTypeCache::RegTypeCache(bool can_load_classes, ScopedArenaAllocator& arena)
     : entries_(arena.Adapter(kArenaAllocVerifier)),
       klass_entries_(arena.Adapter(kArenaAllocVerifier)),
+      descriptor_index_(kNumReserveEntries,
+                        DescriptorHash(),
+                        std::equal_to<StringPiece>(),
+                        arena.Adapter(kArenaAllocVerifier)),
+      klass_index_(kNumReserveEntries,
+                   std::hash<mirror::Class*>(),
+                   std::equal_to<mirror::Class*>(),
+                   arena.Adapter(kArenaAllocVerifier)),
+      klass_index_stale_(false),
       can_load_classes_(can_load_classes),
       arena_(arena) {
   if (kIsDebugBuild) {
     Thread::Current()->AssertThreadSuspensionIsAllowable(gAborting == 0);
   }
   // The klass_entries_ array does not have primitives or small constants.
-  static constexpr size_t kNumReserveEntries = 32;
   klass_entries_.reserve(kNumReserveEntries);
   // We want to have room for additional entries after inserting primitives and small
   // constants.
@@ -668,7 +711,12 @@ void RegTypeCache::VisitRoots(RootVisitor* visitor, const RootInfo& root_info) {
   }
   for (auto& pair : klass_entries_) {
     GcRoot<mirror::Class>& root = pair.first;
+    mirror::Class* const old_klass = root.Read<kWithoutReadBarrier>();
     root.VisitRoot(visitor, root_info);
+    if (root.Read<kWithoutReadBarrier>() != old_klass) {
+      // Do not rebuild the index here, the arena belongs to the thread running the verifier.
+      klass_index_stale_ = true;
+    }
   }
 }
 
@@ -159,6 +159,8 @@ class RegTypeCache {
       SHARED_REQUIRES(Locks::mutator_lock_);
   bool MatchDescriptor(size_t idx, const StringPiece& descriptor, bool precise)
       SHARED_REQUIRES(Locks::mutator_lock_);
+  // Rebuilds klass_index_ after the GC moved some of the classes.
+  void RebuildClassIndex() const SHARED_REQUIRES(Locks::mutator_lock_);
   const ConstantType& FromCat1NonSmallConstant(int32_t value, bool precise)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
@@ -190,12 +192,29 @@ class RegTypeCache {
   // Number of well known primitives that will be copied into a RegTypeCache upon construction.
   static uint16_t primitive_count_;
 
+  // Initial capacity of the entries and indexes, not counting primitives and small constants.
+  static constexpr size_t kNumReserveEntries = 32;
+
   // The actual storage for the RegTypes.
   ScopedArenaVector<const RegType*> entries_;
 
   // Fast lookup for quickly finding entries that have a matching class.
   ScopedArenaVector<std::pair<GcRoot<mirror::Class>, const RegType*>> klass_entries_;
 
+  // Hashes descriptors, which are not null terminated once copied into the arena.
+  struct DescriptorHash {
+    size_t operator()(const StringPiece& descriptor) const;
+  };
+
+  // Index from descriptor to the ids of the entries with that descriptor, so that From() does not
+  // have to scan all the entries for methods that use many types.
+  ScopedArenaUnorderedMultimap<StringPiece, uint16_t, DescriptorHash> descriptor_index_;
+
+  // Index from class to the ids of the entries in klass_entries_. Classes may be moved by the GC,
+  // VisitRoots() then marks the index stale and FindClass() rebuilds it on the mutator.
+  mutable ScopedArenaUnorderedMultimap<mirror::Class*, uint16_t> klass_index_;
+  mutable bool klass_index_stale_;
+
   // Whether or not we're allowed to load classes.
   const bool can_load_classes_;
 
@@ -21,6 +21,7 @@
 #include "base/bit_vector.h"
 #include "base/casts.h"
 #include "base/scoped_arena_allocator.h"
+#include "base/stringprintf.h"
 #include "common_runtime_test.h"
 #include "reg_type_cache-inl.h"
 #include "reg_type-inl.h"
@@ -664,5 +665,53 @@ TEST_F(RegTypeTest, ConstPrecision) {
   EXPECT_FALSE(imprecise_const.Equals(precise_const));
 }
 
+TEST_F(RegTypeReferenceTest, TypeHeavyMethod) {
+  // Simulates the verification of a method of a huge class touching many types, where each
+  // instruction looks up the type of its operands again.
+  static constexpr size_t kNumTypes = 4000;
+  static constexpr size_t kNumIterations = 10;
+  ArenaStack stack(Runtime::Current()->GetArenaPool());
+  ScopedArenaAllocator allocator(&stack);
+  ScopedObjectAccess soa(Thread::Current());
+  RegTypeCache cache(false, allocator);
+  std::vector<std::string> descriptors;
+  for (size_t i = 0; i != kNumTypes; ++i) {
+    descriptors.push_back(StringPrintf("LSynthetic%zu;", i));
+  }
+  const char* const resolved_descriptors[] = {
+      "Ljava/lang/Object;", "Ljava/lang/String;", "Ljava/lang/Class;", "[Ljava/lang/Object;"
+  };
+
+  std::vector<uint16_t> ids;
+  for (const std::string& descriptor : descriptors) {
+    const RegType& type = cache.FromDescriptor(nullptr, descriptor.c_str(), false);
+    EXPECT_TRUE(type.IsUnresolvedReference());
+    ids.push_back(type.GetId());
+  }
+  // Uninitialized types have the descriptor of their type but are never returned for it.
+  for (size_t i = 0; i != kNumTypes; i += 2) {
+    EXPECT_TRUE(cache.Uninitialized(cache.GetFromId(ids[i]), i).IsUninitializedTypes());
+  }
+  for (const char* descriptor : resolved_descriptors) {
+    const RegType& type = cache.FromDescriptor(nullptr, descriptor, false);
+    EXPECT_TRUE(cache.Uninitialized(type, 0u).IsUninitializedTypes());
+  }
+  for (size_t iteration = 0; iteration != kNumIterations; ++iteration) {
+    for (size_t i = 0; i != kNumTypes; ++i) {
+      EXPECT_EQ(ids[i], cache.FromDescriptor(nullptr, descriptors[i].c_str(), true).GetId());
+    }
+    for (const char* descriptor : resolved_descriptors) {
+      const RegType& imprecise = cache.FromDescriptor(nullptr, descriptor, false);
+      const RegType& precise = cache.FromDescriptor(nullptr, descriptor, true);
+      ASSERT_TRUE(imprecise.HasClass());
+      EXPECT_TRUE(imprecise.IsReference() || imprecise.IsPreciseReference());
+      EXPECT_TRUE(precise.IsPreciseReference());
+      EXPECT_EQ(&imprecise, cache.FindClass(imprecise.GetClass(), imprecise.IsPreciseReference()));
+      EXPECT_EQ(&precise, &cache.FromClass(descriptor, precise.GetClass(), true));
+    }
+  }
+  EXPECT_EQ(kNumTypes, ids.back() - ids.front() + 1u);
+}
+
 }  // namespace verifier
 }  // namespace art
@@ -0,0 +1,642 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "verification_cache.h"
+
+#include <sys/file.h>
+#include <zlib.h>
+
+#include <algorithm>
+
+#include "art_field-inl.h"
+#include "art_method-inl.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "base/unix_file/fd_file.h"
+#include "class_linker-inl.h"
+#include "dex_file-inl.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "mirror/dex_cache-inl.h"
+#include "os.h"
+#include "thread-inl.h"
+#include "utils.h"
+
+namespace art {
+namespace verifier {
+
+const uint8_t VerificationCache::kMagic[] = { 'v', 'c', 'c', '\0' };
+const uint8_t VerificationCache::kVersion[] = { '0', '0', '2', '\0' };
+
+// Every record is preceded by its size and its adler32 checksum.
+static constexpr size_t kRecordHeaderSize = 2 * sizeof(uint32_t);
+// Cache files larger than this are discarded rather than read.
+static constexpr size_t kMaxCacheFileSize = 64 * MB;
+// Access flags recorded for a class, field or method that did not resolve.
+static constexpr uint32_t kUnresolved = 0xffffffff;
+
+static void AddUint32ToBuffer(std::vector<uint8_t>* buffer, uint32_t value) {
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    buffer->push_back(static_cast<uint8_t>(value >> (i * kBitsPerByte)));
+  }
+}
+
+static void AddStringToBuffer(std::vector<uint8_t>* buffer, const std::string& value) {
+  AddUint32ToBuffer(buffer, static_cast<uint32_t>(value.size()));
+  buffer->insert(buffer->end(), value.begin(), value.end());
+}
+
+// Reads the values written above, failing rather than reading past the end of the data.
+class BufferReader {
+ public:
+  BufferReader(const uint8_t* data, const uint8_t* end) : data_(data), end_(end) {}
+
+  bool ReadUint32(uint32_t* value) {
+    if (static_cast<size_t>(end_ - data_) < sizeof(*value)) {
+      return false;
+    }
+    *value = 0;
+    for (size_t i = 0; i < sizeof(*value); ++i) {
+      *value |= static_cast<uint32_t>(data_[i]) << (i * kBitsPerByte);
+    }
+    data_ += sizeof(*value);
+    return true;
+  }
+
+  bool ReadString(std::string* value) {
+    uint32_t size;
+    if (!ReadUint32(&size) || static_cast<size_t>(end_ - data_) < size) {
+      return false;
+    }
+    value->assign(reinterpret_cast<const char*>(data_), size);
+    data_ += size;
+    return true;
+  }
+
+  const uint8_t* GetData() const {
+    return data_;
+  }
+
+ private:
+  const uint8_t* data_;
+  const uint8_t* const end_;
+};
+
+static uint32_t AccessFlagsOf(mirror::Class* klass) SHARED_REQUIRES(Locks::mutator_lock_) {
+  return (klass == nullptr) ? kUnresolved : (klass->GetAccessFlags() & kAccJavaFlagsMask);
+}
+
+// Resolves `descriptor` the way the verifier does, returning null if it does not resolve.
+static mirror::Class* ResolveClass(Thread* self,
+                                   const std::string& descriptor,
+                                   Handle<mirror::ClassLoader> class_loader)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  mirror::Class* klass = class_linker->FindClass(self, descriptor.c_str(), class_loader);
+  if (klass == nullptr) {
+    DCHECK(self->IsExceptionPending());
+    self->ClearException();
+  }
+  return klass;
+}
+
+// Resolves the `method_type` invoke of `method_idx` the way the verifier does, returning null if
+// it does not resolve.
+static ArtMethod* ResolveMethod(Thread* self,
+                                const DexFile& dex_file,
+                                uint32_t method_idx,
+                                MethodType method_type,
+                                Handle<mirror::ClassLoader> class_loader,
+                                size_t pointer_size)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  const DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+  mirror::Class* method_class =
+      ResolveClass(self, dex_file.StringByTypeIdx(method_id.class_idx_), class_loader);
+  if (method_class == nullptr) {
+    return nullptr;
+  }
+  const char* name = dex_file.GetMethodName(method_id);
+  const Signature signature = dex_file.GetMethodSignature(method_id);
+  ArtMethod* method = MethodVerifier::FindInvokedMethod(method_class,
+                                                        name,
+                                                        signature,
+                                                        method_type,
+                                                        pointer_size);
+  if (method == nullptr && method_type != METHOD_DIRECT && method_type != METHOD_STATIC) {
+    method = method_class->FindDirectMethod(name, signature, pointer_size);
+  }
+  return method;
+}
+
+VerifierDeps* VerifierDeps::Current() {
+  return Thread::Current()->GetVerifierDeps();
+}
+
+void VerifierDeps::AddClass(const StringPiece& descriptor, mirror::Class* klass) {
+  classes_.emplace(descriptor.as_string(), AccessFlagsOf(klass));
+}
+
+void VerifierDeps::AddField(uint32_t field_idx, ArtField* field) {
+  MemberResolution resolution;
+  resolution.access_flags = kUnresolved;
+  if (field != nullptr) {
+    std::string temp;
+    resolution.declaring_class = field->GetDeclaringClass()->GetDescriptor(&temp);
+    resolution.access_flags = field->GetAccessFlags() & kAccJavaFlagsMask;
+  }
+  fields_.emplace(field_idx, resolution);
+}
+
+void VerifierDeps::AddMethod(uint32_t method_idx, MethodType method_type, ArtMethod* method) {
+  MemberResolution resolution;
+  resolution.access_flags = kUnresolved;
+  if (method != nullptr) {
+    std::string temp;
+    resolution.declaring_class = method->GetDeclaringClass()->GetDescriptor(&temp);
+    resolution.access_flags = method->GetAccessFlags() & kAccJavaFlagsMask;
+  }
+  methods_.emplace(std::make_pair(method_idx, static_cast<uint32_t>(method_type)), resolution);
+}
+
+void VerifierDeps::AddAssignability(mirror::Class* destination,
+                                    mirror::Class* source,
+                                    bool is_assignable) {
+  std::string temp1;
+  std::string temp2;
+  assignabilities_.emplace(std::make_pair(std::string(destination->GetDescriptor(&temp1)),
+                                          std::string(source->GetDescriptor(&temp2))),
+                           is_assignable);
+}
+
+void VerifierDeps::AddSuperVTableEntry(mirror::Class* super_class,
+                                       uint32_t method_idx,
+                                       bool has_entry) {
+  std::string temp;
+  super_vtable_entries_.emplace(std::make_pair(std::string(super_class->GetDescriptor(&temp)),
+                                               method_idx),
+                                has_entry);
+}
+
+void VerifierDeps::AddMethodFlags(uint32_t method_idx, uint32_t flags) {
+  if (flags != 0) {
+    method_flags_[method_idx] |= flags;
+  }
+}
+
+void VerifierDeps::Encode(std::vector<uint8_t>* buffer) const {
+  AddUint32ToBuffer(buffer, classes_.size());
+  for (const auto& entry : classes_) {
+    AddStringToBuffer(buffer, entry.first);
+    AddUint32ToBuffer(buffer, entry.second);
+  }
+  AddUint32ToBuffer(buffer, fields_.size());
+  for (const auto& entry : fields_) {
+    AddUint32ToBuffer(buffer, entry.first);
+    AddStringToBuffer(buffer, entry.second.declaring_class);
+    AddUint32ToBuffer(buffer, entry.second.access_flags);
+  }
+  AddUint32ToBuffer(buffer, methods_.size());
+  for (const auto& entry : methods_) {
+    AddUint32ToBuffer(buffer, entry.first.first);
+    AddUint32ToBuffer(buffer, entry.first.second);
+    AddStringToBuffer(buffer, entry.second.declaring_class);
+    AddUint32ToBuffer(buffer, entry.second.access_flags);
+  }
+  AddUint32ToBuffer(buffer, assignabilities_.size());
+  for (const auto& entry : assignabilities_) {
+    AddStringToBuffer(buffer, entry.first.first);
+    AddStringToBuffer(buffer, entry.first.second);
+    AddUint32ToBuffer(buffer, entry.second ? 1u : 0u);
+  }
+  AddUint32ToBuffer(buffer, super_vtable_entries_.size());
+  for (const auto& entry : super_vtable_entries_) {
+    AddStringToBuffer(buffer, entry.first.first);
+    AddUint32ToBuffer(buffer, entry.first.second);
+    AddUint32ToBuffer(buffer, entry.second ? 1u : 0u);
+  }
+  AddUint32ToBuffer(buffer, method_flags_.size());
+  for (const auto& entry : method_flags_) {
+    AddUint32ToBuffer(buffer, entry.first);
+    AddUint32ToBuffer(buffer, entry.second);
+  }
+}
+
+bool VerifierDeps::Decode(const uint8_t** data, const uint8_t* end) {
+  BufferReader reader(*data, end);
+  uint32_t count;
+  if (!reader.ReadUint32(&count)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string descriptor;
+    uint32_t access_flags;
+    if (!reader.ReadString(&descriptor) || !reader.ReadUint32(&access_flags)) {
+      return false;
+    }
+    classes_.emplace(descriptor, access_flags);
+  }
+  if (!reader.ReadUint32(&count)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t field_idx;
+    MemberResolution resolution;
+    if (!reader.ReadUint32(&field_idx) ||
+        !reader.ReadString(&resolution.declaring_class) ||
+        !reader.ReadUint32(&resolution.access_flags)) {
+      return false;
+    }
+    fields_.emplace(field_idx, resolution);
+  }
+  if (!reader.ReadUint32(&count)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t method_idx;
+    uint32_t method_type;
+    MemberResolution resolution;
+    if (!reader.ReadUint32(&method_idx) ||
+        !reader.ReadUint32(&method_type) ||
+        method_type > METHOD_INTERFACE ||
+        !reader.ReadString(&resolution.declaring_class) ||
+        !reader.ReadUint32(&resolution.access_flags)) {
+      return false;
+    }
+    methods_.emplace(std::make_pair(method_idx, method_type), resolution);
+  }
+  if (!reader.ReadUint32(&count)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string destination;
+    std::string source;
+    uint32_t is_assignable;
+    if (!reader.ReadString(&destination) ||
+        !reader.ReadString(&source) ||
+        !reader.ReadUint32(&is_assignable)) {
+      return false;
+    }
+    assignabilities_.emplace(std::make_pair(destination, source), is_assignable != 0);
+  }
+  if (!reader.ReadUint32(&count)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string super_class;
+    uint32_t method_idx;
+    uint32_t has_entry;
+    if (!reader.ReadString(&super_class) ||
+        !reader.ReadUint32(&method_idx) ||
+        !reader.ReadUint32(&has_entry)) {
+      return false;
+    }
+    super_vtable_entries_.emplace(std::make_pair(super_class, method_idx), has_entry != 0);
+  }
+  if (!reader.ReadUint32(&count)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t method_idx;
+    uint32_t flags;
+    if (!reader.ReadUint32(&method_idx) || !reader.ReadUint32(&flags)) {
+      return false;
+    }
+    method_flags_.emplace(method_idx, flags);
+  }
+  *data = reader.GetData();
+  return true;
+}
+
+bool VerifierDeps::Validate(Thread* self, Handle<mirror::Class> klass) const {
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  const size_t pointer_size = class_linker->GetImagePointerSize();
+  StackHandleScope<3> hs(self);
+  Handle<mirror::ClassLoader> class_loader(hs.NewHandle(klass->GetClassLoader()));
+  Handle<mirror::DexCache> dex_cache(hs.NewHandle(klass->GetDexCache()));
+  MutableHandle<mirror::Class> destination(hs.NewHandle<mirror::Class>(nullptr));
+  const DexFile& dex_file = *dex_cache->GetDexFile();
+  std::string temp;
+
+  for (const auto& entry : classes_) {
+    if (AccessFlagsOf(ResolveClass(self, entry.first, class_loader)) != entry.second) {
+      VLOG(verifier) << "Class " << entry.first << " resolves differently";
+      return false;
+    }
+  }
+
+  for (const auto& entry : fields_) {
+    if (entry.first >= dex_file.NumFieldIds()) {
+      return false;
+    }
+    ArtField* field = class_linker->ResolveFieldJLS(dex_file, entry.first, dex_cache, class_loader);
+    MemberResolution resolution;
+    resolution.access_flags = kUnresolved;
+    if (field == nullptr) {
+      self->ClearException();
+    } else {
+      resolution.declaring_class = field->GetDeclaringClass()->GetDescriptor(&temp);
+      resolution.access_flags = field->GetAccessFlags() & kAccJavaFlagsMask;
+    }
+    if (!(resolution == entry.second)) {
+      VLOG(verifier) << "Field " << PrettyField(entry.first, dex_file) << " resolves differently";
+      return false;
+    }
+  }
+
+  for (const auto& entry : methods_) {
+    const uint32_t method_idx = entry.first.first;
+    const MethodType method_type = static_cast<MethodType>(entry.first.second);
+    if (method_idx >= dex_file.NumMethodIds()) {
+      return false;
+    }
+    const DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+    if (ResolveClass(self, dex_file.StringByTypeIdx(method_id.class_idx_), class_loader) ==
+        nullptr) {
+      return false;
+    }
+    ArtMethod* method =
+        ResolveMethod(self, dex_file, method_idx, method_type, class_loader, pointer_size);
+    MemberResolution resolution;
+    resolution.access_flags = kUnresolved;
+    if (method != nullptr) {
+      resolution.declaring_class = method->GetDeclaringClass()->GetDescriptor(&temp);
+      resolution.access_flags = method->GetAccessFlags() & kAccJavaFlagsMask;
+    }
+    if (!(resolution == entry.second)) {
+      VLOG(verifier) << "Method " << PrettyMethod(method_idx, dex_file) << " resolves differently";
+      return false;
+    }
+  }
+
+  for (const auto& entry : assignabilities_) {
+    destination.Assign(ResolveClass(self, entry.first.first, class_loader));
+    if (destination.Get() == nullptr) {
+      return false;
+    }
+    mirror::Class* source = ResolveClass(self, entry.first.second, class_loader);
+    if (source == nullptr || destination->IsAssignableFrom(source) != entry.second) {
+      VLOG(verifier) << "Assignability of " << entry.first.second << " to " << entry.first.first
+                     << " changed";
+      return false;
+    }
+  }
+
+  for (const auto& entry : super_vtable_entries_) {
+    const uint32_t method_idx = entry.first.second;
+    if (method_idx >= dex_file.NumMethodIds()) {
+      return false;
+    }
+    destination.Assign(ResolveClass(self, entry.first.first, class_loader));
+    if (destination.Get() == nullptr) {
+      return false;
+    }
+    ArtMethod* method =
+        ResolveMethod(self, dex_file, method_idx, METHOD_SUPER, class_loader, pointer_size);
+    if (method == nullptr ||
+        (method->GetMethodIndex() < destination->GetVTableLength()) != entry.second) {
+      VLOG(verifier) << "Vtable entry of " << entry.first.first << " for invoke-super of "
+                     << PrettyMethod(method_idx, dex_file) << " changed";
+      return false;
+    }
+  }
+  return true;
+}
+
+void VerifierDeps::ApplyMethodFlags(mirror::Class* klass, size_t pointer_size) const {
+  if (method_flags_.empty()) {
+    return;
+  }
+  for (ArtMethod& method : klass->GetDeclaredMethods(pointer_size)) {
+    auto it = method_flags_.find(method.GetDexMethodIndex());
+    if (it != method_flags_.end()) {
+      method.SetAccessFlags(method.GetAccessFlags() | it->second);
+    }
+  }
+}
+
+ScopedVerifierDeps::ScopedVerifierDeps(Thread* self, VerifierDeps* deps)
+    : self_(self), previous_deps_(self->GetVerifierDeps()) {
+  self_->SetVerifierDeps(deps);
+}
+
+ScopedVerifierDeps::~ScopedVerifierDeps() {
+  self_->SetVerifierDeps(previous_deps_);
+}
+
+std::string VerificationCache::GetCacheFilename(const std::string& cache_dir,
+                                                const std::string& dex_location) {
+  std::string filename;
+  std::string error_msg;
+  if (!GetDalvikCacheFilename(dex_location.c_str(), cache_dir.c_str(), &filename, &error_msg)) {
+    // Relative location, use it as is.
+    std::string name(dex_location);
+    std::replace(name.begin(), name.end(), '/', '@');
+    filename = cache_dir + "/" + name;
+  }
+  return filename + ".vcache";
+}
+
+std::vector<uint8_t> VerificationCache::EncodeHeader(const DexFile& dex_file) {
+  std::vector<uint8_t> header(kMagic, kMagic + sizeof(kMagic));
+  header.insert(header.end(), kVersion, kVersion + sizeof(kVersion));
+  AddUint32ToBuffer(&header, dex_file.GetLocationChecksum());
+  AddUint32ToBuffer(&header, dex_file.GetHeader().checksum_);
+  const uint8_t* signature = dex_file.GetHeader().signature_;
+  header.insert(header.end(), signature, signature + DexFile::kSha1DigestSize);
+  return header;
+}
+
+void VerificationCache::EncodeRecord(uint16_t class_def_index,
+                                     const Entry& entry,
+                                     std::vector<uint8_t>* buffer) {
+  std::vector<uint8_t> payload;
+  AddUint32ToBuffer(&payload, class_def_index);
+  AddUint32ToBuffer(&payload, static_cast<uint32_t>(entry.kind));
+  entry.deps->Encode(&payload);
+  AddUint32ToBuffer(buffer, payload.size());
+  AddUint32ToBuffer(buffer, adler32(adler32(0L, Z_NULL, 0), payload.data(), payload.size()));
+  buffer->insert(buffer->end(), payload.begin(), payload.end());
+}
+
+std::unique_ptr<VerificationCache> VerificationCache::Open(const std::string& cache_dir,
+                                                           const DexFile& dex_file,
+                                                           std::string* error_msg) {
+  const std::string filename = GetCacheFilename(cache_dir, dex_file.GetLocation());
+  std::unique_ptr<File> file(
+      OS::OpenFileWithFlags(filename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC));
+  if (file == nullptr) {
+    *error_msg = StringPrintf("Failed to open %s: %s", filename.c_str(), strerror(errno));
+    return nullptr;
+  }
+  // Other processes of the app may open the same file. Every write, including the append of a
+  // single record, holds the file lock so that it does not interleave with a rewrite.
+  if (TEMP_FAILURE_RETRY(flock(file->Fd(), LOCK_EX)) != 0) {
+    *error_msg = StringPrintf("Failed to lock %s: %s", filename.c_str(), strerror(errno));
+    UNUSED(file->Close());
+    return nullptr;
+  }
+  std::vector<uint8_t> contents;
+  int64_t length = file->GetLength();
+  if (length > 0 && static_cast<uint64_t>(length) <= kMaxCacheFileSize) {
+    contents.resize(length);
+    if (!file->ReadFully(contents.data(), contents.size())) {
+      contents.clear();
+    }
+  }
+
+  std::unique_ptr<VerificationCache> cache(new VerificationCache(EncodeHeader(dex_file),
+                                                                 file.release()));
+  const std::vector<uint8_t>& header = cache->header_;
+  size_t end = 0;
+  size_t num_records = 0;
+  if (contents.size() >= header.size() &&
+      std::equal(header.begin(), header.end(), contents.begin())) {
+    end = cache->ReadRecords(contents, &num_records);
+  }
+  bool success = true;
+  if (end == 0 || num_records > 2 * cache->entries_.size()) {
+    // Either a new file or one for a previous version of the dex file, or most of the records were
+    // replaced by later ones.
+    success = cache->Rewrite();
+  } else if (end != static_cast<uint64_t>(length)) {
+    // Drop the truncated record of a process which died while appending it.
+    success = cache->file_->SetLength(end) == 0;
+  }
+  if (!success) {
+    *error_msg = StringPrintf("Failed to write %s: %s", filename.c_str(), strerror(errno));
+  }
+  UNUSED(TEMP_FAILURE_RETRY(flock(cache->file_->Fd(), LOCK_UN)));
+  if (!success) {
+    return nullptr;
+  }
+  VLOG(verifier) << "Opened verification cache " << filename << " with "
+                 << cache->entries_.size() << " classes";
+  return cache;
+}
+
+VerificationCache::VerificationCache(const std::vector<uint8_t>& header, File* file)
+    : header_(header),
+      lock_("verification cache lock", kVerificationCacheLock),
+      file_(file) {}
+
+VerificationCache::~VerificationCache() {
+  if (file_->FlushClose() != 0) {
+    PLOG(WARNING) << "Failed to close verification cache " << file_->GetPath();
+  }
+}
+
+size_t VerificationCache::ReadRecords(const std::vector<uint8_t>& contents, size_t* num_records) {
+  size_t offset = header_.size();
+  while (contents.size() - offset >= kRecordHeaderSize) {
+    BufferReader header_reader(contents.data() + offset, contents.data() + contents.size());
+    uint32_t size;
+    uint32_t checksum;
+    UNUSED(header_reader.ReadUint32(&size));
+    UNUSED(header_reader.ReadUint32(&checksum));
+    const uint8_t* data = header_reader.GetData();
+    const uint8_t* end = data + size;
+    if (contents.size() - offset - kRecordHeaderSize < size ||
+        adler32(adler32(0L, Z_NULL, 0), data, size) != checksum) {
+      break;
+    }
+    BufferReader reader(data, end);
+    uint32_t class_def_index;
+    uint32_t kind;
+    if (!reader.ReadUint32(&class_def_index) ||
+        !reader.ReadUint32(&kind) ||
+        kind >= static_cast<uint32_t>(MethodVerifier::kHardFailure)) {
+      break;
+    }
+    data = reader.GetData();
+    std::unique_ptr<VerifierDeps> deps(new VerifierDeps());
+    if (!deps->Decode(&data, end) || data != end) {
+      break;
+    }
+    Entry& entry = entries_[static_cast<uint16_t>(class_def_index)];
+    entry.kind = static_cast<MethodVerifier::FailureKind>(kind);
+    entry.deps.reset(deps.release());
+    offset += kRecordHeaderSize + size;
+    ++*num_records;
+  }
+  return (*num_records == 0) ? 0 : offset;
+}
+
+bool VerificationCache::Rewrite() {
+  std::vector<uint8_t> buffer(header_);
+  for (const auto& entry : entries_) {
+    EncodeRecord(entry.first, entry.second, &buffer);
+  }
+  return file_->ClearContent() && file_->WriteFully(buffer.data(), buffer.size());
+}
+
+bool VerificationCache::IsFor(const DexFile& dex_file) const {
+  return EncodeHeader(dex_file) == header_;
+}
+
+bool VerificationCache::Lookup(Thread* self,
+                               Handle<mirror::Class> klass,
+                               MethodVerifier::FailureKind* kind) {
+  Entry entry;
+  {
+    MutexLock mu(self, lock_);
+    auto it = entries_.find(klass->GetDexClassDefIndex());
+    if (it == entries_.end()) {
+      return false;
+    }
+    entry = it->second;
+  }
+  if (!entry.deps->Validate(self, klass)) {
+    VLOG(verifier) << "Cached verification result of " << PrettyDescriptor(klass.Get())
+                   << " is stale";
+    return false;
+  }
+  entry.deps->ApplyMethodFlags(klass.Get(),
+                               Runtime::Current()->GetClassLinker()->GetImagePointerSize());
+  *kind = entry.kind;
+  return true;
+}
+
+void VerificationCache::Record(uint16_t class_def_index,
+                               MethodVerifier::FailureKind kind,
+                               std::unique_ptr<VerifierDeps> deps) {
+  if (kind == MethodVerifier::kHardFailure) {
+    return;
+  }
+  Entry entry;
+  entry.kind = kind;
+  entry.deps.reset(deps.release());
+  std::vector<uint8_t> buffer;
+  EncodeRecord(class_def_index, entry, &buffer);
+  MutexLock mu(Thread::Current(), lock_);
+  if (TEMP_FAILURE_RETRY(flock(file_->Fd(), LOCK_EX)) != 0) {
+    PLOG(WARNING) << "Failed to lock verification cache " << file_->GetPath();
+  } else {
+    if (!file_->WriteFully(buffer.data(), buffer.size())) {
+      PLOG(WARNING) << "Failed to write verification cache " << file_->GetPath();
+    }
+    UNUSED(TEMP_FAILURE_RETRY(flock(file_->Fd(), LOCK_UN)));
+  }
+  entries_[class_def_index] = entry;
+}
+
+size_t VerificationCache::NumEntries() {
+  MutexLock mu(Thread::Current(), lock_);
+  return entries_.size();
+}
+
+}  // namespace verifier
+}  // namespace art
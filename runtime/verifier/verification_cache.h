@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_VERIFIER_VERIFICATION_CACHE_H_
+#define ART_RUNTIME_VERIFIER_VERIFICATION_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "base/stringpiece.h"
+#include "handle.h"
+#include "method_verifier.h"
+#include "os.h"
+
+namespace art {
+
+class ArtField;
+class ArtMethod;
+class DexFile;
+
+namespace mirror {
+class Class;
+}  // namespace mirror
+
+namespace verifier {
+
+// The facts about the class path a class verification depended on: how the classes, fields and
+// methods the verifier looked at resolved, which assignability checks between resolved classes it
+// made, which invoke-super targets had an entry in the vtable of the super class, and the access
+// flags it added to the methods of the verified class. A verification result still holds as long
+// as all of these resolve the same way, even if the class path changed.
+class VerifierDeps {
+ public:
+  VerifierDeps() {}
+
+  // Records the dependencies of the verification running on the current thread, if any.
+  static VerifierDeps* Current();
+
+  // Records that `descriptor` resolved to `klass`, or failed to resolve if `klass` is null.
+  void AddClass(const StringPiece& descriptor, mirror::Class* klass)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Records that `field_idx` resolved to `field`, or failed to resolve if `field` is null.
+  void AddField(uint32_t field_idx, ArtField* field) SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Records that a `method_type` invoke of `method_idx` resolved to `method`, or failed to
+  // resolve if `method` is null.
+  void AddMethod(uint32_t method_idx, MethodType method_type, ArtMethod* method)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Records the result of `destination->IsAssignableFrom(source)`.
+  void AddAssignability(mirror::Class* destination, mirror::Class* source, bool is_assignable)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Records whether the vtable of `super_class` has an entry for the method an invoke-super of
+  // `method_idx` resolved to.
+  void AddSuperVTableEntry(mirror::Class* super_class, uint32_t method_idx, bool has_entry)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Records the access flags the verifier added to the method `method_idx` of the verified class.
+  void AddMethodFlags(uint32_t method_idx, uint32_t flags);
+
+  // Convenience for the reg types, which do not know the verifier they are used by.
+  static void MaybeAddAssignability(mirror::Class* destination,
+                                    mirror::Class* source,
+                                    bool is_assignable)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    VerifierDeps* deps = Current();
+    if (UNLIKELY(deps != nullptr)) {
+      deps->AddAssignability(destination, source, is_assignable);
+    }
+  }
+
+  void Encode(std::vector<uint8_t>* buffer) const;
+  bool Decode(const uint8_t** data, const uint8_t* end);
+
+  // Returns true if all the recorded dependencies still resolve the same way in the dex cache and
+  // class loader of `klass`. May load classes.
+  bool Validate(Thread* self, Handle<mirror::Class> klass) const
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Adds the recorded method flags to the methods of `klass`.
+  void ApplyMethodFlags(mirror::Class* klass, size_t pointer_size) const
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  size_t Size() const {
+    return classes_.size() + fields_.size() + methods_.size() + assignabilities_.size() +
+        super_vtable_entries_.size();
+  }
+
+ private:
+  // Resolution of a field or method, the access flags are all ones if it did not resolve.
+  struct MemberResolution {
+    std::string declaring_class;
+    uint32_t access_flags;
+
+    bool operator==(const MemberResolution& other) const {
+      return access_flags == other.access_flags && declaring_class == other.declaring_class;
+    }
+  };
+
+  // Class descriptor to access flags.
+  std::map<std::string, uint32_t> classes_;
+  // Field index to resolution.
+  std::map<uint32_t, MemberResolution> fields_;
+  // Method index and method type to resolution.
+  std::map<std::pair<uint32_t, uint32_t>, MemberResolution> methods_;
+  // Destination and source descriptors to the result of the check.
+  std::map<std::pair<std::string, std::string>, bool> assignabilities_;
+  // Super class descriptor and invoke-super method index to whether the vtable has an entry.
+  std::map<std::pair<std::string, uint32_t>, bool> super_vtable_entries_;
+  // Method index to added access flags.
+  std::map<uint32_t, uint32_t> method_flags_;
+
+  DISALLOW_COPY_AND_ASSIGN(VerifierDeps);
+};
+
+// Makes verification running on the current thread record its dependencies into `deps`, which
+// may be null to stop recording, for example for a nested class verification.
+class ScopedVerifierDeps {
+ public:
+  ScopedVerifierDeps(Thread* self, VerifierDeps* deps);
+  ~ScopedVerifierDeps();
+
+ private:
+  Thread* const self_;
+  VerifierDeps* const previous_deps_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedVerifierDeps);
+};
+
+// On-disk cache of the runtime verification results of the classes of one dex file, so that
+// classes which had to be verified at runtime (for example with an interpret-only oat file or a
+// secondary dex file without one) are not verified again on every process start.
+//
+// The file starts with a header identifying the dex file by checksum and signature, a mismatch
+// discards the whole file. It is followed by a list of records, one per verified class, each
+// holding the class def index, the verification result and the VerifierDeps of the verification.
+// Records are only appended, so recording a result costs a single write under the file lock, and
+// a later record for a class replaces earlier ones. A record is used only if its dependencies
+// still hold, which is checked when the class is about to be verified. Hard failures are never
+// cached since the verifier has to run again to produce the error message.
+class VerificationCache {
+ public:
+  static const uint8_t kMagic[];
+  static const uint8_t kVersion[];
+
+  // Opens or creates the cache file of `dex_file` in `cache_dir`. Returns null on error.
+  static std::unique_ptr<VerificationCache> Open(const std::string& cache_dir,
+                                                 const DexFile& dex_file,
+                                                 std::string* error_msg);
+
+  // Name of the cache file of the dex file at `dex_location`.
+  static std::string GetCacheFilename(const std::string& cache_dir,
+                                      const std::string& dex_location);
+
+  ~VerificationCache();
+
+  // Returns true if the cache was opened for `dex_file`, and not for another dex file at the same
+  // location.
+  bool IsFor(const DexFile& dex_file) const;
+
+  // Returns true and sets `kind` if a result for `klass` is cached and still valid. The method
+  // flags set by the verification are applied to `klass`.
+  bool Lookup(Thread* self, Handle<mirror::Class> klass, MethodVerifier::FailureKind* kind)
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!lock_);
+
+  // Caches the result of verifying the class `class_def_index`. Hard failures are ignored.
+  void Record(uint16_t class_def_index,
+              MethodVerifier::FailureKind kind,
+              std::unique_ptr<VerifierDeps> deps)
+      REQUIRES(!lock_);
+
+  size_t NumEntries() REQUIRES(!lock_);
+
+ private:
+  struct Entry {
+    MethodVerifier::FailureKind kind;
+    // Shared with lookups, which validate it without holding the lock.
+    std::shared_ptr<const VerifierDeps> deps;
+  };
+
+  VerificationCache(const std::vector<uint8_t>& header, File* file);
+
+  static std::vector<uint8_t> EncodeHeader(const DexFile& dex_file);
+  static void EncodeRecord(uint16_t class_def_index,
+                           const Entry& entry,
+                           std::vector<uint8_t>* buffer);
+
+  // Reads the records following the header, stopping at the first truncated or corrupt one.
+  // Returns the offset of the end of the last good record and sets `num_records` to the number
+  // of records read. Only called before the cache is published, so it does not need the lock.
+  size_t ReadRecords(const std::vector<uint8_t>& contents, size_t* num_records)
+      NO_THREAD_SAFETY_ANALYSIS;
+
+  // Replaces the contents of the file with the header and the current entries.
+  bool Rewrite() NO_THREAD_SAFETY_ANALYSIS;
+
+  const std::vector<uint8_t> header_;
+  Mutex lock_;
+  std::unique_ptr<File> file_ GUARDED_BY(lock_);
+  std::unordered_map<uint16_t, Entry> entries_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(VerificationCache);
+};
+
+}  // namespace verifier
+}  // namespace art
+
+#endif  // ART_RUNTIME_VERIFIER_VERIFICATION_CACHE_H_
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "verification_cache.h"
+
+#include <memory>
+
+#include "base/unix_file/fd_file.h"
+#include "class_linker-inl.h"
+#include "common_runtime_test.h"
+#include "dex_file.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "scoped_thread_state_change.h"
+
+namespace art {
+namespace verifier {
+
+class VerificationCacheTest : public CommonRuntimeTest {
+ protected:
+  // Loads Interfaces$A, which is not verified yet.
+  mirror::Class* LoadUnverifiedClass(ScopedObjectAccess& soa)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    StackHandleScope<1> hs(soa.Self());
+    Handle<mirror::ClassLoader> class_loader(
+        hs.NewHandle(soa.Decode<mirror::ClassLoader*>(LoadDex("Interfaces"))));
+    mirror::Class* klass = class_linker_->FindClass(soa.Self(), "LInterfaces$A;", class_loader);
+    EXPECT_TRUE(klass != nullptr);
+    EXPECT_FALSE(klass->IsVerified());
+    return klass;
+  }
+
+  std::unique_ptr<VerifierDeps> VerifyAndRecord(Thread* self, Handle<mirror::Class> klass)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    std::unique_ptr<VerifierDeps> deps(new VerifierDeps());
+    ScopedVerifierDeps scoped_deps(self, deps.get());
+    std::string error_msg;
+    MethodVerifier::FailureKind failure = MethodVerifier::VerifyClass(self,
+                                                                      klass.Get(),
+                                                                      nullptr,
+                                                                      true,
+                                                                      LogSeverity::WARNING,
+                                                                      &error_msg);
+    EXPECT_EQ(MethodVerifier::kNoFailure, failure) << error_msg;
+    return deps;
+  }
+};
+
+TEST_F(VerificationCacheTest, RecordsDependencies) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::Class> klass(hs.NewHandle(LoadUnverifiedClass(soa)));
+  ASSERT_TRUE(klass.Get() != nullptr);
+
+  std::unique_ptr<VerifierDeps> deps = VerifyAndRecord(soa.Self(), klass);
+  EXPECT_NE(0u, deps->Size());
+  EXPECT_TRUE(deps->Validate(soa.Self(), klass));
+
+  std::vector<uint8_t> buffer;
+  deps->Encode(&buffer);
+  VerifierDeps decoded;
+  const uint8_t* data = buffer.data();
+  ASSERT_TRUE(decoded.Decode(&data, buffer.data() + buffer.size()));
+  EXPECT_EQ(buffer.data() + buffer.size(), data);
+  EXPECT_EQ(deps->Size(), decoded.Size());
+  EXPECT_TRUE(decoded.Validate(soa.Self(), klass));
+
+  // Truncated data is rejected.
+  VerifierDeps truncated;
+  data = buffer.data();
+  EXPECT_FALSE(truncated.Decode(&data, buffer.data() + buffer.size() - 1));
+}
+
+TEST_F(VerificationCacheTest, RecordsInvokeSuperDependencies) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::ClassLoader> class_loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader*>(LoadDex("Transaction"))));
+  // The finalizer of AbortHelperClass calls super.finalize().
+  Handle<mirror::Class> klass(hs.NewHandle(class_linker_->FindClass(
+      soa.Self(), "LTransaction$AbortHelperClass;", class_loader)));
+  ASSERT_TRUE(klass.Get() != nullptr);
+  ASSERT_FALSE(klass->IsVerified());
+
+  std::unique_ptr<VerifierDeps> deps = VerifyAndRecord(soa.Self(), klass);
+  EXPECT_TRUE(deps->Validate(soa.Self(), klass));
+
+  std::vector<uint8_t> buffer;
+  deps->Encode(&buffer);
+  VerifierDeps decoded;
+  const uint8_t* data = buffer.data();
+  ASSERT_TRUE(decoded.Decode(&data, buffer.data() + buffer.size()));
+  EXPECT_EQ(deps->Size(), decoded.Size());
+  EXPECT_TRUE(decoded.Validate(soa.Self(), klass));
+
+  // The vtable entry of the super class for the invoked method is a dependency of its own.
+  const DexFile& dex_file = klass->GetDexFile();
+  const DexFile::TypeId* object_type_id = dex_file.FindTypeId("Ljava/lang/Object;");
+  const DexFile::TypeId* void_type_id = dex_file.FindTypeId("V");
+  const DexFile::StringId* name_id = dex_file.FindStringId("finalize");
+  ASSERT_TRUE(object_type_id != nullptr && void_type_id != nullptr && name_id != nullptr);
+  const DexFile::ProtoId* proto_id =
+      dex_file.FindProtoId(dex_file.GetIndexForTypeId(*void_type_id), nullptr, 0u);
+  ASSERT_TRUE(proto_id != nullptr);
+  const DexFile::MethodId* method_id = dex_file.FindMethodId(*object_type_id, *name_id, *proto_id);
+  ASSERT_TRUE(method_id != nullptr);
+  const uint32_t method_idx = dex_file.GetIndexForMethodId(*method_id);
+  VerifierDeps valid_deps;
+  valid_deps.AddSuperVTableEntry(klass->GetSuperClass(), method_idx, true);
+  EXPECT_TRUE(valid_deps.Validate(soa.Self(), klass));
+  VerifierDeps stale_deps;
+  stale_deps.AddSuperVTableEntry(klass->GetSuperClass(), method_idx, false);
+  EXPECT_FALSE(stale_deps.Validate(soa.Self(), klass));
+}
+
+TEST_F(VerificationCacheTest, PersistsResults) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::Class> klass(hs.NewHandle(LoadUnverifiedClass(soa)));
+  ASSERT_TRUE(klass.Get() != nullptr);
+  const DexFile& dex_file = klass->GetDexFile();
+  const std::string filename =
+      VerificationCache::GetCacheFilename(android_data_, dex_file.GetLocation());
+
+  std::string error_msg;
+  std::unique_ptr<VerificationCache> cache =
+      VerificationCache::Open(android_data_, dex_file, &error_msg);
+  ASSERT_TRUE(cache != nullptr) << error_msg;
+  EXPECT_TRUE(cache->IsFor(dex_file));
+  EXPECT_EQ(0u, cache->NumEntries());
+  cache->Record(klass->GetDexClassDefIndex(),
+                MethodVerifier::kNoFailure,
+                VerifyAndRecord(soa.Self(), klass));
+  // Hard failures are not cached.
+  cache->Record(klass->GetDexClassDefIndex() + 1u,
+                MethodVerifier::kHardFailure,
+                std::unique_ptr<VerifierDeps>(new VerifierDeps()));
+  cache.reset();
+
+  cache = VerificationCache::Open(android_data_, dex_file, &error_msg);
+  ASSERT_TRUE(cache != nullptr) << error_msg;
+  EXPECT_EQ(1u, cache->NumEntries());
+  MethodVerifier::FailureKind kind = MethodVerifier::kHardFailure;
+  EXPECT_TRUE(cache->Lookup(soa.Self(), klass, &kind));
+  EXPECT_EQ(MethodVerifier::kNoFailure, kind);
+  cache.reset();
+
+  // A partially written record is dropped.
+  std::unique_ptr<File> file(OS::OpenFileReadWrite(filename.c_str()));
+  ASSERT_TRUE(file != nullptr);
+  const int64_t length = file->GetLength();
+  const uint8_t garbage[] = { 0xff, 0x00, 0x00 };
+  ASSERT_TRUE(file->PwriteFully(garbage, sizeof(garbage), length));
+  ASSERT_EQ(0, file->FlushClose());
+  cache = VerificationCache::Open(android_data_, dex_file, &error_msg);
+  ASSERT_TRUE(cache != nullptr) << error_msg;
+  EXPECT_EQ(1u, cache->NumEntries());
+  cache.reset();
+  EXPECT_EQ(length, GetFileSizeBytes(filename));
+
+  // A cache with a different header is discarded.
+  file.reset(OS::OpenFileReadWrite(filename.c_str()));
+  ASSERT_TRUE(file != nullptr);
+  ASSERT_TRUE(file->PwriteFully(garbage, sizeof(garbage), 0));
+  ASSERT_EQ(0, file->FlushClose());
+  cache = VerificationCache::Open(android_data_, dex_file, &error_msg);
+  ASSERT_TRUE(cache != nullptr) << error_msg;
+  EXPECT_EQ(0u, cache->NumEntries());
+  cache.reset();
+
+  ASSERT_EQ(0, unlink(filename.c_str()));
+}
+
+}  // namespace verifier
+}  // namespace art
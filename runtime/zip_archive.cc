@@ -23,6 +23,7 @@
 #include <unistd.h>
 #include <vector>
 
+#include "base/bit_utils.h"
 #include "base/stringprintf.h"
 #include "base/unix_file/fd_file.h"
 
@@ -36,6 +37,15 @@ uint32_t ZipEntry::GetCrc32() {
   return zip_entry_->crc32;
 }
 
+bool ZipEntry::IsUncompressed() {
+  return zip_entry_->method == kCompressStored;
+}
+
+bool ZipEntry::IsAlignedTo(size_t alignment) {
+  DCHECK(IsPowerOfTwo(alignment)) << alignment;
+  return IsAlignedParam(zip_entry_->offset, static_cast<int>(alignment));
+}
+
 ZipEntry::~ZipEntry() {
   delete zip_entry_;
 }
@@ -74,6 +84,46 @@ MemMap* ZipEntry::ExtractToMemMap(const char* zip_filename, const char* entry_fi
   return map.release();
 }
 
+MemMap* ZipEntry::MapDirectlyFromFile(const char* zip_filename, const char* entry_filename,
+                                      std::string* error_msg) {
+  const int zip_fd = GetFileDescriptor(handle_);
+  if (zip_fd < 0) {
+    *error_msg = StringPrintf("Cannot map '%s' from '%s' directly: the zip archive is not file "
+                              "backed", entry_filename, zip_filename);
+    return nullptr;
+  }
+  if (!IsUncompressed()) {
+    *error_msg = StringPrintf("Cannot map '%s' from '%s' directly: the entry is compressed",
+                              entry_filename, zip_filename);
+    return nullptr;
+  }
+  if (zip_entry_->compressed_length != zip_entry_->uncompressed_length) {
+    *error_msg = StringPrintf("Cannot map '%s' from '%s' directly: the entry has a bad size "
+                              "(%u != %u)", entry_filename, zip_filename,
+                              zip_entry_->compressed_length, zip_entry_->uncompressed_length);
+    return nullptr;
+  }
+
+  std::string name(entry_filename);
+  name += " mapped directly in memory from ";
+  name += zip_filename;
+  // MapFile maps the enclosing pages if the entry does not start at a page boundary.
+  std::unique_ptr<MemMap> map(MemMap::MapFile(GetUncompressedLength(),
+                                              PROT_READ,
+                                              MAP_PRIVATE,
+                                              zip_fd,
+                                              zip_entry_->offset,
+                                              false,
+                                              name.c_str(),
+                                              error_msg));
+  if (map.get() == nullptr) {
+    DCHECK(!error_msg->empty());
+    return nullptr;
+  }
+
+  return map.release();
+}
+
 static void SetCloseOnExec(int fd) {
   // This dance is more portable than Linux's O_CLOEXEC open(2) flag.
   int flags = fcntl(fd, F_GETFD);
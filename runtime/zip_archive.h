@@ -39,11 +39,20 @@ class ZipEntry {
   bool ExtractToFile(File& file, std::string* error_msg);
   MemMap* ExtractToMemMap(const char* zip_filename, const char* entry_filename,
                           std::string* error_msg);
+  // Maps a stored (uncompressed) entry read only, straight from the zip file. Unlike the copy made
+  // by ExtractToMemMap, the pages are clean, demand paged and shared with other processes mapping
+  // the same file.
+  MemMap* MapDirectlyFromFile(const char* zip_filename, const char* entry_filename,
+                              std::string* error_msg);
   virtual ~ZipEntry();
 
   uint32_t GetUncompressedLength();
   uint32_t GetCrc32();
 
+  bool IsUncompressed();
+  // Whether the data of the entry starts at an offset in the zip file aligned to `alignment`.
+  bool IsAlignedTo(size_t alignment);
+
  private:
   ZipEntry(ZipArchiveHandle handle,
            ::ZipEntry* zip_entry) : handle_(handle), zip_entry_(zip_entry) {}
@@ -21,6 +21,7 @@
 #include <sys/types.h>
 #include <zlib.h>
 #include <memory>
+#include <vector>
 
 #include "base/unix_file/fd_file.h"
 #include "common_runtime_test.h"
@@ -63,4 +64,104 @@ TEST_F(ZipArchiveTest, FindAndExtract) {
   EXPECT_EQ(zip_entry->GetCrc32(), computed_crc);
 }
 
+static void AppendU2(std::vector<uint8_t>* out, uint16_t value) {
+  out->push_back(static_cast<uint8_t>(value));
+  out->push_back(static_cast<uint8_t>(value >> 8));
+}
+
+static void AppendU4(std::vector<uint8_t>* out, uint32_t value) {
+  AppendU2(out, static_cast<uint16_t>(value));
+  AppendU2(out, static_cast<uint16_t>(value >> 16));
+}
+
+// Writes a zip file with one stored entry whose data starts at `data_offset`.
+static void WriteStoredZip(File* file,
+                           const char* name,
+                           const std::vector<uint8_t>& data,
+                           size_t data_offset) {
+  const size_t kLocalHeaderSize = 30;
+  const uint16_t name_length = strlen(name);
+  ASSERT_GE(data_offset, kLocalHeaderSize + name_length);
+  const uint32_t crc = crc32(crc32(0L, Z_NULL, 0), data.data(), data.size());
+  std::vector<uint8_t> zip;
+  // Local file header, padded with an extra field up to the data.
+  AppendU4(&zip, 0x04034b50);
+  AppendU2(&zip, 10);  // Version needed.
+  AppendU2(&zip, 0);  // Flags.
+  AppendU2(&zip, 0);  // Stored.
+  AppendU4(&zip, 0);  // Modification time and date.
+  AppendU4(&zip, crc);
+  AppendU4(&zip, data.size());
+  AppendU4(&zip, data.size());
+  AppendU2(&zip, name_length);
+  AppendU2(&zip, data_offset - kLocalHeaderSize - name_length);
+  zip.insert(zip.end(), name, name + name_length);
+  zip.resize(data_offset, 0);
+  zip.insert(zip.end(), data.begin(), data.end());
+  // Central directory.
+  const uint32_t central_directory_offset = zip.size();
+  AppendU4(&zip, 0x02014b50);
+  AppendU2(&zip, 10);  // Version made by.
+  AppendU2(&zip, 10);  // Version needed.
+  AppendU2(&zip, 0);  // Flags.
+  AppendU2(&zip, 0);  // Stored.
+  AppendU4(&zip, 0);  // Modification time and date.
+  AppendU4(&zip, crc);
+  AppendU4(&zip, data.size());
+  AppendU4(&zip, data.size());
+  AppendU2(&zip, name_length);
+  AppendU2(&zip, 0);  // Extra field length.
+  AppendU2(&zip, 0);  // Comment length.
+  AppendU2(&zip, 0);  // Disk number.
+  AppendU2(&zip, 0);  // Internal attributes.
+  AppendU4(&zip, 0);  // External attributes.
+  AppendU4(&zip, 0);  // Local header offset.
+  zip.insert(zip.end(), name, name + name_length);
+  const uint32_t central_directory_size = zip.size() - central_directory_offset;
+  // End of central directory.
+  AppendU4(&zip, 0x06054b50);
+  AppendU2(&zip, 0);  // Disk number.
+  AppendU2(&zip, 0);  // Central directory disk.
+  AppendU2(&zip, 1);  // Entries on this disk.
+  AppendU2(&zip, 1);  // Total entries.
+  AppendU4(&zip, central_directory_size);
+  AppendU4(&zip, central_directory_offset);
+  AppendU2(&zip, 0);  // Comment length.
+  ASSERT_TRUE(file->WriteFully(zip.data(), zip.size()));
+  ASSERT_EQ(0, file->Flush());
+}
+
+TEST_F(ZipArchiveTest, MapDirectlyFromFile) {
+  std::vector<uint8_t> data(3 * kPageSize + 17);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i * 7);
+  }
+  // Page aligned and only word aligned data.
+  for (size_t data_offset : { static_cast<size_t>(kPageSize), static_cast<size_t>(64) }) {
+    ScratchFile tmp;
+    WriteStoredZip(tmp.GetFile(), "classes.dex", data, data_offset);
+    std::string error_msg;
+    std::unique_ptr<ZipArchive> zip_archive(ZipArchive::Open(tmp.GetFilename().c_str(),
+                                                             &error_msg));
+    ASSERT_TRUE(zip_archive.get() != nullptr) << error_msg;
+    std::unique_ptr<ZipEntry> zip_entry(zip_archive->Find("classes.dex", &error_msg));
+    ASSERT_TRUE(zip_entry.get() != nullptr) << error_msg;
+    EXPECT_TRUE(zip_entry->IsUncompressed());
+    EXPECT_TRUE(zip_entry->IsAlignedTo(4));
+    EXPECT_EQ(data_offset == static_cast<size_t>(kPageSize), zip_entry->IsAlignedTo(kPageSize));
+
+    std::unique_ptr<MemMap> map(zip_entry->MapDirectlyFromFile(tmp.GetFilename().c_str(),
+                                                               "classes.dex",
+                                                               &error_msg));
+    ASSERT_TRUE(map.get() != nullptr) << error_msg;
+    ASSERT_EQ(data.size(), map->Size());
+    EXPECT_EQ(0, memcmp(data.data(), map->Begin(), data.size()));
+    std::unique_ptr<MemMap> extracted(zip_entry->ExtractToMemMap(tmp.GetFilename().c_str(),
+                                                                 "classes.dex",
+                                                                 &error_msg));
+    ASSERT_TRUE(extracted.get() != nullptr) << error_msg;
+    EXPECT_EQ(0, memcmp(extracted->Begin(), map->Begin(), data.size()));
+  }
+}
+
 }  // namespace art
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.io.File;
+import java.io.IOException;
+import java.lang.reflect.Method;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.Map;
+
+public class Main {
+    private static final String TEMP_FILE_NAME_PREFIX = "test";
+    private static final String TEMP_FILE_NAME_SUFFIX = ".trace";
+    private static final int NUM_RUNNING_THREADS = 4;
+    private static final int SAMPLING_INTERVAL_US = 100;
+    private static final int TRACING_TIME_MS = 500;
+
+    private static final Object lock = new Object();
+    private static volatile boolean stop = false;
+
+    public static void main(String[] args) throws Exception {
+        String name = System.getProperty("java.vm.name");
+        if (!"Dalvik".equals(name)) {
+            System.out.println("This test is not supported on " + name);
+            return;
+        }
+        File file = createTempFile();
+        try {
+            ArrayList<Thread> threads = new ArrayList<Thread>();
+            // Runnable threads record their own samples in the checkpoint.
+            for (int i = 0; i < NUM_RUNNING_THREADS; ++i) {
+                threads.add(new Thread() {
+                    public void run() {
+                        while (!stop) {
+                            doWork();
+                        }
+                    }
+                });
+            }
+            // Suspended threads are not sampled, their previous sample stays current.
+            threads.add(new Thread() {
+                public void run() {
+                    synchronized (lock) {
+                        // Blocked until the main thread releases the lock.
+                    }
+                }
+            });
+            threads.add(new Thread() {
+                public void run() {
+                    while (!stop) {
+                        try {
+                            Thread.sleep(1);
+                        } catch (InterruptedException e) {
+                            throw new RuntimeException(e);
+                        }
+                    }
+                }
+            });
+
+            synchronized (lock) {
+                for (Thread thread : threads) {
+                    thread.start();
+                }
+                // When running the test in trace mode, there is already a trace running.
+                if (VMDebug.getMethodTracingMode() != 0) {
+                    VMDebug.stopMethodTracing();
+                }
+                VMDebug.startMethodTracing(file.getPath(), 0, 0, true, SAMPLING_INTERVAL_US);
+                Thread.sleep(TRACING_TIME_MS);
+                VMDebug.stopMethodTracing();
+            }
+            stop = true;
+            for (Thread thread : threads) {
+                thread.join();
+            }
+            if (file.length() == 0) {
+                System.out.println("Empty trace file");
+            }
+            System.out.println("Done");
+        } finally {
+            file.delete();
+        }
+    }
+
+    private static File createTempFile() throws Exception {
+        try {
+            return File.createTempFile(TEMP_FILE_NAME_PREFIX, TEMP_FILE_NAME_SUFFIX);
+        } catch (IOException e) {
+            System.setProperty("java.io.tmpdir", "/data/local/tmp");
+            try {
+                return File.createTempFile(TEMP_FILE_NAME_PREFIX, TEMP_FILE_NAME_SUFFIX);
+            } catch (IOException e2) {
+                System.setProperty("java.io.tmpdir", "/sdcard");
+                return File.createTempFile(TEMP_FILE_NAME_PREFIX, TEMP_FILE_NAME_SUFFIX);
+            }
+        }
+    }
+
+    private static void doWork() {
+        Map<String, String> map = new HashMap<String, String>();
+        for (int i = 0; i < 100; ++i) {
+            map.put(Integer.toString(i), "foo");
+        }
+        map.clear();
+    }
+
+    private static class VMDebug {
+        private static final Method startMethodTracingMethod;
+        private static final Method stopMethodTracingMethod;
+        private static final Method getMethodTracingModeMethod;
+        static {
+            try {
+                Class<?> c = Class.forName("dalvik.system.VMDebug");
+                startMethodTracingMethod = c.getDeclaredMethod("startMethodTracing", String.class,
+                        Integer.TYPE, Integer.TYPE, Boolean.TYPE, Integer.TYPE);
+                stopMethodTracingMethod = c.getDeclaredMethod("stopMethodTracing");
+                getMethodTracingModeMethod = c.getDeclaredMethod("getMethodTracingMode");
+            } catch (Exception e) {
+                throw new RuntimeException(e);
+            }
+        }
+
+        public static void startMethodTracing(String filename, int bufferSize, int flags,
+                boolean samplingEnabled, int intervalUs) throws Exception {
+            startMethodTracingMethod.invoke(null, filename, bufferSize, flags, samplingEnabled,
+                    intervalUs);
+        }
+        public static void stopMethodTracing() throws Exception {
+            stopMethodTracingMethod.invoke(null);
+        }
+        public static int getMethodTracingMode() throws Exception {
+            return (int) getMethodTracingModeMethod.invoke(null);
+        }
+    }
+}